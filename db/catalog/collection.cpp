@@ -359,6 +359,8 @@ Status Collection::insertDocuments(OperationContext* txn,
     if (_mustTakeCappedLockOnInsert)
         synchronizeOnCappedInFlightResource(txn->lockState(), _ns);
 
+    _infoCache.notifyOfWrite(txn);
+
     Status status = _insertDocuments(txn, begin, end, enforceQuota);
     if (!status.isOK())
         return status;
@@ -395,6 +397,8 @@ Status Collection::insertDocument(OperationContext* txn,
     if (_mustTakeCappedLockOnInsert)
         synchronizeOnCappedInFlightResource(txn->lockState(), _ns);
 
+    _infoCache.notifyOfWrite(txn);
+
     StatusWith<RecordId> loc =
         _recordStore->insertRecord(txn, doc.objdata(), doc.objsize(), _enforceQuota(enforceQuota));
 
@@ -472,6 +476,7 @@ Status Collection::aboutToDeleteCapped(OperationContext* txn,
                                        RecordData data) {
     /* check if any cursors point to us.  if so, advance them. */
     _cursorManager.invalidateDocument(txn, loc, INVALIDATION_DELETION);
+    _infoCache.notifyOfWrite(txn);
 
     BSONObj doc = data.releaseToBson();
     _indexCatalog.unindexRecord(txn, doc, loc, false);
@@ -494,6 +499,7 @@ void Collection::deleteDocument(
 
     /* check if any cursors point to us.  if so, advance them. */
     _cursorManager.invalidateDocument(txn, loc, INVALIDATION_DELETION);
+    _infoCache.notifyOfWrite(txn);
 
     _indexCatalog.unindexRecord(txn, doc.value(), loc, noWarn);
 
@@ -560,6 +566,8 @@ StatusWith<RecordId> Collection::updateDocument(OperationContext* txn,
                 str::stream() << "Cannot change the size of a document in a capped collection: "
                               << oldSize << " != " << newDoc.objsize()};
 
+    _infoCache.notifyOfWrite(txn);
+
     // At the end of this step, we will have a map of UpdateTickets, one per index, which
     // represent the index updates needed to be done, based on the changes between oldDoc and
     // newDoc.
@@ -687,6 +695,7 @@ StatusWith<RecordData> Collection::updateDocumentWithDamages(
 
     // Broadcast the mutation so that query results stay correct.
     _cursorManager.invalidateDocument(txn, loc, INVALIDATION_MUTATION);
+    _infoCache.notifyOfWrite(txn);
 
     auto newRecStatus =
         _recordStore->updateWithDamages(txn, loc, oldRec.value(), damageSource, damages);
@@ -803,6 +812,7 @@ void Collection::temp_cappedTruncateAfter(OperationContext* txn, RecordId end, b
     invariant(_indexCatalog.numIndexesInProgress(txn) == 0);
 
     _cursorManager.invalidateAll(false, "capped collection truncated");
+    _infoCache.notifyOfWrite(txn);
     _recordStore->temp_cappedTruncateAfter(txn, end, inclusive);
 }
 
@@ -42,16 +42,44 @@
 #include "mongo/db/query/plan_cache.h"
 #include "mongo/db/query/planner_ixselect.h"
 #include "mongo/db/service_context.h"
+#include "mongo/db/storage/recovery_unit.h"
 #include "mongo/util/clock_source.h"
 #include "mongo/util/debug_util.h"
 #include "mongo/util/log.h"
 
 namespace mongo {
 
+namespace {
+
+/**
+ * Drops the cached text search results again once a write is committed or rolled back, so that
+ * no search that read the collection while the write was in progress leaves its results behind.
+ */
+class InvalidateTextResultCacheChange final : public RecoveryUnit::Change {
+public:
+    explicit InvalidateTextResultCacheChange(std::shared_ptr<TextResultCache> cache)
+        : _cache(std::move(cache)) {}
+
+    void commit() final {
+        _cache->invalidate();
+    }
+
+    void rollback() final {
+        _cache->invalidate();
+    }
+
+private:
+    const std::shared_ptr<TextResultCache> _cache;
+};
+
+}  // namespace
+
 CollectionInfoCache::CollectionInfoCache(Collection* collection)
     : _collection(collection),
       _keysComputed(false),
       _planCache(new PlanCache(collection->ns().ns())),
+      _textResultCache(std::make_shared<TextResultCache>()),
+      _hasTextIndex(false),
       _querySettings(new QuerySettings()),
       _indexUsageTracker(getGlobalServiceContext()->getClockSource()) {}
 
@@ -65,6 +93,7 @@ const UpdateIndexData& CollectionInfoCache::getIndexKeys(OperationContext* txn)
 
 void CollectionInfoCache::computeIndexKeys(OperationContext* txn) {
     _indexedPaths.clear();
+    _hasTextIndex = false;
 
     IndexCatalog::IndexIterator i = _collection->getIndexCatalog()->getIndexIterator(txn, true);
     while (i.more()) {
@@ -78,6 +107,7 @@ void CollectionInfoCache::computeIndexKeys(OperationContext* txn) {
                 _indexedPaths.addPath(e.fieldName());
             }
         } else {
+            _hasTextIndex = true;
             fts::FTSSpec ftsSpec(descriptor->infoObj());
 
             if (ftsSpec.wildcard()) {
@@ -132,6 +162,17 @@ void CollectionInfoCache::clearQueryCache() {
     if (NULL != _planCache.get()) {
         _planCache->clear();
     }
+    _textResultCache->invalidate();
+}
+
+void CollectionInfoCache::notifyOfWrite(OperationContext* txn) {
+    dassert(txn->lockState()->isCollectionLockedForMode(_collection->ns().ns(), MODE_IX));
+    if (!_hasTextIndex) {
+        return;
+    }
+
+    _textResultCache->invalidate();
+    txn->recoveryUnit()->registerChange(new InvalidateTextResultCacheChange(_textResultCache));
 }
 
 PlanCache* CollectionInfoCache::getPlanCache() const {
@@ -142,6 +183,10 @@ QuerySettings* CollectionInfoCache::getQuerySettings() const {
     return _querySettings.get();
 }
 
+TextResultCache* CollectionInfoCache::getTextResultCache() const {
+    return _textResultCache.get();
+}
+
 void CollectionInfoCache::updatePlanCacheIndexEntries(OperationContext* txn) {
     std::vector<IndexEntry> indexEntries;
 
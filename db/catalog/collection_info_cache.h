@@ -33,6 +33,7 @@
 #include "mongo/db/collection_index_usage_tracker.h"
 #include "mongo/db/query/plan_cache.h"
 #include "mongo/db/query/query_settings.h"
+#include "mongo/db/query/text_result_cache.h"
 #include "mongo/db/update_index_data.h"
 
 namespace mongo {
@@ -59,6 +60,11 @@ public:
      */
     QuerySettings* getQuerySettings() const;
 
+    /**
+     * Get the TextResultCache for this collection.
+     */
+    TextResultCache* getTextResultCache() const;
+
     /* get set of index keys for this namespace.  handy to quickly check if a given
        field is indexed (Note it might be a secondary component of a compound index.)
     */
@@ -95,10 +101,18 @@ public:
     void droppedIndex(OperationContext* txn, StringData indexName);
 
     /**
-     * Removes all cached query plans.
+     * Removes all cached query plans and text search results.
      */
     void clearQueryCache();
 
+    /**
+     * Signal to the cache that 'txn' is writing a document of the collection.  Cached text
+     * search results are dropped now and again when the write commits or rolls back.
+     *
+     * Must be called under at least an intent exclusive collection lock.
+     */
+    void notifyOfWrite(OperationContext* txn);
+
     /**
      * Signal to the cache that a query operation has completed.  'indexesUsed' should list the
      * set of indexes used by the winning plan, if any.
@@ -115,6 +129,14 @@ private:
     // A cache for query plans.
     std::unique_ptr<PlanCache> _planCache;
 
+    // A cache for text search results.  Shared with the changes registered by notifyOfWrite,
+    // which may outlive the collection.
+    std::shared_ptr<TextResultCache> _textResultCache;
+
+    // Whether the collection has a text index, and so whether writes must invalidate
+    // _textResultCache.
+    bool _hasTextIndex;
+
     // Query settings.
     // Includes index filters.
     std::unique_ptr<QuerySettings> _querySettings;
@@ -90,6 +90,20 @@ public:
      */
     static void destroy();
 
+    /**
+     * Moves the Client stored in TLS for the current thread out of TLS and returns it, leaving the
+     * thread without a Client. The current thread must have a Client.
+     *
+     * Together with setCurrent() this lets a pool of worker threads serve many connections, each
+     * keeping its Client between messages.
+     */
+    static ServiceContext::UniqueClient releaseCurrent();
+
+    /**
+     * Stores 'client' in TLS for the current thread, which must not already have a Client.
+     */
+    static void setCurrent(ServiceContext::UniqueClient client);
+
     std::string clientAddress(bool includePort = false) const;
     const std::string& desc() const {
         return _desc;
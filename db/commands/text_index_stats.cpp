@@ -0,0 +1,213 @@
+/**
+ *    Copyright (C) 2016 MongoDB Inc.
+ *
+ *    This program is free software: you can redistribute it and/or  modify
+ *    it under the terms of the GNU Affero General Public License, version 3,
+ *    as published by the Free Software Foundation.
+ *
+ *    This program is distributed in the hope that it will be useful,
+ *    but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *    GNU Affero General Public License for more details.
+ *
+ *    You should have received a copy of the GNU Affero General Public License
+ *    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ *    As a special exception, the copyright holders give permission to link the
+ *    code of portions of this program with the OpenSSL library under certain
+ *    conditions as described in each individual source file and distribute
+ *    linked combinations including the program with the OpenSSL library. You
+ *    must comply with the GNU Affero General Public License in all respects for
+ *    all of the code used other than as permitted herein. If you modify file(s)
+ *    with this exception, you may extend this exception to your version of the
+ *    file(s), but you are not obligated to do so. If you do not wish to do so,
+ *    delete this exception statement from your version. If you delete this
+ *    exception statement from all source files in the program, then also delete
+ *    it in the license file.
+ */
+#include "mongo/platform/basic.h"
+
+#include <string>
+#include <vector>
+
+#include "mongo/db/auth/action_set.h"
+#include "mongo/db/auth/action_type.h"
+#include "mongo/db/auth/privilege.h"
+#include "mongo/db/catalog/collection.h"
+#include "mongo/db/catalog/index_catalog.h"
+#include "mongo/db/commands.h"
+#include "mongo/db/db_raii.h"
+#include "mongo/db/fts/fts_term_stats.h"
+#include "mongo/db/index/fts_access_method.h"
+#include "mongo/db/index_names.h"
+#include "mongo/db/jsobj.h"
+#include "mongo/util/mongoutils/str.h"
+
+namespace mongo {
+
+using std::string;
+using std::stringstream;
+using std::vector;
+
+namespace {
+
+/**
+ * Finds the text index 'indexName' of 'collection', or its only text index if 'indexName' is
+ * empty.
+ */
+Status findTextIndex(OperationContext* txn,
+                     Collection* collection,
+                     const string& indexName,
+                     FTSAccessMethod** out) {
+    if (!collection) {
+        return Status(ErrorCodes::NamespaceNotFound, "no collection");
+    }
+
+    IndexCatalog* catalog = collection->getIndexCatalog();
+    IndexDescriptor* desc = nullptr;
+    if (indexName.empty()) {
+        vector<IndexDescriptor*> indexes;
+        catalog->findIndexByType(txn, IndexNames::TEXT, indexes);
+        if (indexes.size() != 1) {
+            return Status(ErrorCodes::IndexNotFound,
+                          str::stream() << "expected one text index, found " << indexes.size()
+                                        << "; pick one with the 'index' field");
+        }
+        desc = indexes[0];
+    } else {
+        desc = catalog->findIndexByName(txn, indexName);
+        if (!desc || desc->getAccessMethodName() != IndexNames::TEXT) {
+            return Status(ErrorCodes::IndexNotFound,
+                          str::stream() << "no text index named " << indexName);
+        }
+    }
+
+    *out = static_cast<FTSAccessMethod*>(catalog->getIndex(desc));
+    if (!(*out)->getTermStats()) {
+        return Status(ErrorCodes::BadValue,
+                      str::stream() << "text index " << desc->indexName()
+                                    << " keeps no term statistics");
+    }
+    return Status::OK();
+}
+
+void appendTermStats(OperationContext* txn,
+                     Collection* collection,
+                     const FTSAccessMethod* fam,
+                     const BSONObj& cmdObj,
+                     BSONObjBuilder* result) {
+    const fts::FTSTermStats* stats = fam->getTermStats();
+    const long long numDocs = collection->numRecords(txn);
+
+    result->append("numDocs", numDocs);
+    result->appendNumber("numTerms", static_cast<long long>(stats->numTerms()));
+
+    BSONElement terms = cmdObj["terms"];
+    if (terms.type() != Array) {
+        return;
+    }
+
+    BSONArrayBuilder termsBuilder(result->subarrayStart("terms"));
+    for (const auto& elt : terms.Obj()) {
+        const string term = elt.str();
+        fts::FTSTermStats::TermStats termStats = stats->get(term);
+
+        BSONObjBuilder termBuilder(termsBuilder.subobjStart());
+        termBuilder.append("term", term);
+        termBuilder.append("df", termStats.docFreq);
+        termBuilder.append("cf", termStats.weightSum);
+        termBuilder.append("maxWeight", termStats.maxWeight);
+        termBuilder.append("idf", fts::FTSTermStats::idf(termStats.docFreq, numDocs));
+        termBuilder.doneFast();
+    }
+    termsBuilder.doneFast();
+}
+
+}  // namespace
+
+/**
+ * Reports the term statistics of a text index.
+ *
+ * Format:
+ * {
+ *   textIndexStats: <collection name>,
+ *   index: <index name>,           // optional if the collection has one text index
+ *   terms: [<index term>, ...]     // optional, stemmed as in the index
+ * }
+ *
+ * Return format:
+ * {
+ *   numDocs: <documents in the collection>,
+ *   numTerms: <distinct terms in the index>,
+ *   terms: [ { term: <term>, df: <documents>, cf: <sum of scores>, maxWeight: <top score>,
+ *              idf: <BM25 idf> }, ... ]
+ * }
+ */
+class CmdTextIndexStats : public Command {
+public:
+    virtual bool slaveOk() const {
+        return true;
+    }
+    virtual bool adminOnly() const {
+        return false;
+    }
+    virtual bool isWriteCommandForConfigServer() const {
+        return false;
+    }
+    virtual void help(stringstream& help) const {
+        help << "term statistics of a text index\n"
+                "{ textIndexStats : <collection_name>, [index : <index_name>], "
+                "[terms : [<term>, ...]] }\n";
+    }
+    virtual void addRequiredPrivileges(const std::string& dbname,
+                                       const BSONObj& cmdObj,
+                                       std::vector<Privilege>* out) {
+        ActionSet actions;
+        actions.addAction(ActionType::indexStats);
+        out->push_back(Privilege(parseResourcePattern(dbname, cmdObj), actions));
+    }
+
+    CmdTextIndexStats() : Command("textIndexStats") {}
+
+    bool run(OperationContext* txn,
+             const string& dbname,
+             BSONObj& cmdObj,
+             int,
+             string& errmsg,
+             BSONObjBuilder& result) {
+        const NamespaceString ns(parseNsCollectionRequired(dbname, cmdObj));
+        const string indexName = cmdObj["index"].str();
+
+        {
+            AutoGetCollectionForRead autoColl(txn, ns);
+            FTSAccessMethod* fam;
+            Status status = findTextIndex(txn, autoColl.getCollection(), indexName, &fam);
+            if (!status.isOK()) {
+                return appendCommandStatus(result, status);
+            }
+            if (fam->getTermStats()->isSeeded()) {
+                appendTermStats(txn, autoColl.getCollection(), fam, cmdObj, &result);
+                return true;
+            }
+        }
+
+        // The statistics have not been counted since the index was opened: count them from the
+        // index once, with writers shut out so that no update is missed or counted twice.
+        AutoGetCollection autoColl(txn, ns, MODE_S);
+        FTSAccessMethod* fam;
+        Status status = findTextIndex(txn, autoColl.getCollection(), indexName, &fam);
+        if (!status.isOK()) {
+            return appendCommandStatus(result, status);
+        }
+        if (!fam->getTermStats()->isSeeded()) {
+            status = fam->seedTermStats(txn);
+            if (!status.isOK()) {
+                return appendCommandStatus(result, status);
+            }
+        }
+        appendTermStats(txn, autoColl.getCollection(), fam, cmdObj, &result);
+        return true;
+    }
+} cmdTextIndexStats;
+
+}  // namespace mongo
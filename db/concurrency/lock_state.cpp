@@ -43,6 +43,7 @@
 #include "mongo/util/debug_util.h"
 #include "mongo/util/log.h"
 #include "mongo/util/mongoutils/str.h"
+#include "mongo/util/time_support.h"
 
 namespace mongo {
 namespace {
@@ -247,6 +248,7 @@ void CondVarLockGrantNotification::notify(ResourceId resId, LockResult result) {
 
 namespace {
 TicketHolder* ticketHolders[LockModesCount] = {};
+TicketHolder* longRunningTicketHolders[LockModesCount] = {};
 }  // namespace
 
 
@@ -261,6 +263,13 @@ void Locker::setGlobalThrottling(class TicketHolder* reading, class TicketHolder
     ticketHolders[MODE_IX] = writing;
 }
 
+/* static */
+void Locker::setLongRunningThrottling(class TicketHolder* reading, class TicketHolder* writing) {
+    longRunningTicketHolders[MODE_S] = reading;
+    longRunningTicketHolders[MODE_IS] = reading;
+    longRunningTicketHolders[MODE_IX] = writing;
+}
+
 template <bool IsForMMAPV1>
 LockerImpl<IsForMMAPV1>::LockerImpl()
     : _id(idCounter.addAndFetch(1)), _wuowNestingLevel(0), _batchWriter(false) {}
@@ -306,7 +315,14 @@ LockResult LockerImpl<IsForMMAPV1>::lockGlobalBegin(LockMode mode) {
         auto holder = ticketHolders[mode];
         if (holder) {
             _clientState.store(reader ? kQueuedReader : kQueuedWriter);
+            // Long running operations first queue for their own share of the tickets.
+            auto longRunningHolder = _longRunning ? longRunningTicketHolders[mode] : nullptr;
+            if (longRunningHolder) {
+                longRunningHolder->waitForTicket();
+                _holdsLongRunningTicket = true;
+            }
             holder->waitForTicket();
+            _ticketAcquiredMicros = curTimeMicros64();
         }
         _clientState.store(reader ? kActiveReader : kActiveWriter);
         _modeForTicket = mode;
@@ -612,6 +628,7 @@ bool LockerImpl<IsForMMAPV1>::saveLockStateAndUnlock(Locker::LockSnapshot* state
     // Sort locks by ResourceId. They'll later be acquired in this canonical locking order.
     std::sort(stateOut->locks.begin(), stateOut->locks.end());
 
+    _longRunning = true;
     return true;
 }
 
@@ -788,9 +805,14 @@ bool LockerImpl<IsForMMAPV1>::_unlockImpl(LockRequestsMap::Iterator* it) {
         if (it->key() == resourceIdGlobal) {
             invariant(_modeForTicket != MODE_NONE);
             auto holder = ticketHolders[_modeForTicket];
+            auto longRunningHolder = longRunningTicketHolders[_modeForTicket];
             _modeForTicket = MODE_NONE;
             if (holder) {
-                holder->release();
+                holder->release(curTimeMicros64() - _ticketAcquiredMicros);
+            }
+            if (_holdsLongRunningTicket) {
+                longRunningHolder->release();
+                _holdsLongRunningTicket = false;
             }
             _clientState.store(kInactive);
         }
@@ -219,6 +219,16 @@ private:
     // Mode for which the Locker acquired a ticket, or MODE_NONE if no ticket was acquired.
     LockMode _modeForTicket = MODE_NONE;
 
+    // When the ticket for _modeForTicket was acquired, reported to the holder on release.
+    unsigned long long _ticketAcquiredMicros = 0;
+
+    // Set once saveLockStateAndUnlock has released locks, which makes this a long running
+    // operation for the purpose of ticket throttling.
+    bool _longRunning = false;
+
+    // Whether a long running ticket is held along with the ticket for _modeForTicket.
+    bool _holdsLongRunningTicket = false;
+
     // Indicates whether the client is active reader/writer or is queued.
     AtomicWord<ClientState> _clientState{kInactive};
 
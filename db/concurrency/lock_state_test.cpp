@@ -36,7 +36,9 @@
 #include "mongo/config.h"
 #include "mongo/db/concurrency/lock_manager_test_help.h"
 #include "mongo/unittest/unittest.h"
+#include "mongo/util/concurrency/ticketholder.h"
 #include "mongo/util/log.h"
+#include "mongo/util/scopeguard.h"
 #include "mongo/util/timer.h"
 
 namespace mongo {
@@ -161,6 +163,42 @@ TEST(LockerImpl, saveAndRestoreGlobal) {
     ASSERT(locker.unlockAll());
 }
 
+/**
+ * Test that a locker takes a long running ticket once it has yielded its locks.
+ */
+TEST(LockerImpl, LongRunningTicketAfterYield) {
+    TicketHolder reading(10);
+    TicketHolder writing(10);
+    TicketHolder longReading(5);
+    TicketHolder longWriting(5);
+    Locker::setGlobalThrottling(&reading, &writing);
+    Locker::setLongRunningThrottling(&longReading, &longWriting);
+    ON_BLOCK_EXIT([] {
+        Locker::setGlobalThrottling(nullptr, nullptr);
+        Locker::setLongRunningThrottling(nullptr, nullptr);
+    });
+
+    Locker::LockSnapshot lockInfo;
+    DefaultLockerImpl locker;
+
+    locker.lockGlobal(MODE_IS);
+    ASSERT_EQUALS(1, reading.used());
+    ASSERT_EQUALS(0, longReading.used());
+
+    // Yielding releases both tickets, restoring takes a long running one as well.
+    ASSERT(locker.saveLockStateAndUnlock(&lockInfo));
+    ASSERT_EQUALS(0, reading.used());
+    locker.restoreLockState(lockInfo);
+    ASSERT_EQUALS(1, reading.used());
+    ASSERT_EQUALS(1, longReading.used());
+    ASSERT_EQUALS(0, writing.used() + longWriting.used());
+
+    ASSERT(locker.unlockAll());
+    ASSERT_EQUALS(0, reading.used());
+    ASSERT_EQUALS(0, longReading.used());
+    ASSERT_EQUALS(2U, reading.getStats().released);
+}
+
 /**
  * Test that we don't unlock when we have the global lock more than once.
  */
@@ -57,6 +57,15 @@ public:
      */
     static void setGlobalThrottling(class TicketHolder* reading, class TicketHolder* writing);
 
+    /**
+     * Once a locker has released its locks through saveLockStateAndUnlock(), as queries do when
+     * they yield, it counts as long running. From then on its global lock attempts also obtain a
+     * ticket from 'reading' or 'writing' before the one set by setGlobalThrottling. Keeping these
+     * smaller than the main ones reserves the rest of the tickets for short operations, so that
+     * long scans cannot starve point reads. Must have static lifetimes.
+     */
+    static void setLongRunningThrottling(class TicketHolder* reading, class TicketHolder* writing);
+
     /**
      * State for reporting the number of active and queued reader and writer clients.
      */
@@ -626,11 +626,14 @@ struct TextStats : public SpecificStats {
 
     // Index keys that precede the "text" index key.
     BSONObj indexPrefix;
+
+    // Whether the results came from the text result cache of the collection.
+    bool fromResultCache = false;
 };
 
 // @@@proximity
 struct TextProximityStats : public SpecificStats {
-    TextProximityStats() : fetches(0) {}
+    TextProximityStats() : fetches(0), phraseRejects(0) {}
 
     SpecificStats* clone() const final {
         TextProximityStats* specific = new TextProximityStats(*this);
@@ -638,6 +641,46 @@ struct TextProximityStats : public SpecificStats {
     }
 
     size_t fetches;
+
+    // Number of documents dropped without a fetch because their term positions miss a phrase.
+    size_t phraseRejects;
+
+    // Number of best scoring documents wanted, or 0 for all.
+    size_t topK;
+};
+
+struct TextPixStats : public SpecificStats {
+    TextPixStats()
+        : fetches(0),
+          blocksRead(0),
+          deltasRead(0),
+          tombstonesRead(0),
+          postingsRead(0),
+          phraseRejects(0),
+          topK(0) {}
+
+    SpecificStats* clone() const final {
+        TextPixStats* specific = new TextPixStats(*this);
+        return specific;
+    }
+
+    size_t fetches;
+
+    // Number of posting blocks read from the index.
+    size_t blocksRead;
+
+    // Number of delta and tombstone entries read from the index, not yet merged into blocks.
+    size_t deltasRead;
+    size_t tombstonesRead;
+
+    // Number of (term, document) postings decoded from those blocks and deltas.
+    size_t postingsRead;
+
+    // Number of documents dropped without a fetch because their term positions miss a phrase.
+    size_t phraseRejects;
+
+    // Number of best scoring documents wanted, or 0 for all.
+    size_t topK;
 };
 
 struct TextMatchStats : public SpecificStats {
@@ -652,7 +695,7 @@ struct TextMatchStats : public SpecificStats {
 };
 
 struct TextOrStats : public SpecificStats {
-    TextOrStats() : fetches(0) {}
+    TextOrStats() : fetches(0), topK(0), spills(0) {}
 
     SpecificStats* clone() const final {
         TextOrStats* specific = new TextOrStats(*this);
@@ -660,6 +703,12 @@ struct TextOrStats : public SpecificStats {
     }
 
     size_t fetches;
+
+    // Number of best scoring documents wanted, or 0 for all.
+    size_t topK;
+
+    // Number of times partial scores were handed to the external sorter.
+    size_t spills;
 };
 
 }  // namespace mongo
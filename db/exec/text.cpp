@@ -28,18 +28,29 @@
 
 #include "mongo/db/exec/text.h"
 
+#include <cmath>
+#include <limits>
+#include <set>
+#include <string>
 #include <vector>
 
+#include "mongo/db/catalog/collection.h"
+#include "mongo/db/concurrency/write_conflict_exception.h"
 #include "mongo/db/exec/filter.h"
 #include "mongo/db/exec/index_scan.h"
 #include "mongo/db/exec/text_or.h"
+#include "mongo/db/exec/text_pix.h"
 #include "mongo/db/exec/text_proximity.h"
 #include "mongo/db/exec/text_match.h"
 #include "mongo/db/exec/scoped_timer.h"
 #include "mongo/db/exec/working_set.h"
+#include "mongo/db/exec/working_set_common.h"
+#include "mongo/db/exec/working_set_computed_data.h"
 #include "mongo/db/fts/fts_index_format.h"
 #include "mongo/db/jsobj.h"
 #include "mongo/db/query/internal_plans.h"
+#include "mongo/db/query/query_knobs.h"
+#include "mongo/db/storage/recovery_unit.h"
 #include "mongo/stdx/memory.h"
 
 namespace mongo {
@@ -58,36 +69,107 @@ const char* TextStage::kStageType = "TEXT";
 
 const bool t_debug = false;
 
+namespace {
+
+/**
+ * True if 'expr' may match a document differently from one evaluation to the next.
+ */
+bool isNondeterministic(const MatchExpression* expr) {
+    if (expr->matchType() == MatchExpression::WHERE) {
+        return true;
+    }
+    for (size_t i = 0; i < expr->numChildren(); ++i) {
+        if (isNondeterministic(expr->getChild(i))) {
+            return true;
+        }
+    }
+    return false;
+}
+
+}  // namespace
+
 TextStage::TextStage(OperationContext* txn,
                      const TextStageParams& params,
                      WorkingSet* ws,
                      const MatchExpression* filter)
-    : PlanStage(kStageType, txn), _params(params) {
+    : PlanStage(kStageType, txn), _params(params), _ws(ws) {
+    params.spec.uassertProximityKeysUsable();
+
+    _resultCacheKey = resultCacheKey(filter);
+    if (!_resultCacheKey.empty()) {
+        _resultCache = _params.index->getCollection()->infoCache()->getTextResultCache();
+        _resultCacheGeneration = _resultCache->getGeneration();
+        _cachedResults = _resultCache->get(_resultCacheKey);
+        _recordingResults = !_cachedResults;
+    }
+
+    _specificStats.indexPrefix = _params.indexPrefix;
+    _specificStats.indexName = _params.index->indexName();
+    _specificStats.parsedTextQuery = _params.query.toBSON();
+    _specificStats.textIndexVersion = _params.index->infoObj()["textIndexVersion"].numberInt();
+    _specificStats.fromResultCache = static_cast<bool>(_cachedResults);
+
+    if (_cachedResults) {
+        return;
+    }
 
     // @@@proximity
     if (params.spec.proximityIndex())
         _children.emplace_back(buildTextProximityTree( txn, ws, filter,
                                                         params.query.getProximityWindow(),
                                                         params.query.getReorderBound() ));
+    else if (params.spec.pixIndex())
+        _children.emplace_back(buildTextPixTree(txn, ws, filter));
     else
         _children.emplace_back(buildTextTree(txn, ws, filter));
-
-    _specificStats.indexPrefix = _params.indexPrefix;
-    _specificStats.indexName = _params.index->indexName();
-    _specificStats.parsedTextQuery = _params.query.toBSON();
-    _specificStats.textIndexVersion = _params.index->infoObj()["textIndexVersion"].numberInt();
 }
 
 bool TextStage::isEOF() {
+    if (_cachedResults) {
+        return _nextCachedResult == _cachedResults->size();
+    }
     return child()->isEOF();
 }
 
 PlanStage::StageState TextStage::doWork(WorkingSetID* out) {
     if (isEOF()) {
+        cacheResults();
         return PlanStage::IS_EOF;
     }
 
-    return child()->work(out);
+    if (_cachedResults) {
+        return returnCachedResult(out);
+    }
+
+    StageState state = child()->work(out);
+    if (PlanStage::ADVANCED == state) {
+        recordResult(*out);
+    } else if (PlanStage::IS_EOF == state) {
+        cacheResults();
+    }
+    return state;
+}
+
+void TextStage::doSaveState() {
+    if (_recordCursor) {
+        _recordCursor->saveUnpositioned();
+    }
+}
+
+void TextStage::doRestoreState() {
+    if (_recordCursor) {
+        invariant(_recordCursor->restore());
+    }
+}
+
+void TextStage::doDetachFromOperationContext() {
+    if (_recordCursor)
+        _recordCursor->detachFromOperationContext();
+}
+
+void TextStage::doReattachToOperationContext() {
+    if (_recordCursor)
+        _recordCursor->reattachToOperationContext(getOpCtx());
 }
 
 unique_ptr<PlanStageStats> TextStage::getStats() {
@@ -95,7 +177,9 @@ unique_ptr<PlanStageStats> TextStage::getStats() {
 
     unique_ptr<PlanStageStats> ret = make_unique<PlanStageStats>(_commonStats, STAGE_TEXT);
     ret->specific = make_unique<TextStats>(_specificStats);
-    ret->children.emplace_back(child()->getStats());
+    for (auto&& child : _children) {
+        ret->children.emplace_back(child->getStats());
+    }
     return ret;
 }
 
@@ -103,13 +187,135 @@ const SpecificStats* TextStage::getSpecificStats() const {
     return &_specificStats;
 }
 
+bool TextStage::canPruneToTopK() const {
+    // Negations, phrases and case or diacritic sensitive terms are checked by TextMatchStage
+    // after scoring, and could reject documents of the top k.
+    const FTSQueryImpl& query = _params.query;
+    return query.getNegatedTerms().empty() && query.getPositivePhr().empty() &&
+        query.getNegatedPhr().empty() && !query.getCaseSensitive() &&
+        !query.getDiacriticSensitive();
+}
+
+std::string TextStage::resultCacheKey(const MatchExpression* filter) const {
+    // A majority committed snapshot may predate writes that have already invalidated the cache.
+    if (internalQueryTextResultCacheSizeBytes.load() <= 0 ||
+        getOpCtx()->recoveryUnit()->isReadingFromMajorityCommittedSnapshot() ||
+        (filter && isNondeterministic(filter))) {
+        return std::string();
+    }
+
+    // Everything the results depend on besides the documents.
+    const FTSQueryImpl& query = _params.query;
+    BSONObjBuilder bob;
+    bob.append("index", _params.index->indexName());
+    bob.append("prefix", _params.indexPrefix);
+    bob.append("query", query.toBSON());
+    bob.append("termv", query.getTermv());
+    bob.append("language", query.getLanguage());
+    bob.append("caseSensitive", query.getCaseSensitive());
+    bob.append("diacriticSensitive", query.getDiacriticSensitive());
+    bob.append("proximityWindow", static_cast<long long>(query.getProximityWindow()));
+    bob.append("reorderBound", query.getReorderBound());
+    bob.append("topK", static_cast<long long>(canPruneToTopK() ? _params.topK : 0));
+    if (filter) {
+        BSONObjBuilder filterBob(bob.subobjStart("filter"));
+        filter->toBSON(&filterBob);
+    }
+    BSONObj key = bob.obj();
+    return std::string(key.objdata(), key.objsize());
+}
+
+PlanStage::StageState TextStage::returnCachedResult(WorkingSetID* out) {
+    *out = WorkingSet::INVALID_ID;
+    if (!_recordCursor) {
+        try {
+            _recordCursor = _params.index->getCollection()->getCursor(getOpCtx());
+        } catch (const WriteConflictException& wce) {
+            _recordCursor.reset();
+            return PlanStage::NEED_YIELD;
+        }
+    }
+
+    const TextResultCache::Result& result = (*_cachedResults)[_nextCachedResult];
+    WorkingSetID id = _ws->allocate();
+    WorkingSetMember* member = _ws->get(id);
+    member->recordId = result.recordId;
+    _ws->transitionToRecordIdAndIdx(id);
+
+    try {
+        if (!WorkingSetCommon::fetch(getOpCtx(), _ws, id, _recordCursor)) {
+            // Deleted since the results were cached.
+            _ws->free(id);
+            ++_nextCachedResult;
+            return PlanStage::NEED_TIME;
+        }
+    } catch (const WriteConflictException& wce) {
+        // Fetch the same result again after yielding.
+        _ws->free(id);
+        return PlanStage::NEED_YIELD;
+    }
+
+    ++_nextCachedResult;
+    if (!std::isnan(result.score)) {
+        member->addComputed(new TextScoreComputedData(result.score));
+    }
+    *out = id;
+    return PlanStage::ADVANCED;
+}
+
+void TextStage::recordResult(WorkingSetID id) {
+    if (!_recordingResults) {
+        return;
+    }
+
+    WorkingSetMember* member = _ws->get(id);
+    double score = std::numeric_limits<double>::quiet_NaN();
+    if (member->hasComputed(WSM_COMPUTED_TEXT_SCORE)) {
+        score = static_cast<const TextScoreComputedData*>(
+                    member->getComputed(WSM_COMPUTED_TEXT_SCORE))->getScore();
+    }
+    _newResults.push_back({member->recordId, score});
+
+    // Give up as soon as the results could not be cached.
+    if (TextResultCache::entryBytes(_resultCacheKey, _newResults.size()) >
+        static_cast<size_t>(std::max(0, internalQueryTextResultCacheSizeBytes.load()))) {
+        _recordingResults = false;
+        TextResultCache::Results().swap(_newResults);
+    }
+}
+
+void TextStage::cacheResults() {
+    if (!_recordingResults) {
+        return;
+    }
+
+    _recordingResults = false;
+    _resultCache->add(_resultCacheKey, _resultCacheGeneration, std::move(_newResults));
+}
+
 unique_ptr<PlanStage> TextStage::buildTextTree(OperationContext* txn,
                                                WorkingSet* ws,
                                                const MatchExpression* filter) const {
-    auto textScorer = make_unique<TextOrStage>(txn, _params.spec, ws, filter, _params.index);
+    auto textScorer = make_unique<TextOrStage>(txn,
+                                               _params.spec,
+                                               ws,
+                                               filter,
+                                               _params.index,
+                                               _params.query.getTermsForBounds(),
+                                               canPruneToTopK() ? _params.topK : 0);
+
+    // With term statistics, scan the rarest terms first.  The statistics only order the scans:
+    // they are applied after a write commits and are not persisted, so they may trail the index
+    // and cannot bound the score a scan contributes.
+    const std::set<std::string>& termSet = _params.query.getTermsForBounds();
+    const fts::FTSTermStats* termStats =
+        _params.termStats && _params.termStats->isSeeded() ? _params.termStats : nullptr;
+    const std::vector<std::string> terms = termStats
+        ? termStats->orderByDocFreq(termSet)
+        : std::vector<std::string>(termSet.begin(), termSet.end());
 
     // Get all the index scans for each term in our query.
-    for (const auto& term : _params.query.getTermsForBounds()) {
+    for (const auto& term : terms) {
         IndexScanParams ixparams;
 
         ixparams.bounds.startKey = FTSIndexFormat::getIndexKey(
@@ -150,28 +356,54 @@ unique_ptr<PlanStage> TextStage::buildTextProximityTree(
 
         IndexScanParams ixparams;
 
-        ixparams.bounds.startKey = FTSIndexFormat::getProximityIndexKey(
-            term, 0, _params.indexPrefix);
+        ixparams.bounds.startKey =
+            FTSIndexFormat::getProximityIndexKey(term, _params.indexPrefix, false);
+        ixparams.bounds.endKey =
+            FTSIndexFormat::getProximityIndexKey(term, _params.indexPrefix, true);
+        ixparams.bounds.endKeyInclusive = true;
+        ixparams.bounds.isSimpleRange = true;
+        ixparams.descriptor = _params.index;
+        ixparams.direction = 1;
+        // Every {term, RecordId, pos} key is needed, not just the first one of each document.
+        ixparams.doNotDedup = true;
 
-        if (t_debug)
-            std::cout << "startKey = (" << term << ", 0)" << std::endl;
+        proximityStage->addChild(make_unique<IndexScan>(txn, ixparams, ws, nullptr));
+    }
 
-        ixparams.bounds.endKey = FTSIndexFormat::getProximityIndexKey(
-            term, (1<<24), _params.indexPrefix);
+    auto matcher =
+        make_unique<TextMatchStage>(txn, std::move(proximityStage), _params.query, _params.spec, ws);
 
-        if (t_debug)
-            std::cout << "endKey = (" << term << ", " << (1<<24) << ")" << std::endl;
+    unique_ptr<PlanStage> treeRoot = std::move(matcher);
+    return treeRoot;
+}
+
+unique_ptr<PlanStage> TextStage::buildTextPixTree(OperationContext* txn,
+                                                  WorkingSet* ws,
+                                                  const MatchExpression* filter) const {
+    auto pixStage =
+        make_unique<TextPixStage>(txn, _params, ws, filter, canPruneToTopK() ? _params.topK : 0);
+
+    // Get the posting blocks of each term in our query.
+    for (const auto& term : _params.query.getTermsForBounds()) {
+        BSONObj termKey = FTSIndexFormat::getPixTermKey(
+            term, _params.indexPrefix, _params.spec.getTextIndexVersion());
 
-        ixparams.bounds.endKeyInclusive = false;
+        IndexScanParams ixparams;
+
+        ixparams.bounds.startKey = FTSIndexFormat::getPixSeekKey(termKey, 0, false);
+        ixparams.bounds.endKey = FTSIndexFormat::getPixSeekKey(termKey, 0xffffffff, true);
+        ixparams.bounds.endKeyInclusive = true;
         ixparams.bounds.isSimpleRange = true;
         ixparams.descriptor = _params.index;
         ixparams.direction = 1;
+        // Blocks, deltas and tombstones of one term can share a RecordId; none may be dropped.
+        ixparams.doNotDedup = true;
 
-        proximityStage->addChild(make_unique<IndexScan>(txn, ixparams, ws, nullptr));
+        pixStage->addChild(make_unique<IndexScan>(txn, ixparams, ws, nullptr));
     }
 
     auto matcher =
-        make_unique<TextMatchStage>(txn, std::move(proximityStage), _params.query, _params.spec, ws);
+        make_unique<TextMatchStage>(txn, std::move(pixStage), _params.query, _params.spec, ws);
 
     unique_ptr<PlanStage> treeRoot = std::move(matcher);
     return treeRoot;
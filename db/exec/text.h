@@ -35,8 +35,11 @@
 #include "mongo/db/exec/working_set.h"
 #include "mongo/db/fts/fts_query_impl.h"
 #include "mongo/db/fts/fts_spec.h"
+#include "mongo/db/fts/fts_term_stats.h"
 #include "mongo/db/fts/fts_util.h"
 #include "mongo/db/index/index_descriptor.h"
+#include "mongo/db/query/text_result_cache.h"
+#include "mongo/db/storage/record_store.h"
 
 namespace mongo {
 
@@ -62,11 +65,22 @@ struct TextStageParams {
 
     // The text query.
     FTSQueryImpl query;
+
+    // If nonzero, the plan only consumes the 'topK' highest scoring results.
+    size_t topK = 0;
+
+    // Statistics of the index terms, or null if the index keeps none.  Only used to order the
+    // term scans.  The access method owns this.
+    const fts::FTSTermStats* termStats = nullptr;
 };
 
 /**
  * Implements a blocking stage that returns text search results.
  *
+ * The RecordIds and scores of the results are kept in the TextResultCache of the collection,
+ * keyed by the normalized query, the index and the filter.  When the cache holds them, the
+ * stage fetches those documents instead of scanning the index.
+ *
  * Output type: LOC_AND_OBJ.
  */
 class TextStage final : public PlanStage {
@@ -80,6 +94,11 @@ public:
     StageState doWork(WorkingSetID* out) final;
     bool isEOF() final;
 
+    void doSaveState() final;
+    void doRestoreState() final;
+    void doDetachFromOperationContext() final;
+    void doReattachToOperationContext() final;
+
     StageType stageType() const final {
         return STAGE_TEXT;
     }
@@ -105,9 +124,61 @@ private:
                                                  uint32_t proximityWindow,
                                                  int reorderBound) const;
 
+    /**
+     * Builds the plan for a pix text index: one scan over the posting blocks of each term.
+     */
+    unique_ptr<PlanStage> buildTextPixTree(OperationContext* txn,
+                                           WorkingSet* ws,
+                                           const MatchExpression* filter) const;
+
+    /**
+     * True if TextOrStage may return only the top k documents: every document it returns must
+     * also pass the TextMatchStage above it.
+     */
+    bool canPruneToTopK() const;
+
+    /**
+     * The key of this search in the TextResultCache, or the empty string if its results must
+     * not be cached.
+     */
+    std::string resultCacheKey(const MatchExpression* filter) const;
+
+    /**
+     * Returns the next cached result, fetched.
+     */
+    StageState returnCachedResult(WorkingSetID* out);
+
+    /**
+     * Records a result returned by the child, to cache once the child reaches EOF.
+     */
+    void recordResult(WorkingSetID id);
+
+    /**
+     * Caches the results recorded, if they are complete and within bounds.
+     */
+    void cacheResults();
+
     // Parameters of this text stage.
     TextStageParams _params;
 
+    // Not owned by us.
+    WorkingSet* _ws;
+
+    // The result cache of the collection and the key of this search, or null if the results of
+    // this search are not cached.  The generation is read before the index.
+    TextResultCache* _resultCache = nullptr;
+    std::string _resultCacheKey;
+    uint64_t _resultCacheGeneration = 0;
+
+    // On a cache hit, the cached results and the next one to return.  Otherwise null.
+    std::shared_ptr<const TextResultCache::Results> _cachedResults;
+    size_t _nextCachedResult = 0;
+    std::unique_ptr<SeekableRecordCursor> _recordCursor;
+
+    // On a cache miss, the results returned so far, while they may still be cached.
+    bool _recordingResults = false;
+    TextResultCache::Results _newResults;
+
     // Stats.
     TextStats _specificStats;
 };
@@ -33,6 +33,7 @@
 #include <vector>
 
 #include "mongo/db/concurrency/write_conflict_exception.h"
+#include "mongo/db/exec/filter.h"
 #include "mongo/db/exec/index_scan.h"
 #include "mongo/db/exec/scoped_timer.h"
 #include "mongo/db/exec/working_set.h"
@@ -41,7 +42,9 @@
 #include "mongo/db/jsobj.h"
 #include "mongo/db/matcher/matchable.h"
 #include "mongo/db/query/internal_plans.h"
+#include "mongo/db/query/query_knobs.h"
 #include "mongo/db/record_id.h"
+#include "mongo/db/storage/storage_options.h"
 #include "mongo/stdx/memory.h"
 
 namespace mongo {
@@ -52,28 +55,57 @@ using std::string;
 using stdx::make_unique;
 
 using fts::FTSSpec;
+using fts::MAX_WEIGHT;
+using fts::TermFrequencyMap;
 
 const char* TextOrStage::kStageType = "TEXT_OR";
 
+namespace {
+
+// Estimated bytes of a ScoreMap entry and of a partial score while spilling, hash table
+// overhead included.
+const size_t kScoreEntryBytes = sizeof(RecordId) + sizeof(WorkingSetID) + sizeof(double) + 32;
+const size_t kSpilledScoreBytes = sizeof(RecordId) + sizeof(double) + 32;
+
+struct SpilledScoreComparator {
+    int operator()(const TextOrStage::ScoreSorter::Data& lhs,
+                   const TextOrStage::ScoreSorter::Data& rhs) const {
+        return lhs.first.compare(rhs.first);
+    }
+};
+
+}  // namespace
+
 TextOrStage::TextOrStage(OperationContext* txn,
                          const FTSSpec& ftsSpec,
                          WorkingSet* ws,
                          const MatchExpression* filter,
-                         IndexDescriptor* index)
+                         IndexDescriptor* index,
+                         const std::set<std::string>& terms,
+                         size_t topK)
     : PlanStage(kStageType, txn),
       _ftsSpec(ftsSpec),
       _ws(ws),
       _scoreIterator(_scores.end()),
+      _terms(terms),
+      _k(topK),
+      _droppedIterator(_topKDropped.end()),
       _filter(filter),
       _idRetrying(WorkingSet::INVALID_ID),
       _index(index) {
-    std::cout << "debug" << std::endl;
+    // Spilling writes temporary files, which a read only node cannot.
+    _maxMemoryUsageBytes = storageGlobalParams.readOnly
+        ? 0
+        : std::max(0, internalQueryTextOrMaxMemoryBytes.load());
+    _specificStats.topK = topK;
 }
 
 TextOrStage::~TextOrStage() {}
 
-void TextOrStage::addChild(unique_ptr<PlanStage> child) {
+void TextOrStage::addChild(unique_ptr<PlanStage> child, double maxScore) {
     _children.push_back(std::move(child));
+    _childBounds.push_back(maxScore);
+    _childDone.push_back(false);
 }
 
 bool TextOrStage::isEOF() {
@@ -103,6 +135,12 @@ void TextOrStage::doReattachToOperationContext() {
 }
 
 void TextOrStage::doInvalidate(OperationContext* txn, const RecordId& dl, InvalidationType type) {
+    if (_spilling) {
+        // Its partial scores may already be in the Sorter; skip it when they are summed.
+        _spilledScores.erase(dl);
+        _spilledInvalidated.insert(dl);
+    }
+
     // Remove the RecordID from the ScoreMap.
     ScoreMap::iterator scoreIt = _scores.find(dl);
     if (scoreIt != _scores.end()) {
@@ -111,6 +149,31 @@ void TextOrStage::doInvalidate(OperationContext* txn, const RecordId& dl, Invali
         }
         _scores.erase(scoreIt);
     }
+
+    if (_k > 0) {
+        auto droppedIt = _topKDropped.find(dl);
+        if (droppedIt != _topKDropped.end()) {
+            if (droppedIt == _droppedIterator) {
+                _droppedIterator++;
+            }
+            _topKDropped.erase(droppedIt);
+        }
+
+        // Rebuild the top k without it.  The k-th best score may now fall, so the documents
+        // dropped so far are candidates again and the bounds no longer allow stopping early.
+        const size_t size = _topK.size();
+        std::vector<ScoredRecordId> kept;
+        for (; !_topK.empty(); _topK.pop()) {
+            if (_topK.top().second != dl)
+                kept.push_back(_topK.top());
+        }
+        if (kept.size() < size) {
+            _topKInvalidated = true;
+        }
+        for (const auto& scored : kept) {
+            _topK.push(scored);
+        }
+    }
 }
 
 std::unique_ptr<PlanStageStats> TextOrStage::getStats() {
@@ -153,6 +216,12 @@ PlanStage::StageState TextOrStage::doWork(WorkingSetID* out) {
         case State::kReturningResults:
             stageState = returnResults(out);
             break;
+        case State::kReturningSpilledResults:
+            stageState = returnSpilledResults(out);
+            break;
+        case State::kReturningDroppedResults:
+            stageState = returnDroppedResults(out);
+            break;
         case State::kDone:
             // Should have been handled above.
             invariant(false);
@@ -183,6 +252,13 @@ PlanStage::StageState TextOrStage::readFromChildren(WorkingSetID* out) {
     }
     invariant(_currentChild < _children.size());
 
+    if (_k > 0 && _idRetrying == WorkingSet::INVALID_ID && topKComplete()) {
+        // No document left in the index can displace the ones we have.
+        _scoreIterator = _scores.begin();
+        _internalState = State::kReturningResults;
+        return PlanStage::NEED_TIME;
+    }
+
     // Either retry the last WSM we worked on or get a new one from our current child.
     WorkingSetID id;
     StageState childState;
@@ -195,10 +271,20 @@ PlanStage::StageState TextOrStage::readFromChildren(WorkingSetID* out) {
     }
 
     if (PlanStage::ADVANCED == childState) {
-        return addTerm(id, out);
+        StageState state = addTerm(id, out);
+        if (_k > 0 && PlanStage::NEED_YIELD != state) {
+            nextChild();
+        }
+        return state;
     } else if (PlanStage::IS_EOF == childState) {
         // Done with this child.
-        ++_currentChild;
+        if (_k > 0) {
+            _childBounds[_currentChild] = 0;
+            _childDone[_currentChild] = true;
+            nextChild();
+        } else {
+            ++_currentChild;
+        }
 
         if (_currentChild < _children.size()) {
             // We have another child to read from.
@@ -206,6 +292,13 @@ PlanStage::StageState TextOrStage::readFromChildren(WorkingSetID* out) {
         }
 
         // If we're here we are done reading results.  Move to the next state.
+        if (_spilling) {
+            flushSpilledScores();
+            _spilledIterator.reset(_sorter->done());
+            _internalState = State::kReturningSpilledResults;
+            return PlanStage::NEED_TIME;
+        }
+
         _scoreIterator = _scores.begin();
         _internalState = State::kReturningResults;
 
@@ -232,6 +325,11 @@ PlanStage::StageState TextOrStage::readFromChildren(WorkingSetID* out) {
 
 PlanStage::StageState TextOrStage::returnResults(WorkingSetID* out) {
     if (_scoreIterator == _scores.end()) {
+        if (_topKInvalidated) {
+            _droppedIterator = _topKDropped.begin();
+            _internalState = State::kReturningDroppedResults;
+            return PlanStage::NEED_TIME;
+        }
         _internalState = State::kDone;
         return PlanStage::IS_EOF;
     }
@@ -254,6 +352,213 @@ PlanStage::StageState TextOrStage::returnResults(WorkingSetID* out) {
     return PlanStage::ADVANCED;
 }
 
+PlanStage::StageState TextOrStage::returnDroppedResults(WorkingSetID* out) {
+    if (_droppedIterator == _topKDropped.end()) {
+        _internalState = State::kDone;
+        return PlanStage::IS_EOF;
+    }
+
+    // The iterator only moves past a document once it is fetched, so a yield retries it.
+    const RecordId recordId = _droppedIterator->first;
+    const double score = _droppedIterator->second;
+
+    WorkingSetID id = _ws->allocate();
+    WorkingSetMember* member = _ws->get(id);
+    member->recordId = recordId;
+    _ws->transitionToRecordIdAndIdx(id);
+
+    try {
+        ++_specificStats.fetches;
+        if (!WorkingSetCommon::fetch(getOpCtx(), _ws, id, _recordCursor)) {
+            _ws->free(id);
+            ++_droppedIterator;
+            return PlanStage::NEED_TIME;
+        }
+    } catch (const WriteConflictException& wce) {
+        _ws->free(id);
+        *out = WorkingSet::INVALID_ID;
+        return PlanStage::NEED_YIELD;
+    }
+    ++_droppedIterator;
+
+    if (!Filter::passes(member, _filter)) {
+        _ws->free(id);
+        return PlanStage::NEED_TIME;
+    }
+
+    member->addComputed(new TextScoreComputedData(score));
+    *out = id;
+    return PlanStage::ADVANCED;
+}
+
+PlanStage::StageState TextOrStage::returnSpilledResults(WorkingSetID* out) {
+    RecordId recordId;
+    double score;
+    if (_spilledRetrying) {
+        recordId = _spilledRetryId;
+        score = _spilledRetryScore;
+        _spilledRetrying = false;
+    } else {
+        if (!_haveNextSpilled) {
+            if (!_spilledIterator->more()) {
+                _internalState = State::kDone;
+                return PlanStage::IS_EOF;
+            }
+            _nextSpilled = _spilledIterator->next();
+        }
+
+        // The runs are merged in RecordId order, so the partial scores of a RecordId are adjacent.
+        recordId = _nextSpilled.first;
+        score = _nextSpilled.second.score;
+        _haveNextSpilled = false;
+        while (_spilledIterator->more()) {
+            ScoreSorter::Data data = _spilledIterator->next();
+            if (data.first != recordId) {
+                _nextSpilled = data;
+                _haveNextSpilled = true;
+                break;
+            }
+            score += data.second.score;
+        }
+
+        if (_spilledInvalidated.count(recordId)) {
+            return PlanStage::NEED_TIME;
+        }
+    }
+
+    WorkingSetID id = _ws->allocate();
+    WorkingSetMember* member = _ws->get(id);
+    member->recordId = recordId;
+    _ws->transitionToRecordIdAndIdx(id);
+
+    try {
+        ++_specificStats.fetches;
+        if (!WorkingSetCommon::fetch(getOpCtx(), _ws, id, _recordCursor)) {
+            _ws->free(id);
+            return PlanStage::NEED_TIME;
+        }
+    } catch (const WriteConflictException& wce) {
+        _ws->free(id);
+        _spilledRetrying = true;
+        _spilledRetryId = recordId;
+        _spilledRetryScore = score;
+        *out = WorkingSet::INVALID_ID;
+        return PlanStage::NEED_YIELD;
+    }
+
+    if (!Filter::passes(member, _filter)) {
+        _ws->free(id);
+        return PlanStage::NEED_TIME;
+    }
+
+    member->addComputed(new TextScoreComputedData(score));
+    *out = id;
+    return PlanStage::ADVANCED;
+}
+
+void TextOrStage::spill() {
+    SortOptions opts;
+    opts.MaxMemoryUsageBytes(_maxMemoryUsageBytes / 2)
+        .ExtSortAllowed()
+        .TempDir(storageGlobalParams.dbpath + "/_tmp");
+    _sorter.reset(ScoreSorter::make(opts, SpilledScoreComparator()));
+
+    // Documents rejected by the filter are dropped too: any further scores they get are checked
+    // against the filter again when they are fetched.
+    for (const auto& entry : _scores) {
+        if (WorkingSet::INVALID_ID != entry.second.wsid) {
+            _ws->free(entry.second.wsid);
+        }
+        if (entry.second.score >= 0) {
+            _sorter->add(entry.first, SpilledScore{entry.second.score});
+        }
+    }
+
+    _scores.clear();
+    _scoreIterator = _scores.end();
+    _memUsage = 0;
+    _spilling = true;
+    ++_specificStats.spills;
+}
+
+void TextOrStage::addSpilledScore(const RecordId& recordId, double score) {
+    _spilledScores[recordId] += score;
+    if (_spilledScores.size() * kSpilledScoreBytes > _maxMemoryUsageBytes / 2) {
+        flushSpilledScores();
+    }
+}
+
+void TextOrStage::flushSpilledScores() {
+    for (const auto& entry : _spilledScores) {
+        _sorter->add(entry.first, SpilledScore{entry.second});
+    }
+    if (!_spilledScores.empty()) {
+        ++_specificStats.spills;
+    }
+    _spilledScores.clear();
+}
+
+double TextOrStage::scoreDocument(const BSONObj& obj) const {
+    // The same scores the index keys were built from.
+    TermFrequencyMap termFreqs;
+    _ftsSpec.scoreDocument(obj, &termFreqs);
+
+    double score = 0;
+    for (const auto& term : _terms) {
+        TermFrequencyMap::const_iterator it = termFreqs.find(term);
+        if (it != termFreqs.end()) {
+            score += it->second;
+        }
+    }
+    return score;
+}
+
+void TextOrStage::addTopK(const RecordId& recordId, double score) {
+    _topK.push(ScoredRecordId(score, recordId));
+    if (_topK.size() <= _k) {
+        return;
+    }
+
+    RecordId dropped = _topK.top().second;
+    _topKDropped[dropped] = _topK.top().first;
+    _topK.pop();
+
+    // Scores are final and, barring invalidations, the k-th best only rises, so the dropped
+    // document cannot make the top k again: mark it like a rejected document so its remaining
+    // keys are skipped.
+    ScoreMap::iterator it = _scores.find(dropped);
+    if (it != _scores.end()) {
+        if (it->second.wsid != WorkingSet::INVALID_ID) {
+            _ws->free(it->second.wsid);
+        }
+        it->second.wsid = WorkingSet::INVALID_ID;
+        it->second.score = -1;
+    }
+}
+
+bool TextOrStage::topKComplete() const {
+    if (_topKInvalidated || _topK.size() < _k) {
+        return false;
+    }
+
+    double bound = 0;
+    for (double childBound : _childBounds) {
+        bound += childBound;
+    }
+    return _topK.top().first >= bound;
+}
+
+void TextOrStage::nextChild() {
+    for (size_t i = 1; i <= _children.size(); ++i) {
+        size_t child = (_currentChild + i) % _children.size();
+        if (!_childDone[child]) {
+            _currentChild = child;
+            return;
+        }
+    }
+    _currentChild = _children.size();
+}
+
 /**
  * Provides support for covered matching on non-text fields of a compound text index.
  */
@@ -334,7 +639,35 @@ PlanStage::StageState TextOrStage::addTerm(WorkingSetID wsid, WorkingSetID* out)
     invariant(wsm->getState() == WorkingSetMember::RID_AND_IDX);
     invariant(1 == wsm->keyData.size());
     const IndexKeyDatum newKeyData = wsm->keyData.back();  // copy to keep it around.
-    TextRecordData* textRecordData = &_scores[wsm->recordId];
+
+    // Locate score within possibly compound key: {prefix,term,score,suffix}.
+    BSONObjIterator keyIt(newKeyData.keyData);
+    for (unsigned i = 0; i < _ftsSpec.numExtraBefore(); i++) {
+        keyIt.next();
+    }
+
+    keyIt.next();  // Skip past 'term'.
+
+    BSONElement scoreElement = keyIt.next();
+    double documentTermScore = scoreElement.number();
+
+    if (_k > 0) {
+        // Keys come in descending score order: no unseen document scores more for this term.
+        _childBounds[_currentChild] = documentTermScore;
+    }
+
+    if (_spilling) {
+        // Only the score is kept; the document is fetched and filtered once it is complete.
+        addSpilledScore(wsm->recordId, documentTermScore);
+        _ws->free(wsid);
+        return NEED_TIME;
+    }
+
+    auto inserted = _scores.emplace(wsm->recordId, TextRecordData());
+    if (inserted.second) {
+        _memUsage += kScoreEntryBytes;
+    }
+    TextRecordData* textRecordData = &inserted.first->second;
 
     if (textRecordData->score < 0) {
         // We have already rejected this document for not matching the filter.
@@ -401,6 +734,18 @@ PlanStage::StageState TextOrStage::addTerm(WorkingSetID wsid, WorkingSetID* out)
 
         // Ensure that the BSONObj underlying the WorkingSetMember is owned in case we yield.
         wsm->makeObjOwnedIfNeeded();
+        _memUsage += wsm->obj.value().objsize();
+
+        if (_k > 0) {
+            // Score the document in full; its keys from the other children are skipped.
+            textRecordData->score = scoreDocument(wsm->obj.value());
+            addTopK(wsm->recordId, textRecordData->score);
+            return NEED_TIME;
+        }
+    } else if (_k > 0) {
+        // Already scored in full.
+        _ws->free(wsid);
+        return NEED_TIME;
     } else {
         // We already have a working set member for this RecordId. Free the new WSM and retrieve the
         // old one. Note that since we don't keep all index keys, we could get a score that doesn't
@@ -411,20 +756,18 @@ PlanStage::StageState TextOrStage::addTerm(WorkingSetID wsid, WorkingSetID* out)
         wsm = _ws->get(textRecordData->wsid);
     }
 
-    // Locate score within possibly compound key: {prefix,term,score,suffix}.
-    BSONObjIterator keyIt(newKeyData.keyData);
-    for (unsigned i = 0; i < _ftsSpec.numExtraBefore(); i++) {
-        keyIt.next();
-    }
-
-    keyIt.next();  // Skip past 'term'.
-
-    BSONElement scoreElement = keyIt.next();
-    double documentTermScore = scoreElement.number();
-
     // Aggregate relevance score, term keys.
     textRecordData->score += documentTermScore;
+
+    if (_maxMemoryUsageBytes > 0 && _memUsage > _maxMemoryUsageBytes) {
+        spill();
+    }
     return NEED_TIME;
 }
 
 }  // namespace mongo
+
+#include "mongo/db/sorter/sorter.cpp"
+MONGO_CREATE_SORTER(mongo::RecordId,
+                    mongo::TextOrStage::SpilledScore,
+                    mongo::SpilledScoreComparator);
@@ -29,6 +29,9 @@
 #pragma once
 
 #include <memory>
+#include <queue>
+#include <set>
+#include <string>
 #include <vector>
 
 #include "mongo/db/catalog/collection.h"
@@ -37,6 +40,8 @@
 #include "mongo/db/index/index_descriptor.h"
 #include "mongo/db/matcher/expression.h"
 #include "mongo/db/record_id.h"
+#include "mongo/db/sorter/sorter.h"
+#include "mongo/platform/unordered_set.h"
 
 namespace mongo {
 
@@ -51,6 +56,20 @@ class OperationContext;
  * A blocking stage that returns the set of WSMs with RecordIDs of all of the documents that contain
  * the positive terms in the search query, as well as their scores.
  *
+ * If 'topK' is nonzero, only the 'topK' highest scoring documents are returned, in no particular
+ * order.  Each child scans its term in descending score order, so the last score read from every
+ * child bounds the score of any document not yet seen.  The children are read round-robin, each
+ * document is scored in full when first seen, and reading stops once the k-th best score reaches
+ * the sum of those bounds.  If an invalidation removes one of the k best, the documents already
+ * dropped may belong to the top k again: the stage then reads every child to the end and also
+ * returns the dropped documents, refetched, leaving the final cut to the sort above it.
+ *
+ * Otherwise memory is bounded by internalQueryTextOrMaxMemoryBytes.  Past it the stage drops the
+ * documents it buffered and only sums the score of each RecordId, handing the partial sums to a
+ * Sorter that spills sorted runs to disk.  Once the children are exhausted the merged runs are
+ * read in RecordId order, the partial sums of each RecordId are added up, and the document is
+ * fetched and filtered then.
+ *
  * The WorkingSetMembers returned are fetched and in the LOC_AND_OBJ state.
  */
 class TextOrStage final : public PlanStage {
@@ -68,18 +87,53 @@ public:
         // 3. Return results to our parent.
         kReturningResults,
 
+        // 3'. Return results to our parent from the spilled scores.
+        kReturningSpilledResults,
+
+        // 3''. Top-k mode, after an invalidation: return the documents dropped from the top k.
+        kReturningDroppedResults,
+
         // 4. Finished.
         kDone,
     };
 
+    /**
+     * A partial score of a RecordId, as spilled to the Sorter.
+     */
+    struct SpilledScore {
+        double score;
+
+        struct SorterDeserializeSettings {};
+        void serializeForSorter(BufBuilder& buf) const {
+            buf.appendNum(score);
+        }
+        static SpilledScore deserializeForSorter(BufReader& buf, const SorterDeserializeSettings&) {
+            return {buf.read<double>()};
+        }
+        int memUsageForSorter() const {
+            return sizeof(SpilledScore);
+        }
+        SpilledScore getOwned() const {
+            return *this;
+        }
+    };
+
+    typedef Sorter<RecordId, SpilledScore> ScoreSorter;
+
     TextOrStage(OperationContext* txn,
                 const FTSSpec& ftsSpec,
                 WorkingSet* ws,
                 const MatchExpression* filter,
-                IndexDescriptor* index);
+                IndexDescriptor* index,
+                const std::set<std::string>& terms,
+                size_t topK);
     ~TextOrStage();
 
-    void addChild(unique_ptr<PlanStage> child);
+    /**
+     * Adds the index scan of one term.  'maxScore' bounds the score of the term in any document
+     * it returns.
+     */
+    void addChild(unique_ptr<PlanStage> child, double maxScore = fts::MAX_WEIGHT);
 
     bool isEOF() final;
 
@@ -125,6 +179,56 @@ private:
      */
     StageState returnResults(WorkingSetID* out);
 
+    /**
+     * Worker for kReturningDroppedResults.  Fetches and returns the next document dropped from
+     * the top k, if it still passes the filter.
+     */
+    StageState returnDroppedResults(WorkingSetID* out);
+
+    /**
+     * Worker for kReturningSpilledResults.  Sums the spilled scores of the next RecordId and
+     * returns its document if it passes the filter.
+     */
+    StageState returnSpilledResults(WorkingSetID* out);
+
+    /**
+     * Starts spilling: moves the scores of the documents kept so far to the Sorter and frees
+     * their working set members.
+     */
+    void spill();
+
+    /**
+     * Spilling: adds 'score' to the partial score of 'recordId', handing the partial scores to
+     * the Sorter once they take half of the memory bound.
+     */
+    void addSpilledScore(const RecordId& recordId, double score);
+
+    /**
+     * Spilling: hands the partial scores to the Sorter.
+     */
+    void flushSpilledScores();
+
+    /**
+     * Top-k mode: the full score of a fetched document over the query terms.
+     */
+    double scoreDocument(const BSONObj& obj) const;
+
+    /**
+     * Top-k mode: adds a fully scored document to _topK, dropping the lowest scoring document if
+     * there are more than k.
+     */
+    void addTopK(const RecordId& recordId, double score);
+
+    /**
+     * Top-k mode: true once no unseen document can score higher than the k-th best.
+     */
+    bool topKComplete() const;
+
+    /**
+     * Top-k mode: moves _currentChild to the next child that is not at EOF.
+     */
+    void nextChild();
+
     // The index spec used to determine where to find the score.
     FTSSpec _ftsSpec;
 
@@ -152,6 +256,49 @@ private:
     ScoreMap _scores;
     ScoreMap::const_iterator _scoreIterator;
 
+    // Top-k mode: the positive query terms, the number of documents wanted, and the best
+    // documents so far with the lowest score on top.
+    std::set<std::string> _terms;
+    size_t _k;
+    typedef std::pair<double, RecordId> ScoredRecordId;
+    std::priority_queue<ScoredRecordId, std::vector<ScoredRecordId>, std::greater<ScoredRecordId>>
+        _topK;
+
+    // Top-k mode: the last score read from each child, or 0 once it is at EOF.
+    std::vector<double> _childBounds;
+    std::vector<bool> _childDone;
+
+    // Top-k mode: the documents dropped from _topK with their scores.  Once an invalidation has
+    // removed a document from _topK these may belong to the top k again: pruning stops and they
+    // are fetched and returned after the others.
+    unordered_map<RecordId, double, RecordId::Hasher> _topKDropped;
+    unordered_map<RecordId, double, RecordId::Hasher>::const_iterator _droppedIterator;
+    bool _topKInvalidated = false;
+
+    // Estimated bytes held by _scores and the documents buffered in _ws, and the bound past which
+    // the stage spills, or 0 for no bound.
+    size_t _memUsage = 0;
+    size_t _maxMemoryUsageBytes;
+
+    // Spilling: the partial scores not yet handed to the Sorter, the Sorter, and once the
+    // children are exhausted, the merged partial scores in RecordId order.
+    bool _spilling = false;
+    unordered_map<RecordId, double, RecordId::Hasher> _spilledScores;
+    std::unique_ptr<ScoreSorter> _sorter;
+    std::unique_ptr<ScoreSorter::Iterator> _spilledIterator;
+
+    // Spilling: the partial score read past the RecordId being summed, if any.
+    bool _haveNextSpilled = false;
+    ScoreSorter::Data _nextSpilled;
+
+    // Spilling: the RecordId and total score of a document to fetch again after a yield.
+    bool _spilledRetrying = false;
+    RecordId _spilledRetryId;
+    double _spilledRetryScore = 0;
+
+    // Spilling: RecordIds invalidated while their scores were in the Sorter, to skip.
+    unordered_set<RecordId, RecordId::Hasher> _spilledInvalidated;
+
     TextOrStats _specificStats;
 
     // Members needed only for using the TextMatchableDocument.
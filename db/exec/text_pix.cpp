@@ -0,0 +1,398 @@
+/**
+ *    Copyright (C) 2016 MongoDB Inc.
+ *
+ *    This program is free software: you can redistribute it and/or  modify
+ *    it under the terms of the GNU Affero General Public License, version 3,
+ *    as published by the Free Software Foundation.
+ *
+ *    This program is distributed in the hope that it will be useful,
+ *    but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *    GNU Affero General Public License for more details.
+ *
+ *    You should have received a copy of the GNU Affero General Public License
+ *    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ *    As a special exception, the copyright holders give permission to link the
+ *    code of portions of this program with the OpenSSL library under certain
+ *    conditions as described in each individual source file and distribute
+ *    linked combinations including the program with the OpenSSL library. You
+ *    must comply with the GNU Affero General Public License in all respects for
+ *    all of the code used other than as permitted herein. If you modify file(s)
+ *    with this exception, you may extend this exception to your version of the
+ *    file(s), but you are not obligated to do so. If you do not wish to do so,
+ *    delete this exception statement from your version. If you delete this
+ *    exception statement from all source files in the program, then also delete
+ *    it in the license file.
+ */
+
+#include "mongo/db/exec/text_pix.h"
+
+#include <algorithm>
+#include <limits.h>
+#include <vector>
+
+#include "mongo/db/catalog/index_catalog.h"
+#include "mongo/db/concurrency/write_conflict_exception.h"
+#include "mongo/db/exec/filter.h"
+#include "mongo/db/exec/scoped_timer.h"
+#include "mongo/db/exec/working_set.h"
+#include "mongo/db/exec/working_set_common.h"
+#include "mongo/db/exec/working_set_computed_data.h"
+#include "mongo/db/fts/fts_index_format.h"
+#include "mongo/db/fts/fts_language.h"
+#include "mongo/db/index/pix_access_method.h"
+#include "mongo/db/jsobj.h"
+#include "mongo/db/operation_context.h"
+#include "mongo/db/record_id.h"
+#include "mongo/stdx/memory.h"
+
+namespace mongo {
+
+using std::unique_ptr;
+using std::vector;
+using stdx::make_unique;
+
+using fts::FTSIndexFormat;
+
+const char* TextPixStage::kStageType = "TEXT_PIX";
+
+TextPixStage::TextPixStage(OperationContext* txn,
+                           const TextStageParams& params,
+                           WorkingSet* ws,
+                           const MatchExpression* filter,
+                           size_t topK)
+    : PlanStage(kStageType, txn),
+      _params(params),
+      _ws(ws),
+      _k(topK),
+      _phraseMatcher(fts::FTSLanguage::make(params.query.getLanguage(),
+                                            params.spec.getTextIndexVersion()).getValue(),
+                     params.query.getPositivePhr(),
+                     params.query.getTermsForBounds()),
+      _filter(filter),
+      _pixAccess(static_cast<const PixAccessMethod*>(
+          params.index->getIndexCatalog()->getIndex(params.index))) {
+    _specificStats.topK = topK;
+}
+
+TextPixStage::~TextPixStage() {}
+
+void TextPixStage::addChild(unique_ptr<PlanStage> child) {
+    _children.push_back(std::move(child));
+    _termBlocks.push_back(vector<PackedBlock>());
+    _termDeltas.push_back(vector<PackedBlock>());
+    _termTombstones.push_back(vector<unsigned>());
+}
+
+bool TextPixStage::isEOF() {
+    return _internalState == State::kDone;
+}
+
+void TextPixStage::doSaveState() {
+    if (_recordCursor) {
+        _recordCursor->saveUnpositioned();
+    }
+}
+
+void TextPixStage::doRestoreState() {
+    if (_recordCursor) {
+        invariant(_recordCursor->restore());
+    }
+}
+
+void TextPixStage::doDetachFromOperationContext() {
+    if (_recordCursor)
+        _recordCursor->detachFromOperationContext();
+}
+
+void TextPixStage::doReattachToOperationContext() {
+    if (_recordCursor)
+        _recordCursor->reattachToOperationContext(getOpCtx());
+}
+
+std::unique_ptr<PlanStageStats> TextPixStage::getStats() {
+    _commonStats.isEOF = isEOF();
+
+    if (_filter) {
+        BSONObjBuilder bob;
+        _filter->toBSON(&bob);
+        _commonStats.filter = bob.obj();
+    }
+
+    unique_ptr<PlanStageStats> ret = make_unique<PlanStageStats>(_commonStats, STAGE_TEXT_PIX);
+    ret->specific = make_unique<TextPixStats>(_specificStats);
+
+    for (auto&& child : _children) {
+        ret->children.emplace_back(child->getStats());
+    }
+
+    return ret;
+}
+
+const SpecificStats* TextPixStage::getSpecificStats() const {
+    return &_specificStats;
+}
+
+PlanStage::StageState TextPixStage::doWork(WorkingSetID* out) {
+    if (isEOF()) {
+        return PlanStage::IS_EOF;
+    }
+
+    PlanStage::StageState stageState = PlanStage::IS_EOF;
+
+    switch (_internalState) {
+        case State::kInit:
+            stageState = initStage(out);
+            break;
+        case State::kReadingTerms:
+            stageState = readFromChildren(out);
+            break;
+        case State::kReturningResults:
+            stageState = returnResults(out);
+            break;
+        case State::kDone:
+            // Should have been handled above.
+            invariant(false);
+            break;
+    }
+
+    return stageState;
+}
+
+PlanStage::StageState TextPixStage::initStage(WorkingSetID* out) {
+    *out = WorkingSet::INVALID_ID;
+    try {
+        _recordCursor = _params.index->getCollection()->getCursor(getOpCtx());
+        _internalState = State::kReadingTerms;
+        return PlanStage::NEED_TIME;
+    } catch (const WriteConflictException& wce) {
+        invariant(_internalState == State::kInit);
+        _recordCursor.reset();
+        return PlanStage::NEED_YIELD;
+    }
+}
+
+PlanStage::StageState TextPixStage::readFromChildren(WorkingSetID* out) {
+    // Check to see if there were any children added in the first place.
+    if (_children.size() == 0) {
+        _internalState = State::kDone;
+        return PlanStage::IS_EOF;
+    }
+    invariant(_currentChild < _children.size());
+
+    WorkingSetID id = WorkingSet::INVALID_ID;
+    StageState childState = _children[_currentChild]->work(&id);
+
+    if (PlanStage::ADVANCED == childState) {
+        WorkingSetMember* wsm = _ws->get(id);
+        invariant(wsm->getState() == WorkingSetMember::RID_AND_IDX);
+        invariant(1 == wsm->keyData.size());
+
+        // Entry key: {prefix, term, docid, data}.
+        BSONElement docid;
+        BSONElement blob;
+        BSONObjIterator keyIt(wsm->keyData.back().keyData);
+        while (keyIt.more()) {
+            docid = blob;
+            blob = keyIt.next();
+        }
+        invariant(blob.type() == BinData);
+
+        int len;
+        const unsigned char* data = reinterpret_cast<const unsigned char*>(blob.binData(len));
+        switch (FTSIndexFormat::getPixEntryKind(blob)) {
+            case FTSIndexFormat::PixEntryKind::kBlock:
+                _termBlocks[_currentChild].push_back(PackedBlock(data, data + len));
+                ++_specificStats.blocksRead;
+                break;
+            case FTSIndexFormat::PixEntryKind::kDelta:
+                _termDeltas[_currentChild].push_back(PackedBlock(data, data + len));
+                ++_specificStats.deltasRead;
+                break;
+            case FTSIndexFormat::PixEntryKind::kTombstone:
+                _termTombstones[_currentChild].push_back(docid.numberLong());
+                ++_specificStats.tombstonesRead;
+                break;
+        }
+
+        _ws->free(id);
+        return PlanStage::NEED_TIME;
+    } else if (PlanStage::IS_EOF == childState) {
+        // Done with this child.
+        ++_currentChild;
+
+        if (_currentChild < _children.size()) {
+            // We have another child to read from.
+            return PlanStage::NEED_TIME;
+        }
+
+        // If we're here we are done reading results.  Move to the next state.
+        mergePostings();
+        _resultPos = 0;
+        _internalState = State::kReturningResults;
+
+        return PlanStage::NEED_TIME;
+    } else if (PlanStage::FAILURE == childState) {
+        // If a stage fails, it may create a status WSM to indicate why it
+        // failed, in which case 'id' is valid.  If ID is invalid, we
+        // create our own error message.
+        if (WorkingSet::INVALID_ID == id) {
+            mongoutils::str::stream ss;
+            ss << "TEXT_PIX stage failed to read in results from child";
+            Status status(ErrorCodes::InternalError, ss);
+            *out = WorkingSetCommon::allocateStatusMember(_ws, status);
+        } else {
+            *out = id;
+        }
+        return PlanStage::FAILURE;
+    } else {
+        // Propagate WSID from below.
+        *out = id;
+        return childState;
+    }
+}
+
+void TextPixStage::mergePostings() {
+    // Each term has a cursor over its blocks, which skips tombstoned docids, and one over its
+    // deltas.  A live posting is in exactly one of the two.
+    vector<PostingCursor> cursors;
+    cursors.reserve(2 * _termBlocks.size());
+    _cursorTerms.clear();
+    for (size_t term = 0; term < _termBlocks.size(); ++term) {
+        for (const auto* blocks : {&_termBlocks[term], &_termDeltas[term]}) {
+            if (blocks->empty())
+                continue;
+            vector<PostingCursor::Block> cursorBlocks;
+            for (const auto& block : *blocks) {
+                if (!block.empty())
+                    cursorBlocks.push_back(PostingCursor::Block(&block[0], block.size()));
+            }
+            cursors.push_back(PostingCursor(cursorBlocks));
+            _cursorTerms.push_back(term);
+        }
+
+        const vector<unsigned>& tombstones = _termTombstones[term];
+        if (!_termBlocks[term].empty() && !tombstones.empty()) {
+            size_t blockCursor = cursors.size() - (_termDeltas[term].empty() ? 1 : 2);
+            cursors[blockCursor].setDeleted(&tombstones[0], &tombstones[0] + tombstones.size());
+        }
+    }
+
+    vector<PostingCursor*> cv;
+    for (auto& cursor : cursors) {
+        cv.push_back(&cursor);
+    }
+    if (_k > 0 && !_filter && _phraseMatcher.empty()) {
+        // The filter is only applied once a document is fetched, so it could reject documents
+        // of the top k: prune only without one.
+        PostingCursor::_accrueTopK(cv, vector<float>(cv.size(), 1.0f), _k, _results);
+    } else if (_phraseMatcher.empty()) {
+        PostingCursor::_accrue(cv, vector<float>(cv.size(), 1.0f), _results);
+    } else {
+        accruePhrases(cv);
+    }
+
+    for (const auto& cursor : cursors) {
+        _specificStats.postingsRead += cursor.decoded();
+    }
+    _termBlocks.clear();
+    _termDeltas.clear();
+    _termTombstones.clear();
+}
+
+void TextPixStage::accruePhrases(const vector<PostingCursor*>& cursors) {
+    typedef fts::PhrasePositionMatcher::Occurrence Occurrence;
+    vector<Occurrence> occurrences;
+
+    while (true) {
+        // smallest docid among the live cursors
+        unsigned docid = UINT_MAX;
+        bool live = false;
+        for (const auto* cursor : cursors) {
+            if (cursor->done())
+                continue;
+            if (!live || cursor->docid() < docid)
+                docid = cursor->docid();
+            live = true;
+        }
+        if (!live)
+            break;
+
+        ScoredDocid sd = {docid, 0.0f};
+        bool truncated = false;
+        occurrences.clear();
+        for (size_t i = 0; i < cursors.size(); ++i) {
+            PostingCursor* cursor = cursors[i];
+            if (cursor->done() || cursor->docid() != docid)
+                continue;
+            sd.score += cursor->score();
+            truncated = truncated || cursor->tf() >= FTSIndexFormat::kPixMaxPositions;
+            for (auto pos = cursor->positions(); !pos.done(); ++pos)
+                occurrences.push_back(Occurrence(_cursorTerms[i], *pos));
+            cursor->next();
+        }
+
+        // The index keeps only the first kPixMaxPositions positions of a term: past that, leave
+        // the phrases to TextMatchStage.
+        std::sort(occurrences.begin(),
+                  occurrences.end(),
+                  [](const Occurrence& x, const Occurrence& y) { return x.pos < y.pos; });
+        if (truncated || _phraseMatcher.matches(occurrences)) {
+            _results.push_back(sd);
+        } else {
+            ++_specificStats.phraseRejects;
+        }
+    }
+}
+
+PlanStage::StageState TextPixStage::returnResults(WorkingSetID* out) {
+    if (_resultPos == _results.size()) {
+        _internalState = State::kDone;
+        return PlanStage::IS_EOF;
+    }
+
+    RecordId recordId = _pixAccess->findRecordId(getOpCtx(), _results[_resultPos].docid);
+    if (recordId.isNull()) {
+        // No document has this docid any more.
+        ++_resultPos;
+        return PlanStage::NEED_TIME;
+    }
+
+    WorkingSetID wsid = _ws->allocate();
+    WorkingSetMember* wsm = _ws->get(wsid);
+    wsm->recordId = recordId;
+
+    try {
+        auto record = _recordCursor->seekExact(wsm->recordId);
+        ++_specificStats.fetches;
+        if (!record) {
+            // The document was deleted after its posting was read.
+            _ws->free(wsid);
+            ++_resultPos;
+            return PlanStage::NEED_TIME;
+        }
+        wsm->obj = {getOpCtx()->recoveryUnit()->getSnapshotId(), record->data.releaseToBson()};
+        _ws->transitionToRecordIdAndObj(wsid);
+    } catch (const WriteConflictException& wce) {
+        // Retry the same posting after yielding.
+        _ws->free(wsid);
+        *out = WorkingSet::INVALID_ID;
+        return PlanStage::NEED_YIELD;
+    }
+
+    const double score = _results[_resultPos].score;
+    ++_resultPos;
+
+    if (!Filter::passes(wsm, _filter)) {
+        _ws->free(wsid);
+        return PlanStage::NEED_TIME;
+    }
+
+    // Populate the working set member with the text score and return it.
+    wsm->addComputed(new TextScoreComputedData(score));
+    *out = wsid;
+    return PlanStage::ADVANCED;
+}
+
+}  // namespace mongo
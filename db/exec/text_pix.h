@@ -0,0 +1,183 @@
+/**
+ *    Copyright (C) 2016 MongoDB Inc.
+ *
+ *    This program is free software: you can redistribute it and/or  modify
+ *    it under the terms of the GNU Affero General Public License, version 3,
+ *    as published by the Free Software Foundation.
+ *
+ *    This program is distributed in the hope that it will be useful,
+ *    but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *    GNU Affero General Public License for more details.
+ *
+ *    You should have received a copy of the GNU Affero General Public License
+ *    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ *    As a special exception, the copyright holders give permission to link the
+ *    code of portions of this program with the OpenSSL library under certain
+ *    conditions as described in each individual source file and distribute
+ *    linked combinations including the program with the OpenSSL library. You
+ *    must comply with the GNU Affero General Public License in all respects for
+ *    all of the code used other than as permitted herein. If you modify file(s)
+ *    with this exception, you may extend this exception to your version of the
+ *    file(s), but you are not obligated to do so. If you do not wish to do so,
+ *    delete this exception statement from your version. If you delete this
+ *    exception statement from all source files in the program, then also delete
+ *    it in the license file.
+ */
+
+#pragma once
+
+#include <memory>
+#include <vector>
+
+#include "mongo/db/catalog/collection.h"
+#include "mongo/db/exec/plan_stage.h"
+#include "mongo/db/exec/text.h"
+#include "mongo/db/fts/fts_phrase_positions.h"
+#include "mongo/db/fts/pix_posting_cursor.h"
+#include "mongo/db/index/index_descriptor.h"
+#include "mongo/db/matcher/expression.h"
+#include "mongo/db/record_id.h"
+
+namespace mongo {
+
+using std::unique_ptr;
+using std::vector;
+
+class OperationContext;
+class PixAccessMethod;
+
+/**
+ * A blocking stage that answers a text query from a pix text index.
+ *
+ * Each child is an index scan over the entries of one query term: posting blocks, deltas and
+ * tombstones (see PixAccessMethod).  The packed blocks and deltas are buffered per term,
+ * accrued in docid order through PostingCursors without decoding them into PostingLists, with
+ * tombstoned block postings skipped, and every document that contains at least one positive
+ * term is fetched and returned with its score.  Documents whose positions miss a positive phrase
+ * are dropped before they are fetched.
+ *
+ * If 'topK' is nonzero and there is no filter, only the 'topK' highest scoring documents are
+ * fetched and returned, in no particular order.  The docids whose cursors are all in blocks
+ * whose max tf cannot add up to the k-th best score are passed over without being decoded.
+ *
+ * The WorkingSetMembers returned are fetched and in the LOC_AND_OBJ state.
+ */
+class TextPixStage final : public PlanStage {
+public:
+    /**
+     * Internal states.
+     */
+    enum class State {
+        // 1. Initialize the _recordCursor.
+        kInit,
+
+        // 2. Read the posting blocks of every term from the text index.
+        kReadingTerms,
+
+        // 3. Return results to our parent.
+        kReturningResults,
+
+        // 4. Finished.
+        kDone,
+    };
+
+    TextPixStage(OperationContext* txn,
+                 const TextStageParams& params,
+                 WorkingSet* ws,
+                 const MatchExpression* filter,
+                 size_t topK);
+    ~TextPixStage();
+
+    void addChild(unique_ptr<PlanStage> child);
+
+    bool isEOF() final;
+
+    StageState doWork(WorkingSetID* out) final;
+
+    void doSaveState() final;
+    void doRestoreState() final;
+    void doDetachFromOperationContext() final;
+    void doReattachToOperationContext() final;
+
+    StageType stageType() const final {
+        return STAGE_TEXT_PIX;
+    }
+
+    std::unique_ptr<PlanStageStats> getStats() final;
+
+    const SpecificStats* getSpecificStats() const final;
+
+    static const char* kStageType;
+
+private:
+    /**
+     * Worker for kInit. Initializes the _recordCursor member and handles the potential for
+     * getCursor() to throw WriteConflictException.
+     */
+    StageState initStage(WorkingSetID* out);
+
+    /**
+     * Worker for kReadingTerms. Buffers the posting blocks returned by the current child.
+     */
+    StageState readFromChildren(WorkingSetID* out);
+
+    /**
+     * Accrues the buffered blocks and deltas of all terms into _results.
+     */
+    void mergePostings();
+
+    /**
+     * Helper for mergePostings: accrues 'cursors' like PostingCursor::_accrue, keeping only the
+     * documents whose positions hold every positive phrase.
+     */
+    void accruePhrases(const vector<PostingCursor*>& cursors);
+
+    /**
+     * Worker for kReturningResults. Fetches the next document and returns it with its score.
+     */
+    StageState returnResults(WorkingSetID* out);
+
+    // Parameters of this text stage.
+    const TextStageParams& _params;
+
+    // Not owned by us.
+    WorkingSet* _ws;
+
+    // What state are we in?  See the State enum above.
+    State _internalState = State::kInit;
+
+    // Which of _children are we calling work(...) on now?
+    size_t _currentChild = 0;
+
+    // If nonzero, the number of best scoring documents wanted.
+    size_t _k;
+
+    // Packed posting blocks, deltas and tombstoned docids read by each child, in docid order.
+    typedef std::vector<unsigned char> PackedBlock;
+    vector<vector<PackedBlock>> _termBlocks;
+    vector<vector<PackedBlock>> _termDeltas;
+    vector<vector<unsigned>> _termTombstones;
+
+    // The child index of each cursor built by mergePostings().
+    vector<size_t> _cursorTerms;
+
+    // Accrued (docid, score) of all terms and the next one to return.
+    ScoredDocidList _results;
+    size_t _resultPos = 0;
+
+    TextPixStats _specificStats;
+
+    // Matches the positions of a document against the positive phrases; term ids are child
+    // indexes.
+    fts::PhrasePositionMatcher _phraseMatcher;
+
+    const MatchExpression* _filter;
+    std::unique_ptr<SeekableRecordCursor> _recordCursor;
+
+    // Maps the docids of the postings to RecordIds.  The IndexCatalog owns it.
+    const PixAccessMethod* _pixAccess;
+};
+
+}  // namespace mongo
@@ -28,10 +28,9 @@
 
 #include "mongo/db/exec/text_proximity.h"
 
-#include <map>
-#include <vector>
 #include <algorithm>
 #include <iostream>
+#include <vector>
 
 #include "mongo/db/concurrency/write_conflict_exception.h"
 #include "mongo/db/exec/index_scan.h"
@@ -39,6 +38,8 @@
 #include "mongo/db/exec/working_set.h"
 #include "mongo/db/exec/working_set_common.h"
 #include "mongo/db/exec/working_set_computed_data.h"
+#include "mongo/db/fts/fts_index_format.h"
+#include "mongo/db/fts/fts_language.h"
 #include "mongo/db/jsobj.h"
 #include "mongo/db/matcher/matchable.h"
 #include "mongo/db/query/internal_plans.h"
@@ -52,12 +53,37 @@ using std::vector;
 using std::string;
 using stdx::make_unique;
 
+using fts::FTSIndexFormat;
 using fts::FTSSpec;
 
 const char* TextProximityStage::kStageType = "TEXT_PROXIMITY";
 
 const bool tp_debug = false;
 
+namespace {
+
+/**
+ * The position in the query of each term in getTermsForBounds(), which is also the order of
+ * our children, or -1 if it does not appear there.
+ */
+std::vector<int> queryRanks(const TextStageParams& params) {
+    const std::vector<std::string>& termv = params.query.getTermv();
+    std::vector<int> ranks;
+    for (const auto& term : params.query.getTermsForBounds()) {
+        auto it = std::find(termv.begin(), termv.end(), term);
+        ranks.push_back(it == termv.end() ? -1 : static_cast<int>(it - termv.begin()));
+    }
+    return ranks;
+}
+
+const fts::FTSLanguage* queryLanguage(const TextStageParams& params) {
+    // The query was parsed with this language, so it is known to exist.
+    return fts::FTSLanguage::make(params.query.getLanguage(), params.spec.getTextIndexVersion())
+        .getValue();
+}
+
+}  // namespace
+
 TextProximityStage::TextProximityStage(OperationContext* txn,
                                        const TextStageParams& params,
                                        WorkingSet* ws,
@@ -67,8 +93,10 @@ TextProximityStage::TextProximityStage(OperationContext* txn,
     : PlanStage(kStageType, txn),
       _params(params),
       _ws(ws),
-      _proximityWindow(proximityWindow),
-      _reorderBound(reorderBound),
+      _matcher(queryRanks(params), proximityWindow, reorderBound),
+      _phraseMatcher(queryLanguage(params),
+                     params.query.getPositivePhr(),
+                     params.query.getTermsForBounds()),
       _filter(filter),
       _idRetrying(WorkingSet::INVALID_ID)
 {
@@ -80,6 +108,7 @@ TextProximityStage::~TextProximityStage() {}
 
 void TextProximityStage::addChild(unique_ptr<PlanStage> child) {
     _children.push_back(std::move(child));
+    _heads.push_back(ChildHead());
 }
 
 bool TextProximityStage::isEOF() {
@@ -109,7 +138,22 @@ void TextProximityStage::doReattachToOperationContext() {
 }
 
 void TextProximityStage::doInvalidate(OperationContext* txn, const RecordId& dl, InvalidationType type) {
-    // Remove the RecordID from internal data structures
+    // Drop the document: its positions stay in the merge, but it is never returned.
+    for (auto& head : _heads) {
+        if (head.loaded && head.recordId == dl && head.wsid != WorkingSet::INVALID_ID) {
+            _ws->free(head.wsid);
+            head.wsid = WorkingSet::INVALID_ID;
+        }
+    }
+
+    if (!_run.empty() && _runRecordId == dl) {
+        if (_runWsid != WorkingSet::INVALID_ID) {
+            _ws->free(_runWsid);
+            _runWsid = WorkingSet::INVALID_ID;
+        }
+        _runDropped = true;
+        _idRetrying = WorkingSet::INVALID_ID;
+    }
 }
 
 std::unique_ptr<PlanStageStats> TextProximityStage::getStats() {
@@ -149,9 +193,6 @@ PlanStage::StageState TextProximityStage::doWork(WorkingSetID* out) {
         case State::kReadingTerms:
             stageState = readFromChildren(out);
             break;
-        case State::kReturningResults:
-            stageState = returnResults(out);
-            break;
         case State::kDone:
             // Should have been handled above.
             invariant(false);
@@ -178,232 +219,159 @@ PlanStage::StageState TextProximityStage::readFromChildren(WorkingSetID* out) {
 
     // Check to see if there were any children added in the first place.
     if (_children.size() == 0) {
-        if (tp_debug)
-            std::cout << "readFromChildren:001" << std::endl;
         _internalState = State::kDone;
         return PlanStage::IS_EOF;
     }
 
-    // accumulate all results from all children
-
-    // Either retry the last WSM we worked on or get a new one from our current child.
-    WorkingSetID id;
-    StageState childState;
-
-    if (_idRetrying == WorkingSet::INVALID_ID) {
-        if (tp_debug)
-            std::cout << "readFromChildren:002" << std::endl;
-        childState = _children[_currentChild]->work(&id);
-    } else {
-        if (tp_debug)
-            std::cout << "readFromChildren:003" << std::endl;
-        childState = ADVANCED;
-        id = _idRetrying;
+    // Retry the document we yielded on.
+    if (_idRetrying != WorkingSet::INVALID_ID) {
         _idRetrying = WorkingSet::INVALID_ID;
+        return returnRun(out);
     }
 
-    switch(childState) {
-    case PlanStage::ADVANCED: {
-        if (tp_debug)
-            std::cout << "readFromChildren:004" << std::endl;
-        return addTerm(id, out);
+    // Load the next key of the first child that has none.
+    for (; _currentChild < _children.size(); ++_currentChild) {
+        const ChildHead& head = _heads[_currentChild];
+        if (!head.loaded && !head.eof)
+            break;
     }
-    case PlanStage::IS_EOF: {
-        if (tp_debug)
-            std::cout << "readFromChildren:005" << std::endl;
-        // Done with this child.
-        ++_currentChild;
-
-        if (tp_debug)
-            std::cout << "currentChild = " << _currentChild
-                  << ", children.size = " << _children.size() << std::endl;
-
-        if (_currentChild < _children.size()) {
-            if (tp_debug)
-                std::cout << "readFromChildren:005a" << std::endl;
-            // We have another child to read from.
-            return PlanStage::NEED_TIME;
-        }
-
-        // If we're here we are done reading results.  Move to the next state.
-        collectResults();
-        _resultSetIterator = _resultSet.begin();
-        _internalState = State::kReturningResults;
 
-        return PlanStage::NEED_TIME;
-    }
-    case PlanStage::FAILURE: {
-        if (tp_debug)
-            std::cout << "readFromChildren:006" << std::endl;
-
-        // If a stage fails, it may create a status WSM to indicate why it
-        // failed, in which case 'id' is valid.  If ID is invalid, we
-        // create our own error message.
-        if (WorkingSet::INVALID_ID == id) {
-            if (tp_debug)
-                std::cout << "readFromChildren:006a" << std::endl;
-            mongoutils::str::stream ss;
-            ss << "TEXT_PROXIMITY stage failed to read in results from child";
-            Status status(ErrorCodes::InternalError, ss);
-            *out = WorkingSetCommon::allocateStatusMember(_ws, status);
-        } else {
-            if (tp_debug)
-                std::cout << "readFromChildren:006b" << std::endl;
-            *out = id;
+    if (_currentChild < _children.size()) {
+        WorkingSetID id = WorkingSet::INVALID_ID;
+        StageState childState = _children[_currentChild]->work(&id);
+
+        switch (childState) {
+            case PlanStage::ADVANCED:
+                loadHead(_currentChild, id);
+                return PlanStage::NEED_TIME;
+            case PlanStage::IS_EOF:
+                _heads[_currentChild].eof = true;
+                return PlanStage::NEED_TIME;
+            case PlanStage::FAILURE: {
+                // If a stage fails, it may create a status WSM to indicate why it
+                // failed, in which case 'id' is valid.  If ID is invalid, we
+                // create our own error message.
+                if (WorkingSet::INVALID_ID == id) {
+                    mongoutils::str::stream ss;
+                    ss << "TEXT_PROXIMITY stage failed to read in results from child";
+                    Status status(ErrorCodes::InternalError, ss);
+                    *out = WorkingSetCommon::allocateStatusMember(_ws, status);
+                } else {
+                    *out = id;
+                }
+                return PlanStage::FAILURE;
+            }
+            default:
+                // Propagate WSID from below.
+                *out = id;
+                return childState;
         }
-        return PlanStage::FAILURE;
     }
-    default: {
-        if (tp_debug)
-            std::cout << "readFromChildren:007 (state = "
-                    << PlanStage::stateStr(childState)
-                    << ")" << std::endl;
-        // Propagate WSID from below.
-        *out = id;
-        return childState;
+    _currentChild = 0;
+
+    // Every child is positioned: find the next document.
+    bool live = false;
+    RecordId next;
+    for (const auto& head : _heads) {
+        if (!head.loaded)
+            continue;
+        if (!live || head.recordId < next)
+            next = head.recordId;
+        live = true;
     }
+
+    if (!_run.empty() && (!live || next != _runRecordId)) {
+        // No child has any more positions for the current document.
+        return finishRun(out);
     }
-}
 
-bool TextProximityStage::proximitySort(TextRecordData& x, TextRecordData& y) {
-    if (x.recId < y.recId) return true;
-    if (x.recId > y.recId) return false;
-    if (x.pos < y.pos) return true;
-    return false;
-}
+    if (!live) {
+        _internalState = State::kDone;
+        return PlanStage::IS_EOF;
+    }
 
-uint64_t _hash(const std::string& s) {
-    uint64_t r = 0x01000193;
-    const unsigned char* p = (unsigned char*)s.c_str();
-    for (; *p; ++p) r = (r * 0x01000193) ^ *p;
-    return r;
+    _runRecordId = next;
+    consumeHeads();
+    return PlanStage::NEED_TIME;
 }
 
-int _indexOf(const std::vector<uint64_t>& v, uint64_t key) {
-    for (uint32_t n = 0; n<v.size(); ++n)
-        if (v[n] == key) return n;
-    return -1;
-}
+void TextProximityStage::loadHead(size_t child, WorkingSetID wsid) {
+    WorkingSetMember* wsm = _ws->get(wsid);
+    invariant(wsm->getState() == WorkingSetMember::RID_AND_IDX);
+    invariant(1 == wsm->keyData.size());
 
-bool _checkPermutation(std::vector<uint32_t>& perm, uint32_t bound) {
-    // bubblesort.
-    if (tp_debug)
-        std::cout << "checkPermutation(bound = " << bound << ")" << std::endl;
-
-    bool swapped = true;
-    uint32_t nswaps = 0;
-    uint32_t j = 0;
-    uint32_t n = perm.size();
-
-    while (swapped) {
-        swapped = false;
-        ++j;
-        for (uint32_t i = 0; i < n-j; ++i) {
-            if (perm[i] > perm[i+1]) {
-                std::swap(perm[i], perm[i+1]);
-                swapped = true;
-                ++nswaps;
-            }
-        }
+    // compound key {prefix,term,recId,pos} or {prefix,term,recId,BinData(positions)}.
+    BSONObjIterator keyIt(wsm->keyData.back().keyData);
+    for (unsigned i = 0; i < _params.spec.numExtraBefore(); i++) {
+        keyIt.next();
     }
-    if (tp_debug)
-        std::cout << "checkPermutation : nswaps = " << nswaps << std::endl;
-    return (nswaps <= bound);
-}
-
-void TextProximityStage::collectResults() {
-
-    uint64_t recId = 0;
-    uint32_t nterms = _params.query.getTermsForBounds().size();
+    keyIt.next();  // term: the same for every key of this child
+    keyIt.next();  // recId
+    BSONElement posElement = keyIt.next();
 
-    std::vector<const TextRecordData*> runv;    // run of records for common RecordId.
-    std::vector<uint64_t>* termv;               // query term hashes in given order.
-    std::vector<uint32_t>* termperm;            // permutation of terms in matching window.
+    ChildHead& head = _heads[child];
+    head.wsid = wsid;
+    head.recordId = wsm->recordId;
+    head.positions.clear();
+    FTSIndexFormat::getProximityPositions(posElement, &head.positions);
+    head.loaded = true;
 
     if (tp_debug)
-        std::cout << "_reorderBound = " << _reorderBound << std::endl;
-
-    if (_reorderBound >= 0) {
-        // set up permutation testing.
-        termperm = new std::vector<uint32_t>(nterms);
-        termv = new std::vector<uint64_t>(nterms);
-        std::vector<std::string>::const_iterator it;
-        for (it = _params.query.getTermv().begin(); it != _params.query.getTermv().end(); ++it) {
-            if (tp_debug)
-                std::cout << "termv->push_back(_hash(" << *it << "));" << std::endl;
-            termv->push_back(_hash(*it));
+        std::cout << "loadHead(" << child << ", " << head.recordId << ", "
+                  << head.positions.size() << " positions)" << std::endl;
+}
+
+void TextProximityStage::consumeHeads() {
+    for (uint32_t child = 0; child < _heads.size(); ++child) {
+        ChildHead& head = _heads[child];
+        if (!head.loaded || head.recordId != _runRecordId)
+            continue;
+
+        for (uint32_t pos : head.positions)
+            _run.push_back(fts::ProximityWindowMatcher::Occurrence(child, pos));
+
+        // Keep the first WSM of the document to return; the key of any one term will do
+        // for covered matching on the prefix fields.
+        if (head.wsid == WorkingSet::INVALID_ID) {
+            _runDropped = true;
+        } else if (_runWsid == WorkingSet::INVALID_ID && !_runDropped) {
+            _runWsid = head.wsid;
+        } else {
+            _ws->free(head.wsid);
         }
+        head.wsid = WorkingSet::INVALID_ID;
+        head.loaded = false;
     }
+}
 
-    // sort the entire working set and process runs of common RecordIds
-    std::sort(_posv.begin(), _posv.end(), proximitySort);
-    std::vector<TextRecordData>::const_iterator it2 = _posv.begin();
-
-    for (; it2 != _posv.end(); ++it2) {
-        if (it2->recId != recId) {
-            // we have a run of common recordIds stored in runv.
-            termperm->clear();
-            if (tp_debug)
-                std::cout << "runv.size() = " << runv.size() << std::endl;
-
-            std::vector<const TextRecordData*>::const_iterator it3;
-            for (it3 = runv.begin(); it3 != runv.end(); ++it3) {
-                // scan for all terms within _proximityWindow.
-
-                std::set<std::string> terms;    // for counting unique matching terms.
-                uint32_t width = 0;             // current width of match window.
-                uint32_t pos = (*it3)->pos;     // current term position.
-                uint32_t depth = 0;
-
-                std::vector<const TextRecordData*>::const_iterator it4;
-                for (it4 = it3; it4 != runv.end() && width < _proximityWindow; ++it4, ++depth) {
-
-                    const std::string& term = (*it4)->term;
-                    uint32_t termPos = (*it4)->pos;
-
-                    if (tp_debug) {
-                        for (uint32_t z = 0; z<depth; ++z) std::cout << ' ';
-                        std::cout << "(id, term, pos) = (" << recId << ", "
-                                  << term << ", " << termPos << ")" << std::endl;
-                    }
-
-                    width += (termPos - pos);
-                    pos = termPos;
-                    terms.insert(term);
-
-                    if (_reorderBound >= 0) {
-                        int i = _indexOf(*termv, _hash(term));
-                        if (-1==i) {
-                            if (tp_debug)
-                                std::cout << "Uh-oh, internal inconsistentcy: index term hash"
-                                         " does not match any query term hash!" << std:: endl;
-                            break;
-                        }
-                        termperm->push_back((uint32_t)i);
-                    }
+void TextProximityStage::clearRun() {
+    if (_runWsid != WorkingSet::INVALID_ID)
+        _ws->free(_runWsid);
+    _runWsid = WorkingSet::INVALID_ID;
+    _runDropped = false;
+    _run.clear();
+}
 
-                    if (terms.size() == nterms && width < _proximityWindow) {
-                        if (-1 == _reorderBound || _checkPermutation(*termperm, _reorderBound))
-                            _resultSet.push_back((*it4)->wsid);
-                        break;
-                    }
-                }
-            }
-            recId = it2->recId;
-            runv.clear();
-        }
-        runv.push_back(&(*it2));
+PlanStage::StageState TextProximityStage::finishRun(WorkingSetID* out) {
+    if (_runDropped || !matchesRun()) {
+        clearRun();
+        return PlanStage::NEED_TIME;
+    }
+    if (!_phraseMatcher.matches(_run)) {
+        ++_specificStats.phraseRejects;
+        clearRun();
+        return PlanStage::NEED_TIME;
     }
+    return returnRun(out);
 }
 
-PlanStage::StageState TextProximityStage::returnResults(WorkingSetID* out) {
-    if (_resultSetIterator == _resultSet.end()) {
-        _internalState = State::kDone;
-        return PlanStage::IS_EOF;
-    }
-    *out = *_resultSetIterator;
-    ++_resultSetIterator;
-    return PlanStage::ADVANCED;
+bool TextProximityStage::matchesRun() {
+    // the children are merged on RecordId only; order this document's terms by position.
+    std::sort(_run.begin(),
+              _run.end(),
+              [](const fts::ProximityWindowMatcher::Occurrence& x,
+                 const fts::ProximityWindowMatcher::Occurrence& y) { return x.pos < y.pos; });
+    return _matcher.matches(_run);
 }
 
 /**
@@ -481,128 +449,72 @@ private:
     WorkingSetID _id;
 };
 
-PlanStage::StageState TextProximityStage::addTerm(WorkingSetID wsid, WorkingSetID* out) {
-    WorkingSetMember* wsm = _ws->get(wsid);
-    invariant(wsm->getState() == WorkingSetMember::RID_AND_IDX);
-    invariant(1 == wsm->keyData.size());
-    IndexKeyDatum newKeyData = wsm->keyData.back();  // copy to keep it around.
-    uint64_t loc = wsm->recordId.repr();
-    TextRecordData* textRecordData = &_posMap[wsm->recordId];
-
-    if (textRecordData->rejected) {
-        // We rejected this document for not matching the filter.
-        invariant(WorkingSet::INVALID_ID == textRecordData->wsid);
-        _ws->free(wsid);
-        if (tp_debug)
-            std::cout << "addTerm:001" << std::endl;
-        return NEED_TIME;
+PlanStage::StageState TextProximityStage::returnRun(WorkingSetID* out) {
+    if (_runDropped) {
+        // Invalidated while we yielded.
+        clearRun();
+        return PlanStage::NEED_TIME;
     }
 
-    if (WorkingSet::INVALID_ID == textRecordData->wsid) {
-        if (tp_debug)
-            std::cout << "addTerm:002" << std::endl;
-
-        // We haven't seen this RecordId before.
-        bool shouldKeep = true;
-
-        if (_filter) {
-            if (tp_debug)
-                std::cout << "addTerm:003" << std::endl;
-
-            // We have not seen this document before and need to apply a filter.
-            bool wasDeleted = false;
-            try {
-                TextMatchableDocument tdoc(getOpCtx(),
-                                           newKeyData.indexKeyPattern,
-                                           newKeyData.keyData,
-                                           _ws,
-                                           wsid,
-                                           _recordCursor);
-                shouldKeep = _filter->matches(&tdoc);
-            } catch (const WriteConflictException& wce) {
-                // Ensure that the BSONObj underlying the WorkingSetMember is owned because it may
-                // be freed when we yield.
-                wsm->makeObjOwnedIfNeeded();
-                _idRetrying = wsid;
-                *out = WorkingSet::INVALID_ID;
-                if (tp_debug)
-                    std::cout << "addTerm:004" << std::endl;
-                return NEED_YIELD;
-            } catch (const TextMatchableDocument::DocumentDeletedException&) {
-                // We attempted to fetch the document but decided it should be excluded from the
-                // result set.
-                shouldKeep = false;
-                wasDeleted = true;
-            }
-
-            if (wasDeleted || wsm->hasObj()) {
-                ++_specificStats.fetches;
-            }
+    WorkingSetID wsid = _runWsid;
+    WorkingSetMember* wsm = _ws->get(wsid);
+    bool shouldKeep = true;
+
+    if (_filter && !wsm->hasObj()) {
+        // Apply the filter, covered by the prefix fields of the key where possible.
+        invariant(1 == wsm->keyData.size());
+        IndexKeyDatum keyData = wsm->keyData.back();  // copy to keep it around.
+        bool wasDeleted = false;
+        try {
+            TextMatchableDocument tdoc(getOpCtx(),
+                                       keyData.indexKeyPattern,
+                                       keyData.keyData,
+                                       _ws,
+                                       wsid,
+                                       _recordCursor);
+            shouldKeep = _filter->matches(&tdoc);
+        } catch (const WriteConflictException& wce) {
+            // Ensure that the BSONObj underlying the WorkingSetMember is owned because it may
+            // be freed when we yield.
+            wsm->makeObjOwnedIfNeeded();
+            _idRetrying = wsid;
+            *out = WorkingSet::INVALID_ID;
+            return NEED_YIELD;
+        } catch (const TextMatchableDocument::DocumentDeletedException&) {
+            // We attempted to fetch the document but decided it should be excluded from the
+            // result set.
+            shouldKeep = false;
+            wasDeleted = true;
         }
 
-        if (shouldKeep && !wsm->hasObj()) {
-            if (tp_debug)
-                std::cout << "addTerm:005" << std::endl;
-
-            // Our parent expects RID_AND_OBJ members: fetch the document if we haven't already.
-            try {
-                shouldKeep = WorkingSetCommon::fetch(getOpCtx(), _ws, wsid, _recordCursor);
-                ++_specificStats.fetches;
-            } catch (const WriteConflictException& wce) {
-                wsm->makeObjOwnedIfNeeded();
-                _idRetrying = wsid;
-                *out = WorkingSet::INVALID_ID;
-                if (tp_debug)
-                    std::cout << "addTerm:006" << std::endl;
-                return NEED_YIELD;
-            }
+        if (wasDeleted || wsm->hasObj()) {
+            ++_specificStats.fetches;
         }
+    }
 
-        if (!shouldKeep) {
-            _ws->free(wsid);
-            textRecordData->rejected = true;
-            if (tp_debug)
-                std::cout << "addTerm:007" << std::endl;
-            return NEED_TIME;
+    if (shouldKeep && !wsm->hasObj()) {
+        // Our parent expects RID_AND_OBJ members: fetch the document if we haven't already.
+        try {
+            shouldKeep = WorkingSetCommon::fetch(getOpCtx(), _ws, wsid, _recordCursor);
+            ++_specificStats.fetches;
+        } catch (const WriteConflictException& wce) {
+            wsm->makeObjOwnedIfNeeded();
+            _idRetrying = wsid;
+            *out = WorkingSet::INVALID_ID;
+            return NEED_YIELD;
         }
-
-        textRecordData->wsid = wsid;
-
-        // Ensure that the BSONObj underlying the WorkingSetMember is owned in case we yield.
-        wsm->makeObjOwnedIfNeeded();
-
-    } else {
-        // We already have a working set member for this RecordId. Free the new WSM and retrieve the
-        // old one. Note that since we don't keep all index keys, we could get a score that doesn't
-        // match the document, but this has always been a problem.
-        // TODO something to improve the situation.
-        invariant(wsid != textRecordData->wsid);
-        _ws->free(wsid);
-        wsm = _ws->get(textRecordData->wsid);
     }
 
-    // compound key {prefix,term,pos}.
-    BSONObjIterator keyIt(newKeyData.keyData);
-    for (unsigned i = 0; i < _params.spec.numExtraBefore(); i++) {
-        keyIt.next();
+    if (!shouldKeep) {
+        clearRun();
+        return NEED_TIME;
     }
 
-    BSONElement termElement = keyIt.next();
-    std::string term = termElement.String();
-
-    BSONElement posElement = keyIt.next();
-    uint32_t pos = (uint32_t)posElement.Int();
-
-    // Aggregate {term,recordId,pos}
-    textRecordData->term = term;
-    textRecordData->recId = loc;
-    textRecordData->pos = pos;
-
-    _posv.push_back(*textRecordData);
-    if (tp_debug)
-        std::cout << "textRecordData(" << term << ", " << loc << ", " << pos << ")" <<std::endl;
-
-    return NEED_TIME;
+    // The member now belongs to our parent.
+    _runWsid = WorkingSet::INVALID_ID;
+    clearRun();
+    *out = wsid;
+    return PlanStage::ADVANCED;
 }
 
 }  // namespace mongo
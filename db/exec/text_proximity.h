@@ -34,6 +34,8 @@
 #include "mongo/db/catalog/collection.h"
 #include "mongo/db/exec/plan_stage.h"
 #include "mongo/db/exec/text.h"
+#include "mongo/db/fts/fts_phrase_positions.h"
+#include "mongo/db/fts/fts_proximity_window.h"
 #include "mongo/db/fts/fts_spec.h"
 #include "mongo/db/index/index_descriptor.h"
 #include "mongo/db/matcher/expression.h"
@@ -49,8 +51,15 @@ using fts::FTSSpec;
 class OperationContext;
 
 /**
- * A blocking stage that returns the set of WSMs with RecordIDs of documents
- * that contain all the positive terms in the search query.
+ * A streaming stage that returns the set of WSMs with RecordIDs of documents
+ * that contain all the positive terms in the search query within the
+ * proximity window.
+ *
+ * Each child scans the proximity keys of one term, which are ordered by
+ * (RecordId, position).  The children are merged on RecordId, collecting the
+ * term positions of one document at a time; a document is matched and
+ * returned as soon as every child has moved past it.  Documents whose
+ * positions miss a positive phrase are dropped before they are fetched.
  *
  * The WorkingSetMembers returned are fetched and in the LOC_AND_OBJ state.
  */
@@ -63,13 +72,10 @@ public:
         // 1. Initialize the _recordCursor.
         kInit,
 
-        // 2. Read the terms/recId/pos from the text index.
+        // 2. Merge the terms/recId/pos from the text index, returning matching documents.
         kReadingTerms,
 
-        // 3. Return results to our parent.
-        kReturningResults,
-
-        // 4. Finished.
+        // 3. Finished.
         kDone,
     };
 
@@ -101,14 +107,13 @@ public:
     static const char* kStageType;
 
 private:
-    // Temporary score data filled out by children.
-    struct TextRecordData {
-        TextRecordData() : wsid(WorkingSet::INVALID_ID), rejected(false), recId(0), pos(0) {}
-        WorkingSetID wsid;
-        bool rejected;
-        std::string term;
-        uint64_t recId;
-        uint32_t pos;
+    // The next unconsumed index key of one child.
+    struct ChildHead {
+        WorkingSetID wsid = WorkingSet::INVALID_ID;
+        RecordId recordId;
+        std::vector<uint32_t> positions;
+        bool loaded = false;
+        bool eof = false;
     };
 
     /**
@@ -120,40 +125,56 @@ private:
 
     /**
      * Worker for kReadingTerms.
-     * Reads from the children, searching for matching (recId, pos)
+     * Loads the next key of a child, or advances the merge by one document.
      */
     StageState readFromChildren(WorkingSetID* out);
 
     /**
-     * Helper called from readFromChildren.
+     * Helper called from readFromChildren: loads the key in 'wsid' into the head of 'child'.
+     */
+    void loadHead(size_t child, WorkingSetID wsid);
+
+    /**
+     * Moves the heads positioned on the current document into _run.
      */
-    StageState addTerm(WorkingSetID wsid, WorkingSetID* out);
+    void consumeHeads();
 
     /**
-     * Worker for kReturningResults.
+     * Called once every child has moved past the current document: matches its
+     * positions against the proximity window and returns it if it qualifies.
      */
-    StageState returnResults(WorkingSetID* out);
+    StageState finishRun(WorkingSetID* out);
 
     /**
-     * Sort _posMap into _posv.
+     * Applies the filter to the current document and fetches it.  Retried after a yield.
      */
-    void collectResults();
-    static bool proximitySort(TextRecordData&, TextRecordData&);
+    StageState returnRun(WorkingSetID* out);
+
+    /**
+     * True if the positions in _run contain every query term within the proximity window.
+     */
+    bool matchesRun();
+
+    void clearRun();
 
     // State.
     const TextStageParams& _params;
     WorkingSet* _ws;
     State _internalState = State::kInit;
     size_t _currentChild = 0;
-    uint32_t _proximityWindow;
-    int _reorderBound;
 
-    typedef unordered_map<RecordId, TextRecordData, RecordId::Hasher> PositionMap;
-    PositionMap _posMap;
+    // Match a document's positions; term ids are child indexes.
+    fts::ProximityWindowMatcher _matcher;
+    fts::PhrasePositionMatcher _phraseMatcher;
+
+    std::vector<ChildHead> _heads;
 
-    std::vector<TextRecordData> _posv;
-    std::vector<WorkingSetID> _resultSet;
-    std::vector<WorkingSetID>::const_iterator _resultSetIterator;
+    // The document being merged: its positions, sorted by matchesRun(), and the WSM returned
+    // for it.  _runDropped is set if the document was invalidated.
+    RecordId _runRecordId;
+    std::vector<fts::ProximityWindowMatcher::Occurrence> _run;
+    WorkingSetID _runWsid = WorkingSet::INVALID_ID;
+    bool _runDropped = false;
 
     // Members needed only for using the TextMatchableDocument.
     const MatchExpression* _filter;
@@ -74,7 +74,8 @@ bool BasicFTSTokenizer::moveNext() {
 
         // Stop words are case-sensitive so we need them to be lower cased to check
         // against the stop word list
-        if ((_options & FTSTokenizer::kFilterStopWords) && _stopWords->isStopWord(word)) {
+        _isStopWord = _stopWords->isStopWord(word);
+        if ((_options & FTSTokenizer::kFilterStopWords) && _isStopWord) {
             continue;
         }
 
@@ -82,7 +83,8 @@ bool BasicFTSTokenizer::moveNext() {
             word = token.data.toString();
         }
 
-        _stem = _stemmer.stem(word);
+        StringData stem = _stemmer.stem(word);
+        _stem.assign(stem.rawData(), stem.size());
         _word = word;       // @@@proximity
         return true;
     }
@@ -96,5 +98,9 @@ StringData BasicFTSTokenizer::getWord() const {
     return _word;
 }
 
+bool BasicFTSTokenizer::isStopWord() const {
+    return _isStopWord;
+}
+
 }  // namespace fts
 }  // namespace mongo
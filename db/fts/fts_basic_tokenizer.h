@@ -68,6 +68,7 @@ public:
 
     StringData get() const override;
     StringData getWord() const override;
+    bool isStopWord() const override;
 
 private:
     const FTSLanguage* const _language;
@@ -80,6 +81,7 @@ private:
 
     std::string _stem;
     std::string _word;
+    bool _isStopWord = false;
 };
 
 }  // namespace fts
@@ -35,6 +35,8 @@
 #include "mongo/base/init.h"
 #include "mongo/db/fts/fts_index_format.h"
 #include "mongo/db/fts/fts_spec.h"
+#include "mongo/db/fts/pix_codec.h"
+#include "mongo/db/fts/pix_doc_posting.h"
 #include "mongo/util/hex.h"
 #include "mongo/util/md5.hpp"
 #include "mongo/util/mongoutils/str.h"
@@ -51,6 +53,10 @@ namespace {
 BSONObj nullObj;
 BSONElement nullElt;
 
+// BinData subtypes of pix delta and tombstone entries; blocks use BinDataGeneral.
+const BinDataType kPixDeltaSubtype = bdtCustom;
+const BinDataType kPixTombstoneSubtype = static_cast<BinDataType>(bdtCustom + 1);
+
 // New in textIndexVersion 2.
 // If the term is longer than 32 characters, it may
 // result in the generated key being too large
@@ -117,6 +123,8 @@ void FTSIndexFormat::getKeysProximity(
     const BSONObj& obj,
     BSONObjSet* keys)
 {
+    spec.uassertProximityKeysUsable();
+
     TermPositionMap term_pos;
     spec.scanDocument(obj, &term_pos);
 
@@ -125,12 +133,57 @@ void FTSIndexFormat::getKeysProximity(
         const string& term = i->first;
         const PositionList& posList = i->second;
 
+        if (spec.proximityIndexVersion() == PROXIMITY_INDEX_VERSION_3) {
+            for (PositionList::const_iterator j = posList.begin(); j != posList.end(); ++j) {
+                BSONObjBuilder b(64);
+                b.append("", term);
+                b.append("", *j);
+                keys->insert(b.obj());
+            }
+            continue;
+        }
+
+        // Version 2: the positions as varint deltas, in as few keys as kProximityMaxBlobBytes
+        // allows.  Each key codes its first position from 0.
+        vector<unsigned char> blob;
+        uint32_t lastPos = 0;
         for (PositionList::const_iterator j = posList.begin(); j != posList.end(); ++j) {
-            BSONObjBuilder b(64);
-            b.append("", term);
-            b.append("", *j);
-            keys->insert(b.obj());
+            if (blob.size() + 5 > kProximityMaxBlobBytes) {
+                _insertProximityKey(term, blob, keys);
+                blob.clear();
+                lastPos = 0;
+            }
+            PixCodec::varEncode(blob, *j - lastPos);
+            lastPos = *j;
         }
+        _insertProximityKey(term, blob, keys);
+    }
+}
+
+void FTSIndexFormat::_insertProximityKey(const string& term,
+                                         const vector<unsigned char>& blob,
+                                         BSONObjSet* keys) {
+    BSONObjBuilder b(64 + blob.size());
+    b.append("", term);
+    b.appendBinData("", blob.size(), BinDataGeneral, blob.empty() ? NULL : &blob[0]);
+    keys->insert(b.obj());
+}
+
+void FTSIndexFormat::getProximityPositions(const BSONElement& e, vector<uint32_t>* positions) {
+    if (e.type() != BinData) {
+        positions->push_back(static_cast<uint32_t>(e.numberInt()));
+        return;
+    }
+
+    int len;
+    const unsigned char* p = reinterpret_cast<const unsigned char*>(e.binData(len));
+    const unsigned char* end = p + len;
+    uint32_t pos = 0;
+    while (p < end) {
+        uint32_t delta;
+        p += PixCodec::varDecode(p, &delta);
+        pos += delta;
+        positions->push_back(pos);
     }
 }
 
@@ -144,6 +197,11 @@ void FTSIndexFormat::getKeys(
         return;
     }
 
+    if (spec.pixIndex()) {
+        getKeysPix(spec, obj, keys);
+        return;
+    }
+
     int extraSize = 0;
     vector<BSONElement> extrasBefore;
     vector<BSONElement> extrasAfter;
@@ -213,15 +271,143 @@ void FTSIndexFormat::getKeys(
     }
 }
 
+void FTSIndexFormat::getKeysPix(const FTSSpec& spec, const BSONObj& obj, BSONObjSet* keys) {
+    vector<BSONElement> extrasBefore;
+    for (unsigned i = 0; i < spec.numExtraBefore(); i++) {
+        BSONElement e = obj.getFieldDotted(spec.extraBefore(i));
+        if (e.eoo())
+            e = nullElt;
+        uassert(16675, "cannot have a multi-key as a prefix to a text index", e.type() != Array);
+        extrasBefore.push_back(e);
+    }
+
+    TermPositionMap term_pos;
+    spec.scanDocument(obj, &term_pos);
+
+    uassert(16732,
+            mongoutils::str::stream() << "too many unique keys for a single document to"
+                                      << " have a text index, max is " << maxKeysPerDoc
+                                      << obj["_id"],
+            term_pos.size() <= maxKeysPerDoc);
+
+    for (TermPositionMap::iterator i = term_pos.begin(); i != term_pos.end(); ++i) {
+        PositionList& posList = i->second;
+        if (posList.size() > kPixMaxPositions)
+            posList.resize(kPixMaxPositions);
+
+        // The docid is not known here; it is coded as 0 and supplied by the access method.
+        vector<unsigned char> block;
+        DocPosting(0, posList).pack(block, 0);
+
+        BSONObjBuilder b;
+        for (unsigned k = 0; k < extrasBefore.size(); k++) {
+            b.appendAs(extrasBefore[k], "");
+        }
+        _appendTerm(b, i->first, spec.getTextIndexVersion());
+        b.appendBinData("", block.size(), BinDataGeneral, &block[0]);
+        keys->insert(b.obj());
+    }
+}
+
+BSONObj FTSIndexFormat::getPixTermKey(const string& term,
+                                      const BSONObj& indexPrefix,
+                                      TextIndexVersion textIndexVersion) {
+    BSONObjBuilder b;
+    BSONObjIterator i(indexPrefix);
+    while (i.more())
+        b.appendAs(i.next(), "");
+    _appendTerm(b, term, textIndexVersion);
+    return b.obj();
+}
+
+BSONObj FTSIndexFormat::getPixBlockKey(const BSONObj& termKey,
+                                       uint32_t firstDocid,
+                                       const vector<unsigned char>& block) {
+    return getPixEntryKey(termKey, firstDocid, PixEntryKind::kBlock, block);
+}
+
+BSONObj FTSIndexFormat::getPixEntryKey(const BSONObj& termKey,
+                                       uint32_t docid,
+                                       PixEntryKind kind,
+                                       const vector<unsigned char>& data) {
+    BinDataType subtype = BinDataGeneral;
+    if (kind == PixEntryKind::kDelta)
+        subtype = kPixDeltaSubtype;
+    else if (kind == PixEntryKind::kTombstone)
+        subtype = kPixTombstoneSubtype;
+
+    BSONObjBuilder b;
+    BSONObjIterator i(termKey);
+    while (i.more())
+        b.appendAs(i.next(), "");
+    b.append("", static_cast<long long>(docid));
+    b.appendBinData("", data.size(), subtype, data.empty() ? NULL : &data[0]);
+    return b.obj();
+}
+
+FTSIndexFormat::PixEntryKind FTSIndexFormat::getPixEntryKind(const BSONElement& data) {
+    if (data.binDataType() == kPixDeltaSubtype)
+        return PixEntryKind::kDelta;
+    if (data.binDataType() == kPixTombstoneSubtype)
+        return PixEntryKind::kTombstone;
+    return PixEntryKind::kBlock;
+}
+
+BSONObj FTSIndexFormat::getPixSeekKey(const BSONObj& termKey, uint32_t docid, bool maxKey) {
+    BSONObjBuilder b;
+    BSONObjIterator i(termKey);
+    while (i.more())
+        b.appendAs(i.next(), "");
+    b.append("", static_cast<long long>(docid));
+    if (maxKey)
+        b.appendMaxKey("");
+    else
+        b.appendMinKey("");
+    return b.obj();
+}
+
+BSONObj FTSIndexFormat::getPixDocidKey(uint32_t docid) {
+    BSONObjBuilder b;
+    b.appendMinKey("");
+    b.append("", static_cast<long long>(docid));
+    return b.obj();
+}
+
+bool FTSIndexFormat::isPixDocidKey(const BSONObj& key, uint32_t* docid) {
+    BSONObjIterator i(key);
+    if (!i.more() || i.next().type() != MinKey || !i.more())
+        return false;
+    BSONElement e = i.next();
+    if (e.type() != NumberLong || i.more())
+        return false;
+    *docid = static_cast<uint32_t>(e.numberLong());
+    return true;
+}
+
 BSONObj FTSIndexFormat::getProximityIndexKey(const string& term,
-                                             uint32_t pos,
-                                             const BSONObj& indexPrefix) {
+                                             const BSONObj& indexPrefix,
+                                             bool maxKey) {
     BSONObjBuilder b;
     BSONObjIterator i(indexPrefix);
     while (i.more())
         b.appendAs(i.next(), "");
     b.append("", term);
-    b.append("", pos);
+    if (maxKey)
+        b.appendMaxKey("");
+    else
+        b.appendMinKey("");
+    return b.obj();
+}
+
+BSONObj FTSIndexFormat::getProximityStoredKey(const BSONObj& key, const RecordId& loc) {
+    BSONObjBuilder b;
+    BSONObjIterator i(key);
+    while (i.more()) {
+        BSONElement e = i.next();
+        if (!i.more())
+            b.append("", static_cast<long long>(loc.repr()));
+        b.appendAs(e, "");
+    }
     return b.obj();
 }
 
@@ -245,10 +431,16 @@ void FTSIndexFormat::_appendIndexKey(BSONObjBuilder& b,
                                      const string& term,
                                      TextIndexVersion textIndexVersion) {
     verify(weight >= 0 && weight <= MAX_WEIGHT);  // FTSmaxweight =  defined in fts_header
+    _appendTerm(b, term, textIndexVersion);
+    b.append("", weight);
+}
+
+void FTSIndexFormat::_appendTerm(BSONObjBuilder& b,
+                                 const string& term,
+                                 TextIndexVersion textIndexVersion) {
     // Terms are added to index key verbatim.
     if (TEXT_INDEX_VERSION_1 == textIndexVersion) {
         b.append("", term);
-        b.append("", weight);
     }
     // See comments at the top of file for termKeyPrefixLengthV2.
     // Apply hash for text index version 2 to long terms (longer than 32 characters).
@@ -266,7 +458,6 @@ void FTSIndexFormat::_appendIndexKey(BSONObjBuilder& b,
             invariant(termKeySuffixLengthV2 == keySuffix.size());
             b.append("", term.substr(0, termKeyPrefixLengthV2) + keySuffix);
         }
-        b.append("", weight);
     } else {
         invariant(TEXT_INDEX_VERSION_3 == textIndexVersion);
         if (term.size() <= termKeyPrefixLengthV3) {
@@ -276,7 +467,6 @@ void FTSIndexFormat::_appendIndexKey(BSONObjBuilder& b,
             invariant(termKeySuffixLengthV3 == keySuffix.size());
             b.append("", term.substr(0, termKeyPrefixLengthV3) + keySuffix);
         }
-        b.append("", weight);
     }
 }
 }
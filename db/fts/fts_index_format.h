@@ -31,6 +31,7 @@
 #pragma once
 
 #include <string>
+#include <vector>
 
 #include "mongo/base/string_data.h"
 #include "mongo/db/fts/fts_util.h"
@@ -58,11 +59,24 @@ public:
 */
 
     // @@@proximity
+    /**
+     * Generates the keys for a proximity index.  Version 3 emits {term, pos} for every
+     * occurrence; version 2 emits {term, BinData(positions)} per distinct term, the positions
+     * delta and varint coded, split over several keys only if they exceed
+     * kProximityMaxBlobBytes.
+     */
     static void getKeysProximity(
         const FTSSpec& spec,
         const BSONObj& obj,
         BSONObjSet* keys);
-        //const RecordId& loc);
+
+    /**
+     * Appends the positions held by the last element of a proximity key, in either version.
+     */
+    static void getProximityPositions(const BSONElement& e, std::vector<uint32_t>* positions);
+
+    // Upper bound on the packed positions of one version 2 proximity key.
+    static const size_t kProximityMaxBlobBytes = 256;
 
     /**
      * Helper method to get return entry from the FTSIndex as a BSONObj
@@ -77,9 +91,86 @@ public:
                                TextIndexVersion textIndexVersion);
 
     // @@@proximity
+    /**
+     * Returns {prefix, term, bound}, the first (or past the last) stored proximity key of a
+     * term.  Keys of a term are ordered by (RecordId, position).
+     */
     static BSONObj getProximityIndexKey(const std::string& term,
-                                        uint32_t pos,
-                                        const BSONObj& indexPrefix);
+                                        const BSONObj& indexPrefix,
+                                        bool maxKey);
+
+    /**
+     * Returns the stored form {prefix, term, NumberLong(loc), positions} of a key
+     * {prefix, term, positions} generated by getKeysProximity(), so that a scan over one term
+     * returns its documents in RecordId order.
+     */
+    static BSONObj getProximityStoredKey(const BSONObj& key, const RecordId& loc);
+
+    /**
+     * Generates the keys for a pix text index: one {prefix, term, positions} key per distinct
+     * term, where positions is BinData holding the document's DocPosting for that term.
+     * These keys are never stored as-is; PixAccessMethod folds them into posting blocks.
+     */
+    static void getKeysPix(const FTSSpec& spec, const BSONObj& obj, BSONObjSet* keys);
+
+    /**
+     * Returns {prefix, term} for a pix text index, with the term hashed as for the
+     * textIndexVersion of the index.
+     */
+    static BSONObj getPixTermKey(const std::string& term,
+                                 const BSONObj& indexPrefix,
+                                 TextIndexVersion textIndexVersion);
+
+    /**
+     * Kinds of entries stored under a term of a pix index, told apart by the BinData subtype
+     * of the last key field.  Blocks hold merged postings and are never updated in place.  A
+     * delta holds the posting of one document indexed since the term was last merged, and a
+     * tombstone marks a posting in a block whose document has since been unindexed.
+     */
+    enum class PixEntryKind { kBlock, kDelta, kTombstone };
+
+    /**
+     * Returns the stored pix posting block key {prefix, term, firstDocid, block}, where
+     * 'termKey' is {prefix, term} and 'block' is a packed PostingList.
+     */
+    static BSONObj getPixBlockKey(const BSONObj& termKey,
+                                  uint32_t firstDocid,
+                                  const std::vector<unsigned char>& block);
+
+    /**
+     * Returns the stored key {prefix, term, docid, data} of a pix entry of the given kind.
+     * 'data' is a packed PostingList for blocks and deltas, and empty for tombstones.
+     */
+    static BSONObj getPixEntryKey(const BSONObj& termKey,
+                                  uint32_t docid,
+                                  PixEntryKind kind,
+                                  const std::vector<unsigned char>& data);
+
+    /**
+     * Returns the kind of pix entry whose last key field is 'data'.
+     */
+    static PixEntryKind getPixEntryKind(const BSONElement& data);
+
+    /**
+     * Returns the key {prefix, term, docid, bound}, used to position a cursor on the
+     * posting blocks of a term.
+     */
+    static BSONObj getPixSeekKey(const BSONObj& termKey, uint32_t docid, bool maxKey);
+
+    /**
+     * Returns the key {MinKey, docid} that maps a docid of a pix index to the RecordId of its
+     * document (see PixDocidMap).  Having two fields, it never equals an entry of a term.
+     */
+    static BSONObj getPixDocidKey(uint32_t docid);
+
+    /**
+     * Returns true and sets 'docid' if 'key' was made by getPixDocidKey().
+     */
+    static bool isPixDocidKey(const BSONObj& key, uint32_t* docid);
+
+    // Positions kept per (term, document) in a pix index; later positions are dropped so a
+    // single DocPosting always fits in a posting block.
+    static const size_t kPixMaxPositions = 100;
 
 private:
     /**
@@ -93,6 +184,20 @@ private:
                                 double weight,
                                 const std::string& term,
                                 TextIndexVersion textIndexVersion);
+
+    /**
+     * Inserts the version 2 proximity key {term, BinData(blob)}.
+     */
+    static void _insertProximityKey(const std::string& term,
+                                    const std::vector<unsigned char>& blob,
+                                    BSONObjSet* keys);
+
+    /**
+     * Appends the term, hashing long terms as required by textIndexVersion.
+     */
+    static void _appendTerm(BSONObjBuilder& b,
+                            const std::string& term,
+                            TextIndexVersion textIndexVersion);
 };
 }
 }
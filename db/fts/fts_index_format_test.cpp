@@ -73,13 +73,113 @@ TEST(FTSIndexFormat, Proximity1) {
             "data" << "The cat with a hat sat, and the cat with no hat sat in the middle of the flat." <<
             "body" << "The rat with a gat sat in the corner of the flat."
         ),
-        &keys,
-        RecordId(0,103));
+        &keys);
 
     for (BSONObjSet::const_iterator i = keys.begin(); i != keys.end(); ++i) {
-        BSONObj key = *i;
+        BSONObj key = FTSIndexFormat::getProximityStoredKey(*i, RecordId(0,103));
         std::cout << "key => " << key << std::endl;
+        ASSERT_EQUALS(3, key.nFields());
+    }
+}
+
+/**
+ * Version 2 proximity keys pack the positions of a term into a single key.
+ */
+TEST(FTSIndexFormat, ProximityPackedPositions) {
+    FTSSpec spec(FTSSpec::fixSpec(BSON("key" << BSON("data"
+                                                     << "text") << "proximity" << 2)));
+    BSONObjSet keys;
+    FTSIndexFormat::getKeysProximity(spec, BSON("data" << "cat hat cat bat cat"), &keys);
+
+    ASSERT_EQUALS(3U, keys.size());
+    for (BSONObjSet::const_iterator i = keys.begin(); i != keys.end(); ++i) {
+        BSONObjIterator keyIt(*i);
+        string term = keyIt.next().String();
+        std::vector<uint32_t> positions;
+        FTSIndexFormat::getProximityPositions(keyIt.next(), &positions);
+        if (term == "cat") {
+            ASSERT_EQUALS(3U, positions.size());
+            ASSERT_EQUALS(0U, positions[0]);
+            ASSERT_EQUALS(2U, positions[1]);
+            ASSERT_EQUALS(4U, positions[2]);
+        } else {
+            ASSERT_EQUALS(1U, positions.size());
+        }
+    }
+}
+
+/**
+ * Positions that do not fit in one version 2 key are split over several, all of which decode
+ * to absolute positions.
+ */
+TEST(FTSIndexFormat, ProximityPackedPositionsSplit) {
+    FTSSpec spec(FTSSpec::fixSpec(BSON("key" << BSON("data"
+                                                     << "text") << "proximity" << 2)));
+    string text;
+    for (int i = 0; i < 1000; i++)
+        text += "cat ";
+    BSONObjSet keys;
+    FTSIndexFormat::getKeysProximity(spec, BSON("data" << text), &keys);
+
+    ASSERT_GREATER_THAN(keys.size(), 1U);
+    std::set<uint32_t> positions;
+    for (BSONObjSet::const_iterator i = keys.begin(); i != keys.end(); ++i) {
+        BSONObjIterator keyIt(*i);
+        ASSERT_EQUALS("cat", keyIt.next().String());
+        BSONElement blob = keyIt.next();
+        ASSERT_LESS_THAN_OR_EQUALS(blob.valuesize(),
+                                   static_cast<int>(FTSIndexFormat::kProximityMaxBlobBytes) + 5);
+        std::vector<uint32_t> v;
+        FTSIndexFormat::getProximityPositions(blob, &v);
+        positions.insert(v.begin(), v.end());
     }
+    ASSERT_EQUALS(1000U, positions.size());
+    ASSERT_EQUALS(0U, *positions.begin());
+    ASSERT_EQUALS(999U, *positions.rbegin());
+}
+
+/**
+ * Stored proximity keys put the RecordId ahead of the position, so that a scan over one
+ * term returns its documents in RecordId order.
+ */
+TEST(FTSIndexFormat, ProximityStoredKey) {
+    BSONObj stored = FTSIndexFormat::getProximityStoredKey(BSON("" << "cat"
+                                                                   << "" << 7),
+                                                           RecordId(42));
+    ASSERT_EQUALS(BSON("" << "cat"
+                          << "" << 42LL << "" << 7),
+                  stored);
+
+    BSONObj earlier = FTSIndexFormat::getProximityStoredKey(BSON("" << "cat"
+                                                                    << "" << 900),
+                                                            RecordId(41));
+    ASSERT_LESS_THAN(earlier.woCompare(stored), 0);
+
+    BSONObj start = FTSIndexFormat::getProximityIndexKey("cat", BSONObj(), false);
+    BSONObj end = FTSIndexFormat::getProximityIndexKey("cat", BSONObj(), true);
+    ASSERT_LESS_THAN(start.woCompare(earlier), 0);
+    ASSERT_LESS_THAN(stored.woCompare(end), 0);
+}
+
+/**
+ * Pix docid keys sort ahead of the entries of every term and are not mistaken for them.
+ */
+TEST(FTSIndexFormat, PixDocidKey) {
+    BSONObj key = FTSIndexFormat::getPixDocidKey(7);
+    uint32_t docid = 0;
+    ASSERT_TRUE(FTSIndexFormat::isPixDocidKey(key, &docid));
+    ASSERT_EQUALS(7U, docid);
+    ASSERT_LESS_THAN(key.woCompare(FTSIndexFormat::getPixDocidKey(8)), 0);
+
+    BSONObj termKey = BSON("" << "cat");
+    BSONObj block = FTSIndexFormat::getPixBlockKey(termKey, 1, std::vector<unsigned char>(1, 0));
+    ASSERT_FALSE(FTSIndexFormat::isPixDocidKey(block, &docid));
+    ASSERT_LESS_THAN(key.woCompare(block), 0);
+
+    BSONObjBuilder minKeyPrefix;
+    minKeyPrefix.appendMinKey("");
+    minKeyPrefix.append("", "cat");
+    ASSERT_FALSE(FTSIndexFormat::isPixDocidKey(minKeyPrefix.obj(), &docid));
 }
 
 TEST(FTSIndexFormat, ExtraBack1) {
@@ -54,7 +54,7 @@ namespace {
  */
 struct LanguageStringCompare {
     /** Returns true if lhs < rhs. */
-    bool operator()(std::string lhs, std::string rhs) const {
+    bool operator()(StringData lhs, StringData rhs) const {
         size_t minSize = std::min(lhs.size(), rhs.size());
 
         for (size_t x = 0; x < minSize; x++) {
@@ -75,7 +75,8 @@ struct LanguageStringCompare {
 // Lookup table from user language string (case-insensitive) to FTSLanguage.
 // Populated by initializers in initializer FTSRegisterV2LanguagesAndLater and initializer
 // FTSRegisterLanguageAliases.  For use with TEXT_INDEX_VERSION_2 text indexes and above.
-typedef std::map<std::string, const FTSLanguage*, LanguageStringCompare> LanguageMap;
+// Keyed by StringData, like languageMapV1, so that lookups do not copy the language string.
+typedef std::map<StringData, const FTSLanguage*, LanguageStringCompare> LanguageMap;
 
 LanguageMap languageMapV3;
 LanguageMap languageMapV2;
@@ -237,7 +238,7 @@ void FTSLanguage::registerLanguage(StringData languageName,
     if (textIndexVersion >= TEXT_INDEX_VERSION_2) {
         LanguageMap* languageMap =
             (textIndexVersion == TEXT_INDEX_VERSION_3) ? &languageMapV3 : &languageMapV2;
-        (*languageMap)[languageName.toString()] = language;
+        (*languageMap)[language->_canonicalName] = language;
     } else {
         // Legacy text index.
         invariant(textIndexVersion == TEXT_INDEX_VERSION_1);
@@ -253,7 +254,7 @@ void FTSLanguage::registerLanguageAlias(const FTSLanguage* language,
     if (textIndexVersion >= TEXT_INDEX_VERSION_2) {
         LanguageMap* languageMap =
             (textIndexVersion == TEXT_INDEX_VERSION_3) ? &languageMapV3 : &languageMapV2;
-        (*languageMap)[alias.toString()] = language;
+        (*languageMap)[alias] = language;
     } else {
         // Legacy text index.
         invariant(textIndexVersion == TEXT_INDEX_VERSION_1);
@@ -275,7 +276,7 @@ StatusWithFTSLanguage FTSLanguage::make(StringData langName, TextIndexVersion te
         LanguageMap* languageMap =
             (textIndexVersion == TEXT_INDEX_VERSION_3) ? &languageMapV3 : &languageMapV2;
 
-        LanguageMap::const_iterator it = languageMap->find(langName.toString());
+        LanguageMap::const_iterator it = languageMap->find(langName);
 
         if (it == languageMap->end()) {
             // TEXT_INDEX_VERSION_2 and above reject unrecognized language strings.
@@ -107,7 +107,7 @@ public:
     /**
      * Register 'alias' as an alias for 'language' with text index version
      * 'textIndexVersion'.  Subsequent calls to FTSLanguage::make() will recognize the
-     * newly-registered alias.
+     * newly-registered alias.  The language maps do not copy 'alias', which must outlive them.
      */
     static void registerLanguageAlias(const FTSLanguage* language,
                                       StringData alias,
@@ -0,0 +1,123 @@
+/**
+ *    Copyright (C) 2016 MongoDB Inc.
+ *
+ *    This program is free software: you can redistribute it and/or  modify
+ *    it under the terms of the GNU Affero General Public License, version 3,
+ *    as published by the Free Software Foundation.
+ *
+ *    This program is distributed in the hope that it will be useful,
+ *    but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *    GNU Affero General Public License for more details.
+ *
+ *    You should have received a copy of the GNU Affero General Public License
+ *    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ *    As a special exception, the copyright holders give permission to link the
+ *    code of portions of this program with the OpenSSL library under certain
+ *    conditions as described in each individual source file and distribute
+ *    linked combinations including the program with the OpenSSL library. You
+ *    must comply with the GNU Affero General Public License in all respects for
+ *    all of the code used other than as permitted herein. If you modify file(s)
+ *    with this exception, you may extend this exception to your version of the
+ *    file(s), but you are not obligated to do so. If you do not wish to do so,
+ *    delete this exception statement from your version. If you delete this
+ *    exception statement from all source files in the program, then also delete
+ *    it in the license file.
+ */
+#include "mongo/platform/basic.h"
+
+#include "mongo/db/fts/fts_phrase_positions.h"
+
+#include <algorithm>
+#include <memory>
+
+#include "mongo/db/fts/fts_language.h"
+#include "mongo/db/fts/fts_tokenizer.h"
+
+namespace mongo {
+namespace fts {
+
+PhrasePositionMatcher::PhrasePositionMatcher(const FTSLanguage* language,
+                                             const std::vector<std::string>& phrases,
+                                             const std::set<std::string>& terms)
+    : _positions(terms.size()) {
+    std::unique_ptr<FTSTokenizer> tokenizer = language->createTokenizer();
+
+    for (const auto& phrase : phrases) {
+        std::vector<PhraseTerm> phraseTerms;
+        uint32_t offset = 0;
+
+        // Same options as the index keys: lower cased, diacritics removed, stop words kept.
+        tokenizer->reset(phrase.c_str(), FTSTokenizer::kNone);
+        while (tokenizer->moveNext()) {
+            auto it = terms.find(tokenizer->get().toString());
+            if (it != terms.end()) {
+                phraseTerms.push_back(
+                    PhraseTerm(static_cast<uint32_t>(std::distance(terms.begin(), it)), offset));
+            }
+            ++offset;
+        }
+
+        // Phrases match as case folded substrings, so the first and last words of a phrase may
+        // be the tail and head of longer document words ("ring bell" is in "string bells") and
+        // need not occur as terms.  Only the words in between are checked.
+        const uint32_t lastOffset = offset - 1;
+        phraseTerms.erase(std::remove_if(phraseTerms.begin(),
+                                         phraseTerms.end(),
+                                         [lastOffset](const PhraseTerm& t) {
+                                             return t.offset == 0 || t.offset == lastOffset;
+                                         }),
+                          phraseTerms.end());
+
+        if (!phraseTerms.empty()) {
+            _phrases.push_back(std::move(phraseTerms));
+        }
+    }
+}
+
+bool PhrasePositionMatcher::matches(const std::vector<Occurrence>& occurrences) {
+    if (_phrases.empty()) {
+        return true;
+    }
+
+    for (auto& positions : _positions) {
+        positions.clear();
+    }
+    for (const auto& occurrence : occurrences) {
+        if (occurrence.term < _positions.size()) {
+            _positions[occurrence.term].push_back(occurrence.pos);
+        }
+    }
+
+    for (const auto& phrase : _phrases) {
+        if (!_matchesPhrase(phrase)) {
+            return false;
+        }
+    }
+    return true;
+}
+
+bool PhrasePositionMatcher::_matchesPhrase(const std::vector<PhraseTerm>& phrase) const {
+    // Anchor the phrase on each occurrence of its first checked term.
+    const PhraseTerm& first = phrase[0];
+    for (uint32_t pos : _positions[first.term]) {
+        if (pos < first.offset) {
+            continue;
+        }
+        const uint32_t start = pos - first.offset;
+
+        bool found = true;
+        for (size_t i = 1; i < phrase.size() && found; ++i) {
+            const std::vector<uint32_t>& positions = _positions[phrase[i].term];
+            found = std::binary_search(positions.begin(), positions.end(), start + phrase[i].offset);
+        }
+        if (found) {
+            return true;
+        }
+    }
+    return false;
+}
+
+}  // namespace fts
+}  // namespace mongo
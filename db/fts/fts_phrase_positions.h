@@ -0,0 +1,95 @@
+/**
+ *    Copyright (C) 2016 MongoDB Inc.
+ *
+ *    This program is free software: you can redistribute it and/or  modify
+ *    it under the terms of the GNU Affero General Public License, version 3,
+ *    as published by the Free Software Foundation.
+ *
+ *    This program is distributed in the hope that it will be useful,
+ *    but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *    GNU Affero General Public License for more details.
+ *
+ *    You should have received a copy of the GNU Affero General Public License
+ *    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ *    As a special exception, the copyright holders give permission to link the
+ *    code of portions of this program with the OpenSSL library under certain
+ *    conditions as described in each individual source file and distribute
+ *    linked combinations including the program with the OpenSSL library. You
+ *    must comply with the GNU Affero General Public License in all respects for
+ *    all of the code used other than as permitted herein. If you modify file(s)
+ *    with this exception, you may extend this exception to your version of the
+ *    file(s), but you are not obligated to do so. If you do not wish to do so,
+ *    delete this exception statement from your version. If you delete this
+ *    exception statement from all source files in the program, then also delete
+ *    it in the license file.
+ */
+#pragma once
+
+#include <cstdint>
+#include <set>
+#include <string>
+#include <vector>
+
+#include "mongo/db/fts/fts_proximity_window.h"
+
+namespace mongo {
+namespace fts {
+
+class FTSLanguage;
+
+/**
+ * Checks the positive phrases of a query against the term positions of a document, as stored
+ * by position-bearing text indexes, so that documents can be rejected before they are fetched.
+ *
+ * Each phrase is tokenized like the indexed text; a document passes if, for every phrase, its
+ * terms occur at consecutive positions.  Stop words are not scanned by the query, so they are
+ * not checked but still take up their position.
+ *
+ * A phrase matches as a case folded substring of the document, so its first and last words may
+ * be parts of longer words and are never checked; a document is only rejected when the words
+ * between them are missing or out of place, which no substring match allows.  Phrases of one or
+ * two words are not checked at all.  Documents that pass still go through the substring match
+ * of TextMatchStage.
+ */
+class PhrasePositionMatcher {
+public:
+    typedef ProximityWindowMatcher::Occurrence Occurrence;
+
+    /**
+     * 'terms' are the scanned query terms; a term's id is its rank in the set.
+     */
+    PhrasePositionMatcher(const FTSLanguage* language,
+                          const std::vector<std::string>& phrases,
+                          const std::set<std::string>& terms);
+
+    /**
+     * True if there is no phrase to check.
+     */
+    bool empty() const {
+        return _phrases.empty();
+    }
+
+    /**
+     * Returns true if 'occurrences', sorted by position, hold every phrase.
+     */
+    bool matches(const std::vector<Occurrence>& occurrences);
+
+private:
+    struct PhraseTerm {
+        PhraseTerm(uint32_t t, uint32_t o) : term(t), offset(o) {}
+        uint32_t term;
+        uint32_t offset;
+    };
+
+    bool _matchesPhrase(const std::vector<PhraseTerm>& phrase) const;
+
+    std::vector<std::vector<PhraseTerm>> _phrases;
+
+    // Scratch space reused across documents: the positions of each term id.
+    std::vector<std::vector<uint32_t>> _positions;
+};
+
+}  // namespace fts
+}  // namespace mongo
@@ -0,0 +1,94 @@
+/**
+ *    Copyright (C) 2016 MongoDB Inc.
+ *
+ *    This program is free software: you can redistribute it and/or  modify
+ *    it under the terms of the GNU Affero General Public License, version 3,
+ *    as published by the Free Software Foundation.
+ *
+ *    This program is distributed in the hope that it will be useful,
+ *    but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *    GNU Affero General Public License for more details.
+ *
+ *    You should have received a copy of the GNU Affero General Public License
+ *    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ *    As a special exception, the copyright holders give permission to link the
+ *    code of portions of this program with the OpenSSL library under certain
+ *    conditions as described in each individual source file and distribute
+ *    linked combinations including the program with the OpenSSL library. You
+ *    must comply with the GNU Affero General Public License in all respects for
+ *    all of the code used other than as permitted herein. If you modify file(s)
+ *    with this exception, you may extend this exception to your version of the
+ *    file(s), but you are not obligated to do so. If you do not wish to do so,
+ *    delete this exception statement from your version. If you delete this
+ *    exception statement from all source files in the program, then also delete
+ *    it in the license file.
+ */
+#include "mongo/platform/basic.h"
+
+#include "mongo/db/fts/fts_language.h"
+#include "mongo/db/fts/fts_phrase_positions.h"
+#include "mongo/unittest/unittest.h"
+
+namespace mongo {
+namespace fts {
+
+namespace {
+
+typedef PhrasePositionMatcher::Occurrence Occ;
+
+const std::set<std::string> kTerms = {"cat", "hat", "sat"};
+const uint32_t kCat = 0;
+const uint32_t kHat = 1;
+const uint32_t kSat = 2;
+
+}  // namespace
+
+TEST(PhrasePositionMatcher, Consecutive) {
+    PhrasePositionMatcher m(&languageEnglishV2, {"big cat sat hat down"}, kTerms);
+    ASSERT_FALSE(m.empty());
+    ASSERT_TRUE(m.matches({Occ(kCat, 4), Occ(kSat, 5), Occ(kHat, 6)}));
+    ASSERT_FALSE(m.matches({Occ(kCat, 4), Occ(kSat, 6), Occ(kHat, 7)}));
+    ASSERT_FALSE(m.matches({Occ(kSat, 4), Occ(kCat, 5), Occ(kHat, 6)}));
+    ASSERT_TRUE(m.matches(
+        {Occ(kCat, 1), Occ(kSat, 3), Occ(kHat, 4), Occ(kCat, 7), Occ(kSat, 8), Occ(kHat, 9)}));
+}
+
+TEST(PhrasePositionMatcher, StemmedAndFolded) {
+    PhrasePositionMatcher m(&languageEnglishV2, {"my Cats sat down"}, kTerms);
+    ASSERT_TRUE(m.matches({Occ(kCat, 0), Occ(kSat, 1)}));
+}
+
+TEST(PhrasePositionMatcher, StopWordsKeepTheirPosition) {
+    PhrasePositionMatcher m(&languageEnglishV2, {"big cat in the hat now"}, kTerms);
+    ASSERT_TRUE(m.matches({Occ(kCat, 10), Occ(kHat, 13)}));
+    ASSERT_FALSE(m.matches({Occ(kCat, 10), Occ(kHat, 11)}));
+}
+
+TEST(PhrasePositionMatcher, EveryPhrase) {
+    PhrasePositionMatcher m(&languageEnglishV2, {"a cat sat b", "one hat two"}, kTerms);
+    ASSERT_FALSE(m.matches({Occ(kCat, 0), Occ(kSat, 1)}));
+    ASSERT_TRUE(m.matches({Occ(kCat, 0), Occ(kSat, 1), Occ(kHat, 9)}));
+}
+
+// The first and last words may be parts of longer document words: "cat sat" is in "scat sate"
+// and "hat cat sat" in "that cat satisfied".
+TEST(PhrasePositionMatcher, EdgeWordsMayBePartial) {
+    PhrasePositionMatcher pair(&languageEnglishV2, {"cat sat"}, kTerms);
+    ASSERT_TRUE(pair.empty());
+
+    PhrasePositionMatcher m(&languageEnglishV2, {"hat cat sat"}, kTerms);
+    ASSERT_FALSE(m.empty());
+    ASSERT_TRUE(m.matches({Occ(kCat, 3)}));
+    ASSERT_FALSE(m.matches({Occ(kHat, 2), Occ(kSat, 4)}));
+}
+
+TEST(PhrasePositionMatcher, NothingToCheck) {
+    PhrasePositionMatcher m(&languageEnglishV2, {"the"}, kTerms);
+    ASSERT_TRUE(m.empty());
+    ASSERT_TRUE(m.matches({}));
+}
+
+}  // namespace fts
+}  // namespace mongo
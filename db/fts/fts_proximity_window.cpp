@@ -0,0 +1,106 @@
+/**
+ *    Copyright (C) 2016 MongoDB Inc.
+ *
+ *    This program is free software: you can redistribute it and/or  modify
+ *    it under the terms of the GNU Affero General Public License, version 3,
+ *    as published by the Free Software Foundation.
+ *
+ *    This program is distributed in the hope that it will be useful,
+ *    but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *    GNU Affero General Public License for more details.
+ *
+ *    You should have received a copy of the GNU Affero General Public License
+ *    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ *    As a special exception, the copyright holders give permission to link the
+ *    code of portions of this program with the OpenSSL library under certain
+ *    conditions as described in each individual source file and distribute
+ *    linked combinations including the program with the OpenSSL library. You
+ *    must comply with the GNU Affero General Public License in all respects for
+ *    all of the code used other than as permitted herein. If you modify file(s)
+ *    with this exception, you may extend this exception to your version of the
+ *    file(s), but you are not obligated to do so. If you do not wish to do so,
+ *    delete this exception statement from your version. If you delete this
+ *    exception statement from all source files in the program, then also delete
+ *    it in the license file.
+ */
+
+#include "mongo/platform/basic.h"
+
+#include "mongo/db/fts/fts_proximity_window.h"
+
+#include <algorithm>
+
+namespace mongo {
+namespace fts {
+
+ProximityWindowMatcher::ProximityWindowMatcher(std::vector<int> ranks,
+                                               uint32_t window,
+                                               int reorderBound)
+    : _ranks(std::move(ranks)), _window(window), _reorderBound(reorderBound) {
+    for (int rank : _ranks) {
+        if (rank < 0)
+            _ranked = false;
+        else
+            _numRanks = std::max(_numRanks, static_cast<uint32_t>(rank) + 1);
+    }
+}
+
+uint32_t ProximityWindowMatcher::_countAtMost(int rank) const {
+    uint32_t n = 0;
+    for (int i = rank + 1; i > 0; i -= i & -i)
+        n += _tree[i];
+    return n;
+}
+
+void ProximityWindowMatcher::_add(int rank, int delta) {
+    for (int i = rank + 1; i < static_cast<int>(_tree.size()); i += i & -i)
+        _tree[i] += delta;
+}
+
+bool ProximityWindowMatcher::matches(const std::vector<Occurrence>& occurrences) {
+    const uint32_t nterms = _ranks.size();
+    const bool checkOrder = _reorderBound >= 0;
+    if (nterms == 0 || (checkOrder && !_ranked))
+        return false;
+
+    _counts.assign(nterms, 0);
+    if (checkOrder)
+        _tree.assign(_numRanks + 1, 0);
+
+    uint32_t covered = 0;       // distinct terms in the window
+    uint64_t inversions = 0;    // pairs of the window out of query order
+    size_t left = 0;
+
+    for (size_t right = 0; right < occurrences.size(); ++right) {
+        const Occurrence& in = occurrences[right];
+        if (_counts[in.term]++ == 0)
+            ++covered;
+        if (checkOrder) {
+            // earlier occurrences in the window with a later query rank
+            inversions += (right - left) - _countAtMost(_ranks[in.term]);
+            _add(_ranks[in.term], 1);
+        }
+
+        // Drop occurrences from the left whose term occurs again later in the window; what
+        // remains is the shortest window ending at 'right'.
+        while (left < right && _counts[occurrences[left].term] > 1) {
+            const Occurrence& out = occurrences[left++];
+            --_counts[out.term];
+            if (checkOrder) {
+                _add(_ranks[out.term], -1);
+                // later occurrences in the window with an earlier query rank
+                inversions -= _countAtMost(_ranks[out.term] - 1);
+            }
+        }
+
+        if (covered == nterms && in.pos - occurrences[left].pos < _window &&
+            (!checkOrder || inversions <= static_cast<uint64_t>(_reorderBound)))
+            return true;
+    }
+    return false;
+}
+
+}  // namespace fts
+}  // namespace mongo
@@ -0,0 +1,83 @@
+/**
+ *    Copyright (C) 2016 MongoDB Inc.
+ *
+ *    This program is free software: you can redistribute it and/or  modify
+ *    it under the terms of the GNU Affero General Public License, version 3,
+ *    as published by the Free Software Foundation.
+ *
+ *    This program is distributed in the hope that it will be useful,
+ *    but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *    GNU Affero General Public License for more details.
+ *
+ *    You should have received a copy of the GNU Affero General Public License
+ *    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ *    As a special exception, the copyright holders give permission to link the
+ *    code of portions of this program with the OpenSSL library under certain
+ *    conditions as described in each individual source file and distribute
+ *    linked combinations including the program with the OpenSSL library. You
+ *    must comply with the GNU Affero General Public License in all respects for
+ *    all of the code used other than as permitted herein. If you modify file(s)
+ *    with this exception, you may extend this exception to your version of the
+ *    file(s), but you are not obligated to do so. If you do not wish to do so,
+ *    delete this exception statement from your version. If you delete this
+ *    exception statement from all source files in the program, then also delete
+ *    it in the license file.
+ */
+
+#pragma once
+
+#include <cstdint>
+#include <vector>
+
+namespace mongo {
+namespace fts {
+
+/**
+ * Matches the term occurrences of one document against a proximity query: every query term
+ * must occur in a window narrower than 'window' positions, and if 'reorderBound' is not -1
+ * the terms of that window may be out of query order by at most 'reorderBound' inversions.
+ *
+ * Terms are identified by small integers 0..n-1 resolved once per query.  matches() makes a
+ * single pass over the occurrences, keeping the shortest window that ends at each occurrence
+ * and its inversion count in a Fenwick tree over query ranks, so a document costs
+ * O(occurrences * log n) rather than a rescan from every position.
+ */
+class ProximityWindowMatcher {
+public:
+    struct Occurrence {
+        Occurrence(uint32_t t, uint32_t p) : term(t), pos(p) {}
+        uint32_t term;
+        uint32_t pos;
+    };
+
+    /**
+     * 'ranks' holds, for each term id, its position in the query, or -1 if it does not
+     * appear there; with a reorder bound, terms without a rank never match.
+     */
+    ProximityWindowMatcher(std::vector<int> ranks, uint32_t window, int reorderBound);
+
+    /**
+     * Returns true if 'occurrences', sorted by position, contain a qualifying window.
+     */
+    bool matches(const std::vector<Occurrence>& occurrences);
+
+private:
+    // Fenwick tree over query ranks: number of window occurrences with rank <= 'rank'.
+    uint32_t _countAtMost(int rank) const;
+    void _add(int rank, int delta);
+
+    const std::vector<int> _ranks;
+    const uint32_t _window;
+    const int _reorderBound;
+    bool _ranked = true;
+    uint32_t _numRanks = 0;
+
+    // Scratch space reused across documents.
+    std::vector<uint32_t> _counts;
+    std::vector<int> _tree;
+};
+
+}  // namespace fts
+}  // namespace mongo
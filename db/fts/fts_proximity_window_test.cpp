@@ -0,0 +1,136 @@
+/**
+ *    Copyright (C) 2016 MongoDB Inc.
+ *
+ *    This program is free software: you can redistribute it and/or  modify
+ *    it under the terms of the GNU Affero General Public License, version 3,
+ *    as published by the Free Software Foundation.
+ *
+ *    This program is distributed in the hope that it will be useful,
+ *    but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *    GNU Affero General Public License for more details.
+ *
+ *    You should have received a copy of the GNU Affero General Public License
+ *    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ *    As a special exception, the copyright holders give permission to link the
+ *    code of portions of this program with the OpenSSL library under certain
+ *    conditions as described in each individual source file and distribute
+ *    linked combinations including the program with the OpenSSL library. You
+ *    must comply with the GNU Affero General Public License in all respects for
+ *    all of the code used other than as permitted herein. If you modify file(s)
+ *    with this exception, you may extend this exception to your version of the
+ *    file(s), but you are not obligated to do so. If you do not wish to do so,
+ *    delete this exception statement from your version. If you delete this
+ *    exception statement from all source files in the program, then also delete
+ *    it in the license file.
+ */
+
+#include "mongo/platform/basic.h"
+
+#include <algorithm>
+#include <cstdlib>
+
+#include "mongo/db/fts/fts_proximity_window.h"
+#include "mongo/unittest/unittest.h"
+
+namespace mongo {
+namespace fts {
+
+namespace {
+
+typedef ProximityWindowMatcher::Occurrence Occ;
+
+// Checks every window, as the matcher used to.
+bool bruteForce(const std::vector<int>& ranks,
+                const std::vector<Occ>& occ,
+                uint32_t window,
+                int reorderBound) {
+    if (reorderBound >= 0 && std::find(ranks.begin(), ranks.end(), -1) != ranks.end())
+        return false;
+    for (size_t i = 0; i < occ.size(); ++i) {
+        std::vector<bool> seen(ranks.size(), false);
+        size_t covered = 0;
+        for (size_t j = i; j < occ.size() && occ[j].pos - occ[i].pos < window; ++j) {
+            if (!seen[occ[j].term]) {
+                seen[occ[j].term] = true;
+                ++covered;
+            }
+            if (covered < ranks.size())
+                continue;
+            if (reorderBound < 0)
+                return true;
+            int inversions = 0;
+            for (size_t a = i; a <= j; ++a) {
+                for (size_t b = a + 1; b <= j; ++b) {
+                    if (ranks[occ[a].term] > ranks[occ[b].term])
+                        ++inversions;
+                }
+            }
+            if (inversions <= reorderBound)
+                return true;
+        }
+    }
+    return false;
+}
+
+}  // namespace
+
+TEST(ProximityWindowMatcher, Window) {
+    ProximityWindowMatcher m({0, 1}, 3, -1);
+    ASSERT_TRUE(m.matches({Occ(0, 10), Occ(1, 12)}));
+    ASSERT_FALSE(m.matches({Occ(0, 10), Occ(1, 13)}));
+    ASSERT_FALSE(m.matches({Occ(0, 10), Occ(0, 11)}));
+    ASSERT_FALSE(m.matches({}));
+
+    // a later occurrence of the first term shortens the window
+    ASSERT_TRUE(m.matches({Occ(0, 1), Occ(0, 9), Occ(1, 10)}));
+}
+
+TEST(ProximityWindowMatcher, ReorderBound) {
+    ProximityWindowMatcher inOrder({0, 1, 2}, 10, 0);
+    ASSERT_TRUE(inOrder.matches({Occ(0, 1), Occ(1, 2), Occ(2, 3)}));
+    ASSERT_FALSE(inOrder.matches({Occ(1, 1), Occ(0, 2), Occ(2, 3)}));
+
+    ProximityWindowMatcher oneSwap({0, 1, 2}, 10, 1);
+    ASSERT_TRUE(oneSwap.matches({Occ(1, 1), Occ(0, 2), Occ(2, 3)}));
+    ASSERT_FALSE(oneSwap.matches({Occ(2, 1), Occ(0, 2), Occ(1, 3)}));
+
+    // dropping the leading duplicate puts the window back in order
+    ProximityWindowMatcher pair({0, 1}, 10, 0);
+    ASSERT_TRUE(pair.matches({Occ(1, 1), Occ(0, 2), Occ(1, 3)}));
+    ASSERT_FALSE(pair.matches({Occ(1, 1), Occ(0, 2)}));
+}
+
+TEST(ProximityWindowMatcher, UnrankedTerm) {
+    ProximityWindowMatcher ordered({0, -1}, 10, 2);
+    ASSERT_FALSE(ordered.matches({Occ(0, 1), Occ(1, 2)}));
+
+    ProximityWindowMatcher unordered({0, -1}, 10, -1);
+    ASSERT_TRUE(unordered.matches({Occ(0, 1), Occ(1, 2)}));
+}
+
+TEST(ProximityWindowMatcher, MatchesBruteForce) {
+    srand(5);
+    for (int round = 0; round < 2000; ++round) {
+        uint32_t nterms = 1 + rand() % 4;
+        std::vector<int> ranks;
+        for (uint32_t t = 0; t < nterms; ++t)
+            ranks.push_back(rand() % 4);
+        uint32_t window = 1 + rand() % 12;
+        int reorderBound = rand() % 4 - 1;
+
+        std::vector<Occ> occ;
+        uint32_t pos = 0;
+        for (int n = rand() % 16; n > 0; --n) {
+            pos += rand() % 4;
+            occ.push_back(Occ(rand() % nterms, pos));
+        }
+
+        ProximityWindowMatcher m(ranks, window, reorderBound);
+        ASSERT_EQUALS(bruteForce(ranks, occ, window, reorderBound), m.matches(occ));
+    }
+}
+
+}  // namespace fts
+}  // namespace mongo
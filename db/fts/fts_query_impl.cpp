@@ -77,7 +77,7 @@ Status FTSQueryImpl::parse(TextIndexVersion textIndexVersion) {
             string s = t.data.toString();
 
             // @@@proximity
-            _termv.push_back(stemmer.stem(s));
+            _termv.push_back(stemmer.stem(s).toString());
             if (fqi_debug)
                 std::cout << "_termv.push_back(" << stemmer.stem(s) << ")" << std::endl;
 
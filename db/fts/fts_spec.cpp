@@ -54,6 +54,24 @@ namespace {
 // Default language.  Used for new indexes.
 const std::string moduleDefaultLanguage("english");
 
+/**
+ * Parses the "pixBlockFormat" option.  A missing option is kVarint, the skip list frames.
+ */
+bool parsePixBlockFormat(const BSONElement& e, PixCodec::BlockFormat* format) {
+    *format = PixCodec::kVarint;
+    if (e.eoo())
+        return true;
+    if (e.type() != String)
+        return false;
+    if (e.valueStringData() == "groupVarint")
+        *format = PixCodec::kGroupVarint;
+    else if (e.valueStringData() == "bitPack")
+        *format = PixCodec::kBitPack;
+    else if (e.valueStringData() != "varint")
+        return false;
+    return true;
+}
+
 /** Validate the given language override string. */
 bool validateOverride(const string& override) {
     // The override field can't be empty, can't be prefixed with a dollar sign, and
@@ -95,7 +113,32 @@ FTSSpec::FTSSpec(const BSONObj& indexInfo) {
     }
 
     // @@@proximity
-    _proximityIndex = indexInfo["proximity"].boolean();
+    BSONElement proximityElt = indexInfo["proximity"];
+    if (proximityElt.isNumber()) {
+        _proximityIndexVersion = static_cast<ProximityIndexVersion>(proximityElt.numberInt());
+    } else {
+        _proximityIndexVersion =
+            proximityElt.trueValue() ? PROXIMITY_INDEX_VERSION_1 : PROXIMITY_INDEX_NONE;
+    }
+    uassert(34503,
+            str::stream() << "unsupported proximity index version " << _proximityIndexVersion
+                          << "; versions supported: " << PROXIMITY_INDEX_VERSION_3 << ", "
+                          << PROXIMITY_INDEX_VERSION_2,
+            _proximityIndexVersion == PROXIMITY_INDEX_NONE ||
+                _proximityIndexVersion == PROXIMITY_INDEX_VERSION_1 ||
+                _proximityIndexVersion == PROXIMITY_INDEX_VERSION_2 ||
+                _proximityIndexVersion == PROXIMITY_INDEX_VERSION_3);
+    _pixIndex = indexInfo["pix"].boolean();
+    uassert(34500,
+            "text index options 'proximity' and 'pix' are mutually exclusive",
+            !(proximityIndex() && _pixIndex));
+    uassert(34511,
+            "text index option 'pixBlockFormat' must be \"varint\", \"groupVarint\" or "
+            "\"bitPack\"",
+            parsePixBlockFormat(indexInfo["pixBlockFormat"], &_pixBlockFormat));
+    uassert(34512,
+            "text index option 'pixBlockFormat' requires 'pix'",
+            _pixIndex || indexInfo["pixBlockFormat"].eoo());
 
     // Initialize _defaultLanguage.  Note that the FTSLanguage constructor requires
     // textIndexVersion, since language parsing is version-specific.
@@ -154,6 +197,10 @@ FTSSpec::FTSSpec(const BSONObj& indexInfo) {
             else
                 _extraBefore.push_back(e.fieldName());
         }
+
+        uassert(34501,
+                "a pix text index cannot have fields after the text index key",
+                !_pixIndex || _extraAfter.empty());
     }
 }
 
@@ -171,66 +218,74 @@ const FTSLanguage* FTSSpec::_getLanguageToUseV2(const BSONObj& userDoc,
     return swl.getValue();
 }
 
-// @@@proximity
-uint32_t FTSSpec::_scanString(FTSTokenizer* tokenizer,
-                              uint32_t startPos,
-                              StringData raw,
-                              TermPositionMap* termPosMap) const {
-
-    uint32_t pos = startPos;
-    uint32_t termCount = 0;
-    tokenizer->reset(raw.rawData(), FTSTokenizer::kNone);
-
-    while (tokenizer->moveNext()) {
-        string term = tokenizer->get().toString();
-        PositionList& p = (*termPosMap)[term];
-        p.push_back(pos++);
-        ++termCount;
-    }
-    return termCount;
+void FTSSpec::uassertProximityKeysUsable() const {
+    uassert(34510,
+            "proximity index version 1 stores its keys without the RecordId and can no longer "
+            "be read or written; drop the index and create it again",
+            _proximityIndexVersion != PROXIMITY_INDEX_VERSION_1);
 }
 
 // @@@proximity
 void FTSSpec::scanDocument(const BSONObj& obj, TermPositionMap* termPosMap) const {
-
-    FTSElementIterator it(*this, obj);
-    uint32_t startPos = 0;
-
-    while (it.more()) {
-        FTSIteratorValue val = it.next();
-        std::unique_ptr<FTSTokenizer> tokenizer(val._language->createTokenizer());
-        startPos += _scanString(tokenizer.get(), startPos, val._text, termPosMap);
-        startPos += 100;
-    }
+    _analyzeDocument(obj, NULL, termPosMap);
 }
 
 void FTSSpec::scoreDocument(const BSONObj& obj, TermFrequencyMap* term_freqs) const {
-    if (_textIndexVersion == TEXT_INDEX_VERSION_1) {
-        return _scoreDocumentV1(obj, term_freqs);
+    _analyzeDocument(obj, term_freqs, NULL);
+}
+
+void FTSSpec::_analyzeDocument(const BSONObj& obj,
+                               TermFrequencyMap* term_freqs,
+                               TermPositionMap* term_pos) const {
+    invariant(!term_freqs != !term_pos);
+    if (term_freqs && _textIndexVersion == TEXT_INDEX_VERSION_1) {
+        _scoreDocumentV1(obj, term_freqs);
+        return;
     }
 
     FTSElementIterator it(*this, obj);
+    uint32_t startPos = 0;
+
+    // One tokenizer, and so one stemmer, per language of the document.
+    std::map<const FTSLanguage*, std::unique_ptr<FTSTokenizer>> tokenizers;
 
     while (it.more()) {
         FTSIteratorValue val = it.next();
-        std::unique_ptr<FTSTokenizer> tokenizer(val._language->createTokenizer());
-        _scoreStringV2(tokenizer.get(), val._text, term_freqs, val._weight);
+        std::unique_ptr<FTSTokenizer>& tokenizer = tokenizers[val._language];
+        if (!tokenizer) {
+            tokenizer = val._language->createTokenizer();
+        }
+        startPos += _analyzeStringV2(
+            tokenizer.get(), val._text, val._weight, startPos, term_freqs, term_pos);
+        startPos += 100;
     }
 }
 
-void FTSSpec::_scoreStringV2(FTSTokenizer* tokenizer,
-                             StringData raw,
-                             TermFrequencyMap* docScores,
-                             double weight) const {
+uint32_t FTSSpec::_analyzeStringV2(FTSTokenizer* tokenizer,
+                                   StringData raw,
+                                   double weight,
+                                   uint32_t startPos,
+                                   TermFrequencyMap* docScores,
+                                   TermPositionMap* termPosMap) const {
     ScoreHelperMap terms;
 
     unsigned numTokens = 0;
+    uint32_t pos = startPos;
 
-    tokenizer->reset(raw.rawData(), FTSTokenizer::kFilterStopWords);
+    // Positions count stop words, scores do not.
+    tokenizer->reset(raw.rawData(),
+                     termPosMap ? FTSTokenizer::kNone : FTSTokenizer::kFilterStopWords);
 
     while (tokenizer->moveNext()) {
         string term = tokenizer->get().toString();
 
+        if (termPosMap) {
+            (*termPosMap)[term].push_back(pos++);
+        }
+        if (!docScores || tokenizer->isStopWord()) {
+            continue;
+        }
+
         ScoreHelperStruct& data = terms[term];
 
         if (data.exp) {
@@ -264,6 +319,7 @@ void FTSSpec::_scoreStringV2(FTSTokenizer* tokenizer,
         score += (weight * data.freq * coeff * adjustment);
         verify(score <= MAX_WEIGHT);
     }
+    return pos - startPos;
 }
 
 Status FTSSpec::getIndexPrefix(const BSONObj& query, BSONObj* out) const {
@@ -473,6 +529,18 @@ BSONObj FTSSpec::fixSpec(const BSONObj& spec) {
                     textIndexVersion == TEXT_INDEX_VERSION_2 ||
                         textIndexVersion == TEXT_INDEX_VERSION_3);  // supported indexes
 
+        } else if (str::equals(e.fieldName(), "proximity") && e.isBoolean()) {
+            // New proximity indexes get the current key format.
+            if (e.boolean())
+                b.append("proximity", PROXIMITY_INDEX_VERSION_3);
+            else
+                b.append(e);
+        } else if (str::equals(e.fieldName(), "proximity") && e.isNumber()) {
+            uassert(34510,
+                    "proximity index version 1 stores its keys without the RecordId and can no "
+                    "longer be created",
+                    e.numberInt() != PROXIMITY_INDEX_VERSION_1);
+            b.append(e);
         } else {
             b.append(e);
         }
@@ -36,6 +36,7 @@
 
 #include "mongo/db/fts/fts_language.h"
 #include "mongo/db/fts/fts_util.h"
+#include "mongo/db/fts/pix_codec.h"
 #include "mongo/db/fts/stemmer.h"
 #include "mongo/db/fts/stop_words.h"
 #include "mongo/db/fts/tokenizer.h"
@@ -79,9 +80,44 @@ public:
 
     // @@@proximity
     bool proximityIndex() const {
-        return _proximityIndex;
+        return _proximityIndexVersion != PROXIMITY_INDEX_NONE;
     }
 
+    /**
+     * Key format of a proximity index: "proximity": 3 stores one key per term occurrence, and
+     * "proximity": 2 the positions of each (term, document) packed into one key.  fixSpec()
+     * turns "proximity": true into version 3; a stored "proximity": true is a version 1 index,
+     * whose keys lack the RecordId.
+     */
+    ProximityIndexVersion proximityIndexVersion() const {
+        return _proximityIndexVersion;
+    }
+
+    /**
+     * Throws if this is a version 1 proximity index.  Such an index is still loaded, so that it
+     * can be dropped, but generating its keys or querying it fails.
+     */
+    void uassertProximityKeysUsable() const;
+
+    /**
+     * True if the index stores compressed per-term posting blocks ("pix": true).
+     */
+    bool pixIndex() const {
+        return _pixIndex;
+    }
+
+    /**
+     * How a pix index codes its posting blocks ("pixBlockFormat": "varint", the default,
+     * "groupVarint" or "bitPack").  Readers accept every format, so it only affects writes.
+     */
+    PixCodec::BlockFormat pixBlockFormat() const {
+        return _pixBlockFormat;
+    }
+
+    /**
+     * Collects the positions of every term of a document, stop words included.  Positions
+     * count tokens across the indexed fields, with a gap of 100 between fields.
+     */
     void scanDocument(const BSONObj& obj, TermPositionMap* term_pos) const;
 
     bool wildcard() const {
@@ -138,13 +174,24 @@ private:
     //
 
     /**
-     * Calculate the term scores for 'raw' and update 'term_freqs' with the result.  Parses
-     * 'raw' using 'tools', and weights term scores based on 'weight'.
+     * Worker for scoreDocument() and scanDocument(): tokenizes every field once, with one
+     * tokenizer per language of the document.  Exactly one of the outputs is set.
      */
-    void _scoreStringV2(FTSTokenizer* tokenizer,
-                        StringData raw,
-                        TermFrequencyMap* term_freqs,
-                        double weight) const;
+    void _analyzeDocument(const BSONObj& obj,
+                          TermFrequencyMap* term_freqs,
+                          TermPositionMap* term_pos) const;
+
+    /**
+     * Tokenizes 'raw' once.  If 'term_freqs' is not null, adds the term scores of 'raw',
+     * weighted by 'weight'; if 'term_pos' is not null, adds the term positions of 'raw',
+     * numbered from 'startPos'.  Returns the number of tokens in 'raw'.
+     */
+    uint32_t _analyzeStringV2(FTSTokenizer* tokenizer,
+                              StringData raw,
+                              double weight,
+                              uint32_t startPos,
+                              TermFrequencyMap* term_freqs,
+                              TermPositionMap* term_pos) const;
 
 public:
     /**
@@ -176,12 +223,6 @@ private:
 
     static BSONObj _fixSpecV1(const BSONObj& spec);
 
-    // @@@proximity
-    uint32_t _scanString(FTSTokenizer* tokenizer,
-                         uint32_t startPos,
-                         StringData raw,
-                         TermPositionMap* termPosMap) const;
-
     //
     // Instance variables.
     //
@@ -202,7 +243,11 @@ private:
     std::vector<std::string> _extraAfter;
 
     // @@@proximity
-    bool _proximityIndex;
+    ProximityIndexVersion _proximityIndexVersion;
+
+    // posting list index: one compressed block of DocPostings per key
+    bool _pixIndex;
+    PixCodec::BlockFormat _pixBlockFormat;
 };
 
 }
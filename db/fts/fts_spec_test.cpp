@@ -30,6 +30,7 @@
 
 #include "mongo/platform/basic.h"
 
+#include "mongo/db/fts/fts_index_format.h"
 #include "mongo/db/fts/fts_spec.h"
 #include "mongo/db/json.h"
 #include "mongo/unittest/unittest.h"
@@ -263,6 +264,35 @@ TEST(FTSSpec, ScoreRepeatWord) {
     ASSERT(m["run"] > m["sat"]);
 }
 
+TEST(FTSSpec, ScoreAndScanDocument) {
+    BSONObj user = BSON("key" << BSON("title"
+                                      << "text"
+                                      << "body"
+                                      << "text") << "weights" << BSON("title" << 10));
+
+    FTSSpec spec(FTSSpec::fixSpec(user));
+    BSONObj doc = BSON("title"
+                       << "the cat sat"
+                       << "body"
+                       << "cat run run");
+
+    // Scores skip the stop word.
+    TermFrequencyMap scores;
+    spec.scoreDocument(doc, &scores);
+    ASSERT_EQUALS(3U, scores.size());
+    ASSERT_EQUALS(0U, scores.count("the"));
+
+    // Positions include the stop word, and the next field starts 100 positions on.
+    TermPositionMap positions;
+    spec.scanDocument(doc, &positions);
+    ASSERT_EQUALS(4U, positions.size());
+    ASSERT_EQUALS(0U, positions["the"][0]);
+    ASSERT_EQUALS(2U, positions["cat"].size());
+    ASSERT_EQUALS(1U, positions["cat"][0]);
+    ASSERT_EQUALS(103U, positions["cat"][1]);
+    ASSERT_EQUALS(2U, positions["run"].size());
+}
+
 TEST(FTSSpec, Extra1) {
     BSONObj user = BSON("key" << BSON("data"
                                       << "text"));
@@ -595,5 +625,86 @@ TEST(FTSSpec, TextIndexLegacyLanguageRecognition) {
         ASSERT_EQUALS(tfm.size(), 0U);  // "the" recognized as stopword
     }
 }
+
+TEST(FTSSpec, ProximityIndexVersion) {
+    FTSSpec none(FTSSpec::fixSpec(BSON("key" << BSON("data"
+                                                     << "text"))));
+    ASSERT_EQUALS(PROXIMITY_INDEX_NONE, none.proximityIndexVersion());
+    ASSERT_FALSE(none.proximityIndex());
+
+    // New indexes created with "proximity": true get the current key format.
+    BSONObj fixed = FTSSpec::fixSpec(BSON("key" << BSON("data"
+                                                        << "text") << "proximity" << true));
+    ASSERT_EQUALS(PROXIMITY_INDEX_VERSION_3, fixed["proximity"].numberInt());
+    FTSSpec v3(fixed);
+    ASSERT_EQUALS(PROXIMITY_INDEX_VERSION_3, v3.proximityIndexVersion());
+    ASSERT_TRUE(v3.proximityIndex());
+
+    FTSSpec v2(FTSSpec::fixSpec(BSON("key" << BSON("data"
+                                                   << "text") << "proximity" << 2)));
+    ASSERT_EQUALS(PROXIMITY_INDEX_VERSION_2, v2.proximityIndexVersion());
+    ASSERT_TRUE(v2.proximityIndex());
+
+    ASSERT_THROWS(FTSSpec(FTSSpec::fixSpec(BSON("key" << BSON("data"
+                                                              << "text") << "proximity" << 4))),
+                  UserException);
+}
+
+TEST(FTSSpec, PixBlockFormat) {
+    FTSSpec varint(FTSSpec::fixSpec(BSON("key" << BSON("data"
+                                                       << "text") << "pix" << true)));
+    ASSERT_EQUALS(PixCodec::kVarint, varint.pixBlockFormat());
+
+    FTSSpec bitPack(FTSSpec::fixSpec(BSON("key" << BSON("data"
+                                                        << "text") << "pix" << true
+                                                << "pixBlockFormat"
+                                                << "bitPack")));
+    ASSERT_EQUALS(PixCodec::kBitPack, bitPack.pixBlockFormat());
+
+    ASSERT_THROWS_CODE(FTSSpec(FTSSpec::fixSpec(BSON("key" << BSON("data"
+                                                                   << "text") << "pix" << true
+                                                           << "pixBlockFormat"
+                                                           << "simd"))),
+                       UserException,
+                       34511);
+    ASSERT_THROWS_CODE(FTSSpec(FTSSpec::fixSpec(BSON("key" << BSON("data"
+                                                                   << "text")
+                                                           << "pixBlockFormat"
+                                                           << "groupVarint"))),
+                       UserException,
+                       34512);
+}
+
+TEST(FTSSpec, ProximityIndexVersion1LoadsButHasNoKeys) {
+    // An index saved with "proximity": true before the RecordId was added to its keys still
+    // loads, so that it can be dropped, but its keys cannot be generated.
+    BSONObj stored = FTSSpec::fixSpec(BSON("key" << BSON("data"
+                                                         << "text")));
+    BSONObjBuilder b;
+    b.appendElements(stored);
+    b.append("proximity", true);
+    FTSSpec spec(b.obj());
+    ASSERT_EQUALS(PROXIMITY_INDEX_VERSION_1, spec.proximityIndexVersion());
+    ASSERT_THROWS_CODE(spec.uassertProximityKeysUsable(), UserException, 34510);
+
+    BSONObjSet keys;
+    ASSERT_THROWS_CODE(FTSIndexFormat::getKeys(spec,
+                                               BSON("data"
+                                                    << "cat dog"),
+                                               &keys),
+                       UserException,
+                       34510);
+
+    // Nor can a new one be created.
+    ASSERT_THROWS_CODE(FTSSpec::fixSpec(BSON("key" << BSON("data"
+                                                           << "text") << "proximity" << 1)),
+                       UserException,
+                       34510);
+
+    // Other specs are usable.
+    FTSSpec(FTSSpec::fixSpec(BSON("key" << BSON("data"
+                                                << "text") << "proximity" << true)))
+        .uassertProximityKeysUsable();
+}
 }
 }
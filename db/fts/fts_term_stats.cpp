@@ -0,0 +1,105 @@
+/**
+ *    Copyright (C) 2016 MongoDB Inc.
+ *
+ *    This program is free software: you can redistribute it and/or  modify
+ *    it under the terms of the GNU Affero General Public License, version 3,
+ *    as published by the Free Software Foundation.
+ *
+ *    This program is distributed in the hope that it will be useful,
+ *    but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *    GNU Affero General Public License for more details.
+ *
+ *    You should have received a copy of the GNU Affero General Public License
+ *    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ *    As a special exception, the copyright holders give permission to link the
+ *    code of portions of this program with the OpenSSL library under certain
+ *    conditions as described in each individual source file and distribute
+ *    linked combinations including the program with the OpenSSL library. You
+ *    must comply with the GNU Affero General Public License in all respects for
+ *    all of the code used other than as permitted herein. If you modify file(s)
+ *    with this exception, you may extend this exception to your version of the
+ *    file(s), but you are not obligated to do so. If you do not wish to do so,
+ *    delete this exception statement from your version. If you delete this
+ *    exception statement from all source files in the program, then also delete
+ *    it in the license file.
+ */
+#include "mongo/platform/basic.h"
+
+#include "mongo/db/fts/fts_term_stats.h"
+
+#include <algorithm>
+#include <cmath>
+
+namespace mongo {
+namespace fts {
+
+void FTSTermStats::update(const std::string& term, double weight, int count) {
+    stdx::lock_guard<stdx::mutex> lk(_mutex);
+    TermStats& stats = _terms[term];
+    stats.docFreq += count;
+    stats.weightSum += count * weight;
+    if (count > 0 && weight > stats.maxWeight) {
+        stats.maxWeight = weight;
+    }
+    if (stats.docFreq <= 0) {
+        _terms.erase(term);
+    }
+}
+
+FTSTermStats::TermStats FTSTermStats::get(const std::string& term) const {
+    stdx::lock_guard<stdx::mutex> lk(_mutex);
+    auto it = _terms.find(term);
+    return it == _terms.end() ? TermStats() : it->second;
+}
+
+size_t FTSTermStats::numTerms() const {
+    stdx::lock_guard<stdx::mutex> lk(_mutex);
+    return _terms.size();
+}
+
+void FTSTermStats::clear() {
+    stdx::lock_guard<stdx::mutex> lk(_mutex);
+    _terms.clear();
+    _seeded = false;
+}
+
+void FTSTermStats::setSeeded() {
+    stdx::lock_guard<stdx::mutex> lk(_mutex);
+    _seeded = true;
+}
+
+bool FTSTermStats::isSeeded() const {
+    stdx::lock_guard<stdx::mutex> lk(_mutex);
+    return _seeded;
+}
+
+std::vector<std::string> FTSTermStats::orderByDocFreq(const std::set<std::string>& terms) const {
+    std::vector<std::pair<long long, std::string>> byFreq;
+    {
+        stdx::lock_guard<stdx::mutex> lk(_mutex);
+        for (const auto& term : terms) {
+            auto it = _terms.find(term);
+            byFreq.emplace_back(it == _terms.end() ? 0 : it->second.docFreq, term);
+        }
+    }
+    std::stable_sort(byFreq.begin(),
+                     byFreq.end(),
+                     [](const std::pair<long long, std::string>& a,
+                        const std::pair<long long, std::string>& b) { return a.first < b.first; });
+
+    std::vector<std::string> ordered;
+    for (const auto& entry : byFreq) {
+        ordered.push_back(entry.second);
+    }
+    return ordered;
+}
+
+double FTSTermStats::idf(long long docFreq, long long numDocs) {
+    // The "+ 1" keeps the weight positive for terms found in more than half the documents.
+    return std::log(1 + (numDocs - docFreq + 0.5) / (docFreq + 0.5));
+}
+
+}  // namespace fts
+}  // namespace mongo
@@ -0,0 +1,109 @@
+/**
+ *    Copyright (C) 2016 MongoDB Inc.
+ *
+ *    This program is free software: you can redistribute it and/or  modify
+ *    it under the terms of the GNU Affero General Public License, version 3,
+ *    as published by the Free Software Foundation.
+ *
+ *    This program is distributed in the hope that it will be useful,
+ *    but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *    GNU Affero General Public License for more details.
+ *
+ *    You should have received a copy of the GNU Affero General Public License
+ *    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ *    As a special exception, the copyright holders give permission to link the
+ *    code of portions of this program with the OpenSSL library under certain
+ *    conditions as described in each individual source file and distribute
+ *    linked combinations including the program with the OpenSSL library. You
+ *    must comply with the GNU Affero General Public License in all respects for
+ *    all of the code used other than as permitted herein. If you modify file(s)
+ *    with this exception, you may extend this exception to your version of the
+ *    file(s), but you are not obligated to do so. If you do not wish to do so,
+ *    delete this exception statement from your version. If you delete this
+ *    exception statement from all source files in the program, then also delete
+ *    it in the license file.
+ */
+#pragma once
+
+#include <set>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include "mongo/base/disallow_copying.h"
+#include "mongo/stdx/mutex.h"
+
+namespace mongo {
+namespace fts {
+
+/**
+ * Per-term statistics of a text index, kept up to date as its keys are inserted and removed.
+ *
+ * Each key of a text index carries the score of one term in one document, so the statistics
+ * are in the same units: the number of documents containing the term, the sum of its scores
+ * over the collection, and the highest score it has had.  The highest score is an upper bound
+ * only: it is not lowered when the document that set it is removed.
+ *
+ * The counters live in memory only.  They start from zero when the index is opened and are only
+ * trustworthy once they have been seeded from a scan of the whole index (see isSeeded()); they
+ * are lost on restart.  Changes are applied after their write unit of work commits, so a reader
+ * may see counts that trail the index.  The statistics are therefore fit for reporting and for
+ * ordering the scans of a query, not for bounding scores.  Safe for concurrent use.
+ */
+class FTSTermStats {
+    MONGO_DISALLOW_COPYING(FTSTermStats);
+
+public:
+    struct TermStats {
+        long long docFreq = 0;
+        double weightSum = 0;
+        double maxWeight = 0;
+    };
+
+    FTSTermStats() = default;
+
+    /**
+     * Records one document key for 'term' with score 'weight': 'count' is 1 when the key is
+     * inserted and -1 when it is removed.
+     */
+    void update(const std::string& term, double weight, int count);
+
+    /**
+     * Returns the statistics of 'term', all zero if it does not occur in the index.
+     */
+    TermStats get(const std::string& term) const;
+
+    /**
+     * Number of distinct terms in the index.
+     */
+    size_t numTerms() const;
+
+    /**
+     * Drops all counters before they are seeded again from the index.
+     */
+    void clear();
+
+    void setSeeded();
+    bool isSeeded() const;
+
+    /**
+     * Returns 'terms' ordered by increasing document frequency, rarest first; terms with the
+     * same frequency stay in their set order.
+     */
+    std::vector<std::string> orderByDocFreq(const std::set<std::string>& terms) const;
+
+    /**
+     * The BM25 inverse document frequency of a term found in 'docFreq' of 'numDocs' documents.
+     */
+    static double idf(long long docFreq, long long numDocs);
+
+private:
+    mutable stdx::mutex _mutex;
+    bool _seeded = false;
+    std::unordered_map<std::string, TermStats> _terms;
+};
+
+}  // namespace fts
+}  // namespace mongo
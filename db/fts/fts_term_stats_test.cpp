@@ -0,0 +1,95 @@
+/**
+ *    Copyright (C) 2016 MongoDB Inc.
+ *
+ *    This program is free software: you can redistribute it and/or  modify
+ *    it under the terms of the GNU Affero General Public License, version 3,
+ *    as published by the Free Software Foundation.
+ *
+ *    This program is distributed in the hope that it will be useful,
+ *    but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *    GNU Affero General Public License for more details.
+ *
+ *    You should have received a copy of the GNU Affero General Public License
+ *    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ *    As a special exception, the copyright holders give permission to link the
+ *    code of portions of this program with the OpenSSL library under certain
+ *    conditions as described in each individual source file and distribute
+ *    linked combinations including the program with the OpenSSL library. You
+ *    must comply with the GNU Affero General Public License in all respects for
+ *    all of the code used other than as permitted herein. If you modify file(s)
+ *    with this exception, you may extend this exception to your version of the
+ *    file(s), but you are not obligated to do so. If you do not wish to do so,
+ *    delete this exception statement from your version. If you delete this
+ *    exception statement from all source files in the program, then also delete
+ *    it in the license file.
+ */
+#include "mongo/platform/basic.h"
+
+#include "mongo/db/fts/fts_term_stats.h"
+#include "mongo/unittest/unittest.h"
+
+namespace mongo {
+namespace fts {
+
+TEST(FTSTermStats, InsertAndRemove) {
+    FTSTermStats stats;
+    stats.update("run", 1.5, 1);
+    stats.update("run", 0.75, 1);
+    stats.update("walk", 1.0, 1);
+
+    FTSTermStats::TermStats run = stats.get("run");
+    ASSERT_EQUALS(2, run.docFreq);
+    ASSERT_EQUALS(2.25, run.weightSum);
+    ASSERT_EQUALS(1.5, run.maxWeight);
+    ASSERT_EQUALS(2U, stats.numTerms());
+
+    // The maximum is an upper bound and stays put.
+    stats.update("run", 1.5, -1);
+    run = stats.get("run");
+    ASSERT_EQUALS(1, run.docFreq);
+    ASSERT_EQUALS(0.75, run.weightSum);
+    ASSERT_EQUALS(1.5, run.maxWeight);
+
+    // A term goes away with its last document.
+    stats.update("walk", 1.0, -1);
+    ASSERT_EQUALS(0, stats.get("walk").docFreq);
+    ASSERT_EQUALS(1U, stats.numTerms());
+}
+
+TEST(FTSTermStats, Seeded) {
+    FTSTermStats stats;
+    ASSERT_FALSE(stats.isSeeded());
+    stats.update("run", 1.0, 1);
+    stats.setSeeded();
+    ASSERT_TRUE(stats.isSeeded());
+
+    stats.clear();
+    ASSERT_FALSE(stats.isSeeded());
+    ASSERT_EQUALS(0U, stats.numTerms());
+}
+
+TEST(FTSTermStats, OrderByDocFreq) {
+    FTSTermStats stats;
+    for (int i = 0; i < 3; ++i)
+        stats.update("common", 1.0, 1);
+    stats.update("rare", 1.0, 1);
+    stats.update("rarer", 1.0, 1);
+
+    std::vector<std::string> ordered =
+        stats.orderByDocFreq({"common", "missing", "rare", "rarer"});
+    ASSERT_EQUALS(4U, ordered.size());
+    ASSERT_EQUALS("missing", ordered[0]);
+    ASSERT_EQUALS("rare", ordered[1]);
+    ASSERT_EQUALS("rarer", ordered[2]);
+    ASSERT_EQUALS("common", ordered[3]);
+}
+
+TEST(FTSTermStats, Idf) {
+    ASSERT_GREATER_THAN(FTSTermStats::idf(1, 100), FTSTermStats::idf(10, 100));
+    ASSERT_GREATER_THAN(FTSTermStats::idf(100, 100), 0.0);
+}
+
+}  // namespace fts
+}  // namespace mongo
@@ -94,6 +94,12 @@ public:
      */
     virtual StringData get() const = 0;
     virtual StringData getWord() const = 0;     // @@@proximity
+
+    /**
+     * Returns true if the current token is a stop word, which only happens when stop words are
+     * not filtered.
+     */
+    virtual bool isStopWord() const = 0;
 };
 
 }  // namespace fts
@@ -30,6 +30,10 @@
 
 #include "mongo/db/fts/fts_unicode_tokenizer.h"
 
+#if defined(__SSE2__)
+#include <emmintrin.h>
+#endif
+
 #include "mongo/db/fts/fts_query_impl.h"
 #include "mongo/db/fts/fts_spec.h"
 #include "mongo/db/fts/stemmer.h"
@@ -44,6 +48,134 @@ namespace fts {
 
 using std::string;
 
+namespace {
+
+// Per-byte flags of the ASCII classification tables.
+const uint8_t kAsciiDelimiter = 1 << 0;
+// The character lowercases to something other than its ASCII lowercase, or is a diacritic, so a
+// token containing it must go through unicode::String.
+const uint8_t kAsciiNeedsUnicode = 1 << 1;
+
+/**
+ * Classification of the 128 ASCII characters for each delimiter list and case folding mode,
+ * derived once from the codepoint functions so that the two paths cannot disagree.
+ */
+class AsciiClassTables {
+public:
+    AsciiClassTables() {
+        for (int d = 0; d < 2; ++d) {
+            for (int m = 0; m < 2; ++m) {
+                auto delimLang = d ? unicode::DelimiterListLanguage::kNotEnglish
+                                   : unicode::DelimiterListLanguage::kEnglish;
+                auto mode = m ? unicode::CaseFoldMode::kTurkish : unicode::CaseFoldMode::kNormal;
+                for (char32_t c = 0; c < 128; ++c) {
+                    uint8_t flags = 0;
+                    if (unicode::codepointIsDelimiter(c, delimLang)) {
+                        flags |= kAsciiDelimiter;
+                    }
+                    char32_t lower = (c >= 'A' && c <= 'Z') ? c + ('a' - 'A') : c;
+                    if (unicode::codepointToLower(c, mode) != lower ||
+                        unicode::codepointIsDiacritic(c)) {
+                        flags |= kAsciiNeedsUnicode;
+                    }
+                    _tables[d][m][c] = flags;
+                }
+            }
+        }
+    }
+
+    const uint8_t* get(unicode::DelimiterListLanguage delimLang,
+                       unicode::CaseFoldMode mode) const {
+        return _tables[delimLang == unicode::DelimiterListLanguage::kNotEnglish]
+                      [mode == unicode::CaseFoldMode::kTurkish];
+    }
+
+private:
+    uint8_t _tables[2][2][128];
+};
+
+const AsciiClassTables& asciiClassTables() {
+    static const AsciiClassTables tables;
+    return tables;
+}
+
+/**
+ * Returns true if every byte of [p, p + n) is below 0x80.
+ */
+bool isAscii(const char* p, size_t n) {
+    size_t i = 0;
+#if defined(__SSE2__)
+    for (; i + 16 <= n; i += 16) {
+        __m128i v = _mm_loadu_si128(reinterpret_cast<const __m128i*>(p + i));
+        if (_mm_movemask_epi8(v)) {
+            return false;
+        }
+    }
+#endif
+    for (; i < n; ++i) {
+        if (static_cast<unsigned char>(p[i]) & 0x80) {
+            return false;
+        }
+    }
+    return true;
+}
+
+inline bool isAsciiLetter(char c) {
+    return (c | 0x20) >= 'a' && (c | 0x20) <= 'z';
+}
+
+/**
+ * Returns the length of the run of ASCII letters at the start of [p, p + n). Letters are never
+ * delimiters and never need the Unicode path, so most of a word is consumed here.
+ */
+size_t scanAsciiLetters(const char* p, size_t n) {
+    size_t i = 0;
+#if defined(__SSE2__)
+    const __m128i caseBit = _mm_set1_epi8(0x20);
+    const __m128i beforeA = _mm_set1_epi8('a' - 1);
+    const __m128i afterZ = _mm_set1_epi8('z' + 1);
+    for (; i + 16 <= n; i += 16) {
+        __m128i v = _mm_or_si128(_mm_loadu_si128(reinterpret_cast<const __m128i*>(p + i)), caseBit);
+        __m128i letters = _mm_and_si128(_mm_cmpgt_epi8(v, beforeA), _mm_cmplt_epi8(v, afterZ));
+        unsigned mask = ~static_cast<unsigned>(_mm_movemask_epi8(letters)) & 0xffff;
+        if (mask) {
+            return i + __builtin_ctz(mask);
+        }
+    }
+#endif
+    while (i < n && isAsciiLetter(p[i])) {
+        ++i;
+    }
+    return i;
+}
+
+/**
+ * Appends the ASCII lowercase of [p, p + n) to 'out'.
+ */
+void appendAsciiLower(const char* p, size_t n, std::string* out) {
+    size_t base = out->size();
+    out->resize(base + n);
+    char* dst = &(*out)[base];
+    size_t i = 0;
+#if defined(__SSE2__)
+    const __m128i beforeA = _mm_set1_epi8('A' - 1);
+    const __m128i afterZ = _mm_set1_epi8('Z' + 1);
+    const __m128i caseBit = _mm_set1_epi8(0x20);
+    for (; i + 16 <= n; i += 16) {
+        __m128i v = _mm_loadu_si128(reinterpret_cast<const __m128i*>(p + i));
+        __m128i upper = _mm_and_si128(_mm_cmpgt_epi8(v, beforeA), _mm_cmplt_epi8(v, afterZ));
+        v = _mm_or_si128(v, _mm_and_si128(upper, caseBit));
+        _mm_storeu_si128(reinterpret_cast<__m128i*>(dst + i), v);
+    }
+#endif
+    for (; i < n; ++i) {
+        char c = p[i];
+        dst[i] = (c >= 'A' && c <= 'Z') ? c | 0x20 : c;
+    }
+}
+
+}  // namespace
+
 UnicodeFTSTokenizer::UnicodeFTSTokenizer(const FTSLanguage* language)
     : _language(language), _stemmer(language), _stopWords(StopWords::getStopWords(language)) {
     if (_language->str() == "english") {
@@ -57,12 +189,20 @@ UnicodeFTSTokenizer::UnicodeFTSTokenizer(const FTSLanguage* language)
     } else {
         _caseFoldMode = unicode::CaseFoldMode::kNormal;
     }
+
+    _asciiClasses = asciiClassTables().get(_delimListLanguage, _caseFoldMode);
 }
 
 void UnicodeFTSTokenizer::reset(StringData document, Options options) {
     _options = options;
     _pos = 0;
-    _document.resetData(document);
+
+    _asciiDocument = isAscii(document.rawData(), document.size());
+    if (_asciiDocument) {
+        _asciiBuf.assign(document.rawData(), document.size());
+    } else {
+        _document.resetData(document);
+    }
 
     // Skip any leading delimiters (and handle the case where the document is entirely delimiters).
     _skipDelimiters();
@@ -70,46 +210,119 @@ void UnicodeFTSTokenizer::reset(StringData document, Options options) {
 
 bool UnicodeFTSTokenizer::moveNext() {
     while (true) {
-        if (_pos >= _document.size()) {
+        if (_pos >= _documentSize()) {
             _stem = "";
             return false;
         }
 
-        // Traverse through non-delimiters and build the next token.
-        size_t start = _pos++;
-        while (_pos < _document.size() &&
-               (!unicode::codepointIsDelimiter(_document[_pos], _delimListLanguage))) {
-            ++_pos;
+        if (_asciiDocument ? _nextAsciiToken() : _nextUnicodeToken()) {
+            return true;
         }
-        _document.substrToBuf(start, _pos - start, _tokenBuf);
-
-        // Skip the delimiters before the next token.
-        _skipDelimiters();
+    }
+}
 
-        // Stop words are case-sensitive and diacritic sensitive, so we need them to be lower cased
-        // but with diacritics not removed to check against the stop word list.
-        _tokenBuf.toLowerToBuf(_caseFoldMode, _wordBuf);
+bool UnicodeFTSTokenizer::_nextAsciiToken() {
+    const char* data = _asciiBuf.data();
+    const size_t size = _asciiBuf.size();
 
-        if ((_options & kFilterStopWords) && _stopWords->isStopWord(_wordBuf.toString())) {
-            continue;
+    // Traverse through non-delimiters, a run of letters at a time, and build the next token.
+    size_t start = _pos;
+    uint8_t flags = 0;
+    while (_pos < size) {
+        _pos += scanAsciiLetters(data + _pos, size - _pos);
+        if (_pos >= size) {
+            break;
         }
-
-        if (_options & kGenerateCaseSensitiveTokens) {
-            _tokenBuf.copyToBuf(_wordBuf);
+        uint8_t c = _asciiClasses[static_cast<unsigned char>(data[_pos])];
+        if (c & kAsciiDelimiter) {
+            break;
         }
+        flags |= c;
+        ++_pos;
+    }
+    StringData token(data + start, _pos - start);
 
-        // The stemmer is diacritic sensitive, so stem the word before removing diacritics.
-        _word = _wordBuf.toString();        // @@@proximity
-        _stem = _stemmer.stem(_word);       // @@@proximity
+    // Skip the delimiters before the next token.
+    _skipDelimiters();
+
+    if (flags & kAsciiNeedsUnicode) {
+        _tokenBuf.resetData(token);
+        return _processTokenBuf();
+    }
 
-        if (!(_options & kGenerateDiacriticSensitiveTokens)) {
-            _tokenBuf.resetData(_stem);
-            _tokenBuf.removeDiacriticsToBuf(_wordBuf);
-            _stem = _wordBuf.toString();
+    _word.clear();
+    appendAsciiLower(token.rawData(), token.size(), &_word);
+
+    _isStopWord = _stopWords->isStopWord(_word);
+    if ((_options & kFilterStopWords) && _isStopWord) {
+        return false;
+    }
+
+    if (_options & kGenerateCaseSensitiveTokens) {
+        _word.assign(token.rawData(), token.size());
+    }
+
+    StringData stem = _stemmer.stem(_word);
+    _stem.assign(stem.rawData(), stem.size());
+
+    // The stem of an ASCII word is normally ASCII without diacritics; anything else goes through
+    // the Unicode diacritic removal.
+    if (!(_options & kGenerateDiacriticSensitiveTokens)) {
+        for (char c : _stem) {
+            if ((c & 0x80) || (_asciiClasses[static_cast<unsigned char>(c)] & kAsciiNeedsUnicode)) {
+                _tokenBuf.resetData(_stem);
+                _tokenBuf.removeDiacriticsToBuf(_wordBuf);
+                _stem = _wordBuf.toString();
+                break;
+            }
         }
+    }
 
-        return true;
+    return true;
+}
+
+bool UnicodeFTSTokenizer::_nextUnicodeToken() {
+    // Traverse through non-delimiters and build the next token.
+    size_t start = _pos++;
+    while (_pos < _document.size() &&
+           (!unicode::codepointIsDelimiter(_document[_pos], _delimListLanguage))) {
+        ++_pos;
+    }
+    _document.substrToBuf(start, _pos - start, _tokenBuf);
+
+    // Skip the delimiters before the next token.
+    _skipDelimiters();
+
+    return _processTokenBuf();
+}
+
+bool UnicodeFTSTokenizer::_processTokenBuf() {
+    // Stop words are case-sensitive and diacritic sensitive, so we need them to be lower cased
+    // but with diacritics not removed to check against the stop word list.
+    _tokenBuf.toLowerToBuf(_caseFoldMode, _wordBuf);
+
+    _word = _wordBuf.toString();        // @@@proximity
+    _isStopWord = _stopWords->isStopWord(_word);
+    if ((_options & kFilterStopWords) && _isStopWord) {
+        return false;
+    }
+
+    if (_options & kGenerateCaseSensitiveTokens) {
+        _tokenBuf.copyToBuf(_wordBuf);
+        _word = _wordBuf.toString();
     }
+
+    // The stemmer is diacritic sensitive, so stem the word before removing diacritics.
+    StringData stem = _stemmer.stem(_word);       // @@@proximity
+    _stem.assign(stem.rawData(), stem.size());
+
+    if (!(_options & kGenerateDiacriticSensitiveTokens)) {
+        _tokenBuf.resetData(_stem);
+        _tokenBuf.removeDiacriticsToBuf(_wordBuf);
+        _stem = _wordBuf.toString();
+    }
+
+    return true;
 }
 
 StringData UnicodeFTSTokenizer::get() const {
@@ -120,7 +333,19 @@ StringData UnicodeFTSTokenizer::getWord() const {
     return _word;
 }
 
+bool UnicodeFTSTokenizer::isStopWord() const {
+    return _isStopWord;
+}
+
 void UnicodeFTSTokenizer::_skipDelimiters() {
+    if (_asciiDocument) {
+        while (_pos < _asciiBuf.size() &&
+               (_asciiClasses[static_cast<unsigned char>(_asciiBuf[_pos])] & kAsciiDelimiter)) {
+            ++_pos;
+        }
+        return;
+    }
+
     while (_pos < _document.size() &&
            unicode::codepointIsDelimiter(_document[_pos], _delimListLanguage)) {
         ++_pos;
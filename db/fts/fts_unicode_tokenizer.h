@@ -28,6 +28,9 @@
 
 #pragma once
 
+#include <cstdint>
+#include <string>
+
 #include "mongo/base/disallow_copying.h"
 #include "mongo/base/string_data.h"
 #include "mongo/db/fts/fts_tokenizer.h"
@@ -53,6 +56,11 @@ class StopWords;
  *
  * For each word returns a stem version of a word optimized for full text indexing.
  * Optionally supports returning case sensitive search terms.
+ *
+ * Documents that are entirely ASCII are tokenized directly on their bytes, 16 at a time where
+ * SSE2 is available, without the UTF-32 conversion. Tokens containing a character whose
+ * delimiter, case folding or diacritic rules cannot be taken from the ASCII tables (for example
+ * 'I' under Turkish case folding) are handed to the Unicode path one token at a time.
  */
 class UnicodeFTSTokenizer final : public FTSTokenizer {
     MONGO_DISALLOW_COPYING(UnicodeFTSTokenizer);
@@ -66,6 +74,7 @@ public:
 
     StringData get() const override;
     StringData getWord() const override;    // @@@proximity
+    bool isStopWord() const override;
 
 private:
     /**
@@ -74,6 +83,28 @@ private:
      */
     void _skipDelimiters();
 
+    /**
+     * Scans the next token of an ASCII document. Returns false if the token is a stop word that is
+     * being filtered.
+     */
+    bool _nextAsciiToken();
+
+    /**
+     * Scans the next token of a document that is not all ASCII. Returns false if the token is a
+     * stop word that is being filtered.
+     */
+    bool _nextUnicodeToken();
+
+    /**
+     * Lowercases, stop word checks, stems and removes diacritics from the token in _tokenBuf.
+     * Returns false if the token is a stop word that is being filtered.
+     */
+    bool _processTokenBuf();
+
+    size_t _documentSize() const {
+        return _asciiDocument ? _asciiBuf.size() : _document.size();
+    }
+
     unicode::DelimiterListLanguage _delimListLanguage;
     unicode::CaseFoldMode _caseFoldMode;
 
@@ -84,6 +115,12 @@ private:
     unicode::String _document;
     size_t _pos;
 
+    // Set by reset() when the document is all ASCII; the document is then held in _asciiBuf
+    // and _pos is a byte offset into it.
+    bool _asciiDocument = false;
+    std::string _asciiBuf;
+    const uint8_t* _asciiClasses;
+
     unicode::String _tokenBuf;
     unicode::String _wordBuf;
 
@@ -91,6 +128,7 @@ private:
 
     std::string _stem;
     std::string _word;  // @@@proximity
+    bool _isStopWord = false;
 };
 
 }  // namespace fts
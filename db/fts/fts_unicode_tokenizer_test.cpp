@@ -239,5 +239,49 @@ TEST(FtsUnicodeTokenizer, FrenchStopWordsAndDiacriticSensitive) {
     ASSERT_EQUALS("excit", terms[4]);
 }
 
+// Ensure that documents that are all ASCII, which are tokenized on their bytes, produce the same
+// tokens as the Unicode path. Appending a no-break space, which is a delimiter, forces the
+// Unicode path without changing the tokens.
+TEST(FtsUnicodeTokenizer, AsciiMatchesUnicodePath) {
+    const char* docs[] = {
+        "Do you see Mark's dog running?",
+        "  , Voyez-vous le chien de Mark courante? C'est bien!  ",
+        "SEN NEREDEN VARDIR? IRMAK ISTANBUL izmir",
+        "Internationalization_and_localization REPRESENTATIONALISM x86_64 2016-03-01",
+        "a^b `quoted` under_score tab\there\nthere {braces} [brackets] ~tilde~ 0123456789abcdef",
+        "",
+        "?!",
+    };
+    const char* languages[] = {"english", "french", "turkish", "none"};
+    FTSTokenizer::Options options[] = {FTSTokenizer::kNone,
+                                       FTSTokenizer::kFilterStopWords,
+                                       FTSTokenizer::kGenerateCaseSensitiveTokens,
+                                       FTSTokenizer::kGenerateDiacriticSensitiveTokens};
+
+    for (const char* doc : docs) {
+        std::string unicodeDoc = std::string(doc) + "\xc2\xa0";
+        for (const char* language : languages) {
+            for (FTSTokenizer::Options option : options) {
+                std::vector<std::string> asciiTerms = tokenizeString(doc, language, option);
+                std::vector<std::string> unicodeTerms =
+                    tokenizeString(unicodeDoc.c_str(), language, option);
+                ASSERT_EQUALS(unicodeTerms.size(), asciiTerms.size());
+                for (size_t i = 0; i < asciiTerms.size(); ++i) {
+                    ASSERT_EQUALS(unicodeTerms[i], asciiTerms[i]);
+                }
+            }
+        }
+    }
+}
+
+// Ensure that ASCII tokens whose Turkish lowercase is not ASCII are still folded correctly.
+TEST(FtsUnicodeTokenizer, TurkishAsciiDocument) {
+    std::vector<std::string> terms = tokenizeString(
+        "IRMAK", "turkish", FTSTokenizer::kGenerateDiacriticSensitiveTokens);
+
+    ASSERT_EQUALS(1U, terms.size());
+    ASSERT_EQUALS(0U, terms[0].find("ı"));
+}
+
 }  // namespace fts
 }  // namespace mongo
@@ -47,5 +47,17 @@ enum TextIndexVersion {
     TEXT_INDEX_VERSION_2 = 2,        // Index format with ASCII support and murmur hashing.
     TEXT_INDEX_VERSION_3 = 3,        // Current index format with basic Unicode support.
 };
+
+// @@@proximity
+// Proximity key formats, numbered in the order they were introduced.  A new index created with
+// "proximity": true gets version 3, the one key per occurrence format that "true" has always
+// meant; version 2 is the compact format, which has to be asked for by number.  A version 1
+// index still loads and can be dropped, but its keys can no longer be read or written.
+enum ProximityIndexVersion {
+    PROXIMITY_INDEX_NONE = 0,        // Not a proximity index.
+    PROXIMITY_INDEX_VERSION_1 = 1,   // Legacy {term, pos} keys without the RecordId.  Unusable.
+    PROXIMITY_INDEX_VERSION_2 = 2,   // One key per (term, document): {term, packed positions}.
+    PROXIMITY_INDEX_VERSION_3 = 3,   // One key per term occurrence: {term, pos}.
+};
 }
 }
@@ -1,5 +1,55 @@
 import sys
 
+def fnv1a( word, seed ):
+    # must match StopWords::hash
+    h = 2166136261 ^ seed
+    for c in bytearray( word ):
+        h = ( ( h ^ c ) * 16777619 ) & 0xffffffff
+    return h
+
+def perfect_hash( words ):
+    """Returns (slots, displacements) of a minimal perfect hash table over words.
+
+    A word lands in bucket fnv1a( word, 0 ) % n.  Buckets holding several words are placed
+    first, largest first, each with the first seed that sends its words to free slots.  The
+    words of single-word buckets then fill the remaining slots, and their displacement
+    -(slot + 1) records the slot directly.  StopWords( const std::set<std::string>& ) builds
+    the same table at runtime.
+    """
+    n = len( words )
+    buckets = [ [] for b in range( n ) ]
+    for w in words:
+        buckets[ fnv1a( w, 0 ) % n ].append( w )
+
+    order = sorted( range( n ), key=lambda b: -len( buckets[ b ] ) )
+    slots = [ None ] * n
+    displacements = [ 0 ] * n
+
+    i = 0
+    while i < n and len( buckets[ order[ i ] ] ) > 1:
+        bucket = buckets[ order[ i ] ]
+        seed = 1
+        while True:
+            placed = [ fnv1a( w, seed ) % n for w in bucket ]
+            if len( set( placed ) ) == len( placed ) and \
+                    all( slots[ s ] is None for s in placed ):
+                break
+            seed += 1
+        for w, s in zip( bucket, placed ):
+            slots[ s ] = w
+        displacements[ order[ i ] ] = seed
+        i += 1
+
+    free_slot = 0
+    while i < n and len( buckets[ order[ i ] ] ) == 1:
+        while slots[ free_slot ] is not None:
+            free_slot += 1
+        slots[ free_slot ] = buckets[ order[ i ] ][ 0 ]
+        displacements[ order[ i ] ] = -free_slot - 1
+        i += 1
+
+    return slots, displacements
+
 def generate( header, source, language_files ):
     print( "header: %s" % header )
     print( "source: %s" % source )
@@ -10,13 +60,12 @@ def generate( header, source, language_files ):
     out = open( header, "wb" )
     out.write( """
 #pragma once
-#include <set>
-#include <string>
+#include "mongo/db/fts/stop_words.h"
 #include "mongo/util/string_map.h"
 namespace mongo {
 namespace fts {
 
-  void loadStopWordMap( StringMap< std::set< std::string > >* m );
+  void loadStopWordTables( StringMap< StopWords::Table >* m );
 }
 }
 """ )
@@ -30,25 +79,40 @@ namespace fts {
 namespace mongo {
 namespace fts {
 
-  void loadStopWordMap( StringMap< std::set< std::string > >* m ) {
+namespace {
 
 """ )
 
+    languages = []
     for l_file in language_files:
         l = l_file.rpartition( "_" )[2].partition( "." )[0]
+        languages.append( l )
+
+        words = sorted( set( word.strip() for word in open( l_file, "rb" ) ) )
+        slots, displacements = perfect_hash( words )
 
         out.write( '  // %s\n' % l_file )
-        out.write( '  {\n' )
-        out.write( '   const char* const words[] = {\n' )
-        for word in open( l_file, "rb" ):
-            out.write( '       "%s",\n' % word.strip() )
-        out.write( '   };\n' )
-        out.write( '   const size_t wordcnt = sizeof(words) / sizeof(words[0]);\n' )
-        out.write( '   std::set< std::string >& l = (*m)["%s"];\n' % l )
-        out.write( '   l.insert(&words[0], &words[wordcnt]);\n' )
-        out.write( '  }\n' )
-    out.write( """
-  }
+        out.write( '  const char* const %sWords[] = {\n' % l )
+        for word in slots:
+            out.write( '       "%s",\n' % word )
+        out.write( '  };\n' )
+        out.write( '  const uint32_t %sSizes[] = {\n' % l )
+        for word in slots:
+            out.write( '       %d,\n' % len( word ) )
+        out.write( '  };\n' )
+        out.write( '  const int32_t %sDisplacements[] = {\n' % l )
+        for d in displacements:
+            out.write( '       %d,\n' % d )
+        out.write( '  };\n\n' )
+
+    out.write( """} // namespace
+
+  void loadStopWordTables( StringMap< StopWords::Table >* m ) {
+""" )
+    for l in languages:
+        out.write( '    (*m)["%s"] = StopWords::Table{ %sWords, %sSizes, %sDisplacements,\n'
+                   '        sizeof(%sWords) / sizeof(%sWords[0]) };\n' % ( l, l, l, l, l, l ) )
+    out.write( """  }
 } // namespace fts
 } // namespace mongo
 """ )
@@ -85,7 +85,7 @@ void BitBuffer::pack(unsigned char* cbuf, uint32_t clen) {
 }
 
 void BitBuffer::print() const {
-    for (int j=0; j<buflen; ++j)
+    for (uint32_t j=0; j<buflen; ++j)
         std::cout << (get(j) ? "1" : "0");
 }
 
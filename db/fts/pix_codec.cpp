@@ -54,19 +54,21 @@ uint32_t PixCodec::varCompress(   // return: number of output bytes
             cbuf[offset++] = (unsigned char)(c|HIGHBIT);
             cbuf[offset++] = (unsigned char)(d);
         }
-        if (b!=0) {
+        else if (b!=0) {
             if (offset+3 > clen) goto error;
             cbuf[offset++] = (unsigned char)(b|HIGHBIT);
             cbuf[offset++] = (unsigned char)(c|HIGHBIT);
             cbuf[offset++] = (unsigned char)(d);
         }
-        if (c!=0) {
+        else if (c!=0) {
             if (offset+2 > clen) goto error;
             cbuf[offset++] = (unsigned char)(c|HIGHBIT);
             cbuf[offset++] = (unsigned char)(d);
         }
-        if (offset+1 > clen) goto error;
-        cbuf[offset++] = (unsigned char)(d);
+        else {
+            if (offset+1 > clen) goto error;
+            cbuf[offset++] = (unsigned char)(d);
+        }
     }
     return offset;
 
@@ -74,6 +76,7 @@ error:
     std::cout << "Output buffer overrun: clen = " << clen <<
                  "offset = " << offset << std::endl;
     assert(false);
+    return offset;
 }
 
 uint32_t PixCodec::varCompress(     // return: number of output bytes
@@ -356,6 +359,31 @@ uint32_t PixCodec::varCompress(     // return: number of output bytes
     return n;
 }
 
+uint32_t PixCodec::varEncode(       // return: number of output bytes
+    vector<unsigned char>& cvec,    // output: vector of compressed values
+    uint32_t x)                     // input:  value to encode
+{
+    // 7 bits per byte, most significant group first, HIGHBIT on all but the last.
+    uint32_t n = 1;
+    while (n<5 && (x >> (7*n)) != 0) ++n;
+    for (uint32_t k=n-1; k>0; --k)
+        cvec.push_back( (unsigned char)(((x >> (7*k)) & LOWMASK) | HIGHBIT) );
+    cvec.push_back( (unsigned char)(x & LOWMASK) );
+    return n;
+}
+
+uint32_t PixCodec::varDecode(       // return: number of input bytes
+    const unsigned char* cbuf,      // input:  array of compressed values
+    uint32_t* x)                    // output: decoded value
+{
+    const unsigned char* p = cbuf;
+    uint32_t result = 0;
+    for (; (*p)&HIGHBIT; ++p) { result <<= 7; result |= (*p)&LOWMASK; }
+    result <<= 7; result |= *p++;
+    *x = result;
+    return (uint32_t)(p-cbuf);
+}
+
 void PixCodec::varUncompress(
     vector<uint32_t>& uvec,         // output: vector of uncompressed values
     unsigned char* cbuf,            // input: array of compressed values
@@ -473,6 +501,256 @@ void PixCodec::varUncompress(
 }
 
 
+// Block codecs
+// ------------
+
+namespace {
+
+// lookup tables indexed by a group varint control byte
+struct GroupVarTables {
+    unsigned char length[256];          // total data bytes of the group
+    unsigned char shuffle[256][16];     // pshufb mask expanding the group to 4 x 32 bits
+
+    GroupVarTables() {
+        for (uint32_t c=0; c<256; ++c) {
+            uint32_t offset = 0;
+            for (uint32_t i=0; i<4; ++i) {
+                uint32_t len = ((c >> (2*i)) & 3) + 1;
+                for (uint32_t j=0; j<4; ++j)
+                    shuffle[c][4*i+j] = (unsigned char)(j<len ? offset+j : 0x80);
+                offset += len;
+            }
+            length[c] = (unsigned char)offset;
+        }
+    }
+};
+
+const GroupVarTables& groupVarTables() {
+    static const GroupVarTables tables;
+    return tables;
+}
+
+inline uint32_t byteLength(uint32_t x) {
+    return x < (1u<<8) ? 1 : x < (1u<<16) ? 2 : x < (1u<<24) ? 3 : 4;
+}
+
+inline uint32_t bitWidth(uint32_t x) {
+    uint32_t b = 0;
+    while (x) { ++b; x >>= 1; }
+    return b;
+}
+
+// var decode n values, bounded by end; returns bytes consumed
+uint32_t varDecodeTail(uint32_t* ubuf, const unsigned char* p, const unsigned char* end, uint32_t n) {
+    const unsigned char* start = p;
+    for (uint32_t i=0; i<n && p<end; ++i)
+        p += PixCodec::varDecode(p, &ubuf[i]);
+    return (uint32_t)(p-start);
+}
+
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+#define PIX_CODEC_SSSE3 1
+
+// One pshufb per group of 4 values.  The shuffle loads 16 bytes, so it is only
+// used while at least 17 input bytes remain; the scalar loop finishes the rest.
+__attribute__((target("ssse3")))
+uint32_t groupVarDecodeSSSE3(uint32_t* ubuf, const unsigned char* cbuf, uint32_t clen,
+                             uint32_t groups, uint32_t* done) {
+    typedef long long v2di __attribute__((vector_size(16)));
+    typedef char v16qi __attribute__((vector_size(16)));
+
+    const GroupVarTables& t = groupVarTables();
+    const unsigned char* p = cbuf;
+    const unsigned char* end = cbuf+clen;
+    uint32_t g = 0;
+    for (; g<groups && end-p >= 17; ++g) {
+        unsigned char c = *p++;
+        v2di data, mask;
+        __builtin_memcpy(&data, p, 16);
+        __builtin_memcpy(&mask, t.shuffle[c], 16);
+        v2di out = (v2di)__builtin_ia32_pshufb128((v16qi)data, (v16qi)mask);
+        __builtin_memcpy(ubuf + 4*g, &out, 16);
+        p += t.length[c];
+    }
+    *done = g;
+    return (uint32_t)(p-cbuf);
+}
+
+#endif
+
+}  // namespace
+
+bool PixCodec::simdAvailable() {
+#ifdef PIX_CODEC_SSSE3
+    static const bool ssse3 = __builtin_cpu_supports("ssse3");
+    return ssse3;
+#else
+    return false;
+#endif
+}
+
+uint32_t PixCodec::encodeBlock(     // return: number of output bytes
+    BlockFormat format,             // input:  block format
+    vector<unsigned char>& cvec,    // output: vector of compressed values
+    const uint32_t* ubuf,           // input:  array to compress
+    uint32_t n)                     // input:  value count
+{
+    switch (format) {
+        case kGroupVarint: return groupVarEncode(cvec, ubuf, n);
+        case kBitPack:     return bitPackEncode(cvec, ubuf, n);
+        case kVarint:      break;
+    }
+    uint32_t bytes = 0;
+    for (uint32_t i=0; i<n; ++i) bytes += varEncode(cvec, ubuf[i]);
+    return bytes;
+}
+
+uint32_t PixCodec::decodeBlock(     // return: number of input bytes
+    BlockFormat format,             // input:  block format
+    uint32_t* ubuf,                 // output: array of n values
+    const unsigned char* cbuf,      // input:  array of compressed values
+    uint32_t clen,                  // input:  input byte count
+    uint32_t n)                     // input:  value count
+{
+    switch (format) {
+        case kGroupVarint: return groupVarDecode(ubuf, cbuf, clen, n);
+        case kBitPack:     return bitPackDecode(ubuf, cbuf, clen, n);
+        case kVarint:      break;
+    }
+    return varDecodeTail(ubuf, cbuf, cbuf+clen, n);
+}
+
+uint32_t PixCodec::groupVarEncode(  // return: number of output bytes
+    vector<unsigned char>& cvec,    // output: vector of compressed values
+    const uint32_t* ubuf,           // input:  array to compress
+    uint32_t n)                     // input:  value count
+{
+    size_t start = cvec.size();
+    uint32_t groups = n/4;
+    for (uint32_t g=0; g<groups; ++g) {
+        const uint32_t* v = ubuf + 4*g;
+        size_t control = cvec.size();
+        cvec.push_back(0);
+        unsigned char c = 0;
+        for (uint32_t i=0; i<4; ++i) {
+            uint32_t len = byteLength(v[i]);
+            c |= (unsigned char)((len-1) << (2*i));
+            for (uint32_t j=0; j<len; ++j)
+                cvec.push_back((unsigned char)(v[i] >> (8*j)));
+        }
+        cvec[control] = c;
+    }
+    for (uint32_t i=4*groups; i<n; ++i)
+        varEncode(cvec, ubuf[i]);
+    return (uint32_t)(cvec.size()-start);
+}
+
+uint32_t PixCodec::groupVarDecodeScalar(  // return: number of input bytes
+    uint32_t* ubuf,                 // output: array of n values
+    const unsigned char* cbuf,      // input:  array of compressed values
+    uint32_t clen,                  // input:  input byte count
+    uint32_t n)                     // input:  value count
+{
+    const GroupVarTables& t = groupVarTables();
+    const unsigned char* p = cbuf;
+    const unsigned char* end = cbuf+clen;
+    uint32_t groups = n/4;
+    for (uint32_t g=0; g<groups; ++g) {
+        if (p>=end || end-p < 1+t.length[*p]) return (uint32_t)(p-cbuf);  // truncated
+        unsigned char c = *p++;
+        for (uint32_t i=0; i<4; ++i) {
+            uint32_t len = ((c >> (2*i)) & 3) + 1;
+            uint32_t x = 0;
+            for (uint32_t j=0; j<len; ++j)
+                x |= (uint32_t)p[j] << (8*j);
+            ubuf[4*g+i] = x;
+            p += len;
+        }
+    }
+    p += varDecodeTail(ubuf+4*groups, p, end, n-4*groups);
+    return (uint32_t)(p-cbuf);
+}
+
+uint32_t PixCodec::groupVarDecode(  // return: number of input bytes
+    uint32_t* ubuf,                 // output: array of n values
+    const unsigned char* cbuf,      // input:  array of compressed values
+    uint32_t clen,                  // input:  input byte count
+    uint32_t n)                     // input:  value count
+{
+#ifdef PIX_CODEC_SSSE3
+    if (simdAvailable()) {
+        // shuffle decode the bulk, then finish the last groups and the tail in scalar
+        uint32_t done = 0;
+        uint32_t used = groupVarDecodeSSSE3(ubuf, cbuf, clen, n/4, &done);
+        return used + groupVarDecodeScalar(ubuf+4*done, cbuf+used, clen-used, n-4*done);
+    }
+#endif
+    return groupVarDecodeScalar(ubuf, cbuf, clen, n);
+}
+
+uint32_t PixCodec::bitPackEncode(   // return: number of output bytes
+    vector<unsigned char>& cvec,    // output: vector of compressed values
+    const uint32_t* ubuf,           // input:  array to compress
+    uint32_t n)                     // input:  value count
+{
+    size_t start = cvec.size();
+    for (uint32_t f=0; f<n; f+=kBitPackFrame) {
+        const uint32_t* v = ubuf + f;
+        uint32_t m = n-f < kBitPackFrame ? n-f : kBitPackFrame;
+        uint32_t maxv = 0;
+        for (uint32_t i=0; i<m; ++i) maxv |= v[i];
+        uint32_t b = bitWidth(maxv);
+        cvec.push_back((unsigned char)b);
+
+        uint64_t acc = 0;
+        uint32_t bits = 0;
+        for (uint32_t i=0; i<m; ++i) {
+            acc |= (uint64_t)v[i] << bits;
+            bits += b;
+            while (bits >= 8) {
+                cvec.push_back((unsigned char)acc);
+                acc >>= 8;
+                bits -= 8;
+            }
+        }
+        if (bits > 0)
+            cvec.push_back((unsigned char)acc);
+    }
+    return (uint32_t)(cvec.size()-start);
+}
+
+uint32_t PixCodec::bitPackDecode(   // return: number of input bytes
+    uint32_t* ubuf,                 // output: array of n values
+    const unsigned char* cbuf,      // input:  array of compressed values
+    uint32_t clen,                  // input:  input byte count
+    uint32_t n)                     // input:  value count
+{
+    const unsigned char* p = cbuf;
+    const unsigned char* end = cbuf+clen;
+    for (uint32_t f=0; f<n; f+=kBitPackFrame) {
+        uint32_t m = n-f < kBitPackFrame ? n-f : kBitPackFrame;
+        if (p>=end) return (uint32_t)(p-cbuf);
+        uint32_t b = *p++;
+        if (b > 32 || (uint32_t)(end-p) < (m*b+7)/8) return (uint32_t)(p-1-cbuf);   // malformed
+        uint32_t* v = ubuf + f;
+        const uint64_t mask = (((uint64_t)1) << b) - 1;
+
+        uint64_t acc = 0;
+        uint32_t bits = 0;
+        for (uint32_t i=0; i<m; ++i) {
+            while (bits < b) {
+                acc |= (uint64_t)(*p++) << bits;
+                bits += 8;
+            }
+            v[i] = (uint32_t)(acc & mask);
+            acc >>= b;
+            bits -= b;
+        }
+    }
+    return (uint32_t)(p-cbuf);
+}
+
+
 // Gamma coding
 // ------------
 
@@ -721,9 +999,9 @@ void PixCodec::deltaUncompress(
     }
 }
 
-// Bernoulli codec
+// Bernoulli codec (not yet exposed through PixCodec)
 
-static uint32_t bernoulliCompress(  // return: bit count
+uint32_t bernoulliCompress(  // return: bit count
     unsigned char *cbuf,            // output: output buffer - compressed
     uint32_t  clen,                 // input: output buffer capacity
     const uint32_t* ubuf,           // input: input buffer
@@ -784,7 +1062,7 @@ static uint32_t bernoulliCompress(  // return: bit count
         if (debug)
             std::cout << "Bernoulli: compress remaining bits" << std::endl;
 
-        for (int a = 0; a < ulen; a++) {
+        for (uint32_t a = 0; a < ulen; a++) {
             x     = ubuf[a];
             delta = x - lastX;
             lastX = x;
@@ -831,7 +1109,7 @@ static uint32_t bernoulliCompress(  // return: bit count
     return bitCount;
 }
 
-static void bernoulliUnCompress(
+void bernoulliUnCompress(
     unsigned char* cbuf,            // input: input buffer, compressed
     uint32_t clen,                  // input: input buffer length
     std::vector<uint32_t>& uvec)    // output: uncompressed vector
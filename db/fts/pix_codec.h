@@ -11,6 +11,17 @@ namespace mongo {
 class PixCodec {
 
 public:
+    /*
+    *  Block formats for runs of 32-bit values (docid or position deltas)
+    */
+    enum BlockFormat {
+        kVarint = 0,                    // one varint per value
+        kGroupVarint = 1,               // 4 values per control byte, 1-4 bytes each
+        kBitPack = 2                    // 128-value frames packed at a fixed bit width
+    };
+
+    static const uint32_t kBitPackFrame = 128;
+
     /*
     *  Var compress from array to array
     */
@@ -60,6 +71,20 @@ public:
         std::vector<unsigned char>& cvec,   // output: vector of compressed values
         const std::vector<uint64_t>& uvec); // input:  vector to compress
 
+    /*
+    *  Var encode one value (up to 32 bits), appending to vector
+    */
+    static uint32_t varEncode(              // return: number of output bytes
+        std::vector<unsigned char>& cvec,   // output: vector of compressed values
+        uint32_t x);                        // input:  value to encode
+
+    /*
+    *  Var decode one value from array
+    */
+    static uint32_t varDecode(              // return: number of input bytes
+        const unsigned char* cbuf,          // input:  array of compressed values
+        uint32_t* x);                       // output: decoded value
+
     /*
     *  Var uncompress from array to vector
     */
@@ -95,6 +120,70 @@ public:
         uint32_t coffset,                        // input:  starting index in cvec
         uint32_t clen);                          // input:  input count
 
+// Block codecs
+
+    /*
+    *  Encode n values in the given block format, appending to vector
+    */
+    static uint32_t encodeBlock(        // return: number of output bytes
+        BlockFormat format,             // input:  block format
+        std::vector<unsigned char>& cvec, // output: vector of compressed values
+        const uint32_t* ubuf,           // input:  array to compress
+        uint32_t n);                    // input:  value count
+
+    /*
+    *  Decode n values in the given block format
+    */
+    static uint32_t decodeBlock(        // return: number of input bytes
+        BlockFormat format,             // input:  block format
+        uint32_t* ubuf,                 // output: array of n values
+        const unsigned char* cbuf,      // input:  array of compressed values
+        uint32_t clen,                  // input:  input byte count
+        uint32_t n);                    // input:  value count
+
+    /*
+    *  Group varint: a control byte holds the byte lengths (2 bits each) of the
+    *  next 4 values, which follow little-endian.  A tail of n%4 values is
+    *  var encoded.
+    */
+    static uint32_t groupVarEncode(     // return: number of output bytes
+        std::vector<unsigned char>& cvec, // output: vector of compressed values
+        const uint32_t* ubuf,           // input:  array to compress
+        uint32_t n);                    // input:  value count
+
+    static uint32_t groupVarDecode(     // return: number of input bytes
+        uint32_t* ubuf,                 // output: array of n values
+        const unsigned char* cbuf,      // input:  array of compressed values
+        uint32_t clen,                  // input:  input byte count
+        uint32_t n);                    // input:  value count
+
+    static uint32_t groupVarDecodeScalar( // return: number of input bytes
+        uint32_t* ubuf,                 // output: array of n values
+        const unsigned char* cbuf,      // input:  array of compressed values
+        uint32_t clen,                  // input:  input byte count
+        uint32_t n);                    // input:  value count
+
+    /*
+    *  Frame of reference bit packing: each frame of kBitPackFrame values, the
+    *  last one possibly shorter, is a bit width byte b followed by the values
+    *  packed LSB first in b bits each, padded to a whole byte.
+    */
+    static uint32_t bitPackEncode(      // return: number of output bytes
+        std::vector<unsigned char>& cvec, // output: vector of compressed values
+        const uint32_t* ubuf,           // input:  array to compress
+        uint32_t n);                    // input:  value count
+
+    static uint32_t bitPackDecode(      // return: number of input bytes
+        uint32_t* ubuf,                 // output: array of n values
+        const unsigned char* cbuf,      // input:  array of compressed values
+        uint32_t clen,                  // input:  input byte count
+        uint32_t n);                    // input:  value count
+
+    /*
+    *  True if groupVarDecode uses the SSSE3 shuffle decoder on this cpu
+    */
+    static bool simdAvailable();
+
 // Gamma
 
     /*
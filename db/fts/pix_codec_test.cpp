@@ -1,58 +1,155 @@
+/**
+ *    Copyright (C) 2016 MongoDB Inc.
+ *
+ *    This program is free software: you can redistribute it and/or  modify
+ *    it under the terms of the GNU Affero General Public License, version 3,
+ *    as published by the Free Software Foundation.
+ *
+ *    This program is distributed in the hope that it will be useful,
+ *    but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *    GNU Affero General Public License for more details.
+ *
+ *    You should have received a copy of the GNU Affero General Public License
+ *    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ *    As a special exception, the copyright holders give permission to link the
+ *    code of portions of this program with the OpenSSL library under certain
+ *    conditions as described in each individual source file and distribute
+ *    linked combinations including the program with the OpenSSL library. You
+ *    must comply with the GNU Affero General Public License in all respects for
+ *    all of the code used other than as permitted herein. If you modify file(s)
+ *    with this exception, you may extend this exception to your version of the
+ *    file(s), but you are not obligated to do so. If you do not wish to do so,
+ *    delete this exception statement from your version. If you delete this
+ *    exception statement from all source files in the program, then also delete
+ *    it in the license file.
+ */
 
-#include "pix_codec.h"
-
-#include <iostream>
-#include <stdlib.h>
-
-int main(int argc, char* argv[]) {
-
-    uint32_t ulen = 1000;
-    uint32_t clen = 10000;
-    uint32_t* ubuf = new uint32_t[ulen];
-    unsigned char* cbuf = new unsigned char[clen];
-    std::vector<uint32_t> uvecv;
-
-    std::cout << "Init" << std::endl;
-    for (uint32_t i=0; i<ulen; ++i) {
-        uint32_t base = (i>0 ? ubuf[i-1] : 0);
-        ubuf[i] = base + (rand()%100) + 1;
-        //std::cout << "ubuf[" << i << "] = " << ubuf[i] << std::endl;
-    }
-
-    std::cout << "Var compress" << std::endl;
-    uint32_t n = mongo::PixCodec::varCompress(cbuf, clen, ubuf, 0, ulen);
-    std::cout << "Var uncompress" << std::endl;
-    mongo::PixCodec::varUncompress(uvecv, cbuf, 0, n);
-    std::cout << "Var compress - check errors" << std::endl;
-    for (uint32_t j=0; j<uvecv.size(); ++j) {
-        if (uvecv[j] != ubuf[j])
-            std::cout << "varCompress error: [" << j << "] "
-                      << uvecv[j] << " != " << ubuf[j] << std::endl;
-    }
-
-    std::cout << "Gamma compress" << std::endl;
-    n = mongo::PixCodec::gammaCompress(cbuf, clen, ubuf, 0, ulen);
-    std::cout << "Gamma uncompress, n = " << n << std::endl;
-    uvecv.clear();
-    mongo::PixCodec::gammaUncompress(uvecv, cbuf, 0, n>>3);
-    std::cout << "Gamma compress - check errors" << std::endl;
-    for (uint32_t j=0; j<uvecv.size(); ++j) {
-        if (uvecv[j] != ubuf[j])
-            std::cout << "gammaCompress error: [" << j << "] "
-                      << uvecv[j] << " != " << ubuf[j] << std::endl;
-    }
-
-    std::cout << "Delta compress" << std::endl;
-    n = mongo::PixCodec::deltaCompress(cbuf, clen, ubuf, 0, ulen);
-    std::cout << "Delta uncompress, n = " << n << std::endl;
-    uvecv.clear();
-    mongo::PixCodec::deltaUncompress(uvecv, cbuf, 0, n>>3);
-    std::cout << "Delta compress - check errors" << std::endl;
-    for (uint32_t j=0; j<uvecv.size(); ++j) {
-        if (uvecv[j] != ubuf[j])
-            std::cout << "deltaCompress error: [" << j << "] "
-                      << uvecv[j] << " != " << ubuf[j] << std::endl;
+#include "mongo/db/fts/pix_codec.h"
+
+#include <vector>
+
+#include "mongo/unittest/unittest.h"
+
+namespace mongo {
+
+using std::vector;
+
+namespace {
+
+const uint32_t kValues = 1000;
+const uint32_t kBufferBytes = 10000;
+
+// Ascending values with gaps of 1 to 100, as the docids of a term.
+vector<uint32_t> ascendingValues() {
+    vector<uint32_t> values(kValues);
+    uint32_t x = 0;
+    for (uint32_t i = 0; i < kValues; ++i) {
+        x += (i * 37) % 100 + 1;
+        values[i] = x;
     }
+    return values;
+}
+
+}  // namespace
+
+TEST(PixCodec, VarRoundTrip) {
+    vector<uint32_t> values = ascendingValues();
+    vector<unsigned char> cbuf(kBufferBytes);
+
+    uint32_t n = PixCodec::varCompress(&cbuf[0], kBufferBytes, &values[0], 0, kValues);
+    vector<uint32_t> decoded;
+    PixCodec::varUncompress(decoded, &cbuf[0], 0, n);
+
+    ASSERT_EQUALS(kValues, decoded.size());
+    for (uint32_t i = 0; i < kValues; ++i) {
+        ASSERT_EQUALS(values[i], decoded[i]);
+    }
+}
+
+TEST(PixCodec, VarEncodeDecode) {
+    const uint32_t values[] = {0, 1, 127, 128, 16383, 16384, 2097151, 2097152, 0x0fffffff};
+    vector<unsigned char> cvec;
+    for (uint32_t x : values) {
+        PixCodec::varEncode(cvec, x);
+    }
+
+    const unsigned char* p = &cvec[0];
+    for (uint32_t x : values) {
+        uint32_t decoded;
+        p += PixCodec::varDecode(p, &decoded);
+        ASSERT_EQUALS(x, decoded);
+    }
+    ASSERT_EQUALS(cvec.size(), static_cast<size_t>(p - &cvec[0]));
+}
 
+TEST(PixCodec, GammaRoundTrip) {
+    vector<uint32_t> values = ascendingValues();
+    vector<unsigned char> cbuf(kBufferBytes);
+
+    uint32_t bits = PixCodec::gammaCompress(&cbuf[0], kBufferBytes, &values[0], 0, kValues);
+    vector<uint32_t> decoded;
+    PixCodec::gammaUncompress(decoded, &cbuf[0], 0, bits >> 3);
+
+    ASSERT_EQUALS(kValues, decoded.size());
+    for (uint32_t i = 0; i < kValues; ++i) {
+        ASSERT_EQUALS(values[i], decoded[i]);
+    }
+}
+
+TEST(PixCodec, DeltaRoundTrip) {
+    vector<uint32_t> values = ascendingValues();
+    vector<unsigned char> cbuf(kBufferBytes);
+
+    uint32_t bits = PixCodec::deltaCompress(&cbuf[0], kBufferBytes, &values[0], 0, kValues);
+    vector<uint32_t> decoded;
+    PixCodec::deltaUncompress(decoded, &cbuf[0], 0, bits >> 3);
+
+    ASSERT_EQUALS(kValues, decoded.size());
+    for (uint32_t i = 0; i < kValues; ++i) {
+        ASSERT_EQUALS(values[i], decoded[i]);
+    }
+}
+
+TEST(PixCodec, BlockFormatsRoundTrip) {
+    // Gaps of every byte length, in a count that leaves group and frame tails.
+    vector<uint32_t> values;
+    for (uint32_t i = 0; i < 2 * PixCodec::kBitPackFrame + 7; ++i) {
+        uint32_t width = (i * 7) % 33;
+        values.push_back(width == 0 ? 0 : (0xffffffffU >> (32 - width)) - i % 3);
+    }
+    const uint32_t n = values.size();
+
+    const PixCodec::BlockFormat formats[] = {
+        PixCodec::kVarint, PixCodec::kGroupVarint, PixCodec::kBitPack};
+    for (PixCodec::BlockFormat format : formats) {
+        vector<unsigned char> cvec;
+        uint32_t bytes = PixCodec::encodeBlock(format, cvec, &values[0], n);
+        ASSERT_EQUALS(cvec.size(), bytes);
+
+        vector<uint32_t> decoded(n);
+        ASSERT_EQUALS(bytes, PixCodec::decodeBlock(format, &decoded[0], &cvec[0], bytes, n));
+        for (uint32_t i = 0; i < n; ++i) {
+            ASSERT_EQUALS(values[i], decoded[i]);
+        }
+    }
+}
+
+TEST(PixCodec, GroupVarintDecodersAgree) {
+    vector<uint32_t> values = ascendingValues();
+    vector<unsigned char> cvec;
+    uint32_t bytes = PixCodec::groupVarEncode(cvec, &values[0], kValues);
+
+    // groupVarDecode uses the SSSE3 decoder when the cpu has it.
+    vector<uint32_t> fast(kValues);
+    vector<uint32_t> scalar(kValues);
+    ASSERT_EQUALS(bytes, PixCodec::groupVarDecode(&fast[0], &cvec[0], bytes, kValues));
+    ASSERT_EQUALS(bytes, PixCodec::groupVarDecodeScalar(&scalar[0], &cvec[0], bytes, kValues));
+    for (uint32_t i = 0; i < kValues; ++i) {
+        ASSERT_EQUALS(values[i], fast[i]);
+        ASSERT_EQUALS(values[i], scalar[i]);
+    }
 }
 
+}  // namespace mongo
@@ -1,37 +1,106 @@
+#include <assert.h>
 #include <iostream>
 #include <sstream>
 
-#include "Exception.h"
-#include "DocPosting.h"
+#include "pix_doc_posting.h"
 
 using namespace std;
 
 namespace mongo {
 
-DocPosting::~DocPosting()
-{}
-
 void DocPosting::init(
     unsigned d,
-    const vector<unsigned> posv,
+    const vector<unsigned>& posv,
     bool takeDeltas)
 {
     //store (docid,tf)
     docid = d;
     tf = posv.size();
     score = (float)tf;
+    uvec.clear();
+    uvec.reserve(tf+2);
     uvec.push_back(docid);
     uvec.push_back(tf);
 
     //store position list
     unsigned lastPos = 0;
     for (vector<unsigned>::const_iterator p1 = posv.begin(); p1!=posv.end(); p1++) {
-    	unsigned pos = *p1;
-    	if (takeDeltas) { pos -= lastPos; lastPos = *p1; }
+        unsigned pos = *p1;
+        if (takeDeltas) { pos -= lastPos; lastPos = *p1; }
         uvec.push_back(pos);
     }
 }
 
+void DocPosting::unpack(
+    const unsigned char* p,
+    const unsigned char* end,
+    unsigned lastDocid)
+{
+    uvec.clear();
+    if (p>=end) return;
+
+    unsigned x;
+    p += PixCodec::varDecode(p, &x);
+    docid = lastDocid + x;
+    if (p>=end) return;
+    p += PixCodec::varDecode(p, &tf);
+    score = (float)tf;
+
+    uvec.reserve(tf+2);
+    uvec.push_back(docid);
+    uvec.push_back(tf);
+    while (p<end) {
+        p += PixCodec::varDecode(p, &x);
+        uvec.push_back(x);
+    }
+    assert(uvec.size() == tf+2);
+}
+
+void DocPosting::unpackPositions(
+    const unsigned char* p,
+    const unsigned char* end)
+{
+    uvec.clear();
+    uvec.push_back(docid);
+    uvec.push_back(0);
+    unsigned x;
+    while (p<end) {
+        p += PixCodec::varDecode(p, &x);
+        uvec.push_back(x);
+    }
+    tf = uvec.size()-2;
+    uvec[1] = tf;
+    score = (float)tf;
+}
+
+unsigned DocPosting::pack(
+    vector<unsigned char>& cvec,
+    unsigned lastDocid) const
+{
+    assert(docid >= lastDocid);
+    unsigned n = PixCodec::varEncode(cvec, docid-lastDocid);
+    n += PixCodec::varEncode(cvec, tf);
+    for (unsigned i=2; i<uvec.size(); ++i)
+        n += PixCodec::varEncode(cvec, uvec[i]);
+    return n;
+}
+
+unsigned DocPosting::packPositions(
+    vector<unsigned char>& cvec) const
+{
+    unsigned n = 0;
+    for (unsigned i=2; i<uvec.size(); ++i)
+        n += PixCodec::varEncode(cvec, uvec[i]);
+    return n;
+}
+
+void DocPosting::getPositions(
+    vector<unsigned>& posv) const
+{
+    for (DocPostingIterator it = iterator(); !it.done(); ++it)
+        posv.push_back(*it);
+}
+
 string DocPosting::toString() const
 {
     ostringstream oss;
@@ -39,7 +108,7 @@ string DocPosting::toString() const
     oss << "tf = " << tf << endl;
     unsigned j = 0;
     for (DocPosting::DocPostingIterator it = iterator(); !it.done(); ++it) {
-    	oss << "pos[" << j++ << "] = " << (*it).first << "\n";
+        oss << "pos[" << j++ << "] = " << *it << "\n";
     }
     return oss.str();
 }
@@ -54,17 +123,17 @@ string DocPosting::compactString() const
     for (; !it.done(); ++it) {
         if (!init) oss << ", ";
         init = false;
-    	oss << (*it).first;
+        oss << *it;
     }
     return oss.str();
 }
 
 void DocPosting::append_uvec(
-    vector<unsigned>& v)
+    vector<unsigned>& v) const
 {
     vector<unsigned>::const_iterator it = uvec.begin();
     for (; it!=uvec.end(); ++it) {
-    	v.push_back(*it);
+        v.push_back(*it);
     }
 }
 
@@ -74,38 +143,32 @@ void DocPosting::merge(
     const DocPosting& b,
     DocPosting& result)
 {
-    if (a.getDocid()!=b.getDocid()) {
-    	throw Exception("DOCPOSTING", "merge: unequal docid lists");
-    }
+    assert(a.getDocid()==b.getDocid());
     vector<unsigned> posv;
+    posv.reserve(a.getTF()+b.getTF());
 
     DocPostingIterator aIt = a.iterator();
     DocPostingIterator bIt = b.iterator();
 
     while (!aIt.done() && !bIt.done()) {
-    	unsigned aa = *aIt;
-    	unsigned bb = *bIt;
-
-    	//cout << "aa = " << aa << endl;
-    	//cout << "bb = " << bb << endl;
-
-    	if (aa.first <= bb.first) {
-    		posv.push_back(aa);
-    		++aIt;
-    	} else {
-    		posv.push_back(bb);
-    		++bIt;
-    	}
+        unsigned aa = *aIt;
+        unsigned bb = *bIt;
+
+        if (aa <= bb) {
+            posv.push_back(aa);
+            ++aIt;
+        } else {
+            posv.push_back(bb);
+            ++bIt;
+        }
     }
     while (!aIt.done()) {
-    	unsigned aa = *aIt;
-    	posv.push_back(aa);
-    	++aIt;
+        posv.push_back(*aIt);
+        ++aIt;
     }
     while (!bIt.done()) {
-    	unsigned bb = *bIt;
-    	posv.push_back(bb);
-    	++bIt;
+        posv.push_back(*bIt);
+        ++bIt;
     }
     result.init(a.getDocid(), posv, true);
 }
@@ -113,8 +176,8 @@ void DocPosting::merge(
 
 // merge with proximity
 #define INITIAL_STEP    0
-#define A_STEP     			1
-#define B_STEP    			2
+#define A_STEP          1
+#define B_STEP          2
 
 void DocPosting::proximity_merge(
     const DocPosting& a,
@@ -122,61 +185,33 @@ void DocPosting::proximity_merge(
     DocPosting& result,
     unsigned& sepresult)
 {
-    if (a.getDocid()!=b.getDocid()) {
-    	throw Exception("DOCPOSTING", "merge: unequal docid lists");
-    }
+    assert(a.getDocid()==b.getDocid());
 
     vector<unsigned> posv;
+    posv.reserve(a.getTF()+b.getTF());
 
     DocPostingIterator aIt = a.iterator();
     DocPostingIterator bIt = b.iterator();
 
-    unsigned aa = *aIt;
-    unsigned bb = *bIt;
-
+    unsigned last = 0;
     int lastStep = INITIAL_STEP;
-    int sep = (1<<31);// minimum (a,b) term separation
+    unsigned sep = ~0u;     // minimum (a,b) term separation
 
-    while (!aIt.done() && !bIt.done()) {
-    	if (aa.first <= bb.first) {
-    		if (lastStep==B_STEP) {
-    			int n = (bb - aa);
-    			if (n < sep) sep = n;
-    		}
-    		lastStep = A_STEP;
-    		posv.push_back(aa);
-    		++aIt;
-    	} else {
-    		if (lastStep==A_STEP) {
-    			int n = (aa - bb);
-    			if (n < sep) sep = n;
-    		}
-    		lastStep = B_STEP;
-    		posv.push_back(bb.first);
-    		++bIt;
-    	}
-    }
-    if (!aIt.done() && lastStep==B_STEP) {
-    	int n = (bb - aa);
-    	if (n < sep) sep = n;
-    }
-    while (!aIt.done()) {
-    	aa = *aIt;
-    	posv.push_back(aa);
-    	++aIt;
-    }
-    if (!bIt.done() && lastStep==A_STEP) {
-    	int n = (aa - bb);
-    	if (n < sep) sep = n;
-    }
-    while (!bIt.done()) {
-    	bb = *bIt;
-    	posv.push_back(bb);
-    	++bIt;
+    while (!aIt.done() || !bIt.done()) {
+        bool takeA = bIt.done() || (!aIt.done() && *aIt <= *bIt);
+        unsigned pos = takeA ? *aIt : *bIt;
+        int step = takeA ? A_STEP : B_STEP;
+
+        if (lastStep!=INITIAL_STEP && lastStep!=step && pos-last < sep)
+            sep = pos-last;
+        lastStep = step;
+        last = pos;
+
+        posv.push_back(pos);
+        if (takeA) ++aIt; else ++bIt;
     }
     result.init(a.getDocid(), posv, true);
     sepresult = sep;
 }
 
 }    /* namespace mongo */
-
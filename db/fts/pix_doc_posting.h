@@ -1,13 +1,11 @@
+
 #ifndef __DOCPOSTING_H_
 #define __DOCPOSTING_H_
 
-#include <iostream>
+#include <string>
 #include <vector>
-#include <utility>
 
-#include "RC.h"
-#include "Coder.h"
-#include "Logger.h"
+#include "pix_codec.h"
 
 namespace mongo {
 
@@ -18,9 +16,9 @@ namespace mongo {
 |                                                                      |
 |  DocPosting index format:                                            |
 |                                                                      |
-|     docid           -- document id                                   |
+|     docid           -- document id (delta from previous posting)     |
 |     length          -- pos list length = term frequency = tf         |
-|     pos             -- term position in doc                          |
+|     pos             -- term position in doc (delta from prev pos)    |
 |     ...                                                              |
 |     pos                                                              |
 |                                                                      |
@@ -34,49 +32,49 @@ protected:    // state
     unsigned docid;
     unsigned tf;                 // term frequency (= posv.size())
     float score;                 // aggregate score
-    std::vector<unsigned> uvec;  // uncompressed index list
+    std::vector<unsigned> uvec;  // uncompressed index list: docid, tf, pos deltas
 
 public:
     // Create from compressed index list window
-    DocPosting(
-        const std::vector<unsigned char>& ifv,// compressed index list
-        unsigned offset,         // starting offset
-        unsigned length);        // byte length
-
     DocPosting(
         const std::vector<unsigned char>& ifv,// compressed index list
         unsigned offset,         // starting offset
         unsigned length,         // byte length
-        Logger& logger);
+        unsigned lastDocid = 0); // docid of the previous DocPosting
 
     // Create from compressed index list window
     DocPosting(
-        unsigned char* ifv,      // compressed index list
+        const unsigned char* ifv,// compressed index list
         unsigned offset,         // starting offset
-        unsigned length);        // byte length
+        unsigned length,         // byte length
+        unsigned lastDocid = 0); // docid of the previous DocPosting
 
     // Create from uncompressed inputs
     DocPosting(
-        unsigned docid,                    // new document id
-        const std::vector<unsigned> posv); // position list
+        unsigned docid,                     // new document id
+        const std::vector<unsigned>& posv); // ascending position list
+
+    // Create from a docid and compressed position deltas
+    DocPosting(
+        unsigned docid,          // document id
+        const unsigned char* p,  // position deltas
+        unsigned length);        // byte length
 
     DocPosting(
         unsigned docid,          // new document id
-        unsigned pos);           // position list
+        unsigned pos);           // single position
 
     // Create empty DocPosting
-    DocPosting(unsigned d) : docid(d) {}
+    DocPosting(unsigned d) : docid(d), tf(0), score(0.0f) {}
+
+    DocPosting() : docid(0), tf(0), score(0.0f) {}
 
     // common initialization
     void init(
         unsigned docid,                    // new document id
-        const std::vector<unsigned> posv,  // position list
+        const std::vector<unsigned>& posv, // position list
         bool takeDeltas);                  // store (posv[i] - posv[i-1])
 
-    DocPosting() {}
-
-    ~DocPosting();
-
     // getters & setters
     unsigned getTF() const    { return tf;    }
     float getScore() const    { return score; }
@@ -84,9 +82,11 @@ public:
     void setTF(unsigned t)    { tf    = t; }
     void setScore(float s)    { score = s; }
     void setDocid(unsigned d) { docid = d; }
-    unsigned getPos(unsigned n) const { return tf>0 ? uvec[2+n] : 0; }
     unsigned size() const     { return uvec.size(); }
 
+    // absolute positions, in ascending order
+    void getPositions(std::vector<unsigned>& posv) const;
+
     // basic merge
     static void merge(
         const DocPosting&,
@@ -101,21 +101,21 @@ public:
         unsigned& sepresult);
 
     // iterator interface
-    class DocPostingIterator : public RCObject {
+    class DocPostingIterator {
 
     public:
         DocPostingIterator(const DocPosting&);
         ~DocPostingIterator() {}
-    
-    public: 
+
+    public:
         bool done() const;
         void operator++();
-        unsigned operator*();
-    
+        unsigned operator*() const;
+
     protected:
         std::vector<unsigned>::const_iterator posIt;    // pos list iterator
         std::vector<unsigned>::const_iterator end;
-        unsigned pos,lastPos;
+        unsigned pos;
     };
 
     DocPostingIterator iterator() const;
@@ -123,75 +123,82 @@ public:
     std::string compactString() const;
 
     // append the uvec representation to a given vector
-    void append_uvec(std::vector<unsigned>& v);
-
+    void append_uvec(std::vector<unsigned>& v) const;
+
+    // append the compressed representation, docid coded relative to lastDocid
+    unsigned pack(
+        std::vector<unsigned char>& cvec,
+        unsigned lastDocid) const;
+
+    // append the compressed position deltas only
+    unsigned packPositions(
+        std::vector<unsigned char>& cvec) const;
+
+protected:
+    // decode (docid delta, tf, pos...) from [p, end)
+    void unpack(
+        const unsigned char* p,
+        const unsigned char* end,
+        unsigned lastDocid);
+
+    // decode position deltas from [p, end)
+    void unpackPositions(
+        const unsigned char* p,
+        const unsigned char* end);
 };
 
 inline DocPosting::DocPosting(
     const std::vector<unsigned char>& ifv,  // raw index list
     unsigned offset,                        // the start offset
-    unsigned length)                        // the compressed length
+    unsigned length,                        // the compressed length
+    unsigned lastDocid)                     // previous docid in the list
 :
     docid(0),
-    tf(1),
-    score(1.0f),
+    tf(0),
+    score(0.0f),
     uvec()
 {
-    Coder::varUncompress(uvec, ifv, offset, length);
-    if (uvec.size()>=2) {
-        docid = uvec[0];
-        tf    = uvec[1];
-        score = (float)tf;
-    }
+    if (offset+length <= ifv.size() && length > 0)
+        unpack(&ifv[offset], &ifv[offset]+length, lastDocid);
 }
 
 inline DocPosting::DocPosting(
-    const std::vector<unsigned char>& ifv,  // raw index list
+    const unsigned char* ifv,               // raw index list
     unsigned offset,                        // the start offset
     unsigned length,                        // the compressed length
-    Logger& logger)
+    unsigned lastDocid)                     // previous docid in the list
 :
     docid(0),
-    tf(1),
-    score(1.0f),
+    tf(0),
+    score(0.0f),
     uvec()
 {
-    Coder::varUncompress(uvec, ifv, offset, length, logger);
-    if (uvec.size()>=2) {
-        docid = uvec[0];
-        tf    = uvec[1];
-        score = (float)tf;
-    }
+    unpack(ifv+offset, ifv+offset+length, lastDocid);
 }
 
 inline DocPosting::DocPosting(
-    unsigned char* ifv,                     // raw index list
-    unsigned offset,                        // the start offset
-    unsigned length)                        // the compressed length
+    unsigned _docid,
+    const std::vector<unsigned>& posv)
 :
-    docid(0),
-    tf(1),
-    score(1.0f),
+    docid(_docid),
+    tf(0),
+    score(0.0f),
     uvec()
 {
-    Coder::varUncompress(uvec, ifv, offset, length);
-    if (uvec.size()>=2) {
-        docid = uvec[0];
-        tf    = uvec[1];
-        score = (float)tf;
-    }
+    init(_docid, posv, true);
 }
 
 inline DocPosting::DocPosting(
     unsigned _docid,
-    const std::vector<unsigned> posv)
-: 
+    const unsigned char* p,
+    unsigned length)
+:
     docid(_docid),
-    tf(1),
-    score (1.0f),
+    tf(0),
+    score(0.0f),
     uvec()
 {
-    init(docid, posv, false);
+    unpackPositions(p, p+length);
 }
 
 inline DocPosting::DocPosting(
@@ -203,9 +210,9 @@ inline DocPosting::DocPosting(
     score(1.0f),
     uvec()
 {
-  uvec.push_back(docid);
-  uvec.push_back(tf);
-  uvec.push_back(_pos);
+    uvec.push_back(docid);
+    uvec.push_back(tf);
+    uvec.push_back(_pos);
 }
 
 inline DocPosting::DocPostingIterator DocPosting::iterator() const
@@ -219,13 +226,15 @@ inline DocPosting::DocPostingIterator DocPosting::iterator() const
 inline DocPosting::DocPostingIterator::DocPostingIterator(
     const DocPosting& dp)
 :
-    lastPos(0)
+    pos(0)
 {
-    std::vector<unsigned>::const_iterator p = dp.uvec.begin();
-    posIt = p + 2;          // skip tf
-    end = posIt + dp.tf;
-    pos = *posIt;
-    lastPos = pos;
+    if (dp.uvec.size() < 2) {
+        posIt = end = dp.uvec.end();
+        return;
+    }
+    posIt = dp.uvec.begin() + 2;    // skip docid, tf
+    end = dp.uvec.end();
+    if (posIt != end) pos = *posIt;
 }
 
 inline bool DocPosting::DocPostingIterator::done() const
@@ -236,15 +245,13 @@ inline bool DocPosting::DocPostingIterator::done() const
 inline void DocPosting::DocPostingIterator::operator++()
 {
     ++posIt;
-    pos = *posIt + lastPos;    // expand difference coding
-    lastPos = pos;
+    if (posIt != end) pos += *posIt;    // expand difference coding
 }
 
-inline unsigned DocPosting::DocPostingIterator::operator*()
+inline unsigned DocPosting::DocPostingIterator::operator*() const
 {
-  return pos;
+    return pos;
 }
 
 }  /* namespace mongo */
-#endif 
-
+#endif
@@ -0,0 +1,407 @@
+
+//@file pix_posting_cursor.cpp
+
+#include "pix_posting_cursor.h"
+
+#include <algorithm>
+#include <functional>
+#include <limits.h>
+#include <queue>
+
+using namespace std;
+namespace mongo {
+
+PostingCursor::PostingCursor(
+    const unsigned char* data,
+    unsigned len)
+:
+    _block(0),
+    _blockEnd(NULL),
+    _frame(NULL),
+    _ordinal(0),
+    _docid(0),
+    _tf(0),
+    _posStart(NULL),
+    _posEnd(NULL),
+    _decoded(0),
+    _done(false),
+    _deleted(NULL),
+    _deletedEnd(NULL),
+    _columns(false),
+    _count(0),
+    _posBase(NULL)
+{
+    addBlocks(Block(data, len));
+    loadBlock(0);
+}
+
+
+PostingCursor::PostingCursor(
+    const vector<Block>& blocks)
+:
+    _block(0),
+    _blockEnd(NULL),
+    _frame(NULL),
+    _ordinal(0),
+    _docid(0),
+    _tf(0),
+    _posStart(NULL),
+    _posEnd(NULL),
+    _decoded(0),
+    _done(false),
+    _deleted(NULL),
+    _deletedEnd(NULL),
+    _columns(false),
+    _count(0),
+    _posBase(NULL)
+{
+    for (unsigned i = 0; i < blocks.size(); ++i)
+        addBlocks(blocks[i]);
+    loadBlock(0);
+}
+
+
+void PostingCursor::addBlocks(
+    const Block& b)
+{
+    // a malformed list contributes the blocks before the damage
+    PostingList::readBlockHeaders(b.data, b.len, _headers);
+}
+
+
+void PostingCursor::loadBlock(
+    unsigned i)
+{
+    for (; i < _headers.size(); ++i) {
+        _block = i;
+        _frame = _headers[i].data;
+        _blockEnd = _headers[i].data + _headers[i].length;
+        _ordinal = 0;
+        _columns = _headers[i].format != PixCodec::kVarint;
+        if (_columns) {
+            _posBase = PostingList::readColumns(
+                _headers[i], _colDocids, _colTfs, _colPosEnds, &_count);
+            if (!_posBase) continue;
+            readColumn();
+            return;
+        }
+        if (readFrame(_headers[i].firstDocid, false)) return;   // docids are deltas from firstDocid
+    }
+    _done = true;
+}
+
+
+void PostingCursor::readColumn()
+{
+    _docid = _colDocids[_ordinal];
+    _tf = _colTfs[_ordinal];
+    _posStart = _posBase + (_ordinal ? _colPosEnds[_ordinal-1] : 0);
+    _posEnd = _posBase + _colPosEnds[_ordinal];
+    ++_decoded;
+}
+
+
+bool PostingCursor::readFrame(
+    unsigned base,
+    bool knownDocid)
+{
+    const unsigned char* p = _frame;
+    if (p+4 > _blockEnd || p[0]!=0) return false;     // sanity check
+
+    unsigned length = PostingList::frameWord(p);
+    unsigned levels = PostingList::skipLevels(_ordinal);
+
+    // skip the offsets and the skip docids
+    p += 4 + 4*levels;
+    unsigned x;
+    for (unsigned j = 0; j < levels; ++j) {
+        if (p >= _blockEnd) return false;
+        p += PixCodec::varDecode(p, &x);
+    }
+    if (length == 0 || p > _blockEnd || length > (unsigned)(_blockEnd-p)) return false;
+    _posEnd = p+length;
+
+    // DocPosting: docid delta, tf, positions
+    p += PixCodec::varDecode(p, &x);
+    _docid = knownDocid ? base : base+x;
+    p += PixCodec::varDecode(p, &_tf);
+    _posStart = p;
+
+    ++_decoded;
+    return true;
+}
+
+
+void PostingCursor::next()
+{
+    step();
+    skipDeleted();
+}
+
+
+void PostingCursor::nextBlock()
+{
+    if (_done) return;
+    loadBlock(_block+1);
+    skipDeleted();
+}
+
+
+void PostingCursor::step()
+{
+    if (_done) return;
+    if (_columns) {
+        if (++_ordinal < _count) readColumn(); else loadBlock(_block+1);
+        return;
+    }
+    unsigned lastDocid = _docid;
+    _frame = _posEnd;
+    ++_ordinal;
+    if (!readFrame(lastDocid, false))
+        loadBlock(_block+1);
+}
+
+
+void PostingCursor::setDeleted(
+    const unsigned* begin,
+    const unsigned* end)
+{
+    _deleted = begin;
+    _deletedEnd = end;
+    skipDeleted();
+}
+
+
+void PostingCursor::skipDeleted()
+{
+    while (!_done && _deleted != _deletedEnd) {
+        while (_deleted != _deletedEnd && *_deleted < _docid) ++_deleted;
+        if (_deleted == _deletedEnd || *_deleted != _docid) return;
+        step();
+    }
+}
+
+
+bool PostingCursor::skipForward(
+    unsigned target)
+{
+    for (unsigned j = PostingList::skipLevels(_ordinal); j > 0; --j) {
+        unsigned offset = PostingList::frameWord(_frame + 4*j);
+        if (offset == 0 || offset >= (unsigned)(_blockEnd-_frame)) continue;
+
+        // docid_j of the target frame is its distance from the current docid
+        const unsigned char* t = _frame + offset;
+        unsigned tOrdinal = _ordinal + PostingList::kSkipStride[j];
+        const unsigned char* p = t + 4 + 4*PostingList::skipLevels(tOrdinal);
+        unsigned delta = 0;
+        for (unsigned k = 1; k <= j; ++k)
+            p += PixCodec::varDecode(p, &delta);
+
+        unsigned tDocid = _docid + delta;
+        if (tDocid > target) continue;
+
+        _frame = t;
+        _ordinal = tOrdinal;
+        return readFrame(tDocid, true);
+    }
+    return false;
+}
+
+
+void PostingCursor::skipColumns(
+    unsigned target)
+{
+    unsigned* end = _colDocids + _count;
+    unsigned* it = std::lower_bound(_colDocids + _ordinal, end, target);
+    if (it == end) { loadBlock(_block+1); return; }
+    _ordinal = it - _colDocids;
+    readColumn();
+}
+
+
+void PostingCursor::skipTo(
+    unsigned target)
+{
+    if (_done || _docid >= target) return;
+
+    // jump to the first block that ends at or after target
+    unsigned lo = _block;
+    unsigned hi = _headers.size();
+    while (lo < hi) {
+        unsigned mid = lo + (hi-lo)/2;
+        if (_headers[mid].lastDocid < target) lo = mid+1; else hi = mid;
+    }
+    if (lo == _headers.size()) { _done = true; return; }
+    if (lo > _block) loadBlock(lo);
+
+    // then follow skip offsets, stepping where there are none
+    while (!_done && _docid < target) {
+        if (_columns) skipColumns(target);
+        else if (!skipForward(target)) step();
+    }
+    skipDeleted();
+}
+
+
+// intersect two cursors with weights
+void PostingCursor::_and2(
+    PostingCursor& c1,
+    PostingCursor& c2,
+    float w1,
+    float w2,
+    ScoredDocidList& result)
+{
+    while (!c1.done() && !c2.done()) {
+        if (c1.docid() < c2.docid()) {
+            c1.skipTo(c2.docid());
+        }
+        else if (c1.docid() > c2.docid()) {
+            c2.skipTo(c1.docid());
+        }
+        else {
+            ScoredDocid sd = { c1.docid(), w1*c1.score() + w2*c2.score() };
+            result.push_back(sd);
+            c1.next();
+            c2.next();
+        }
+    }
+}
+
+
+// union two cursors
+void PostingCursor::_or(
+    PostingCursor& c1,
+    PostingCursor& c2,
+    ScoredDocidList& result)
+{
+    _accrue2(c1, c2, 1.0f, 1.0f, result);
+}
+
+
+// accrue two cursors with weights
+void PostingCursor::_accrue2(
+    PostingCursor& c1,
+    PostingCursor& c2,
+    float w1,
+    float w2,
+    ScoredDocidList& result)
+{
+    while (!c1.done() || !c2.done()) {
+        if (c2.done() || (!c1.done() && c1.docid() < c2.docid())) {
+            ScoredDocid sd = { c1.docid(), w1*c1.score() };
+            result.push_back(sd);
+            c1.next();
+        }
+        else if (c1.done() || c2.docid() < c1.docid()) {
+            ScoredDocid sd = { c2.docid(), w2*c2.score() };
+            result.push_back(sd);
+            c2.next();
+        }
+        else {
+            ScoredDocid sd = { c1.docid(), w1*c1.score() + w2*c2.score() };
+            result.push_back(sd);
+            c1.next();
+            c2.next();
+        }
+    }
+}
+
+
+// accrue any number of cursors with weights
+void PostingCursor::_accrue(
+    const vector<PostingCursor*>& cv,
+    const vector<float>& wv,
+    ScoredDocidList& result)
+{
+    while (true) {
+        // smallest docid among the live cursors
+        unsigned docid = UINT_MAX;
+        bool live = false;
+        for (unsigned i = 0; i < cv.size(); ++i) {
+            if (cv[i]->done()) continue;
+            if (!live || cv[i]->docid() < docid) docid = cv[i]->docid();
+            live = true;
+        }
+        if (!live) break;
+
+        ScoredDocid sd = { docid, 0.0f };
+        for (unsigned i = 0; i < cv.size(); ++i) {
+            if (cv[i]->done() || cv[i]->docid() != docid) continue;
+            sd.score += wv[i]*cv[i]->score();
+            cv[i]->next();
+        }
+        result.push_back(sd);
+    }
+}
+
+
+void PostingCursor::_accrueTopK(
+    const vector<PostingCursor*>& cv,
+    const vector<float>& wv,
+    size_t k,
+    ScoredDocidList& result)
+{
+    if (k == 0) {
+        _accrue(cv, wv, result);
+        return;
+    }
+
+    // the k best (score, docid) so far, lowest on top
+    typedef pair<float, unsigned> Scored;
+    priority_queue<Scored, vector<Scored>, greater<Scored> > best;
+
+    while (true) {
+        // smallest docid among the live cursors, and the end of the
+        // range in which every live cursor stays in its current block
+        unsigned docid = UINT_MAX;
+        unsigned end = UINT_MAX;
+        bool live = false;
+        for (unsigned i = 0; i < cv.size(); ++i) {
+            if (cv[i]->done()) continue;
+            if (!live || cv[i]->docid() < docid) docid = cv[i]->docid();
+            end = min(end, cv[i]->blockLastDocid());
+            live = true;
+        }
+        if (!live) break;
+
+        // once k docids are kept, no docid in [docid, end] can score more
+        // than the block maxTf of the cursors positioned in that range
+        if (best.size() == k && end < UINT_MAX) {
+            float bound = 0.0f;
+            for (unsigned i = 0; i < cv.size(); ++i) {
+                if (!cv[i]->done() && cv[i]->docid() <= end)
+                    bound += wv[i]*cv[i]->blockMaxTf();
+            }
+            if (bound <= best.top().first) {
+                for (unsigned i = 0; i < cv.size(); ++i) {
+                    if (!cv[i]->done() && cv[i]->docid() <= end)
+                        cv[i]->skipTo(end+1);
+                }
+                continue;
+            }
+        }
+
+        ScoredDocid sd = { docid, 0.0f };
+        for (unsigned i = 0; i < cv.size(); ++i) {
+            if (cv[i]->done() || cv[i]->docid() != docid) continue;
+            sd.score += wv[i]*cv[i]->score();
+            cv[i]->next();
+        }
+        if (best.size() < k) {
+            best.push(Scored(sd.score, sd.docid));
+        } else if (sd.score > best.top().first) {
+            best.pop();
+            best.push(Scored(sd.score, sd.docid));
+        }
+    }
+
+    size_t first = result.size();
+    for (; !best.empty(); best.pop()) {
+        ScoredDocid sd = { best.top().second, best.top().first };
+        result.push_back(sd);
+    }
+    sort(result.begin()+first, result.end(),
+         [](const ScoredDocid& a, const ScoredDocid& b) { return a.docid < b.docid; });
+}
+
+}   // namespace mongo
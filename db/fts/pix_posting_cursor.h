@@ -0,0 +1,209 @@
+
+
+#ifndef __POSTING_CURSOR_H_
+#define __POSTING_CURSOR_H_
+
+#include <vector>
+
+#include "pix_codec.h"
+#include "pix_posting_list.h"
+
+
+namespace mongo {
+
+/*________________________________________________________________
+|                                                                 |
+|  Streaming cursor over compressed PostingList blocks            |
+|                                                                 |
+|  Decodes the docid and tf of one DocPosting at a time, as       |
+|  written by PostingList::pack.  Positions are decoded on        |
+|  demand straight from the compressed bytes.  skipTo() binary    |
+|  searches the block headers, then follows the skip list         |
+|  offsets within the block.  A block coded in columns is         |
+|  decoded whole when the cursor enters it, and skipTo() binary   |
+|  searches its docids instead.  blockMaxTf() and nextBlock()     |
+|  let a top-k caller pass over blocks that cannot score high     |
+|  enough.  Nothing is allocated while iterating; the packed      |
+|  lists are not owned and must outlive the cursor.               |
+|  setDeleted() hides a sorted set of docids, the tombstones of   |
+|  a pix index, from every method.                                |
+|_________________________________________________________________*/
+
+struct ScoredDocid {
+    unsigned docid;
+    float score;
+};
+
+typedef std::vector<ScoredDocid> ScoredDocidList;
+
+class PostingCursor
+{
+public:    // types
+    // one packed PostingList, of one or more blocks
+    struct Block {
+        Block(const unsigned char* d, unsigned l) : data(d), len(l) {}
+        const unsigned char* data;
+        unsigned len;
+    };
+
+    // positions of the current DocPosting, ascending
+    class PositionIterator {
+    public:
+        PositionIterator(const unsigned char* p, const unsigned char* end);
+
+        bool done() const { return _done; }
+        void operator++();
+        unsigned operator*() const { return _pos; }
+
+    private:
+        const unsigned char* _p;
+        const unsigned char* _end;
+        unsigned _pos;
+        bool _done;
+    };
+
+public:
+    // cursor over a single packed block
+    PostingCursor(
+        const unsigned char* data,
+        unsigned len);
+
+    // cursor over consecutive packed blocks of one term, in docid order
+    PostingCursor(
+        const std::vector<Block>& blocks);
+
+    bool done() const         { return _done; }
+    unsigned docid() const    { return _docid; }
+    unsigned tf() const       { return _tf; }
+    float score() const       { return (float)_tf; }
+
+    // number of DocPosting headers decoded so far
+    unsigned decoded() const  { return _decoded; }
+
+    // highest tf and last docid of the block of the current DocPosting
+    unsigned blockMaxTf() const     { return _headers[_block].maxTf; }
+    unsigned blockLastDocid() const { return _headers[_block].lastDocid; }
+
+    // positions of the current DocPosting
+    PositionIterator positions() const { return PositionIterator(_posStart, _posEnd); }
+
+    // advance to the next DocPosting
+    void next();
+
+    // advance to the first DocPosting with docid >= target
+    void skipTo(unsigned target);
+
+    // advance to the first DocPosting of the next block
+    void nextBlock();
+
+    // skip the ascending docids in [begin, end); not owned, must outlive the cursor
+    void setDeleted(const unsigned* begin, const unsigned* end);
+
+
+    // intersect two cursors with weights
+    static void _and2(
+        PostingCursor&,
+        PostingCursor&,
+        float w1,
+        float w2,
+        ScoredDocidList& result);
+
+    // union two cursors
+    static void _or(
+        PostingCursor&,
+        PostingCursor&,
+        ScoredDocidList& result);
+
+    // accrue two cursors with weights
+    static void _accrue2(
+        PostingCursor&,
+        PostingCursor&,
+        float w1,
+        float w2,
+        ScoredDocidList& result);
+
+    // accrue any number of cursors with weights
+    static void _accrue(
+        const std::vector<PostingCursor*>&,
+        const std::vector<float>& wv,
+        ScoredDocidList& result);
+
+    // accrue only the k best scoring docids, in docid order, passing
+    // over docid ranges whose block maxTf bound cannot reach them
+    static void _accrueTopK(
+        const std::vector<PostingCursor*>&,
+        const std::vector<float>& wv,
+        size_t k,
+        ScoredDocidList& result);
+
+private:
+    // append the block headers of a packed list
+    void addBlocks(const Block& b);
+
+    // position on the first DocPosting of block i or a later non-empty block
+    void loadBlock(unsigned i);
+
+    // decode the frame at _frame; knownDocid overrides the docid_0 delta
+    bool readFrame(unsigned lastDocid, bool knownDocid);
+
+    // take the DocPosting at _ordinal of the current block of columns
+    void readColumn();
+
+    // follow the highest skip offset of the current frame that stays <= target
+    bool skipForward(unsigned target);
+
+    // advance within the current block of columns, or past it, towards target
+    void skipColumns(unsigned target);
+
+    // advance to the next DocPosting, deleted or not
+    void step();
+
+    // advance past deleted DocPostings
+    void skipDeleted();
+
+    std::vector<PostingList::BlockHeader> _headers;   // every block, in docid order
+    unsigned _block;                    // current block
+    const unsigned char* _blockEnd;
+    const unsigned char* _frame;        // current frame
+    unsigned _ordinal;                  // ordinal of the current frame in its block
+    unsigned _docid;
+    unsigned _tf;
+    const unsigned char* _posStart;     // position deltas of the current DocPosting
+    const unsigned char* _posEnd;
+    unsigned _decoded;
+    bool _done;
+    const unsigned* _deleted;           // next deleted docid that may still be ahead
+    const unsigned* _deletedEnd;
+
+    // the current block when it is coded in columns (see PostingList::readColumns)
+    bool _columns;
+    unsigned _count;
+    const unsigned char* _posBase;
+    unsigned _colDocids[PostingList::kBlockPostings];
+    unsigned _colTfs[PostingList::kBlockPostings];
+    unsigned _colPosEnds[PostingList::kBlockPostings];
+};
+
+inline PostingCursor::PositionIterator::PositionIterator(
+    const unsigned char* p,
+    const unsigned char* end)
+:
+    _p(p),
+    _end(end),
+    _pos(0),
+    _done(false)
+{
+    ++(*this);
+}
+
+inline void PostingCursor::PositionIterator::operator++()
+{
+    if (_p >= _end) { _done = true; return; }
+    unsigned delta;
+    _p += PixCodec::varDecode(_p, &delta);
+    _pos += delta;                      // expand difference coding
+}
+
+}    /* namespace mongo */
+
+#endif
@@ -0,0 +1,308 @@
+/**
+ *    Copyright (C) 2016 MongoDB Inc.
+ *
+ *    This program is free software: you can redistribute it and/or  modify
+ *    it under the terms of the GNU Affero General Public License, version 3,
+ *    as published by the Free Software Foundation.
+ *
+ *    This program is distributed in the hope that it will be useful,
+ *    but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *    GNU Affero General Public License for more details.
+ *
+ *    You should have received a copy of the GNU Affero General Public License
+ *    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ *    As a special exception, the copyright holders give permission to link the
+ *    code of portions of this program with the OpenSSL library under certain
+ *    conditions as described in each individual source file and distribute
+ *    linked combinations including the program with the OpenSSL library. You
+ *    must comply with the GNU Affero General Public License in all respects for
+ *    all of the code used other than as permitted herein. If you modify file(s)
+ *    with this exception, you may extend this exception to your version of the
+ *    file(s), but you are not obligated to do so. If you do not wish to do so,
+ *    delete this exception statement from your version. If you delete this
+ *    exception statement from all source files in the program, then also delete
+ *    it in the license file.
+ */
+
+#include "mongo/db/fts/pix_posting_cursor.h"
+
+#include <algorithm>
+#include <set>
+#include <vector>
+
+#include "mongo/db/fts/pix_posting_list.h"
+#include "mongo/unittest/unittest.h"
+
+namespace mongo {
+
+using std::vector;
+
+namespace {
+
+// Packs docids first, first+stride, ... with tf = 1 + docid % 3 and positions 10, 20, ...
+vector<unsigned char> packList(unsigned first,
+                               unsigned stride,
+                               unsigned count,
+                               PixCodec::BlockFormat format = PixCodec::kVarint) {
+    PostingList pList("t");
+    for (unsigned i = 0; i < count; ++i) {
+        unsigned docid = first + i * stride;
+        vector<unsigned> posv;
+        for (unsigned p = 1; p <= 1 + docid % 3; ++p)
+            posv.push_back(p * 10);
+        pList.append(DocPosting(docid, posv));
+    }
+    vector<unsigned char> block;
+    pList.pack(block, format);
+    return block;
+}
+
+}  // namespace
+
+TEST(PixPostingCursor, IteratesLikeDecodedList) {
+    vector<unsigned char> block = packList(5, 7, 600);
+    PostingList decoded("t", &block[0], block.size());
+
+    PostingCursor cursor(&block[0], block.size());
+    for (PostingList::PostingListIterator it = decoded.begin(); it != decoded.end(); ++it) {
+        ASSERT_FALSE(cursor.done());
+        ASSERT_EQUALS(it->getDocid(), cursor.docid());
+        ASSERT_EQUALS(it->getTF(), cursor.tf());
+
+        DocPosting::DocPostingIterator pos = it->iterator();
+        PostingCursor::PositionIterator cpos = cursor.positions();
+        for (; !pos.done(); ++pos, ++cpos) {
+            ASSERT_FALSE(cpos.done());
+            ASSERT_EQUALS(*pos, *cpos);
+        }
+        ASSERT_TRUE(cpos.done());
+        cursor.next();
+    }
+    ASSERT_TRUE(cursor.done());
+}
+
+// skipTo lands on the first docid >= target and decodes far fewer postings than it passes.
+TEST(PixPostingCursor, SkipToUsesSkipList) {
+    vector<unsigned char> block = packList(1, 1, 5000);
+    PostingCursor cursor(&block[0], block.size());
+
+    cursor.skipTo(4321);
+    ASSERT_EQUALS(4321U, cursor.docid());
+    ASSERT_LESS_THAN(cursor.decoded(), 100U);
+
+    cursor.skipTo(4321);
+    ASSERT_EQUALS(4321U, cursor.docid());
+
+    cursor.skipTo(4999);
+    ASSERT_EQUALS(4999U, cursor.docid());
+
+    cursor.skipTo(6000);
+    ASSERT_TRUE(cursor.done());
+}
+
+TEST(PixPostingCursor, SkipToAcrossBlocks) {
+    vector<unsigned char> b1 = packList(10, 10, 100);    // 10..1000
+    vector<unsigned char> b2 = packList(1010, 10, 100);  // 1010..2000
+    vector<unsigned char> b3 = packList(2010, 10, 100);  // 2010..3000
+
+    vector<PostingCursor::Block> blocks;
+    blocks.push_back(PostingCursor::Block(&b1[0], b1.size()));
+    blocks.push_back(PostingCursor::Block(&b2[0], b2.size()));
+    blocks.push_back(PostingCursor::Block(&b3[0], b3.size()));
+
+    PostingCursor cursor(blocks);
+    cursor.skipTo(2015);
+    ASSERT_EQUALS(2020U, cursor.docid());
+
+    PostingCursor all(blocks);
+    unsigned n = 0;
+    for (; !all.done(); all.next())
+        ++n;
+    ASSERT_EQUALS(300U, n);
+}
+
+// nextBlock() passes over the rest of a block without decoding it.
+TEST(PixPostingCursor, NextBlock) {
+    vector<unsigned char> block = packList(1, 1, 1000);
+    PostingCursor cursor(&block[0], block.size());
+
+    ASSERT_EQUALS(PostingList::kBlockPostings, cursor.blockLastDocid());
+    ASSERT_EQUALS(3U, cursor.blockMaxTf());
+
+    cursor.next();
+    cursor.nextBlock();
+    ASSERT_EQUALS(PostingList::kBlockPostings + 1, cursor.docid());
+    ASSERT_EQUALS(3U, cursor.decoded());
+
+    unsigned blocks = 1;
+    for (; !cursor.done(); cursor.nextBlock())
+        ++blocks;
+    ASSERT_EQUALS((1000 + PostingList::kBlockPostings - 1) / PostingList::kBlockPostings, blocks);
+}
+
+TEST(PixPostingCursor, Merges) {
+    vector<unsigned char> common = packList(1, 1, 3000);
+    vector<unsigned char> rare = packList(1000, 1000, 4);  // 1000..4000
+
+    {
+        PostingCursor c1(&rare[0], rare.size());
+        PostingCursor c2(&common[0], common.size());
+        ScoredDocidList result;
+        PostingCursor::_and2(c1, c2, 1.0f, 2.0f, result);
+        ASSERT_EQUALS(3U, result.size());
+        ASSERT_EQUALS(2000U, result[1].docid);
+        ASSERT_EQUALS(3.0f * (1 + 2000 % 3), result[1].score);
+    }
+
+    {
+        PostingCursor c1(&rare[0], rare.size());
+        PostingCursor c2(&common[0], common.size());
+        ScoredDocidList result;
+        PostingCursor::_or(c1, c2, result);
+        ASSERT_EQUALS(3001U, result.size());
+        ASSERT_EQUALS(4000U, result.back().docid);
+    }
+
+    {
+        PostingCursor c1(&rare[0], rare.size());
+        PostingCursor c2(&common[0], common.size());
+        vector<PostingCursor*> cv = {&c1, &c2};
+        vector<float> wv = {1.0f, 1.0f};
+        ScoredDocidList result;
+        PostingCursor::_accrue(cv, wv, result);
+        ASSERT_EQUALS(3001U, result.size());
+        ASSERT_EQUALS(2.0f * (1 + 1000 % 3), result[999].score);
+    }
+}
+
+TEST(PixPostingCursor, SkipsDeleted) {
+    vector<unsigned char> block = packList(5, 7, 600);
+    PostingList decoded("t", &block[0], block.size());
+
+    // every third docid, including the first and the last
+    vector<unsigned> deleted;
+    for (PostingList::PostingListIterator it = decoded.begin(); it != decoded.end(); it += 3)
+        deleted.push_back(it->getDocid());
+    deleted.push_back(decoded.begin()[decoded.size()-1].getDocid());
+
+    PostingCursor cursor(&block[0], block.size());
+    cursor.setDeleted(&deleted[0], &deleted[0] + deleted.size());
+    for (unsigned i = 0; i < decoded.size(); ++i) {
+        unsigned docid = decoded.begin()[i].getDocid();
+        if (i % 3 == 0 || i == decoded.size()-1) continue;
+        ASSERT_FALSE(cursor.done());
+        ASSERT_EQUALS(docid, cursor.docid());
+        cursor.next();
+    }
+    ASSERT_TRUE(cursor.done());
+
+    // skipTo lands past a deleted target
+    PostingCursor skipper(&block[0], block.size());
+    skipper.setDeleted(&deleted[0], &deleted[0] + deleted.size());
+    skipper.skipTo(decoded.begin()[300].getDocid());
+    ASSERT_EQUALS(decoded.begin()[301].getDocid(), skipper.docid());
+}
+
+// Blocks coded in columns iterate, skip and hide deleted docids like the skip list frames.
+TEST(PixPostingCursor, BlockFormats) {
+    vector<unsigned char> varint = packList(5, 7, 600);
+    PostingList decoded("t", &varint[0], varint.size());
+
+    vector<unsigned> deleted;
+    for (unsigned i = 0; i < decoded.size(); i += 5)
+        deleted.push_back(decoded.begin()[i].getDocid());
+
+    const PixCodec::BlockFormat formats[] = {PixCodec::kGroupVarint, PixCodec::kBitPack};
+    for (PixCodec::BlockFormat format : formats) {
+        vector<unsigned char> block = packList(5, 7, 600, format);
+
+        PostingCursor cursor(&block[0], block.size());
+        for (PostingList::PostingListIterator it = decoded.begin(); it != decoded.end(); ++it) {
+            ASSERT_FALSE(cursor.done());
+            ASSERT_EQUALS(it->getDocid(), cursor.docid());
+            ASSERT_EQUALS(it->getTF(), cursor.tf());
+
+            DocPosting::DocPostingIterator pos = it->iterator();
+            PostingCursor::PositionIterator cpos = cursor.positions();
+            for (; !pos.done(); ++pos, ++cpos) {
+                ASSERT_FALSE(cpos.done());
+                ASSERT_EQUALS(*pos, *cpos);
+            }
+            ASSERT_TRUE(cpos.done());
+            cursor.next();
+        }
+        ASSERT_TRUE(cursor.done());
+
+        PostingCursor skipper(&block[0], block.size());
+        skipper.skipTo(decoded.begin()[300].getDocid() - 1);
+        ASSERT_EQUALS(decoded.begin()[300].getDocid(), skipper.docid());
+        ASSERT_EQUALS(3U, skipper.blockMaxTf());
+        skipper.skipTo(decoded.begin()[599].getDocid());
+        ASSERT_EQUALS(decoded.begin()[599].getDocid(), skipper.docid());
+        skipper.next();
+        ASSERT_TRUE(skipper.done());
+
+        PostingCursor live(&block[0], block.size());
+        live.setDeleted(&deleted[0], &deleted[0] + deleted.size());
+        unsigned n = 0;
+        for (; !live.done(); live.next()) {
+            ASSERT_NOT_EQUALS(0U, (live.docid() - 5) / 7 % 5);
+            ++n;
+        }
+        ASSERT_EQUALS(480U, n);
+    }
+}
+
+// The k best docids match a full accrual, and blocks whose maxTf cannot reach them are skipped.
+TEST(PixPostingCursor, AccrueTopK) {
+    // tf 1 everywhere but for a few docids of each term
+    vector<vector<unsigned char>> blocks;
+    const unsigned high[2][3] = {{300, 1500, 4001}, {1500, 2500, 4000}};
+    for (unsigned t = 0; t < 2; ++t) {
+        PostingList pList("t");
+        for (unsigned docid = 1 + t; docid <= 5000; docid += 1 + t) {
+            unsigned tf = 1;
+            for (unsigned h : high[t])
+                if (docid == h)
+                    tf = 5 + h % 7;
+            vector<unsigned> posv;
+            for (unsigned p = 1; p <= tf; ++p)
+                posv.push_back(p);
+            pList.append(DocPosting(docid, posv));
+        }
+        blocks.push_back(vector<unsigned char>());
+        pList.pack(blocks.back());
+    }
+
+    vector<float> wv = {1.0f, 1.0f};
+    ScoredDocidList all;
+    {
+        PostingCursor c1(&blocks[0][0], blocks[0].size());
+        PostingCursor c2(&blocks[1][0], blocks[1].size());
+        vector<PostingCursor*> cv = {&c1, &c2};
+        PostingCursor::_accrue(cv, wv, all);
+    }
+    std::stable_sort(all.begin(), all.end(), [](const ScoredDocid& a, const ScoredDocid& b) {
+        return a.score > b.score;
+    });
+
+    PostingCursor c1(&blocks[0][0], blocks[0].size());
+    PostingCursor c2(&blocks[1][0], blocks[1].size());
+    vector<PostingCursor*> cv = {&c1, &c2};
+    ScoredDocidList top;
+    PostingCursor::_accrueTopK(cv, wv, 4, top);
+    ASSERT_EQUALS(4U, top.size());
+    for (unsigned i = 1; i < top.size(); ++i)
+        ASSERT_LESS_THAN(top[i - 1].docid, top[i].docid);
+
+    std::set<unsigned> expected;
+    for (unsigned i = 0; i < 4; ++i)
+        expected.insert(all[i].docid);
+    for (const ScoredDocid& sd : top)
+        ASSERT_EQUALS(1U, expected.count(sd.docid));
+    ASSERT_LESS_THAN(c1.decoded() + c2.decoded(), 2500U);
+}
+
+}  // namespace mongo
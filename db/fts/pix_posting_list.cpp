@@ -1,9 +1,10 @@
-//@file PostingList.cpp
 
-#include "hash32map.h"
-#include "Scorer.h"
-#include "PostingList.h"
+//@file pix_posting_list.cpp
 
+#include "pix_posting_list.h"
+
+#include <algorithm>
+#include <assert.h>
 #include <iostream>
 #include <sstream>
 #include <vector>
@@ -12,6 +13,12 @@ using namespace std;
 namespace mongo {
 
 /*---------------------------------------------------------------------------
+              _________
+              nblocks   \
+              header_0  |__block directory
+              ...       |
+              header_n  |
+              _________/
               _________
               offset_0 \
              [offset_1]|__skiplist frame
@@ -23,304 +30,321 @@ namespace mongo {
               pos      |__DocPosting
               ...      |
               pos      |
-              tag      |
-              ...      |
-              tag      |
               _________/
+              ...          up to kBlockPostings frames per block
               _________
-              offset_0 \
-             [offset_1]|__skiplist frame
-              ...      |
-             [offset_b]|
-              _ _ _ _ _/
-              docid_1  \
-              tf       |
-              pos      |__DocPosting 
-              ...      |
-              pos      |
-              tag      |
-              ...      |
-              tag      |
-             __________/
-  
+              offset_0 \    frames of the next block
+              ...
+
       Item        Size        Description
       ----        ----        -----------
+      format      [1]         PixCodec::BlockFormat of the blocks
+      nblocks     [3]         number of blocks
+      firstDocid  [4]  \
+      lastDocid   [4]  |__    header of each block, in block order
+      maxTf       [4]  |
+      length      [4]  /      byte length of the frames of the block
+    _ _ _ _ _ _ _ _ _ _ _ _ _ _ _ _ _ _ _ _ _ _ _ _ _ _ _ _ _ _ _ _ _ _ _ _ _
       offset_0    [4]         byte length of the DocPosting block
-     [offset_1]   [4]         byte offset to the DocPosting block 4 steps ahead
-     [offset_2]   [4]         byte offset to the DocPosting block 16 steps ahead
-     [offset_3]   [4]         byte offset to the DocPosting block 256 steps ahead
-     [offset_4]   [4]         byte offset to the DocPosting block 65536 steps ahead
+     [offset_1]   [4]         byte offset to the frame 4 steps ahead
+     [offset_2]   [4]         byte offset to the frame 16 steps ahead
+     [offset_3]   [4]         byte offset to the frame 64 steps ahead
+     [docid_1]    [var]       docid delta from frame back 4 steps
+     [docid_2]    [var]       docid delta from frame back 16 steps
+     [docid_3]    [var]       docid delta from frame back 64 steps
     _ _ _ _ _ _ _ _ _ _ _ _ _ _ _ _ _ _ _ _ _ _ _ _ _ _ _ _ _ _ _ _ _ _ _ _ _
-      docid_0     [var]       docid delta from previous block
-     [docid_1]    [var]       docid delta from block back 4 steps
-     [docid_2]    [var]       docid delta from block back 16 steps
-     [docid_3]    [var]       docid delta from block back 256 steps
-     [docid_4]    [var]       docid delta from block back 65536 steps
+      docid_0     [var]       docid delta from previous DocPosting
       tf          [var]       position list length = document term frequency
-      pos         [var]       term positions
-      tag         [var]       term contexts (term field id)
-  
+      pos         [var]       term positions (delta from previous position)
+
       for j>0:
-          offset_j \__ occurs <=> (ordinal_position % 2^(2^j) == 0)
-          docid_j  /              
-  
-      The level in the skip list is implicit, based on the ordinal position
-      of the DocPosting. The offsets are forward references and have to be poked
-      into place, hence fixed width.  The docid deltas are backward refernces and
-      can be computed from context.
+          offset_j \__ occurs <=> (ordinal_position % 4^j == 0)
+          docid_j  /
+
+      The DocPostings are cut into blocks of kBlockPostings.  The fixed width
+      headers in front let a reader binary search for the block holding a
+      docid, skip blocks whose maxTf cannot matter, and read just the blocks
+      it needs.  Each block is coded on its own: the ordinal position restarts
+      at 0 and docids are deltas from the block's firstDocid, so the first
+      docid_0 and the docid_j of the first frame are 0.
+
+      Within a block, the level in the skip list is implicit, based on the
+      ordinal position of the DocPosting. The offsets are forward references
+      and have to be poked into place, hence fixed width.  The docid deltas are
+      backward references and can be computed from context.
+
+      An offset_j of 0 means there is no frame that far ahead.  To skip from
+      frame k to frame k+4^j, follow offset_j and add the docid_j found there
+      to docid(k); decoding then resumes at the target frame.  The docid_j are
+      kept in the frame rather than in the DocPosting so that DocPosting
+      coding does not depend on the ordinal position.
+
+      The frames above are the kVarint format, which lists packed before
+      the format byte existed have too.  In the other formats each block
+      holds columns instead, so that the docids and tfs of a whole block
+      decode in one PixCodec::decodeBlock call each:
+
+      count       [var]       number of DocPostings in the block
+      docid       [count]     docid deltas, the first from firstDocid  \
+      tf          [count]     term frequencies                          |__ in format
+      poslen      [count]     byte length of the position deltas       /
+      pos         [var]       position deltas of each DocPosting in turn
+
+      A reader that skips within a block binary searches the decoded docids
+      instead of following skip offsets.
   ---------------------------------------------------------------------------*/
 
-PostingList::PostingList(
-    const std::string& t,
-    const vector<unsigned char>* _cvec)
-:
-    cvec(_cvec),
-    term(t)
-{
-    // unpack
-    vector<unsigned char>::const_iterator p = cvec->begin();
-    uint32_t offset = 0;
-    uint32_t length = 0;
+#define HIGHBIT ((unsigned char)0x80)
+#define LOWMASK ((unsigned char)0x7f)
 
-    #ifdef DEBUG
-    cout <<__FUNCTION__<<": offset = " << offset << endl;
-    cout <<__FUNCTION__<<": length = " << length << endl;
-    cout <<__FUNCTION__<<": cvec.size() = " << cvec.size() << endl;
-    #endif
+namespace {
 
-    while (p!=cvec->end()) {
-        // extract length to next DocPosting
-        unsigned char a = *p++; 
-        unsigned char b = *p++;
-        unsigned char c = *p++;
-        unsigned char d = *p++;
+// scoring helpers
+inline float score_accrue1(const DocPosting& p, float w) {
+    return w*p.getScore();
+}
 
-        if (a!=0) return;    // sanity check
+inline float score_accrue2(const DocPosting& p1, const DocPosting& p2, float w1, float w2) {
+    return w1*p1.getScore() + w2*p2.getScore();
+}
 
-        length = (a<<24)|(b<<16)|(c<<8)|d;
-        offset += 4;
+inline float score_and2(const DocPosting& p1, const DocPosting& p2, float w1, float w2) {
+    return w1*p1.getScore() + w2*p2.getScore();
+}
 
-        // extract DocPosting
+float score_phrase(const vector<const DocPosting*>& dpv, const vector<float>& wv) {
+    float s = 0.0f;
+    for (unsigned i=0; i<dpv.size(); ++i) s += wv[i]*dpv[i]->getScore();
+    return s;
+}
 
-        #ifdef DEBUG
-        cout <<__FUNCTION__<<": offset = " << offset << endl;
-        cout <<__FUNCTION__<<": length = " << length << endl;
-        #endif
+inline unsigned getLength(const unsigned char* p) {
+    return PostingList::frameWord(p);
+}
 
-        DocPosting dp(*cvec, offset, length);
+inline void putLength(unsigned char* p, unsigned length) {
+    p[0] = (unsigned char)(length>>24);
+    p[1] = (unsigned char)(length>>16);
+    p[2] = (unsigned char)(length>>8);
+    p[3] = (unsigned char)(length);
+}
 
-        #ifdef DEBUG
-        cout << "DocPosting = " << dp.toString() << endl;
-        #endif
+inline unsigned skipLevels(unsigned ordinal) {
+    return PostingList::skipLevels(ordinal);
+}
 
-        if (dp.size() > 0) uvec.push_back(dp);
-        offset += length;
-        p += length;
+// Parse the frame header at p.  Returns the start of the DocPosting block and
+// its length, or NULL if the frame is malformed or overruns end.
+const unsigned char* readFrame(
+    const unsigned char* p,
+    const unsigned char* end,
+    unsigned ordinal,
+    unsigned* length)
+{
+    if (p+4 > end || p[0]!=0) return NULL;     // sanity check
+    *length = getLength(p);
+    p += 4 + 4*skipLevels(ordinal);
+    for (unsigned j = skipLevels(ordinal); j > 0; --j) {
+        while (p < end && ((*p)&0x80)) ++p;     // skip docid_j
+        ++p;
     }
+    if (p > end || *length > (unsigned)(end-p)) return NULL;
+    return p;
 }
 
+// Advance it to the first DocPosting with docid >= target.  Probes ahead in
+// strides of 4, 16, 64... from the current position, then binary searches the
+// last stride, so the cost follows log(distance) rather than distance.
+PostingList::PostingListIterator gallop(
+    PostingList::PostingListIterator it,
+    PostingList::PostingListIterator end,
+    unsigned target)
+{
+    if (it==end || it->getDocid() >= target) return it;
+
+    PostingList::PostingListIterator lo = it;
+    PostingList::PostingListIterator hi = end;
+    size_t step = 1;
+    while ((size_t)(end-lo) > step) {
+        PostingList::PostingListIterator probe = lo + step;
+        if (probe->getDocid() >= target) { hi = probe; break; }
+        lo = probe;
+        step <<= 2;
+    }
+    while (lo < hi) {
+        PostingList::PostingListIterator mid = lo + (hi-lo)/2;
+        if (mid->getDocid() < target) lo = mid+1; else hi = mid;
+    }
+    return lo;
+}
+
+}  // namespace
+
+const unsigned PostingList::kSkipStride[PostingList::kSkipLevels+1] = { 1, 4, 16, 64 };
+
+
+// parse the block directory of a packed list
+bool PostingList::readBlockHeaders(
+    const unsigned char* p,
+    unsigned len,
+    vector<BlockHeader>& headers)
+{
+    if (len < 4) return len == 0;
+    unsigned format = p[0];
+    unsigned n = frameWord(p) & 0xffffff;
+    if (format > PixCodec::kBitPack || n > (len-4)/kBlockHeaderBytes) return false;
+
+    const unsigned char* data = p + 4 + n*kBlockHeaderBytes;
+    const unsigned char* end = p + len;
+    for (unsigned i = 0; i < n; ++i) {
+        const unsigned char* h = p + 4 + i*kBlockHeaderBytes;
+        BlockHeader header;
+        header.firstDocid = frameWord(h);
+        header.lastDocid = frameWord(h+4);
+        header.maxTf = frameWord(h+8);
+        header.length = frameWord(h+12);
+        header.format = (PixCodec::BlockFormat)format;
+        header.data = data;
+        if (header.length > (unsigned)(end-data)) return false;
+        data += header.length;
+        headers.push_back(header);
+    }
+    return true;
+}
 
 PostingList::PostingList(
     const std::string& t,
     const vector<unsigned char>* _cvec)
 :
     cvec(_cvec),
-    term(t)
+    term(t),
+    handicap(1.0f)
 {
-    // unpack
-    vector<unsigned char>::const_iterator p = cvec->begin();
-    unsigned offset = 0;
-    unsigned length = 0;
-
-    #ifdef DEBUG
-    cout <<__FUNCTION__<<": offset = " << offset << endl;
-    cout <<__FUNCTION__<<": length = " << length << endl;
-    cout <<__FUNCTION__<<": cvec.size() = " << cvec.size() << endl;
-    #endif
-
-    while (p!=cvec->end()) {
-        // extract length to next DocPosting
-        unsigned char a = *p++; 
-        unsigned char b = *p++;
-        unsigned char c = *p++;
-        unsigned char d = *p++;
-
-        if (a!=0) return;    // sanity check
-
-        length = (a<<24)|(b<<16)|(c<<8)|d;
-        offset += 4;
-
-        // extract DocPosting
-
-        #ifdef DEBUG
-        cout <<__FUNCTION__<<": offset = " << offset << endl;
-        cout <<__FUNCTION__<<": length = " << length << endl;
-        #endif
-
-        DocPosting dp(*cvec, offset, length, logger);
-
-        #ifdef DEBUG
-        cout << "DocPosting = " << dp.toString() << endl;
-        #endif
-
-        if (dp.size() > 0) uvec.push_back(dp);
-        offset += length;
-        p += length;
-    }
+    if (!cvec->empty())
+        unpack(&(*cvec)[0], &(*cvec)[0]+cvec->size());
 }
 
 
 PostingList::PostingList(
     const std::string& t,
-    unsigned char* indexBlock,
+    const unsigned char* indexBlock,
     unsigned len)
 :
-    term(t)
+    cvec(NULL),
+    term(t),
+    handicap(1.0f)
 {
-    // unpack
-    unsigned char* p = indexBlock;
-    unsigned length = 0;
+    unpack(indexBlock, indexBlock+len);
+}
+
 
+// decode the blocks in [p, end)
+void PostingList::unpack(
+    const unsigned char* p,
+    const unsigned char* end)
+{
     #ifdef DEBUG
-    cout <<__FUNCTION__<<": offset = " << offset << endl;
-    cout <<__FUNCTION__<<": length = " << length << endl;
-    cout <<__FUNCTION__<<": len = " << len << endl;
+    cout <<__FUNCTION__<<": len = " << (end-p) << endl;
     #endif
 
-    unsigned char* end = indexBlock+len;
-    while (p!=end) {
-        // extract length to next DocPosting
-        unsigned char a = *p++; 
-        unsigned char b = *p++;
-        unsigned char c = *p++;
-        unsigned char d = *p++;
-        length = (a<<24)|(b<<16)|(c<<8)|d;
-
-        // extract DocPosting
-
-        #ifdef DEBUG
-        cout <<__FUNCTION__<<": offset = " << offset << endl;
-        cout <<__FUNCTION__<<": length = " << length << endl;
-        #endif
-
-        DocPosting dp(p, 0, length);
-
-        #ifdef DEBUG
-        cout << "DocPosting = " << dp.toString() << endl;
-        #endif
-
-        if (dp.size() > 0) uvec.push_back(dp);
-        p      += length;
+    vector<BlockHeader> headers;
+    readBlockHeaders(p, end-p, headers);
+    for (unsigned i = 0; i < headers.size(); ++i) {
+        if (headers[i].format == PixCodec::kVarint)
+            unpackBlock(headers[i]);
+        else
+            unpackColumns(headers[i]);
     }
 }
 
-#define HIGHBIT ((unsigned char)0x80)
-#define LOWMASK ((unsigned char)0x7f)
 
-PostingList::PostingList(
-    const std::string& t,
-    unsigned char* indexBlock,
-    unsigned len,
-    bool b)
-:
-    term(t)
+// decode the frames of one block
+void PostingList::unpackBlock(
+    const BlockHeader& header)
 {
-    // unpack
-    unsigned char* p = indexBlock;
+    const unsigned char* p = header.data;
+    const unsigned char* end = header.data + header.length;
     unsigned length = 0;
+    unsigned lastDocid = header.firstDocid;
+    unsigned ordinal = 0;
 
-    #ifdef DEBUG
-    cout <<__FUNCTION__<<": offset = " << offset << endl;
-    cout <<__FUNCTION__<<": length = " << length << endl;
-    cout <<__FUNCTION__<<": len = " << len << endl;
-    #endif
-
-    unsigned char* end = indexBlock+len;
-    while (p<end)
-    {
-        // extract length to next DocPosting
-        unsigned char a = *p++; 
-        unsigned char b = *p++;
-        unsigned char c = *p++;
-        unsigned char d = *p++;
-        length = (a<<24)|(b<<16)|(c<<8)|d;
-        
-        // unpack length to next DocPosting
-        if (length>1024) break;
+    while (p < end) {
+        // skip the frame header: offsets and skip docids
+        const unsigned char* dpStart = readFrame(p, end, ordinal, &length);
+        if (!dpStart) break;
 
         // extract DocPosting
 
         #ifdef DEBUG
-        cout <<__FUNCTION__<<": offset = " << offset << endl;
         cout <<__FUNCTION__<<": length = " << length << endl;
         #endif
 
-        DocPosting dp(p, 0, length);
+        DocPosting dp(dpStart, 0, length, lastDocid);
 
         #ifdef DEBUG
         cout << "DocPosting = " << dp.toString() << endl;
         #endif
 
-        if (dp.size() > 0) uvec.push_back(dp);
-        p += length;
+        if (dp.size() > 0) {
+            uvec.push_back(dp);
+            lastDocid = dp.getDocid();
+        }
+        p = dpStart+length;
+        ++ordinal;
     }
 }
 
 
-PostingList::PostingList(
-    const std::string& t,
-    unsigned char* indexBlock,
-    unsigned len,
-    int b)
-:
-    term(t)
+// decode the columns of one block
+void PostingList::unpackColumns(
+    const BlockHeader& header)
 {
-    // unpack
-    unsigned char* p = indexBlock;
-    unsigned length = 0;
-
-    #ifdef DEBUG
-    cout <<__FUNCTION__<<": offset = " << offset << endl;
-    cout <<__FUNCTION__<<": length = " << length << endl;
-    cout <<__FUNCTION__<<": len = " << len << endl;
-    #endif
-
-    unsigned char* end = indexBlock+len;
-    hash32map<char> docidmap;
-    while (p<end)
-    {
-        // extract length to next DocPosting
-        unsigned char a = *p++; 
-        unsigned char b = *p++;
-        unsigned char c = *p++;
-        unsigned char d = *p++;
-        length = (a<<24)|(b<<16)|(c<<8)|d;
-        
-        // unpack length to next DocPosting
-        if (length>1024) break;
-
-        // extract DocPosting
-
-        #ifdef DEBUG
-        cout <<__FUNCTION__<<": offset = " << offset << endl;
-        cout <<__FUNCTION__<<": length = " << length << endl;
-        #endif
-
-        DocPosting dp(p, 0, length);
-
-        unsigned docid = dp.getDocid();
-        unsigned idx;
-        if (!docidmap.find(docid,idx) && dp.size()>0) {
-            docidmap.put(docid,'1');
-            uvec.push_back(dp);
-        }
+    unsigned docids[kBlockPostings];
+    unsigned tfs[kBlockPostings];
+    unsigned posEnds[kBlockPostings];
+    unsigned count = 0;
+    const unsigned char* pos = readColumns(header, docids, tfs, posEnds, &count);
+    if (!pos) return;
+
+    unsigned start = 0;
+    for (unsigned i = 0; i < count; ++i) {
+        uvec.push_back(DocPosting(docids[i], pos+start, posEnds[i]-start));
+        start = posEnds[i];
+    }
+}
 
-        #ifdef DEBUG
-        cout << "DocPosting = " << dp.toString() << endl;
-        #endif
 
-        p += length;
+const unsigned char* PostingList::readColumns(
+    const BlockHeader& header,
+    unsigned* docids,
+    unsigned* tfs,
+    unsigned* posEnds,
+    unsigned* count)
+{
+    const unsigned char* p = header.data;
+    const unsigned char* end = header.data + header.length;
+    if (p >= end) return NULL;
+    p += PixCodec::varDecode(p, count);
+    if (*count == 0 || *count > kBlockPostings) return NULL;
+
+    unsigned* columns[3] = { docids, tfs, posEnds };
+    for (unsigned c = 0; c < 3; ++c) {
+        if (p >= end) return NULL;
+        p += PixCodec::decodeBlock(header.format, columns[c], p, end-p, *count);
     }
+    if (p > end) return NULL;
+
+    // expand the docid and position length deltas
+    unsigned docid = header.firstDocid;
+    unsigned posEnd = 0;
+    for (unsigned i = 0; i < *count; ++i) {
+        docid += docids[i];
+        docids[i] = docid;
+        posEnd += posEnds[i];
+        posEnds[i] = posEnd;
+    }
+    if (docid != header.lastDocid || posEnd > (unsigned)(end-p)) return NULL;
+    return p;
 }
 
 
@@ -329,38 +353,158 @@ PostingList::PostingList(
     const vector<DocPosting>& dPv)
 :
     uvec(dPv),
-    term(t)
+    cvec(NULL),
+    term(t),
+    handicap(1.0f)
 {
 }
 
 
 PostingList::PostingList(
     const std::string& t)
-: term(t)
+:
+    cvec(NULL),
+    term(t),
+    handicap(1.0f)
 {
 }
 
 
-PostingList::PostingList(
-    const PostingList& pList,
-    const docid_set& dset)
+// append a PostingList to this one
+void PostingList::append(
+    const PostingList& pList)
+{
+    uvec.insert(uvec.end(), pList.begin(), pList.end());
+}
+
+
+// insert a DocPosting in docid order
+void PostingList::insert(
+    const DocPosting& dp)
+{
+    if (uvec.empty() || uvec.back().getDocid() < dp.getDocid()) {
+        uvec.push_back(dp);
+        return;
+    }
+    vector<DocPosting>::iterator it = uvec.begin();
+    while (it!=uvec.end() && it->getDocid() < dp.getDocid()) ++it;
+    if (it!=uvec.end() && it->getDocid()==dp.getDocid())
+        *it = dp;
+    else
+        uvec.insert(it, dp);
+}
+
+
+// remove the DocPosting for a docid
+bool PostingList::remove(
+    unsigned docid)
+{
+    vector<DocPosting>::iterator it = uvec.begin();
+    while (it!=uvec.end() && it->getDocid() < docid) ++it;
+    if (it==uvec.end() || it->getDocid()!=docid) return false;
+    uvec.erase(it);
+    return true;
+}
+
+
+// serialize to the compressed index format
+void PostingList::pack(
+    vector<unsigned char>& out,
+    PixCodec::BlockFormat format) const
+{
+    unsigned nblocks = (size() + kBlockPostings - 1) / kBlockPostings;
+    size_t directory = out.size();
+    out.resize(directory + 4 + nblocks*kBlockHeaderBytes, 0);
+    putLength(&out[directory], nblocks);
+    out[directory] = (unsigned char)format;
+
+    for (unsigned b = 0; b < nblocks; ++b) {
+        PostingListIterator first = begin() + b*kBlockPostings;
+        PostingListIterator last = (b+1 == nblocks) ? end() : first + kBlockPostings;
+
+        size_t start = out.size();
+        unsigned maxTf = 0;
+        for (PostingListIterator it = first; it != last; ++it)
+            maxTf = std::max(maxTf, it->getTF());
+        if (format == PixCodec::kVarint)
+            packBlock(first, last, out);
+        else
+            packColumns(first, last, format, out);
+
+        unsigned char* h = &out[directory + 4 + b*kBlockHeaderBytes];
+        putLength(h, first->getDocid());
+        putLength(h+4, (last-1)->getDocid());
+        putLength(h+8, maxTf);
+        putLength(h+12, out.size()-start);
+    }
+}
+
+
+// serialize the frames of one block
+void PostingList::packBlock(
+    PostingListIterator first,
+    PostingListIterator last,
+    vector<unsigned char>& out)
 {
-    PostingListIterator it = pList.begin();
-    for (; it!=pList.end(); ++it) {
+    unsigned lastDocid = first->getDocid();
+
+    // per level: frame start and docid of the last frame at that level
+    size_t levelFrame[kSkipLevels+1];
+    unsigned levelDocid[kSkipLevels+1];
+    for (unsigned j=0; j<=kSkipLevels; ++j) levelDocid[j] = lastDocid;
+
+    unsigned ordinal = 0;
+    for (PostingListIterator it = first; it!=last; ++it, ++ordinal) {
+        size_t frame = out.size();
         unsigned docid = it->getDocid();
-        if (dset.contains(docid)) append(*it);
+        unsigned levels = skipLevels(ordinal);
+
+        // poke the forward offsets of the frames that skip to this one
+        for (unsigned j=1; j<=levels; ++j) {
+            if (ordinal > 0)
+                putLength(&out[levelFrame[j]+4*j], frame-levelFrame[j]);
+        }
+
+        out.resize(frame+4+4*levels, 0);
+        for (unsigned j=1; j<=levels; ++j) {
+            PixCodec::varEncode(out, docid - levelDocid[j]);
+            levelFrame[j] = frame;
+            levelDocid[j] = docid;
+        }
+
+        unsigned length = it->pack(out, lastDocid);
+        putLength(&out[frame], length);
+        lastDocid = docid;
     }
 }
 
 
-// append a PostingList to this one
-void PostingList::append(
-    const PostingList& pList)
+void PostingList::packColumns(
+    PostingListIterator first,
+    PostingListIterator last,
+    PixCodec::BlockFormat format,
+    vector<unsigned char>& out)
 {
-    PostingListIterator it = pList.begin();
-    for (; it!=pList.end(); ++it) {
-        append(*it);
+    unsigned count = last-first;
+    assert(count <= kBlockPostings);
+    unsigned docids[kBlockPostings];
+    unsigned tfs[kBlockPostings];
+    unsigned posLengths[kBlockPostings];
+    vector<unsigned char> positions;
+
+    unsigned lastDocid = first->getDocid();
+    for (unsigned i = 0; i < count; ++i, ++first) {
+        docids[i] = first->getDocid() - lastDocid;
+        lastDocid = first->getDocid();
+        tfs[i] = first->getTF();
+        posLengths[i] = first->packPositions(positions);
     }
+
+    PixCodec::varEncode(out, count);
+    PixCodec::encodeBlock(format, out, docids, count);
+    PixCodec::encodeBlock(format, out, tfs, count);
+    PixCodec::encodeBlock(format, out, posLengths, count);
+    out.insert(out.end(), positions.begin(), positions.end());
 }
 
 
@@ -369,53 +513,40 @@ void PostingList::merge(
     const PostingList& pL1,
     const PostingList& pL2,
     PostingList& result)
-    //const HashSet<unsigned> deleteSet)    // tombstones
 {
     PostingListIterator it1 = pL1.begin();
     PostingListIterator e1  = pL1.end();
     PostingListIterator it2 = pL2.begin();
     PostingListIterator e2  = pL2.end();
-    unsigned docid1, docid2;
-    DocPosting p1 = *it1;
-    DocPosting p2 = *it2;
 
-    int c = 0;
     while (it1!=e1 || it2!=e2) {
+        int c;
         if (it1!=e1 && it2!=e2) {
-            docid1 = p1.getDocid();
-            docid2 = p2.getDocid();
-            c = docid1 - docid2;
+            unsigned docid1 = it1->getDocid();
+            unsigned docid2 = it2->getDocid();
+            c = (docid1 < docid2) ? -1 : (docid1 > docid2) ? +1 : 0;
         }
-         else if (it1==e1) {
-            docid2 = p2.getDocid();
+        else if (it1==e1) {
             c = +1;
         }
         else { // if (it2==e2)
-            docid1 = p1.getDocid();
             c = -1;
         }
 
         if (c < 0) {
-            //if (!deleteSet.contains( docid1 )) result.append( p1 );
-            result.append( p1 );
+            result.append( *it1 );
             ++it1;
-            if (it1!=e1) p1 = *it1;
         }
         else if (c > 0) {
-            //if (!deleteSet.contains( docid2 )) result.append( p2 );
-            result.append( p2 );
+            result.append( *it2 );
             ++it2;
-            if (it2!=e2) p2 = *it2;
         }
         else {
-            //ostringstream oss;
-            //oss << "duplicate docid " << docid1 << " in merge";
-            //throw Exception("POSTINGLIST", oss.str());
             DocPosting p3;
-            DocPosting::merge(p1,p2,p3);
+            DocPosting::merge(*it1,*it2,p3);
             result.append( p3 );
-            ++it1; if (it1!=e1) p1 = *it1;
-            ++it2; if (it2!=e2) p2 = *it2;
+            ++it1;
+            ++it2;
         }
     }
 }
@@ -439,7 +570,7 @@ void PostingList::_phrase2(
     PostingList& pList)
 {
     if (!pLv.size()) return;
-  
+
     // get the begining and end iterator for each PostingList
     // also form the term ("term1 term2...")
 
@@ -448,26 +579,12 @@ void PostingList::_phrase2(
     ostringstream oss;
     oss << "(\"";
     unsigned i;
-    vector<unsigned> posidxv;
-    unsigned posidx = 0;
-    bool bNextStop = true;
     for (i=0; i<pLv.size(); ++i) {
+        if (pLv[i]->size()==0) return;
         itv.push_back(pLv[i]->begin());
         iendv.push_back(pLv[i]->end());
-
-        string term = pLv[i]->getTerm();
-        oss << term;
+        oss << pLv[i]->getTerm();
         if (i != pLv.size() - 1) oss << " ";
-
-        if (bNextStop) {
-            bNextStop = false; 
-            posidxv.push_back(posidx); 
-            continue; 
-        }
-        if (i && !bNextStop) {
-            posidxv.push_back(++posidx);
-            if (term.find('#') != string::npos) bNextStop = true;
-        }
     }
     oss << "\")";
     pList.setTerm(oss.str());
@@ -475,104 +592,59 @@ void PostingList::_phrase2(
     // look for common docid in PostingLists for all terms
 
     // target docid
-    unsigned docid = (*itv[0]).getDocid();  
+    unsigned docid = itv[0]->getDocid();
 
-    bool terminate = false;
-    while (true) {     
-        bool match = true;     
-        for (i=0; i<itv.size(); ++i) {       
+    while (true) {
+        bool match = true;
+        bool terminate = false;
+        for (i=0; i<itv.size(); ++i) {
             // advance docid if it's less than the target docid
-            while (itv[i]!=iendv[i] && (*itv[i]).getDocid() < docid) ++itv[i];
+            itv[i] = gallop(itv[i], iendv[i], docid);
 
             // termination condition
             if (itv[i]==iendv[i]) { terminate = true; break; }
 
             // if the next docid is greater than target, it's the next target docid
-            if ((*itv[i]).getDocid() > docid) {
-                docid = (*itv[i]).getDocid();
+            if (itv[i]->getDocid() > docid) {
+                docid = itv[i]->getDocid();
                 match = false;
                 break;
             } // else match
         }
-    
+
         if (terminate) break;
+        if (!match) continue;
 
-        if (match) { // found common docid in PostingList for all terms
-            // construct the DocPosting
-            vector<unsigned> posv;
-            vector<unsigned> tagv;
-            bool addNewDocs = false;
-
-            // iterators of DocPostings for other terms except the first
-            vector<DocPosting::DocPostingIterator> idpv;
-            for (i=0; i<itv.size(); ++i)
-                idpv.push_back((*itv[i]).iterator()); 
-      
-            bool done = false;
-            unsigned pos = (*idpv[0]).first;
-
-            while (true) {
-                // loop through DocPostings
-                for (i=0; i<idpv.size(); ++i) {
-
-                    // advance DocPosting that is less than the first term's pos + i
-                    while (!(idpv[i]).done() && (*idpv[i]).first < pos + posidxv[i]) ++idpv[i];
-
-                    // done with DocPosting condition
-                    if ((idpv[i]).done()) {
-                        done = true;
-                        match = false; 
-                        break;
-                    }
-    
-                    if ((*idpv[i]).first != pos+posidxv[i]) { 
-                        pos = (*idpv[i]).first-posidxv[i]; match = false; break;
-                    }
-                } 
-
-                // Found consecutive postions for the phrase
-                if (match) {
-                    // put DocPostings for all terms
-                    for (i=0; i<idpv.size(); ++i) {
-                        posv.push_back((*idpv[i]).first);
-                        tagv.push_back((*idpv[i]).second);
-                        addNewDocs = true;
-                    }
-
-                    if (!(idpv[0].done())) {
-                        ++idpv[0];
-                        pos = (*idpv[0]).first;
-                    }
-                    else
-                        done = true;
-
-                }
-
-                if (done) break;
-                match = true;
-            } // end: inner while
-
-            if (addNewDocs) {
-                DocPosting p;
-                p.init(docid, posv, tagv, true);
-                vector<DocPosting*> dpv;
-                for (i=0; i<itv.size(); ++i)
-                    dpv.push_back(const_cast<DocPosting*>(&(*itv[i])));
-                p.setScore(Scorer::_phrase(dpv,wv));
-                pList.append(p);
-            }
+        // found common docid in PostingList for all terms:
+        // term i must appear at position (pos + i) for some pos of term 0.
+        vector<vector<unsigned> > posvv(itv.size());
+        for (i=0; i<itv.size(); ++i) itv[i]->getPositions(posvv[i]);
 
-            if (done) { 
-                // not found in this docid, advance docid to the next one
-                if (itv[0] != iendv[0]) {
-                    ++itv[0];
-                    docid = (*itv[0]).getDocid();
-                }
-                else
-                    terminate = true;
-            }
-        }   // end: if (match)
-    }  // end: outer while 
+        vector<unsigned> posv;
+        for (unsigned k=0; k<posvv[0].size(); ++k) {
+            unsigned pos = posvv[0][k];
+            bool found = true;
+            for (i=1; i<posvv.size() && found; ++i)
+                found = binary_search(posvv[i].begin(), posvv[i].end(), pos+i);
+            if (found)
+                for (i=0; i<posvv.size(); ++i) posv.push_back(pos+i);
+        }
+
+        if (!posv.empty()) {
+            sort(posv.begin(), posv.end());
+            DocPosting p;
+            p.init(docid, posv, true);
+            vector<const DocPosting*> dpv;
+            for (i=0; i<itv.size(); ++i) dpv.push_back(&(*itv[i]));
+            p.setScore(score_phrase(dpv,wv));
+            pList.append(p);
+        }
+
+        // advance to the next docid
+        ++itv[0];
+        if (itv[0]==iendv[0]) break;
+        docid = itv[0]->getDocid();
+    }
 }
 
 
@@ -582,43 +654,34 @@ void PostingList::_andnot(
     const PostingList &pL2,
     PostingList& pList)
 {
-    if (pL1.size()==0 || pL2.size()==0) return;
+    if (pL1.size()==0) return;
+    if (pL2.size()==0) { pList = pL1; return; }
 
     PostingListIterator it1 = pL1.begin();
     PostingListIterator e1  = pL1.end();
     PostingListIterator it2 = pL2.begin();
     PostingListIterator e2  = pL2.end();
-  
-    if (it1==e1 || it2==e2) return;
-    
+
     // for the term (&- term1 term2)
     ostringstream oss;
     oss << "(&- " << pL1.getTerm() << " " << pL2.getTerm() << ")";
     pList.setTerm(oss.str());
 
-    unsigned docid1, docid2;
-    while (it1!=e1 && it2!=e2) {
-        docid1 = (*it1).getDocid();
-        docid2 = (*it2).getDocid();
-        if (docid1 < docid2) { 
-            pList.append(*it1); 
-            ++it1; 
-        }
-        else if (docid1 > docid2) {
-            ++it2;
-        }
-        else {
-            ++it1;
-            ++it2;
-        }
+    // every posting of pL1 is output unless pL2 has its docid, so only pL2
+    // can be skipped over
+    for (; it1!=e1 && it2!=e2; ++it1) {
+        it2 = gallop(it2, e2, it1->getDocid());
+        if (it2==e2 || it2->getDocid()!=it1->getDocid())
+            pList.append(*it1);
     }
+    for (; it1!=e1; ++it1) pList.append(*it1);
 }
 
 
 // merge two PostingLists in Near cndition
 void PostingList::_near(
-    PostingList &pL1,
-    PostingList &pL2,
+    const PostingList &pL1,
+    const PostingList &pL2,
     int radius,
     PostingList &pList)
 {
@@ -628,10 +691,10 @@ void PostingList::_near(
 
 // merge two PostingLists in Near cndition
 void PostingList::_near2(
-    PostingList &pL1,
-    PostingList &pL2,
-    int radius;
-    float w1;
+    const PostingList &pL1,
+    const PostingList &pL2,
+    int radius,
+    float w1,
     float w2,
     PostingList &pList)
 {
@@ -642,175 +705,46 @@ void PostingList::_near2(
     oss << "(" << pL1.getTerm() << "  w/" << radius << " " << pL2.getTerm() << ")";
     pList.setTerm(oss.str());
 
-    vector<PostingListIterator> itv;
-    vector<PostingListIterator> iendv;
-
-    itv.push_back(pL1.begin());
-    itv.push_back(pL2.begin());
-    iendv.push_back(pL1.end());
-    iendv.push_back(pL2.end());
-
-    unsigned i, docid = (*itv[0]).getDocid();  //target docid 
-
-    bool terminate = false;
-    while (true) {     
-        bool match = true;     
-        for (i=0; i<itv.size(); ++i) {       
-            // advance docid if it's less than the target docid
-            while (itv[i]!=iendv[i] && (*itv[i]).getDocid() < docid) ++itv[i];
-
-            // termination condition
-            if (itv[i]==iendv[i]) { terminate = true; break; }
+    PostingListIterator it1 = pL1.begin();
+    PostingListIterator e1  = pL1.end();
+    PostingListIterator it2 = pL2.begin();
+    PostingListIterator e2  = pL2.end();
 
-            // if the next docid is greater than the target, it's the next target docid
-            if ((*itv[i]).getDocid() > docid) {
-                docid = (*itv[i]).getDocid();
-                match = false;
-                break;
+    while (it1!=e1 && it2!=e2) {
+        unsigned docid1 = it1->getDocid();
+        unsigned docid2 = it2->getDocid();
+        if (docid1 < docid2) { it1 = gallop(it1, e1, docid2); continue; }
+        if (docid1 > docid2) { it2 = gallop(it2, e2, docid1); continue; }
+
+        // common docid: keep every position that has a partner within radius
+        vector<unsigned> posv;
+        DocPosting::DocPostingIterator a = it1->iterator();
+        DocPosting::DocPostingIterator b = it2->iterator();
+        while (!a.done() && !b.done()) {
+            unsigned pa = *a;
+            unsigned pb = *b;
+            unsigned d = (pa<pb) ? pb-pa : pa-pb;
+            if (d <= (unsigned)radius) {
+                posv.push_back(pa);
+                posv.push_back(pb);
             }
+            if (pa <= pb) ++a; else ++b;
         }
-        
-        if (terminate) break;
 
-        if (match) { // found common docid in PostingList for all terms
-            // construct the DocPosting
-            vector<unsigned> posv;
-            vector<unsigned> tagv;
-            bool addNewDocs = false;
-
-            vector<DocPosting::DocPostingIterator> idpv;
-            for (i=0; i<itv.size(); ++i) idpv.push_back((*itv[i]).iterator());
-
-            bool done = false;
-            int posidx = 0;
-            unsigned pos = (*idpv[posidx]).first;
-            while (true) {
-
-                // loop through DocPostings of other terms
-                for (i=0; i<idpv.size(); ++i) {
-
-                    // advance DocPosting that is less than the first term's pos + i
-                    while (!(idpv[i].done()) && (((*idpv[i]).first+radius) < pos)) ++idpv[i];
-
-                    // done with DocPosting condition
-                    if (idpv[i].done()) {
-                        done = true;
-                        if (((*idpv[i]).first+radius) < pos || ((*idpv[i]).first > (pos+radius))) {
-                        match = false;
-                        break; }
-                    }
-
-                    if (((*idpv[i]).first) > (pos+radius)) {
-                        posidx = i;
-                        pos = (*idpv[posidx]).first;
-                        match = false;
-                        break;
-                    }
-                }
-
-                if (match) {
-                    posidx = posidx? 0:1;
-                    while ((*idpv[posidx]).first <= pos+radius) {
-                        posv.push_back((*idpv[0]).first);
-                        posv.push_back((*idpv[1]).first);
-                        tagv.push_back((*idpv[0]).second);
-                        tagv.push_back((*idpv[1]).second);
-                        addNewDocs = true;
-
-                        if (!(idpv[posidx].done()))
-                            ++idpv[posidx];
-                        else {
-                            done = true;
-                            break;
-                        }
-                    }
-
-                    if (!done)
-                        pos = (*idpv[posidx]).first;
-                }
-
-                if (done) break; 
-                match = true;
-
-            }   // end: while (true)
-
-            if (addNewDocs) {
-                DocPosting p;
-                p.init(docid, posv, tagv, true);
-                p.setScore(Scorer::_and2(*itv[0],*itv[1],w1,w2));
-                pList.append(p);          
-            }
-
-            if (done) { 
-                if (itv[0]!=iendv[0]) { ++itv[0]; docid = (*itv[0]).getDocid(); }
-                else terminate = true; 
-            }
+        if (!posv.empty()) {
+            sort(posv.begin(), posv.end());
+            posv.erase(unique(posv.begin(), posv.end()), posv.end());
+            DocPosting p;
+            p.init(docid1, posv, true);
+            p.setScore(score_and2(*it1,*it2,w1,w2));
+            pList.append(p);
         }
+        ++it1;
+        ++it2;
     }
 }
 
 
-void PostingList::_tag(
-  PostingList &pL,
-  int type,
-  PostingList &pList)
-{
-  _tag2(pL, type, 1.0f, pList);
-}
-
-
-void PostingList::_tag2(
-  PostingList &pL,
-  int type, float w,
-  PostingList &pList)
-{
-    if (pL.size()==0) return;
-
-  // for the term (tag:token)
-  ostringstream oss;
-  oss << "(";
-  if (type == 1) // title_tag
-    oss << "intitle:";
-  else if (type == 2) // url_tag
-    oss << "inurl:";
-  else if (type == 0) // site_tag
-    oss << "site:";
-  oss << pL.getTerm() << ")";
-  pList.setTerm(oss.str());
-
-  // filter out result based on tag
-  PostingList::PostingListIterator ipL = pL.begin(); 
-  for(; ipL != pL.end(); ++ipL)
-  {
-    unsigned docid = (*ipL).getDocid();
-    vector<unsigned> posv;
-    vector<unsigned> tagv;
-    bool match = false;
-
-    DocPosting::DocPostingIterator idp = (*ipL).iterator();
-    for (; !idp.done(); ++idp)
-    {
-      if ((type == 1 /*title_tag*/ && (*idp).second == TagScanner::h_title) ||
-          (type == 2 /*url_tag*/   && (*idp).second == TagScanner::h_url) ||
-          (type == 0 /*site_tag*/   && (*idp).second == TagScanner::h_url)) 
-      {
-        posv.push_back((*idp).first);
-        tagv.push_back((*idp).second);
-        match = true;
-      }
-    }
-
-    if (match)
-    {
-      DocPosting p;
-      p.init(docid, posv, tagv, true);
-            p.setScore(Scorer::_accrue1(p,w));
-      pList.append(p);
-    }
-  }
-}
-
-
 // intersect two PostingLists with weights
 void PostingList::_and2(
     const PostingList& pL1,
@@ -832,44 +766,22 @@ void PostingList::_and2(
     PostingListIterator it2 = pL2.begin();
     PostingListIterator e2  = pL2.end();
 
-    if (it1==e1 || it2==e2) return;
-
-    DocPosting  p1 = *it1;
-    DocPosting  p2 = *it2;
-    unsigned docid1 = p1.getDocid();
-    unsigned docid2 = p2.getDocid();
-
     while (it1!=e1 && it2!=e2) {
-        //cout << "_and: (docid1,docid2) = (" << docid1 << "," << docid2 << ")\n";
+        unsigned docid1 = it1->getDocid();
+        unsigned docid2 = it2->getDocid();
         if (docid1 < docid2) {
-            ++it1;
-            if (it1!=e1) {
-                p1 = *it1;    // XXX skiplist here
-                docid1 = p1.getDocid();
-            }
+            it1 = gallop(it1, e1, docid2);
         }
         else if (docid1 > docid2) {
-            ++it2;
-            if (it2!=e2){
-                p2 = *it2;    // XXX skiplist here
-                docid2 = p2.getDocid();
-            }
+            it2 = gallop(it2, e2, docid1);
         }
         else {    // docid1==docid2
             DocPosting p;
-            DocPosting::merge( p1, p2, p );
-            p.setScore(Scorer::_and2(p1,p2,w1,w2));
+            DocPosting::merge( *it1, *it2, p );
+            p.setScore(score_and2(*it1,*it2,w1,w2));
             result.append( p );
             ++it1;
             ++it2;
-            if (it1!=e1) {
-                p1 = *it1;
-                docid1 = p1.getDocid();
-            }
-            if (it2!=e2) {
-                p2 = *it2;
-                docid2 = p2.getDocid();
-            }
         }
     }
 }
@@ -899,53 +811,7 @@ void PostingList::_or(
     oss << "(| " << pL1.getTerm() << " " << pL2.getTerm() << ")";
     result.setTerm(oss.str());
 
-    PostingListIterator it1 = pL1.begin();
-    PostingListIterator e1  = pL1.end();
-    PostingListIterator it2 = pL2.begin();
-    PostingListIterator e2  = pL2.end();
-
-    DocPosting  p1, p2;
-    unsigned docid1, docid2;
-
-    if (it1!=e1) { p1 = *it1; }
-    if (it2!=e2) { p2 = *it2; }
-
-    int c;
-    while (it1!=e1 || it2!=e2)
-    {
-        if (it1!=e1 && it2!=e2) {
-            docid1 = p1.getDocid();
-            docid2 = p2.getDocid();
-            c = docid1 - docid2;
-        }
-        else if (it1==e1) {
-            docid2 = p2.getDocid();
-            c = +1;
-        }
-        else { //(it2==e2) 
-            docid1 = p1.getDocid();
-            c = -1;
-        }
-
-        if (c < 0) {
-            result.append( p1 );
-            ++it1;
-            if (it1!=e1) p1 = *it1;
-        }
-        else if (c > 0) {
-            result.append( p2 );
-            ++it2;
-            if (it2!=e2) p2 = *it2;
-        }
-        else {
-            DocPosting p(docid1);
-            DocPosting::merge( p1, p2, p );
-            result.append( p );
-            ++it1; ++it2;
-            if (it1!=e1) p1 = *it1;
-            if (it2!=e2) p2 = *it2;
-        }
-    }
+    merge(pL1, pL2, result);
 }
 
 
@@ -956,16 +822,14 @@ void PostingList::_accrue2(
     float w1, float w2,
     PostingList& result)
 {
-    string term1 = pL1.getTerm();
-    string term2 = pL2.getTerm();
-    unsigned loc1 = term1.find("vert:", 0);
-    unsigned loc2 = term2.find("vert:", 0);
+    const string& term1 = pL1.getTerm();
+    const string& term2 = pL2.getTerm();
 
-    if (loc1==0 || loc2==0) {
+    if (term1.find("vert:")==0 || term2.find("vert:")==0) {
         _and2(pL1, pL2, w1, w2, result);
         return;
     }
-    
+
     if (pL1.size()==0) { result = pL2; return; }
     if (pL2.size()==0) { result = pL1; return; }
 
@@ -979,123 +843,41 @@ void PostingList::_accrue2(
     PostingListIterator it2 = pL2.begin();
     PostingListIterator e2  = pL2.end();
 
-    DocPosting  p1, p2;
-    unsigned docid1, docid2;
-
-    if (it1!=e1) { p1 = *it1; }
-    if (it2!=e2) { p2 = *it2; }
-
-    int c;
     while (it1!=e1 || it2!=e2)
     {
+        int c;
         if (it1!=e1 && it2!=e2) {
-            docid1 = p1.getDocid();
-            docid2 = p2.getDocid();
-            c = docid1 - docid2;
+            unsigned docid1 = it1->getDocid();
+            unsigned docid2 = it2->getDocid();
+            c = (docid1 < docid2) ? -1 : (docid1 > docid2) ? +1 : 0;
         }
         else if (it1==e1) {
-            docid2 = p2.getDocid();
             c = +1;
         }
-        else { //(it2==e2) 
-            docid1 = p1.getDocid();
+        else { //(it2==e2)
             c = -1;
         }
 
         if (c < 0) {
-            p1.setScore(Scorer::_accrue1(p1,w1));
-            result.append( p1 );
+            result.append( *it1 );
+            result.uvec.back().setScore(score_accrue1(*it1,w1));
             ++it1;
-            if (it1!=e1) p1 = *it1;
         }
         else if (c > 0) {
-            p2.setScore(Scorer::_accrue1(p2,w2));
-            result.append( p2 );
+            result.append( *it2 );
+            result.uvec.back().setScore(score_accrue1(*it2,w2));
             ++it2;
-            if (it2!=e2) p2 = *it2;
         }
         else {
-            DocPosting p(docid1);
-            DocPosting::merge( p1, p2, p );
-            p.setScore(Scorer::_accrue2(p1,p2,w1,w2));
-            result.append( p );
-            ++it1; ++it2;
-            if (it1!=e1) p1 = *it1;
-            if (it2!=e2) p2 = *it2;
-        }
-    }
-}
-
-
-// Accrue three PostingLists with weights
-/*
-void PostingList::_accrue3(
-    const PostingList& pL1,
-    const PostingList& pL2,
-    const PostingList& pL3,
-    float w1, float w2, float w3,
-    PostingList& result)
-{
-    if (pL1.size()==0) { result = pL2; return; }
-    if (pL2.size()==0) { result = pL1; return; }
-
-    // form the term "(accrue term1 term2)"
-    ostringstream oss;
-    oss << "(@ " << pL1.getTerm() << " " << pL2.getTerm() << ")";
-    result.setTerm(oss.str());
-
-    PostingListIterator it1 = pL1.begin();
-    PostingListIterator e1  = pL1.end();
-    PostingListIterator it2 = pL2.begin();
-    PostingListIterator e2  = pL2.end();
-
-    DocPosting  p1, p2;
-    unsigned docid1, docid2;
-
-    if (it1!=e1) { p1 = *it1; }
-    if (it2!=e2) { p2 = *it2; }
-
-    int c;
-    while (it1!=e1 || it2!=e2)
-    {
-        if (it1!=e1 && it2!=e2) {
-            docid1 = p1.getDocid();
-            docid2 = p2.getDocid();
-            c = docid1 - docid2;
-        }
-        else if (it1==e1) {
-            docid2 = p2.getDocid();
-            c = +1;
-        }
-        else { //(it2==e2) 
-            docid1 = p1.getDocid();
-            c = -1;
-        }
-
-        if (c < 0) {
-            p1.setScore(Scorer::_accrue1(p1,w1));
-            result.append( p1 );
+            result.uvec.push_back(DocPosting());
+            DocPosting::merge( *it1, *it2, result.uvec.back() );
+            result.uvec.back().setScore(score_accrue2(*it1,*it2,w1,w2));
             ++it1;
-            if (it1!=e1) p1 = *it1;
-        }
-        else if (c > 0) {
-            p2.setScore(Scorer::_accrue1(p2,w2));
-            result.append( p2 );
             ++it2;
-            if (it2!=e2) p2 = *it2;
-        }
-        else {
-            DocPosting p(docid1);
-            DocPosting::merge( p1, p2, p );
-            p.setScore(Scorer::_accrue2(p1,p2,w1,w2));
-            result.append( p );
-            ++it1; ++it2;
-            if (it1!=e1) p1 = *it1;
-            if (it2!=e2) p2 = *it2;
         }
     }
 }
-*/
+
 
 // Accrue two PostingLists with default weights
 void PostingList::_accrue(
@@ -1111,8 +893,7 @@ string PostingList::toString() const
 {
     ostringstream oss;
     for (PostingListIterator it = begin(); it!=end(); ++it) {
-      DocPosting docP =*it;
-      oss << docP.toString() << endl;
+        oss << it->toString() << endl;
     }
     return oss.str();
 }
@@ -1120,94 +901,107 @@ string PostingList::toString() const
 
 // Low-level access functions
 void PostingList::findtf(
-    unsigned char* indexbuf,
+    const unsigned char* indexbuf,
     unsigned buflen,
     unsigned start,
     unsigned count,
     unsigned tfmin,
     PostingList& pL)
 {
-    unsigned char* p = indexbuf;
-    unsigned char* q = &indexbuf[buflen];
-    unsigned len = 0;
-    unsigned docid = 0;
-    unsigned tf = 0;
+    vector<BlockHeader> headers;
+    readBlockHeaders(indexbuf, buflen, headers);
+
     unsigned k = 0;
+    unsigned n = 0;
+    for (unsigned b = 0; b < headers.size() && n < count; ++b) {
+        // no DocPosting of the block reaches tfmin
+        if (headers[b].maxTf < tfmin) continue;
+        if (headers[b].format == PixCodec::kVarint)
+            findtfBlock(headers[b], start, count, tfmin, k, n, pL);
+        else
+            findtfColumns(headers[b], start, count, tfmin, k, n, pL);
+    }
+}
 
-    while (p<q && k<start) {
-        len = docid = tf = 0;
-
-        // unpack length
-        unsigned a = *p++;
-        unsigned b = *p++;
-        unsigned c = *p++;
-        unsigned d = *p++;
-        len = (a<<24)+(b<<16)+(c<<8)+d;
-        unsigned char* p0 = p;
-    
-        // unpack docid
-        for (; (*p0)&HIGHBIT ; ++p0) { docid <<= 7; docid += (*p0)&LOWMASK;    }
-        docid <<= 7; docid += (*p0++);
-    
-        // unpack tf
-        for (; (*p0)&HIGHBIT ; ++p0) { tf <<= 7; tf += (*p0)&LOWMASK;    }
-        tf <<= 7; tf += (*p0++);
 
-        #ifdef DEBUG
-        cout << "len.="<<len;
-        cout << ", docid.="<<docid;
-        cout << ", tf.="<<tf<<endl;
-        #endif
-    
-        if (tf>=tfmin) k++;
-        p += len;
-    
-        // step past pos,pos,..
-        //for (unsigned j=0; j<tf; ++j) { while ((*p0)&HIGHBIT) ++p0; ++p0; }
-        // step past tag,tag,..
-        //for (unsigned j=0; j<tf; ++j) { while ((*p0)&HIGHBIT) ++p0; ++p0; }
+// findtf over the columns of one block
+void PostingList::findtfColumns(
+    const BlockHeader& header,
+    unsigned start,
+    unsigned count,
+    unsigned tfmin,
+    unsigned& k,
+    unsigned& n,
+    PostingList& pL)
+{
+    unsigned docids[kBlockPostings];
+    unsigned tfs[kBlockPostings];
+    unsigned posEnds[kBlockPostings];
+    unsigned ndocs = 0;
+    const unsigned char* pos = readColumns(header, docids, tfs, posEnds, &ndocs);
+    if (!pos) return;
+
+    for (unsigned i = 0; i < ndocs && n < count; ++i) {
+        if (tfs[i] < tfmin) continue;
+        if (k++ < start) continue;
+
+        unsigned posStart = i ? posEnds[i-1] : 0;
+        pL.append(DocPosting(docids[i], pos+posStart, posEnds[i]-posStart));
+        ++n;
     }
+}
+
+
+// findtf over the frames of one block; k counts the entries passed, n those returned
+void PostingList::findtfBlock(
+    const BlockHeader& header,
+    unsigned start,
+    unsigned count,
+    unsigned tfmin,
+    unsigned& k,
+    unsigned& n,
+    PostingList& pL)
+{
+    const unsigned char* p = header.data;
+    const unsigned char* q = header.data + header.length;
+    unsigned len = 0;
+    unsigned delta = 0;
+    unsigned docid = header.firstDocid;
+    unsigned tf = 0;
+    unsigned ordinal = 0;
+
+    while (p<q && n<count) {
+        unsigned lastDocid = docid;
+
+        // skip the frame header
+        const unsigned char* p0 = readFrame(p, q, ordinal++, &len);
+        if (!p0) break;
+        p = p0+len;
+
+        // unpack docid delta
+        delta = 0;
+        for (; (*p0)&HIGHBIT ; ++p0) { delta <<= 7; delta += (*p0)&LOWMASK; }
+        delta <<= 7; delta += (*p0++);
+        docid += delta;
 
-    k = 0;
-    while (p<q && k<count) {
-        len = docid = tf = 0;
-
-        // unpack length
-        unsigned a = *p++;
-        unsigned b = *p++;
-        unsigned c = *p++;
-        unsigned d = *p++;
-        len = (a<<24)+(b<<16)+(c<<8)+d;
-        unsigned char* p0 = p;
-    
-        // unpack docid
-        for (; (*p0)&HIGHBIT ; ++p0) { docid <<= 7; docid += (*p0)&LOWMASK;    }
-        docid <<= 7; docid += (*p0++);
-    
         // unpack tf
-        for (; (*p0)&HIGHBIT ; ++p0) { tf <<= 7; tf += (*p0)&LOWMASK;    }
+        tf = 0;
+        for (; (*p0)&HIGHBIT ; ++p0) { tf <<= 7; tf += (*p0)&LOWMASK; }
         tf <<= 7; tf += (*p0++);
-    
+
         #ifdef DEBUG
         cout << "len="<<len;
         cout << ", docid="<<docid;
         cout << ", tf="<<tf<<endl;
         #endif
 
-        if (tf>=tfmin) {
-            pL.append(DocPosting((unsigned char*)p,0,len));
-            ++k;
-        }
-        p += len;
-        
-        // step past pos,pos,..
-        //for (unsigned j=0; j<tf; ++j) { while ((*p0)&HIGHBIT) ++p0; ++p0; }
-        // step past tag,tag,..
-        //for (unsigned j=0; j<tf; ++j) { while ((*p0)&HIGHBIT) ++p0; ++p0; }
+        if (tf<tfmin) continue;
+        if (k++<start) continue;
+
+        pL.append(DocPosting(p-len,0,len,lastDocid));
+        ++n;
     }
 }
 
 
 }   // namespace mongo
-
-
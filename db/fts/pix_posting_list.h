@@ -1,12 +1,13 @@
 
+
 #ifndef __POSTING_LIST_H_
 #define __POSTING_LIST_H_
 
+#include <string>
+#include <utility>
 #include <vector>
 
-#include "docid_set.h"
-#include "Logger.h"
-#include "DocPosting.h"
+#include "pix_doc_posting.h"
 
 
 namespace mongo {
@@ -30,32 +31,15 @@ protected: // state
 
 public:
 
-    PostingList(    // construct from compressed index list 
+    PostingList(    // construct from compressed index list
         const std::string& term,
         const std::vector<unsigned char>*);
 
-    PostingList(
-        const std::string& term,
-        const std::vector<unsigned char>*,
-        Logger& logger);
-
-    PostingList(    // construct from compressed index list 
+    PostingList(    // construct from compressed index list
         const std::string& term,
-        unsigned char*,
+        const unsigned char*,
         unsigned len);
 
-    PostingList(    // variant: cut on DocPosting bad length
-        const std::string& term,
-        unsigned char*,
-        unsigned len,
-        bool);
-
-    PostingList(    // variant: as above, and dedup docids
-        const std::string& term,
-        unsigned char*,
-        unsigned len,
-        int);
-
     PostingList(
         const std::string& term,
         const std::vector<DocPosting>&);
@@ -63,19 +47,21 @@ public:
     PostingList(
         const std::string& term);
 
-    PostingList(
-        const PostingList& pList,
-        const docid_set& dset);
-
-    PostingList() : cvec(NULL) {}
+    PostingList() : cvec(NULL), handicap(1.0f) {}
 
     PostingList(const PostingList& pList)
-    : uvec(pList.uvec), cvec(pList.cvec), term(pList.term) {}
-    
+    : uvec(pList.uvec), cvec(pList.cvec), term(pList.term), handicap(pList.handicap) {}
+
     ~PostingList() {}
 
+    PostingList& operator=(const PostingList& pList) {
+        uvec = pList.uvec; cvec = pList.cvec; term = pList.term; handicap = pList.handicap;
+        return *this;
+    }
+
     void swap(PostingList& pL)
-    { uvec.swap(pL.uvec); cvec = pL.cvec; term.swap(pL.term); }
+    { uvec.swap(pL.uvec); std::swap(cvec, pL.cvec); term.swap(pL.term);
+      std::swap(handicap, pL.handicap); }
 
     // iterator interface
     typedef std::vector<DocPosting>::const_iterator PostingListIterator;
@@ -86,16 +72,22 @@ public:
 
     // manipulators
 
-    // append DocPosting to this list 
+    // append DocPosting to this list
     void append(const DocPosting&);
 
-    // append PostingList to this list 
+    // append PostingList to this list
     void append(const PostingList&);
 
+    // insert DocPosting in docid order, replacing any posting with the same docid
+    void insert(const DocPosting&);
+
+    // remove the DocPosting for docid; return false if not present
+    bool remove(unsigned docid);
+
     // return the number of DocPostings in this list
     unsigned size() const;
 
-    // get or set the term for this PostingList 
+    // get or set the term for this PostingList
     const std::string& getTerm() const;
     void setTerm(const std::string& t);
 
@@ -103,8 +95,14 @@ public:
     float getHandicap() const { return handicap; }
     void setHandicap(float _handicap) { handicap = _handicap; }
 
+    // append the compressed index format of this list to cvec, its blocks coded in the
+    // given format (kVarint: skip list frames, otherwise docid, tf and position length columns)
+    void pack(
+        std::vector<unsigned char>& cvec,
+        PixCodec::BlockFormat format = PixCodec::kVarint) const;
+
 
-    // intersect two PostingLists 
+    // intersect two PostingLists
     static void _and(
         const PostingList&,
         const PostingList&,
@@ -138,22 +136,21 @@ public:
         const PostingList&,
         PostingList& result);
 
-    // merge two PostingLists 
+    // merge two PostingLists
     static void merge(
         const PostingList&,
         const PostingList&,
         PostingList& result);
-        //const HashSet& deleteSet);
 
     // merge phrase PostingLists
     static void _phrase(
-        const vector<PostingList*>&,
+        const std::vector<PostingList*>&,
         PostingList&);
 
     // merge phrase PostingLists
     static void _phrase2(
-        const vector<PostingList*>&,
-        const vector<float>&,
+        const std::vector<PostingList*>&,
+        const std::vector<float>&,
         PostingList&);
 
     // merge two PostingLists in AndNot condition
@@ -164,42 +161,120 @@ public:
 
     // merge two PostingLists in Near cndition
     static void _near(
-        PostingList&,
-        PostingList&,
+        const PostingList&,
+        const PostingList&,
         int,
         PostingList&);
 
     // merge two PostingLists in Near cndition
     static void _near2(
-        PostingList&,
-        PostingList&,
+        const PostingList&,
+        const PostingList&,
         int,
         float w1,
         float w2,
         PostingList&);
 
-    // filter PostingLists by tag
-    static void _tag(
-        PostingList&,
-        int,
-        PostingList&);
-
-    // filter PostingLists by tag
-    static void _tag2(
-        PostingList&,
-        int, float w,
-        PostingList&);
-
-    // return high-tf entries
+    // compressed format helpers (see the layout in pix_posting_list.cpp)
+    static const unsigned kBlockPostings = 128;         // DocPostings per block
+    static const unsigned kBlockHeaderBytes = 16;
+    static const unsigned kSkipLevels = 3;
+    static const unsigned kSkipStride[kSkipLevels+1];   // in DocPostings, level 0 = 1
+
+    // header of one block of a packed list
+    struct BlockHeader {
+        unsigned firstDocid;
+        unsigned lastDocid;
+        unsigned maxTf;                 // highest tf of the block's DocPostings
+        PixCodec::BlockFormat format;   // coding of the block, the same for the whole list
+        const unsigned char* data;      // the block's frames or columns
+        unsigned length;                // byte length of the frames or columns
+    };
+
+    // append the headers of the packed list [p, p+len); false if it is malformed
+    static bool readBlockHeaders(
+        const unsigned char* p,
+        unsigned len,
+        std::vector<BlockHeader>& headers);
+
+    // decode the columns of a block not in kVarint format: the absolute docids and the tfs of
+    // its count DocPostings, and in posEnds[i] the end offset of the position deltas of
+    // DocPosting i, which start at posEnds[i-1] (at 0 for i = 0) from the returned pointer;
+    // the arrays hold kBlockPostings values.  NULL if the block is malformed.
+    static const unsigned char* readColumns(
+        const BlockHeader& header,
+        unsigned* docids,
+        unsigned* tfs,
+        unsigned* posEnds,
+        unsigned* count);
+
+    // number of skip levels present in the frame at a given ordinal position
+    static unsigned skipLevels(unsigned ordinal) {
+        unsigned n = 0;
+        while (n < kSkipLevels && ordinal % kSkipStride[n+1] == 0) ++n;
+        return n;
+    }
+
+    // fixed width (big endian) length or offset word
+    static unsigned frameWord(const unsigned char* p) {
+        return (p[0]<<24)|(p[1]<<16)|(p[2]<<8)|p[3];
+    }
+
+    // return high-tf entries, skipping blocks whose maxTf is below tfmin
     static void findtf(
-        unsigned char* indexbuf1,   // index block
-        unsigned buflen,            // block length
-        unsigned start,             // requested docid start
-        unsigned count,             // requested docid count
-        unsigned tfmin,             // lower bound on tf
-        PostingList& pL);           // return value
-
-
+        const unsigned char* indexbuf,  // index block
+        unsigned buflen,                // block length
+        unsigned start,                 // number of high-tf entries to pass over
+        unsigned count,                 // requested docid count
+        unsigned tfmin,                 // lower bound on tf
+        PostingList& pL);               // return value
+
+protected:
+    // decode the compressed blocks in [p, end) into uvec
+    void unpack(
+        const unsigned char* p,
+        const unsigned char* end);
+
+    // decode the frames of one block into uvec
+    void unpackBlock(
+        const BlockHeader& header);
+
+    // decode the columns of one block into uvec
+    void unpackColumns(
+        const BlockHeader& header);
+
+    // append the frames of the DocPostings [first, last) as one block
+    static void packBlock(
+        PostingListIterator first,
+        PostingListIterator last,
+        std::vector<unsigned char>& out);
+
+    // append the DocPostings [first, last) as one block of columns in the given format
+    static void packColumns(
+        PostingListIterator first,
+        PostingListIterator last,
+        PixCodec::BlockFormat format,
+        std::vector<unsigned char>& out);
+
+    // findtf over one block of frames
+    static void findtfBlock(
+        const BlockHeader& header,
+        unsigned start,
+        unsigned count,
+        unsigned tfmin,
+        unsigned& k,
+        unsigned& n,
+        PostingList& pL);
+
+    // findtf over one block of columns
+    static void findtfColumns(
+        const BlockHeader& header,
+        unsigned start,
+        unsigned count,
+        unsigned tfmin,
+        unsigned& k,
+        unsigned& n,
+        PostingList& pL);
 };
 
 inline void PostingList::append(const DocPosting& dp) { uvec.push_back(dp); }
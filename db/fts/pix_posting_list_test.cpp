@@ -0,0 +1,265 @@
+/**
+ *    Copyright (C) 2016 MongoDB Inc.
+ *
+ *    This program is free software: you can redistribute it and/or  modify
+ *    it under the terms of the GNU Affero General Public License, version 3,
+ *    as published by the Free Software Foundation.
+ *
+ *    This program is distributed in the hope that it will be useful,
+ *    but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *    GNU Affero General Public License for more details.
+ *
+ *    You should have received a copy of the GNU Affero General Public License
+ *    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ *    As a special exception, the copyright holders give permission to link the
+ *    code of portions of this program with the OpenSSL library under certain
+ *    conditions as described in each individual source file and distribute
+ *    linked combinations including the program with the OpenSSL library. You
+ *    must comply with the GNU Affero General Public License in all respects for
+ *    all of the code used other than as permitted herein. If you modify file(s)
+ *    with this exception, you may extend this exception to your version of the
+ *    file(s), but you are not obligated to do so. If you do not wish to do so,
+ *    delete this exception statement from your version. If you delete this
+ *    exception statement from all source files in the program, then also delete
+ *    it in the license file.
+ */
+
+#include "mongo/db/fts/pix_posting_list.h"
+
+#include <vector>
+
+#include "mongo/unittest/unittest.h"
+
+namespace mongo {
+
+using std::vector;
+
+namespace {
+
+DocPosting makePosting(unsigned docid, const vector<unsigned>& posv) {
+    return DocPosting(docid, posv);
+}
+
+}  // namespace
+
+// pack() followed by construction from the packed bytes is lossless.
+TEST(PixPostingList, PackRoundTrip) {
+    PostingList pList("a");
+    pList.insert(makePosting(10, {1, 5, 9}));
+    pList.insert(makePosting(3, {2, 300}));
+    pList.insert(makePosting(200000, {7}));
+
+    vector<unsigned char> block;
+    pList.pack(block);
+
+    PostingList decoded("a", &block[0], block.size());
+    ASSERT_EQUALS(3U, decoded.size());
+
+    PostingList::PostingListIterator it = decoded.begin();
+    ASSERT_EQUALS(3U, it->getDocid());
+    ASSERT_EQUALS(2U, it->getTF());
+    ++it;
+    ASSERT_EQUALS(10U, it->getDocid());
+    vector<unsigned> posv;
+    it->getPositions(posv);
+    ASSERT_EQUALS(3U, posv.size());
+    ASSERT_EQUALS(9U, posv[2]);
+    ++it;
+    ASSERT_EQUALS(200000U, it->getDocid());
+}
+
+// Every block format decodes to the same postings and block headers, findtf included.
+TEST(PixPostingList, PackBlockFormats) {
+    PostingList pList("a");
+    for (unsigned d = 1; d <= 300; ++d) {
+        vector<unsigned> posv;
+        for (unsigned p = 0; p <= d % 5; ++p)
+            posv.push_back(d + 40 * p);
+        pList.append(makePosting(d * 3, posv));
+    }
+    vector<unsigned char> varint;
+    pList.pack(varint);
+    PostingList expected("a", &varint[0], varint.size());
+
+    const PixCodec::BlockFormat formats[] = {PixCodec::kGroupVarint, PixCodec::kBitPack};
+    for (PixCodec::BlockFormat format : formats) {
+        vector<unsigned char> block;
+        pList.pack(block, format);
+
+        vector<PostingList::BlockHeader> headers;
+        ASSERT_TRUE(PostingList::readBlockHeaders(&block[0], block.size(), headers));
+        ASSERT_EQUALS(3U, headers.size());
+        ASSERT_EQUALS(format, headers[0].format);
+        ASSERT_EQUALS(3U, headers[0].firstDocid);
+        ASSERT_EQUALS(5U, headers[1].maxTf);
+        ASSERT_EQUALS(900U, headers[2].lastDocid);
+
+        PostingList decoded("a", &block[0], block.size());
+        ASSERT_EQUALS(expected.size(), decoded.size());
+        for (unsigned i = 0; i < expected.size(); ++i) {
+            ASSERT_EQUALS(expected.begin()[i].compactString(), decoded.begin()[i].compactString());
+        }
+
+        PostingList high;
+        PostingList::findtf(&block[0], block.size(), 2, 3, 5, high);
+        ASSERT_EQUALS(3U, high.size());
+        ASSERT_EQUALS(42U, high.begin()->getDocid());
+        ASSERT_EQUALS(5U, high.begin()->getTF());
+
+        // A truncated list is rejected.
+        headers.clear();
+        ASSERT_FALSE(PostingList::readBlockHeaders(&block[0], block.size() - 1, headers));
+    }
+}
+
+// insert() keeps docid order and replaces an existing docid; remove() drops it.
+TEST(PixPostingList, InsertRemove) {
+    PostingList pList("a");
+    pList.insert(makePosting(5, {1}));
+    pList.insert(makePosting(2, {1}));
+    pList.insert(makePosting(5, {1, 2}));
+    ASSERT_EQUALS(2U, pList.size());
+    ASSERT_EQUALS(2U, pList.begin()->getDocid());
+    ASSERT_EQUALS(2U, (pList.begin() + 1)->getTF());
+
+    ASSERT_TRUE(pList.remove(2));
+    ASSERT_FALSE(pList.remove(2));
+    ASSERT_EQUALS(1U, pList.size());
+}
+
+// Lists long enough to carry skip frames at every level but the last round trip too.
+TEST(PixPostingList, PackRoundTripWithSkips) {
+    PostingList pList("a");
+    for (unsigned d = 1; d <= 1000; ++d) {
+        pList.append(makePosting(d * 3, {d, d + 7}));
+    }
+
+    vector<unsigned char> block;
+    pList.pack(block);
+
+    PostingList decoded("a", &block[0], block.size());
+    ASSERT_EQUALS(1000U, decoded.size());
+    for (unsigned d = 1; d <= 1000; ++d) {
+        ASSERT_EQUALS(d * 3, (decoded.begin() + d - 1)->getDocid());
+    }
+
+    PostingList high;
+    PostingList::findtf(&block[0], block.size(), 10, 5, 2, high);
+    ASSERT_EQUALS(5U, high.size());
+    ASSERT_EQUALS(33U, high.begin()->getDocid());
+}
+
+// pack() cuts the list into blocks of kBlockPostings, each with its docid range and max tf.
+TEST(PixPostingList, PackWritesBlockHeaders) {
+    PostingList pList("a");
+    for (unsigned d = 1; d <= 300; ++d) {
+        vector<unsigned> posv(d == 200 ? 7 : 1, 1);
+        for (unsigned i = 0; i < posv.size(); ++i)
+            posv[i] = i + 1;
+        pList.append(makePosting(d * 2, posv));
+    }
+
+    vector<unsigned char> block;
+    pList.pack(block);
+
+    vector<PostingList::BlockHeader> headers;
+    ASSERT_TRUE(PostingList::readBlockHeaders(&block[0], block.size(), headers));
+    ASSERT_EQUALS(3U, headers.size());
+    ASSERT_EQUALS(2U, headers[0].firstDocid);
+    ASSERT_EQUALS(256U, headers[0].lastDocid);
+    ASSERT_EQUALS(1U, headers[0].maxTf);
+    ASSERT_EQUALS(258U, headers[1].firstDocid);
+    ASSERT_EQUALS(7U, headers[1].maxTf);
+    ASSERT_EQUALS(600U, headers[2].lastDocid);
+    ASSERT_TRUE(headers[2].data + headers[2].length == &block[0] + block.size());
+
+    // Only the middle block has a posting with tf >= 2.
+    PostingList high;
+    PostingList::findtf(&block[0], block.size(), 0, 10, 2, high);
+    ASSERT_EQUALS(1U, high.size());
+    ASSERT_EQUALS(400U, high.begin()->getDocid());
+
+    // A truncated list is rejected.
+    headers.clear();
+    ASSERT_FALSE(PostingList::readBlockHeaders(&block[0], block.size() - 1, headers));
+}
+
+// A rare term intersected with a common one, in both argument orders.
+TEST(PixPostingList, AndRareWithCommon) {
+    PostingList common("common");
+    for (unsigned d = 1; d <= 5000; ++d) {
+        common.append(makePosting(d, {1}));
+    }
+    PostingList rare("rare");
+    rare.append(makePosting(7, {2}));
+    rare.append(makePosting(4096, {2}));
+    rare.append(makePosting(9000, {2}));
+
+    PostingList result1;
+    PostingList::_and(rare, common, result1);
+    ASSERT_EQUALS(2U, result1.size());
+    ASSERT_EQUALS(4096U, (result1.begin() + 1)->getDocid());
+
+    PostingList result2;
+    PostingList::_and(common, rare, result2);
+    ASSERT_EQUALS(2U, result2.size());
+
+    PostingList notRare;
+    PostingList::_andnot(common, rare, notRare);
+    ASSERT_EQUALS(4998U, notRare.size());
+}
+
+TEST(PixPostingList, AndOrAndNot) {
+    PostingList a("a");
+    a.insert(makePosting(1, {1}));
+    a.insert(makePosting(2, {1}));
+    a.insert(makePosting(4, {1}));
+    PostingList b("b");
+    b.insert(makePosting(2, {3}));
+    b.insert(makePosting(3, {3}));
+
+    PostingList andList;
+    PostingList::_and(a, b, andList);
+    ASSERT_EQUALS(1U, andList.size());
+    ASSERT_EQUALS(2U, andList.begin()->getDocid());
+
+    PostingList orList;
+    PostingList::_or(a, b, orList);
+    ASSERT_EQUALS(4U, orList.size());
+
+    PostingList andNotList;
+    PostingList::_andnot(a, b, andNotList);
+    ASSERT_EQUALS(2U, andNotList.size());
+
+    PostingList accrued;
+    PostingList::_accrue(a, b, accrued);
+    ASSERT_EQUALS(4U, accrued.size());
+    ASSERT_EQUALS(2.0f, (accrued.begin() + 1)->getScore());
+}
+
+TEST(PixPostingList, PhraseAndNear) {
+    PostingList a("a");
+    a.insert(makePosting(1, {4, 20}));
+    a.insert(makePosting(2, {4}));
+    PostingList b("b");
+    b.insert(makePosting(1, {21}));
+    b.insert(makePosting(2, {8}));
+
+    vector<PostingList*> terms = {&a, &b};
+    PostingList phrase;
+    PostingList::_phrase(terms, phrase);
+    ASSERT_EQUALS(1U, phrase.size());
+    ASSERT_EQUALS(1U, phrase.begin()->getDocid());
+
+    PostingList nearList;
+    PostingList::_near(a, b, 4, nearList);
+    ASSERT_EQUALS(2U, nearList.size());
+
+    PostingList tight;
+    PostingList::_near(a, b, 1, tight);
+    ASSERT_EQUALS(1U, tight.size());
+}
+
+}  // namespace mongo
@@ -29,9 +29,13 @@
 */
 
 #include <cstdlib>
+#include <deque>
 #include <string>
+#include <unordered_map>
 
 #include "mongo/db/fts/stemmer.h"
+#include "mongo/platform/atomic_word.h"
+#include "mongo/util/concurrency/threadlocal.h"
 #include "mongo/util/mongoutils/str.h"
 
 namespace mongo {
@@ -40,7 +44,83 @@ namespace fts {
 
 using std::string;
 
-Stemmer::Stemmer(const FTSLanguage* language) {
+namespace {
+
+// Stems cached by all threads.
+AtomicWord<long long> totalCachedStems(0);
+
+/**
+ * Stems computed by the current thread, per language.  Emptied whenever it reaches
+ * Stemmer::kMaxCachedStems entries, or the caches of all threads reach
+ * Stemmer::kMaxTotalCachedStems; the words that recur are soon cached again.
+ *
+ * The keys point into the words held by _entries, so that a lookup needs no copy of the word.
+ */
+class StemCache {
+public:
+    ~StemCache() {
+        clear();
+    }
+
+    const string* find(const FTSLanguage* language, StringData word) const {
+        auto langIt = _stems.find(language);
+        if (langIt == _stems.end())
+            return NULL;
+        auto it = langIt->second.find(word);
+        return it == langIt->second.end() ? NULL : it->second;
+    }
+
+    /**
+     * Caches 'stem' as the stem of 'word' unless the caches of all threads are full.
+     */
+    void insert(const FTSLanguage* language, StringData word, StringData stem) {
+        if (_entries.size() >= Stemmer::kMaxCachedStems ||
+            totalCachedStems.load() >= static_cast<long long>(Stemmer::kMaxTotalCachedStems)) {
+            clear();
+            if (totalCachedStems.load() >= static_cast<long long>(Stemmer::kMaxTotalCachedStems))
+                return;
+        }
+
+        _entries.push_back(Entry{word.toString(), stem.toString()});
+        const Entry& entry = _entries.back();
+        _stems[language][StringData(entry.word)] = &entry.stem;
+        totalCachedStems.fetchAndAdd(1);
+    }
+
+    size_t size() const {
+        return _entries.size();
+    }
+
+private:
+    struct Entry {
+        string word;
+        string stem;
+    };
+
+    void clear() {
+        totalCachedStems.fetchAndSubtract(_entries.size());
+        _stems.clear();
+        _entries.clear();
+    }
+
+    // A deque does not move its elements as it grows.
+    std::deque<Entry> _entries;
+    std::unordered_map<const FTSLanguage*,
+                       std::unordered_map<StringData, const string*, StringData::Hasher>> _stems;
+};
+
+}  // namespace
+}  // namespace fts
+
+TSP_DECLARE(fts::StemCache, stemCache);
+TSP_DEFINE(fts::StemCache, stemCache);
+
+namespace fts {
+
+const size_t Stemmer::kMaxCachedStems;
+const size_t Stemmer::kMaxTotalCachedStems;
+
+Stemmer::Stemmer(const FTSLanguage* language) : _language(language) {
     _stemmer = NULL;
     if (language->str() != "none")
         _stemmer = sb_stemmer_new(language->str().c_str(), "UTF_8");
@@ -53,9 +133,13 @@ Stemmer::~Stemmer() {
     }
 }
 
-string Stemmer::stem(StringData word) const {
+StringData Stemmer::stem(StringData word) const {
     if (!_stemmer)
-        return word.toString();
+        return word;
+
+    StemCache* cache = stemCache.getMake();
+    if (const string* cached = cache->find(_language, word))
+        return *cached;
 
     const sb_symbol* sb_sym =
         sb_stemmer_stem(_stemmer, (const sb_symbol*)word.rawData(), word.size());
@@ -65,7 +149,16 @@ string Stemmer::stem(StringData word) const {
         invariant(false);
     }
 
-    return string((const char*)(sb_sym), sb_stemmer_length(_stemmer));
+    // Valid until the next call to sb_stemmer_stem on this stemmer, which is only used by the
+    // calling thread.
+    StringData stemmed((const char*)(sb_sym), sb_stemmer_length(_stemmer));
+    cache->insert(_language, word, stemmed);
+    return stemmed;
+}
+
+size_t Stemmer::threadCacheSize() {
+    StemCache* cache = stemCache.get();
+    return cache ? cache->size() : 0;
 }
 }
 }
@@ -45,6 +45,12 @@ namespace fts {
  * maintains case
  * but works
  * running/Running -> run/Run
+ *
+ * Stems are remembered in a per-thread cache keyed on the language and the word, since the same
+ * words recur across the documents a thread indexes and sb_stemmer_stem is costly.  Each thread,
+ * and so each connection, caches at most kMaxCachedStems stems, about 1.5MB with typical words;
+ * all threads together cache at most kMaxTotalCachedStems, past which a thread empties its own
+ * cache and stems uncached until the total falls.
  */
 class Stemmer {
     MONGO_DISALLOW_COPYING(Stemmer);
@@ -53,9 +59,23 @@ public:
     Stemmer(const FTSLanguage* language);
     ~Stemmer();
 
-    std::string stem(StringData word) const;
+    /**
+     * Returns the stem of 'word'.  The result is only valid until the next call to stem() on the
+     * calling thread, or for the "none" language, as long as 'word'.
+     */
+    StringData stem(StringData word) const;
+
+    /**
+     * Number of stems cached for the calling thread, across all languages.
+     */
+    static size_t threadCacheSize();
+
+    // Bounds on the number of stems each thread caches, and all threads together.
+    static const size_t kMaxCachedStems = 16 * 1024;
+    static const size_t kMaxTotalCachedStems = 1024 * 1024;
 
 private:
+    const FTSLanguage* _language;
     struct sb_stemmer* _stemmer;
 };
 }
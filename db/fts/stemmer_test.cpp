@@ -43,6 +43,29 @@ TEST(English, Stemmer1) {
     ASSERT_EQUALS("Run", s.stem("Running"));
 }
 
+TEST(English, Cached) {
+    Stemmer english(&languageEnglishV2);
+    Stemmer french(&languageFrenchV2);
+
+    ASSERT_EQUALS("run", english.stem("running"));
+    size_t cached = Stemmer::threadCacheSize();
+    ASSERT_EQUALS("run", english.stem("running"));
+    ASSERT_EQUALS(cached, Stemmer::threadCacheSize());
+
+    // The same word is cached separately for each language.
+    french.stem("running");
+    ASSERT_EQUALS(cached + 1, Stemmer::threadCacheSize());
+}
+
+TEST(English, CacheBound) {
+    Stemmer s(&languageEnglishV2);
+    for (size_t i = 0; i < Stemmer::kMaxCachedStems + 10; i++) {
+        s.stem(std::string("walking") + std::to_string(i));
+    }
+    ASSERT_LESS_THAN_OR_EQUALS(Stemmer::threadCacheSize(), Stemmer::kMaxCachedStems);
+    ASSERT_EQUALS("walk", s.stem("walking"));
+}
+
 TEST(English, Caps) {
     Stemmer s(&languagePorterV1);
     ASSERT_EQUALS("unit", s.stem("united"));
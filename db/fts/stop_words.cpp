@@ -28,19 +28,21 @@
 *    it in the license file.
 */
 
+#include <algorithm>
 #include <set>
 #include <string>
 
 #include "mongo/db/fts/stop_words.h"
 
 #include "mongo/base/init.h"
+#include "mongo/util/assert_util.h"
 #include "mongo/util/string_map.h"
 
 namespace mongo {
 
 namespace fts {
 
-void loadStopWordMap(StringMap<std::set<std::string>>* m);
+void loadStopWordTables(StringMap<StopWords::Table>* m);
 
 namespace {
 StringMap<std::shared_ptr<StopWords>> StopWordsMap;
@@ -48,11 +50,71 @@ StopWords empty;
 }
 
 
-StopWords::StopWords() {}
+StopWords::StopWords() : _table{nullptr, nullptr, nullptr, 0} {}
 
-StopWords::StopWords(const std::set<std::string>& words) {
-    for (std::set<std::string>::const_iterator i = words.begin(); i != words.end(); ++i)
-        _words.insert(*i);
+StopWords::StopWords(const Table& table) : _table(table) {}
+
+StopWords::StopWords(const std::set<std::string>& words)
+    : _words(words.size()),
+      _wordData(words.size()),
+      _sizes(words.size()),
+      _displacements(words.size()) {
+    // The same construction as generate_stop_words.py: place the largest buckets first, each
+    // with the first seed that puts its words in free slots, then the single-word buckets.
+    const uint32_t n = words.size();
+    std::vector<std::vector<const std::string*>> buckets(n);
+    for (const std::string& word : words) {
+        buckets[hash(word, 0) % n].push_back(&word);
+    }
+
+    std::vector<uint32_t> order(n);
+    for (uint32_t b = 0; b < n; ++b) {
+        order[b] = b;
+    }
+    std::stable_sort(order.begin(), order.end(), [&buckets](uint32_t a, uint32_t b) {
+        return buckets[a].size() > buckets[b].size();
+    });
+
+    std::vector<bool> taken(n, false);
+    std::vector<uint32_t> slots;
+    size_t i = 0;
+    for (; i < n && buckets[order[i]].size() > 1; ++i) {
+        const std::vector<const std::string*>& bucket = buckets[order[i]];
+        for (uint32_t seed = 1;; ++seed) {
+            invariant(seed < static_cast<uint32_t>(INT32_MAX));
+            slots.clear();
+            for (const std::string* word : bucket) {
+                uint32_t slot = hash(*word, seed) % n;
+                if (taken[slot] || std::find(slots.begin(), slots.end(), slot) != slots.end())
+                    break;
+                slots.push_back(slot);
+            }
+            if (slots.size() < bucket.size())
+                continue;
+
+            for (size_t j = 0; j < bucket.size(); ++j) {
+                taken[slots[j]] = true;
+                _words[slots[j]] = *bucket[j];
+            }
+            _displacements[order[i]] = seed;
+            break;
+        }
+    }
+
+    uint32_t freeSlot = 0;
+    for (; i < n && buckets[order[i]].size() == 1; ++i) {
+        while (taken[freeSlot])
+            ++freeSlot;
+        taken[freeSlot] = true;
+        _words[freeSlot] = *buckets[order[i]][0];
+        _displacements[order[i]] = -static_cast<int32_t>(freeSlot) - 1;
+    }
+
+    for (uint32_t slot = 0; slot < n; ++slot) {
+        _wordData[slot] = _words[slot].data();
+        _sizes[slot] = _words[slot].size();
+    }
+    _table = Table{_wordData.data(), _sizes.data(), _displacements.data(), n};
 }
 
 const StopWords* StopWords::getStopWords(const FTSLanguage* language) {
@@ -64,9 +126,9 @@ const StopWords* StopWords::getStopWords(const FTSLanguage* language) {
 
 
 MONGO_INITIALIZER(StopWords)(InitializerContext* context) {
-    StringMap<std::set<std::string>> raw;
-    loadStopWordMap(&raw);
-    for (StringMap<std::set<std::string>>::const_iterator i = raw.begin(); i != raw.end(); ++i) {
+    StringMap<StopWords::Table> tables;
+    loadStopWordTables(&tables);
+    for (StringMap<StopWords::Table>::const_iterator i = tables.begin(); i != tables.end(); ++i) {
         StopWordsMap[i->first].reset(new StopWords(i->second));
     }
     return Status::OK();
@@ -31,35 +31,81 @@
 
 #pragma once
 
+#include <cstdint>
 #include <set>
 #include <string>
+#include <vector>
 
+#include "mongo/base/disallow_copying.h"
+#include "mongo/base/string_data.h"
 #include "mongo/db/fts/fts_language.h"
-#include "mongo/platform/unordered_set.h"
 
 namespace mongo {
 
 namespace fts {
 
+/**
+ * A fixed set of stop words held in a minimal perfect hash table, probed with a StringData so
+ * that checking a token allocates nothing.
+ *
+ * A word hashes with seed 0 to one of numWords buckets.  A negative displacement -(slot + 1)
+ * names the word's slot directly; otherwise the displacement is the seed that spreads the
+ * words of that bucket over distinct slots.  Every probe costs two hashes at most and one
+ * comparison.  The tables of the built-in lists are written by generate_stop_words.py.
+ */
 class StopWords {
     MONGO_DISALLOW_COPYING(StopWords);
 
 public:
+    /**
+     * The arrays of a perfect hash table, all of them numWords long.  Not owned.
+     */
+    struct Table {
+        const char* const* words;      // indexed by slot
+        const uint32_t* sizes;         // byte length of each word
+        const int32_t* displacements;  // indexed by bucket
+        uint32_t numWords;
+    };
+
     StopWords();
+    explicit StopWords(const Table& table);
     StopWords(const std::set<std::string>& words);
 
-    bool isStopWord(const std::string& word) const {
-        return _words.count(word) > 0;
+    bool isStopWord(StringData word) const {
+        if (_table.numWords == 0)
+            return false;
+        int32_t d = _table.displacements[hash(word, 0) % _table.numWords];
+        uint32_t slot = d < 0 ? static_cast<uint32_t>(-d - 1)
+                              : hash(word, static_cast<uint32_t>(d)) % _table.numWords;
+        return word == StringData(_table.words[slot], _table.sizes[slot]);
     }
 
     size_t numStopWords() const {
-        return _words.size();
+        return _table.numWords;
     }
 
     static const StopWords* getStopWords(const FTSLanguage* language);
 
+    /**
+     * Seeded 32-bit FNV-1a; generate_stop_words.py computes the same function.
+     */
+    static uint32_t hash(StringData word, uint32_t seed) {
+        uint32_t h = 2166136261U ^ seed;
+        for (size_t i = 0; i < word.size(); ++i) {
+            h ^= static_cast<unsigned char>(word[i]);
+            h *= 16777619U;
+        }
+        return h;
+    }
+
 private:
-    unordered_set<std::string> _words;
+    Table _table;
+
+    // Backing storage of a table built at runtime from a set of words.
+    std::vector<std::string> _words;
+    std::vector<const char*> _wordData;
+    std::vector<uint32_t> _sizes;
+    std::vector<int32_t> _displacements;
 };
 }
 }
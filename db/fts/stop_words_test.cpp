@@ -31,6 +31,7 @@
 #include "mongo/db/fts/fts_spec.h"
 #include "mongo/db/fts/stop_words.h"
 #include "mongo/unittest/unittest.h"
+#include "mongo/util/mongoutils/str.h"
 
 namespace mongo {
 namespace fts {
@@ -40,5 +41,44 @@ TEST(English, Basic1) {
     ASSERT(englishStopWords->isStopWord("the"));
     ASSERT(!englishStopWords->isStopWord("computer"));
 }
+
+TEST(English, ProbeWithoutTerminator) {
+    const StopWords* englishStopWords = StopWords::getStopWords(&languageEnglishV2);
+    StringData text("thesis");
+    ASSERT(englishStopWords->isStopWord(text.substr(0, 3)));
+    ASSERT(!englishStopWords->isStopWord(text));
+    ASSERT(!englishStopWords->isStopWord(StringData()));
+}
+
+TEST(Russian, Basic1) {
+    const StopWords* russianStopWords =
+        StopWords::getStopWords(FTSLanguage::make("russian", TEXT_INDEX_VERSION_2).getValue());
+    ASSERT(russianStopWords->isStopWord("\xd0\xb8"));  // и
+    ASSERT(!russianStopWords->isStopWord("\xd0\xba\xd0\xbe\xd1\x82"));  // кот
+}
+
+TEST(StopWords, Empty) {
+    StopWords empty;
+    ASSERT_EQUALS(0U, empty.numStopWords());
+    ASSERT(!empty.isStopWord("the"));
+    ASSERT(!empty.isStopWord(""));
+}
+
+TEST(StopWords, FromSet) {
+    std::set<std::string> words;
+    for (int i = 0; i < 500; ++i) {
+        words.insert(mongoutils::str::stream() << "w" << i);
+    }
+    StopWords stopWords(words);
+    ASSERT_EQUALS(words.size(), stopWords.numStopWords());
+    for (const std::string& word : words) {
+        ASSERT(stopWords.isStopWord(word));
+    }
+    for (int i = 500; i < 1000; ++i) {
+        std::string word = mongoutils::str::stream() << "w" << i;
+        ASSERT(!stopWords.isStopWord(word));
+    }
+    ASSERT(!stopWords.isStopWord("w"));
+}
 }
 }
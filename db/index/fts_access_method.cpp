@@ -31,11 +31,47 @@
 #include "mongo/platform/basic.h"
 
 #include "mongo/db/index/fts_access_method.h"
+#include "mongo/db/fts/fts_index_format.h"
 #include "mongo/db/index/expression_keys_private.h"
+#include "mongo/db/operation_context.h"
+#include "mongo/db/server_parameters.h"
+#include "mongo/db/storage/recovery_unit.h"
 #include "mongo/util/log.h"
 
 namespace mongo {
 
+// Threads generating keys during a bulk text index build.
+MONGO_EXPORT_SERVER_PARAMETER(textIndexBuildWorkers, int, 4);
+
+namespace {
+
+/**
+ * Counts one text index key in the term statistics once its write unit of work commits.
+ */
+class TermStatsChange : public RecoveryUnit::Change {
+public:
+    TermStatsChange(fts::FTSTermStats* stats, std::string term, double weight, int count)
+        : _stats(stats), _term(std::move(term)), _weight(weight), _count(count) {}
+
+    void commit() final {
+        _stats->update(_term, _weight, _count);
+    }
+
+    void rollback() final {}
+
+private:
+    fts::FTSTermStats* const _stats;
+    const std::string _term;
+    const double _weight;
+    const int _count;
+};
+
+bool hasTermStats(const fts::FTSSpec& spec) {
+    return !spec.proximityIndex() && !spec.pixIndex();
+}
+
+}  // namespace
+
 FTSAccessMethod::FTSAccessMethod(IndexCatalogEntry* btreeState, SortedDataInterface* btree)
     : IndexAccessMethod(btreeState, btree), _ftsSpec(btreeState->descriptor()->infoObj()) {}
 
@@ -43,4 +79,91 @@ void FTSAccessMethod::getKeys(const BSONObj& obj, BSONObjSet* keys) const {
     ExpressionKeysPrivate::getFTSKeys(obj, _ftsSpec, keys);
 }
 
+std::unique_ptr<IndexAccessMethod::BulkBuilder> FTSAccessMethod::initiateBulk() {
+    return initiateParallelBulk(textIndexBuildWorkers);
+}
+
+void FTSAccessMethod::getBulkKeys(const BSONObj& obj,
+                                  const RecordId& loc,
+                                  BSONObjSet* keys) const {
+    if (!_ftsSpec.proximityIndex()) {
+        getKeys(obj, keys);
+        return;
+    }
+
+    BSONObjSet generated;
+    getKeys(obj, &generated);
+    for (const BSONObj& key : generated) {
+        keys->insert(fts::FTSIndexFormat::getProximityStoredKey(key, loc));
+    }
+}
+
+Status FTSAccessMethod::insertKey(OperationContext* txn,
+                                  const BSONObj& key,
+                                  const RecordId& loc,
+                                  bool dupsAllowed) {
+    if (_ftsSpec.proximityIndex()) {
+        return IndexAccessMethod::insertKey(
+            txn, fts::FTSIndexFormat::getProximityStoredKey(key, loc), loc, dupsAllowed);
+    }
+
+    Status status = IndexAccessMethod::insertKey(txn, key, loc, dupsAllowed);
+    if (status.isOK())
+        _recordTermKey(txn, key, 1);
+    return status;
+}
+
+void FTSAccessMethod::unindexKey(OperationContext* txn,
+                                 const BSONObj& key,
+                                 const RecordId& loc,
+                                 bool dupsAllowed) {
+    if (_ftsSpec.proximityIndex()) {
+        IndexAccessMethod::unindexKey(
+            txn, fts::FTSIndexFormat::getProximityStoredKey(key, loc), loc, dupsAllowed);
+        return;
+    }
+
+    IndexAccessMethod::unindexKey(txn, key, loc, dupsAllowed);
+    _recordTermKey(txn, key, -1);
+}
+
+const fts::FTSTermStats* FTSAccessMethod::getTermStats() const {
+    return hasTermStats(_ftsSpec) ? &_termStats : nullptr;
+}
+
+Status FTSAccessMethod::seedTermStats(OperationContext* txn) {
+    if (!hasTermStats(_ftsSpec)) {
+        return Status(ErrorCodes::BadValue, "term statistics are not kept for this text index");
+    }
+
+    _termStats.clear();
+    auto cursor = newCursor(txn, true);
+    for (auto kv = cursor->seek(BSONObj(), true, SortedDataInterface::Cursor::kWantKey); kv;
+         kv = cursor->next(SortedDataInterface::Cursor::kWantKey)) {
+        // Keys come back without field names: {prefix, term, score, suffix}.
+        BSONObjIterator it(kv->key);
+        for (unsigned i = 0; i < _ftsSpec.numExtraBefore(); i++) {
+            it.next();
+        }
+        std::string term = it.next().String();
+        _termStats.update(term, it.next().number(), 1);
+    }
+    _termStats.setSeeded();
+    return Status::OK();
+}
+
+void FTSAccessMethod::_recordTermKey(OperationContext* txn, const BSONObj& key, int count) {
+    if (_ftsSpec.pixIndex())
+        return;
+
+    // Locate term and score within possibly compound key: {prefix, term, score, suffix}.
+    BSONObjIterator it(key);
+    for (unsigned i = 0; i < _ftsSpec.numExtraBefore(); i++) {
+        it.next();
+    }
+    std::string term = it.next().String();
+    double weight = it.next().number();
+    txn->recoveryUnit()->registerChange(new TermStatsChange(&_termStats, term, weight, count));
+}
+
 }  // namespace mongo
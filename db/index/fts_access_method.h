@@ -30,6 +30,7 @@
 
 #include "mongo/base/status.h"
 #include "mongo/db/fts/fts_spec.h"
+#include "mongo/db/fts/fts_term_stats.h"
 #include "mongo/db/index/index_access_method.h"
 #include "mongo/db/index/index_descriptor.h"
 #include "mongo/db/jsobj.h"
@@ -45,11 +46,55 @@ public:
         return _ftsSpec;
     }
 
+    /**
+     * Tokenizing dominates the cost of building a text index, so bulk builds generate keys on
+     * textIndexBuildWorkers threads.
+     */
+    virtual std::unique_ptr<BulkBuilder> initiateBulk();
+
+    /**
+     * For a proximity index, the stored {term, RecordId, pos} keys (see insertKey()).
+     */
+    virtual void getBulkKeys(const BSONObj& obj, const RecordId& loc, BSONObjSet* keys) const;
+
+    /**
+     * Per-term statistics of a regular text index, maintained as documents are indexed and
+     * unindexed, or nullptr for proximity and pix indexes.
+     */
+    const fts::FTSTermStats* getTermStats() const;
+
+    /**
+     * Recounts the term statistics from a scan of the whole index.  The caller must hold the
+     * collection lock in a mode that excludes writers.
+     */
+    Status seedTermStats(OperationContext* txn);
+
+protected:
+    /**
+     * For a proximity index, stores each {term, pos} key as {term, RecordId, pos} so that
+     * the documents of a term are scanned in RecordId order.
+     */
+    virtual Status insertKey(OperationContext* txn,
+                             const BSONObj& key,
+                             const RecordId& loc,
+                             bool dupsAllowed);
+
+    virtual void unindexKey(OperationContext* txn,
+                            const BSONObj& key,
+                            const RecordId& loc,
+                            bool dupsAllowed);
+
 private:
     // Implemented:
     virtual void getKeys(const BSONObj& obj, BSONObjSet* keys) const;
 
+    /**
+     * Applies a key of a regular text index to the term statistics when 'txn' commits.
+     */
+    void _recordTermKey(OperationContext* txn, const BSONObj& key, int count);
+
     fts::FTSSpec _ftsSpec;
+    fts::FTSTermStats _termStats;
 };
 
 }  // namespace mongo
@@ -32,6 +32,7 @@
 
 #include "mongo/db/index/btree_access_method.h"
 
+#include <deque>
 #include <vector>
 
 #include "mongo/base/error_codes.h"
@@ -44,6 +45,9 @@
 #include "mongo/db/operation_context.h"
 #include "mongo/db/server_parameters.h"
 #include "mongo/db/storage/storage_options.h"
+#include "mongo/stdx/condition_variable.h"
+#include "mongo/stdx/mutex.h"
+#include "mongo/stdx/thread.h"
 #include "mongo/util/log.h"
 #include "mongo/util/progress_meter.h"
 
@@ -115,7 +119,7 @@ Status IndexAccessMethod::insert(OperationContext* txn,
 
     Status ret = Status::OK();
     for (BSONObjSet::const_iterator i = keys.begin(); i != keys.end(); ++i) {
-        Status status = _newInterface->insert(txn, *i, loc, options.dupsAllowed);
+        Status status = insertKey(txn, *i, loc, options.dupsAllowed);
 
         if (iam_debug)  // @@@proximity
             std::cout << "index insert(" << loc.repr() << ", " << i->toString(0,0) << ")" << std::endl;
@@ -162,7 +166,7 @@ void IndexAccessMethod::removeOneKey(OperationContext* txn,
                                      const RecordId& loc,
                                      bool dupsAllowed) {
     try {
-        _newInterface->unindex(txn, key, loc, dupsAllowed);
+        unindexKey(txn, key, loc, dupsAllowed);
     } catch (AssertionException& e) {
         log() << "Assertion failure: _unindex failed " << _descriptor->indexNamespace() << endl;
         log() << "Assertion failure: _unindex failed: " << e.what() << "  key:" << key.toString()
@@ -171,6 +175,20 @@ void IndexAccessMethod::removeOneKey(OperationContext* txn,
     }
 }
 
+Status IndexAccessMethod::insertKey(OperationContext* txn,
+                                    const BSONObj& key,
+                                    const RecordId& loc,
+                                    bool dupsAllowed) {
+    return _newInterface->insert(txn, key, loc, dupsAllowed);
+}
+
+void IndexAccessMethod::unindexKey(OperationContext* txn,
+                                   const BSONObj& key,
+                                   const RecordId& loc,
+                                   bool dupsAllowed) {
+    _newInterface->unindex(txn, key, loc, dupsAllowed);
+}
+
 std::unique_ptr<SortedDataInterface::Cursor> IndexAccessMethod::newCursor(OperationContext* txn,
                                                                           bool isForward) const {
     return _newInterface->newCursor(txn, isForward);
@@ -196,6 +214,7 @@ Status IndexAccessMethod::remove(OperationContext* txn,
         ++*numDeleted;
     }
 
+    unindexDocument(txn, loc);
     return Status::OK();
 }
 
@@ -310,12 +329,11 @@ Status IndexAccessMethod::update(OperationContext* txn,
     }
 
     for (size_t i = 0; i < ticket.removed.size(); ++i) {
-        _newInterface->unindex(txn, *ticket.removed[i], ticket.loc, ticket.dupsAllowed);
+        unindexKey(txn, *ticket.removed[i], ticket.loc, ticket.dupsAllowed);
     }
 
     for (size_t i = 0; i < ticket.added.size(); ++i) {
-        Status status =
-            _newInterface->insert(txn, *ticket.added[i], ticket.loc, ticket.dupsAllowed);
+        Status status = insertKey(txn, *ticket.added[i], ticket.loc, ticket.dupsAllowed);
         if (!status.isOK()) {
             if (status.code() == ErrorCodes::KeyTooLong && ignoreKeyTooLong(txn)) {
                 // Ignore.
@@ -331,17 +349,212 @@ Status IndexAccessMethod::update(OperationContext* txn,
     return Status::OK();
 }
 
+namespace {
+
+const size_t kBulkSortMemoryBytes = 100 * 1024 * 1024;
+
+SortOptions bulkSortOptions(size_t maxMemoryUsageBytes) {
+    return SortOptions()
+        .TempDir(storageGlobalParams.dbpath + "/_tmp")
+        .ExtSortAllowed()
+        .MaxMemoryUsageBytes(maxMemoryUsageBytes);
+}
+
+/**
+ * A BulkBuilder that generates keys on a pool of worker threads.
+ *
+ * insert() copies documents into batches that are queued for the workers.  Each worker runs
+ * getBulkKeys() and adds the keys to a Sorter of its own, which spills sorted runs to disk once
+ * it exceeds its share of the memory budget.  done() merges the output of all the workers into
+ * one sorted stream, so commitBulk() still writes the index in a single pass.
+ */
+class ParallelBulkBuilder final : public IndexAccessMethod::BulkBuilder {
+public:
+    ParallelBulkBuilder(const IndexAccessMethod* index,
+                        const IndexDescriptor* descriptor,
+                        size_t numWorkers)
+        : BulkBuilder(index),
+          _sortOptions(bulkSortOptions(kBulkSortMemoryBytes / numWorkers)),
+          _comparison(descriptor->keyPattern(), descriptor->version()),
+          _maxQueuedBatches(2 * numWorkers) {
+        for (size_t i = 0; i < numWorkers; i++) {
+            _workers.emplace_back(new Worker(Sorter::make(_sortOptions, _comparison)));
+        }
+        for (auto& worker : _workers) {
+            Worker* w = worker.get();
+            w->thread = stdx::thread([this, w] { _run(w); });
+        }
+    }
+
+    ~ParallelBulkBuilder() {
+        _shutdown();
+    }
+
+    /**
+     * Keys are generated later on a worker, so 'numInserted' is not updated.
+     */
+    Status insert(OperationContext* txn,
+                  const BSONObj& obj,
+                  const RecordId& loc,
+                  const InsertDeleteOptions& options,
+                  int64_t* numInserted) override {
+        _batch.emplace_back(obj.getOwned(), loc);
+        if (_batch.size() < kBatchDocs) {
+            return Status::OK();
+        }
+        return _push();
+    }
+
+protected:
+    Status done(std::unique_ptr<Sorter::Iterator>* sorted) override {
+        if (!_batch.empty()) {
+            _push();
+        }
+        _shutdown();
+        if (!_error.isOK()) {
+            return _error;
+        }
+
+        std::vector<std::shared_ptr<Sorter::Iterator>> runs;
+        for (auto& worker : _workers) {
+            _keysInserted += worker->keysInserted;
+            _isMultiKey = _isMultiKey || worker->isMultiKey;
+            runs.emplace_back(worker->sorter->done());
+        }
+        sorted->reset(Sorter::Iterator::merge(runs, _sortOptions, _comparison));
+        return Status::OK();
+    }
+
+private:
+    using Batch = std::vector<std::pair<BSONObj, RecordId>>;
+
+    // Documents handed to a worker at a time.
+    static const size_t kBatchDocs = 128;
+
+    struct Worker {
+        explicit Worker(Sorter* s) : sorter(s) {}
+
+        std::unique_ptr<Sorter> sorter;
+        int64_t keysInserted = 0;
+        bool isMultiKey = false;
+        stdx::thread thread;
+    };
+
+    Status _push() {
+        stdx::unique_lock<stdx::mutex> lk(_mutex);
+        while (_queue.size() >= _maxQueuedBatches && _error.isOK()) {
+            _spaceAvailable.wait(lk);
+        }
+        if (!_error.isOK()) {
+            return _error;
+        }
+        _queue.push_back(std::move(_batch));
+        _batch.clear();
+        _workAvailable.notify_one();
+        return Status::OK();
+    }
+
+    void _run(Worker* worker) {
+        while (true) {
+            Batch batch;
+            {
+                stdx::unique_lock<stdx::mutex> lk(_mutex);
+                while (_queue.empty() && !_closed) {
+                    _workAvailable.wait(lk);
+                }
+                if (_queue.empty()) {
+                    return;
+                }
+                batch = std::move(_queue.front());
+                _queue.pop_front();
+                _spaceAvailable.notify_one();
+
+                // After a failure the remaining batches are only drained.
+                if (!_error.isOK()) {
+                    continue;
+                }
+            }
+
+            try {
+                for (const auto& doc : batch) {
+                    BSONObjSet keys;
+                    _real->getBulkKeys(doc.first, doc.second, &keys);
+                    worker->isMultiKey = worker->isMultiKey || (keys.size() > 1);
+                    for (const BSONObj& key : keys) {
+                        worker->sorter->add(key, doc.second);
+                    }
+                    worker->keysInserted += keys.size();
+                }
+            } catch (const DBException& e) {
+                _fail(e.toStatus());
+            } catch (const std::exception& e) {
+                _fail(Status(ErrorCodes::InternalError, e.what()));
+            }
+        }
+    }
+
+    void _fail(Status status) {
+        stdx::lock_guard<stdx::mutex> lk(_mutex);
+        if (_error.isOK()) {
+            _error = std::move(status);
+        }
+        _spaceAvailable.notify_all();
+    }
+
+    void _shutdown() {
+        {
+            stdx::lock_guard<stdx::mutex> lk(_mutex);
+            if (_closed) {
+                return;
+            }
+            _closed = true;
+            _workAvailable.notify_all();
+        }
+        for (auto& worker : _workers) {
+            worker->thread.join();
+        }
+    }
+
+    const SortOptions _sortOptions;
+    const BtreeExternalSortComparison _comparison;
+    const size_t _maxQueuedBatches;
+    std::vector<std::unique_ptr<Worker>> _workers;
+
+    // Only touched by the thread calling insert() and done().
+    Batch _batch;
+
+    stdx::mutex _mutex;
+    stdx::condition_variable _workAvailable;
+    stdx::condition_variable _spaceAvailable;
+    std::deque<Batch> _queue;
+    bool _closed = false;
+    Status _error = Status::OK();
+};
+
+}  // namespace
+
 std::unique_ptr<IndexAccessMethod::BulkBuilder> IndexAccessMethod::initiateBulk() {
     return std::unique_ptr<BulkBuilder>(new BulkBuilder(this, _descriptor));
 }
 
+std::unique_ptr<IndexAccessMethod::BulkBuilder> IndexAccessMethod::initiateParallelBulk(
+    int numWorkers) {
+    if (numWorkers <= 1) {
+        return IndexAccessMethod::initiateBulk();
+    }
+    return std::unique_ptr<BulkBuilder>(new ParallelBulkBuilder(this, _descriptor, numWorkers));
+}
+
+void IndexAccessMethod::getBulkKeys(const BSONObj& obj,
+                                    const RecordId& loc,
+                                    BSONObjSet* keys) const {
+    getKeys(obj, keys);
+}
+
 IndexAccessMethod::BulkBuilder::BulkBuilder(const IndexAccessMethod* index,
                                             const IndexDescriptor* descriptor)
     : _sorter(Sorter::make(
-          SortOptions()
-              .TempDir(storageGlobalParams.dbpath + "/_tmp")
-              .ExtSortAllowed()
-              .MaxMemoryUsageBytes(100 * 1024 * 1024),
+          bulkSortOptions(kBulkSortMemoryBytes),
           BtreeExternalSortComparison(descriptor->keyPattern(), descriptor->version()))),
       _real(index) {}
 
@@ -351,7 +564,7 @@ Status IndexAccessMethod::BulkBuilder::insert(OperationContext* txn,
                                               const InsertDeleteOptions& options,
                                               int64_t* numInserted) {
     BSONObjSet keys;
-    _real->getKeys(obj, &keys);
+    _real->getBulkKeys(obj, loc, &keys);
 
     _isMultiKey = _isMultiKey || (keys.size() > 1);
 
@@ -367,6 +580,17 @@ Status IndexAccessMethod::BulkBuilder::insert(OperationContext* txn,
     return Status::OK();
 }
 
+Status IndexAccessMethod::BulkBuilder::done(std::unique_ptr<Sorter::Iterator>* sorted) {
+    sorted->reset(_sorter->done());
+    return Status::OK();
+}
+
+Status IndexAccessMethod::addBulkKey(OperationContext* txn,
+                                     SortedDataBuilderInterface* builder,
+                                     const BSONObj& key,
+                                     const RecordId& loc) {
+    return builder->addKey(key, loc);
+}
 
 Status IndexAccessMethod::commitBulk(OperationContext* txn,
                                      std::unique_ptr<BulkBuilder> bulk,
@@ -375,7 +599,11 @@ Status IndexAccessMethod::commitBulk(OperationContext* txn,
                                      set<RecordId>* dupsToDrop) {
     Timer timer;
 
-    std::unique_ptr<BulkBuilder::Sorter::Iterator> i(bulk->_sorter->done());
+    std::unique_ptr<BulkBuilder::Sorter::Iterator> i;
+    Status doneStatus = bulk->done(&i);
+    if (!doneStatus.isOK()) {
+        return doneStatus;
+    }
 
     stdx::unique_lock<Client> lk(*txn->getClient());
     ProgressMeterHolder pm(*txn->setMessage_inlock("Index Bulk Build: (2/3) btree bottom up",
@@ -412,7 +640,7 @@ Status IndexAccessMethod::commitBulk(OperationContext* txn,
 
         // Get the next datum and add it to the builder.
         BulkBuilder::Sorter::Data d = i->next();
-        Status status = builder->addKey(d.first, d.second);
+        Status status = addBulkKey(txn, builder.get(), d.first, d.second);
 
         if (!status.isOK()) {
             // Overlong key that's OK to skip?
@@ -439,6 +667,16 @@ Status IndexAccessMethod::commitBulk(OperationContext* txn,
         wunit.commit();
     }
 
+    {
+        WriteUnitOfWork wunit(txn);
+        txn->recoveryUnit()->setRollbackWritesDisabled();
+        Status status = flushBulkKeys(txn, builder.get());
+        if (!status.isOK()) {
+            return status;
+        }
+        wunit.commit();
+    }
+
     pm.finished();
 
     {
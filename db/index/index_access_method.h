@@ -191,22 +191,35 @@ public:
 
     class BulkBuilder {
     public:
+        virtual ~BulkBuilder() = default;
+
         /**
          * Insert into the BulkBuilder as-if inserting into an IndexAccessMethod.
          */
-        Status insert(OperationContext* txn,
-                      const BSONObj& obj,
-                      const RecordId& loc,
-                      const InsertDeleteOptions& options,
-                      int64_t* numInserted);
+        virtual Status insert(OperationContext* txn,
+                              const BSONObj& obj,
+                              const RecordId& loc,
+                              const InsertDeleteOptions& options,
+                              int64_t* numInserted);
 
-    private:
+    protected:
         friend class IndexAccessMethod;
 
         using Sorter = mongo::Sorter<BSONObj, RecordId>;
 
         BulkBuilder(const IndexAccessMethod* index, const IndexDescriptor* descriptor);
 
+        /**
+         * For subclasses that sort the keys themselves; leaves _sorter empty.
+         */
+        explicit BulkBuilder(const IndexAccessMethod* index) : _real(index) {}
+
+        /**
+         * Called once all documents have been inserted.  Sets 'sorted' to an iterator over every
+         * key in index order, or returns the first error raised while generating the keys.
+         */
+        virtual Status done(std::unique_ptr<Sorter::Iterator>* sorted);
+
         std::unique_ptr<Sorter> _sorter;
         const IndexAccessMethod* _real;
         int64_t _keysInserted = 0;
@@ -220,7 +233,7 @@ public:
      *
      * It is only legal to initiate bulk when the index is new and empty.
      */
-    std::unique_ptr<BulkBuilder> initiateBulk();
+    virtual std::unique_ptr<BulkBuilder> initiateBulk();
 
     /**
      * Call this when you are ready to finish your bulk work.
@@ -242,10 +255,57 @@ public:
      */
     virtual void getKeys(const BSONObj& obj, BSONObjSet* keys) const = 0;
 
+    /**
+     * Fills 'keys' with the keys that bulk building sorts for 'obj' at 'loc' and then hands to
+     * addBulkKey() in order.  By default these are the keys from getKeys().
+     */
+    virtual void getBulkKeys(const BSONObj& obj, const RecordId& loc, BSONObjSet* keys) const;
+
 protected:
     // Determines whether it's OK to ignore ErrorCodes::KeyTooLong for this OperationContext
     bool ignoreKeyTooLong(OperationContext* txn);
 
+    /**
+     * Writes a single key generated by getKeys() to the underlying SortedDataInterface.
+     * Subclasses whose stored entries differ from the generated keys (e.g. the pix text
+     * index, which folds keys into per-term posting blocks) override this pair.
+     */
+    virtual Status insertKey(OperationContext* txn,
+                             const BSONObj& key,
+                             const RecordId& loc,
+                             bool dupsAllowed);
+
+    virtual void unindexKey(OperationContext* txn,
+                            const BSONObj& key,
+                            const RecordId& loc,
+                            bool dupsAllowed);
+
+    /**
+     * Called by remove() once every key of the document at 'loc' has been unindexed.
+     */
+    virtual void unindexDocument(OperationContext* txn, const RecordId& loc) {}
+
+    /**
+     * Returns a BulkBuilder that generates and sorts keys on 'numWorkers' threads, for indexes
+     * whose key generation is expensive.  With one worker or fewer this is the plain
+     * BulkBuilder.  getBulkKeys() must be safe to call concurrently.
+     */
+    std::unique_ptr<BulkBuilder> initiateParallelBulk(int numWorkers);
+
+    /**
+     * Adds one sorted key produced by getBulkKeys() to 'builder' during commitBulk().
+     * flushBulkKeys() is called after the last key.  Subclasses whose bulk keys are not their
+     * stored entries override this pair.
+     */
+    virtual Status addBulkKey(OperationContext* txn,
+                              SortedDataBuilderInterface* builder,
+                              const BSONObj& key,
+                              const RecordId& loc);
+
+    virtual Status flushBulkKeys(OperationContext* txn, SortedDataBuilderInterface* builder) {
+        return Status::OK();
+    }
+
     IndexCatalogEntry* _btreeState;  // owned by IndexCatalogEntry
     const IndexDescriptor* _descriptor;
 
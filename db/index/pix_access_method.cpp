@@ -0,0 +1,419 @@
+/**
+ *    Copyright (C) 2016 MongoDB Inc.
+ *
+ *    This program is free software: you can redistribute it and/or  modify
+ *    it under the terms of the GNU Affero General Public License, version 3,
+ *    as published by the Free Software Foundation.
+ *
+ *    This program is distributed in the hope that it will be useful,
+ *    but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *    GNU Affero General Public License for more details.
+ *
+ *    You should have received a copy of the GNU Affero General Public License
+ *    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ *    As a special exception, the copyright holders give permission to link the
+ *    code of portions of this program with the OpenSSL library under certain
+ *    conditions as described in each individual source file and distribute
+ *    linked combinations including the program with the OpenSSL library. You
+ *    must comply with the GNU Affero General Public License in all respects for
+ *    all of the code used other than as permitted herein. If you modify file(s)
+ *    with this exception, you may extend this exception to your version of the
+ *    file(s), but you are not obligated to do so. If you do not wish to do so,
+ *    delete this exception statement from your version. If you delete this
+ *    exception statement from all source files in the program, then also delete
+ *    it in the license file.
+ */
+
+#define MONGO_LOG_DEFAULT_COMPONENT ::mongo::logger::LogComponent::kIndex
+
+#include "mongo/platform/basic.h"
+
+#include "mongo/db/index/pix_access_method.h"
+
+#include "mongo/db/fts/fts_index_format.h"
+#include "mongo/db/operation_context.h"
+#include "mongo/util/assert_util.h"
+
+namespace mongo {
+
+using std::vector;
+
+using fts::FTSIndexFormat;
+
+namespace {
+
+/**
+ * Forgets a docid allocated by a unit of work that rolls back.
+ */
+class UnallocateDocidChange : public RecoveryUnit::Change {
+public:
+    UnallocateDocidChange(PixDocidMap* docids, uint32_t docid) : _docids(docids), _docid(docid) {}
+
+    void commit() final {}
+
+    void rollback() final {
+        _docids->unallocate(_docid);
+    }
+
+private:
+    PixDocidMap* _docids;
+    const uint32_t _docid;
+};
+
+/**
+ * Restores the docid of a removed document if the unit of work rolls back.
+ */
+class RestoreDocidChange : public RecoveryUnit::Change {
+public:
+    RestoreDocidChange(PixDocidMap* docids, uint32_t docid, const RecordId& loc)
+        : _docids(docids), _docid(docid), _loc(loc) {}
+
+    void commit() final {}
+
+    void rollback() final {
+        _docids->set(_docid, _loc);
+    }
+
+private:
+    PixDocidMap* _docids;
+    const uint32_t _docid;
+    const RecordId _loc;
+};
+
+/**
+ * True if 'blockKey' starts with the {prefix..., term} fields of 'termKey'.
+ */
+bool sameTerm(const BSONObj& blockKey, const BSONObj& termKey) {
+    BSONObjIterator bi(blockKey);
+    BSONObjIterator ti(termKey);
+    while (ti.more()) {
+        if (!bi.more() || bi.next().woCompare(ti.next(), false) != 0)
+            return false;
+    }
+    return true;
+}
+
+/**
+ * The last field of a stored key: the BinData of a block, delta or tombstone.
+ */
+BSONElement lastElement(const BSONObj& key) {
+    BSONElement last;
+    BSONObjIterator i(key);
+    while (i.more())
+        last = i.next();
+    invariant(last.type() == BinData);
+    return last;
+}
+
+/**
+ * The docid field of a stored key {prefix..., term, docid, data}.
+ */
+long long entryDocid(const BSONObj& key) {
+    BSONElement docid;
+    BSONElement last;
+    BSONObjIterator i(key);
+    while (i.more()) {
+        docid = last;
+        last = i.next();
+    }
+    return docid.numberLong();
+}
+
+PostingList decodeBlock(const BSONObj& blockKey) {
+    BSONElement blob = lastElement(blockKey);
+
+    int len;
+    const char* data = blob.binData(len);
+    return PostingList("", reinterpret_cast<const unsigned char*>(data), len);
+}
+
+}  // namespace
+
+PixAccessMethod::PixAccessMethod(IndexCatalogEntry* btreeState, SortedDataInterface* btree)
+    : FTSAccessMethod(btreeState, btree) {}
+
+std::unique_ptr<IndexAccessMethod::BulkBuilder> PixAccessMethod::initiateBulk() {
+    _docids.initializeAsEmpty();
+    return FTSAccessMethod::initiateBulk();
+}
+
+void PixAccessMethod::getBulkKeys(const BSONObj& obj,
+                                  const RecordId& loc,
+                                  BSONObjSet* keys) const {
+    BSONObjSet generated;
+    FTSAccessMethod::getBulkKeys(obj, loc, &generated);
+    if (generated.empty())
+        return;
+
+    uint32_t docid = _docids.allocate(loc);
+    keys->insert(FTSIndexFormat::getPixDocidKey(docid));
+    for (const BSONObj& key : generated) {
+        BSONElement blob;
+        BSONObjBuilder b;
+        b.appendElements(_termKey(key, &blob));
+        b.append("", static_cast<long long>(docid));
+        b.append(blob);
+        keys->insert(b.obj());
+    }
+}
+
+Status PixAccessMethod::insertKey(OperationContext* txn,
+                                  const BSONObj& key,
+                                  const RecordId& loc,
+                                  bool dupsAllowed) {
+    uint32_t docid = _docid(txn, loc, true);
+    BSONObj termKey;
+    BSONObj deltaKey = _deltaKey(key, docid, &termKey);
+
+    Status status = _newInterface->insert(txn, deltaKey, RecordId(docid), true);
+    if (!status.isOK())
+        return status;
+    return _mergeDeltas(txn, termKey, deltaKey);
+}
+
+void PixAccessMethod::unindexKey(OperationContext* txn,
+                                 const BSONObj& key,
+                                 const RecordId& loc,
+                                 bool dupsAllowed) {
+    uint32_t docid = _docid(txn, loc, false);
+    if (docid == PixDocidMap::kNoDocid)
+        return;
+
+    BSONObj termKey;
+    BSONObj deltaKey = _deltaKey(key, docid, &termKey);
+
+    // A posting that is still a delta is simply removed.
+    std::unique_ptr<SortedDataInterface::Cursor> cursor(_newInterface->newCursor(txn, true));
+    if (cursor->seekExact(deltaKey, SortedDataInterface::Cursor::kWantLoc)) {
+        cursor.reset();
+        _newInterface->unindex(txn, deltaKey, RecordId(docid), true);
+        return;
+    }
+    cursor.reset();
+
+    // Otherwise it is in a block, which is left alone until the next merge.
+    BSONObj tombstoneKey = FTSIndexFormat::getPixEntryKey(
+        termKey, docid, FTSIndexFormat::PixEntryKind::kTombstone, vector<unsigned char>());
+    uassertStatusOK(_newInterface->insert(txn, tombstoneKey, RecordId(docid), true));
+    uassertStatusOK(_mergeDeltas(txn, termKey, tombstoneKey));
+}
+
+void PixAccessMethod::unindexDocument(OperationContext* txn, const RecordId& loc) {
+    uint32_t docid = _docid(txn, loc, false);
+    if (docid == PixDocidMap::kNoDocid)
+        return;
+
+    // Forgotten right away so that a document reinserted at 'loc' gets a new docid entry.
+    _newInterface->unindex(txn, FTSIndexFormat::getPixDocidKey(docid), loc, true);
+    _docids.remove(loc);
+    txn->recoveryUnit()->registerChange(new RestoreDocidChange(&_docids, docid, loc));
+}
+
+RecordId PixAccessMethod::findRecordId(OperationContext* txn, uint32_t docid) const {
+    _docids.load(txn, _newInterface.get());
+    return _docids.findRecordId(docid);
+}
+
+Status PixAccessMethod::addBulkKey(OperationContext* txn,
+                                   SortedDataBuilderInterface* builder,
+                                   const BSONObj& key,
+                                   const RecordId& loc) {
+    // Docid entries sort apart from the postings and are stored as they are.
+    uint32_t docidKey;
+    if (FTSIndexFormat::isPixDocidKey(key, &docidKey)) {
+        Status status = flushBulkKeys(txn, builder);
+        if (!status.isOK())
+            return status;
+        return builder->addKey(key, loc);
+    }
+
+    // {prefix..., term, docid, positions}
+    BSONObjBuilder termKey;
+    BSONObjIterator i(key);
+    for (size_t k = 0; k <= getSpec().numExtraBefore(); k++) {
+        termKey.append(i.next());
+    }
+    uint32_t docid = static_cast<uint32_t>(i.next().numberLong());
+    BSONElement blob = i.next();
+
+    BSONObj term = termKey.obj();
+    if (_bulkPostings.size() > 0 && term.woCompare(_bulkTermKey, BSONObj(), false) != 0) {
+        Status status = flushBulkKeys(txn, builder);
+        if (!status.isOK())
+            return status;
+    }
+    if (_bulkPostings.size() == 0)
+        _bulkTermKey = term;
+
+    int len;
+    const char* data = blob.binData(len);
+    _bulkPostings.append(DocPosting(reinterpret_cast<const unsigned char*>(data), 0, len, docid));
+
+    if (_bulkPostings.size() >= kBulkPostings)
+        return flushBulkKeys(txn, builder);
+    return Status::OK();
+}
+
+Status PixAccessMethod::flushBulkKeys(OperationContext* txn, SortedDataBuilderInterface* builder) {
+    if (_bulkPostings.size() == 0)
+        return Status::OK();
+
+    PostingList pList;
+    pList.swap(_bulkPostings);
+    return _writeBlocks(txn, _bulkTermKey, pList, builder);
+}
+
+uint32_t PixAccessMethod::_docid(OperationContext* txn, const RecordId& loc, bool allocate) {
+    _docids.load(txn, _newInterface.get());
+    uint32_t docid = _docids.findDocid(loc);
+    if (docid != PixDocidMap::kNoDocid || !allocate)
+        return docid;
+
+    docid = _docids.allocate(loc);
+    txn->recoveryUnit()->registerChange(new UnallocateDocidChange(&_docids, docid));
+    uassertStatusOK(_newInterface->insert(txn, FTSIndexFormat::getPixDocidKey(docid), loc, true));
+    return docid;
+}
+
+BSONObj PixAccessMethod::_termKey(const BSONObj& key, BSONElement* blob) const {
+    BSONObjBuilder b;
+    BSONObjIterator i(key);
+    for (size_t k = 0; k <= getSpec().numExtraBefore(); k++) {
+        b.append(i.next());
+    }
+    *blob = i.next();
+    invariant(blob->type() == BinData);
+    return b.obj();
+}
+
+BSONObj PixAccessMethod::_deltaKey(const BSONObj& key, uint32_t docid, BSONObj* termKey) const {
+    BSONElement blob;
+    *termKey = _termKey(key, &blob);
+
+    // getKeys() codes the docid as 0, so decoding relative to the real docid restores it.
+    int len;
+    const char* data = blob.binData(len);
+    PostingList pList;
+    pList.append(DocPosting(reinterpret_cast<const unsigned char*>(data), 0, len, docid));
+
+    vector<unsigned char> delta;
+    pList.pack(delta);
+    return FTSIndexFormat::getPixEntryKey(
+        *termKey, docid, FTSIndexFormat::PixEntryKind::kDelta, delta);
+}
+
+Status PixAccessMethod::_mergeDeltas(OperationContext* txn,
+                                     const BSONObj& termKey,
+                                     const BSONObj& entryKey) {
+    typedef FTSIndexFormat::PixEntryKind Kind;
+    const uint32_t docid = static_cast<uint32_t>(entryDocid(entryKey));
+
+    // The block holding 'docid' is the last one whose first docid is at most 'docid'.  It is
+    // found by docid rather than by walking back from 'entryKey': BinData sorts by length
+    // first, so a tombstone or short delta at a block's first docid sorts before that block.
+    bool haveBlock = false;
+    uint32_t firstDocid = 0;
+    {
+        std::unique_ptr<SortedDataInterface::Cursor> cursor(_newInterface->newCursor(txn, false));
+        for (auto entry = cursor->seek(FTSIndexFormat::getPixSeekKey(termKey, docid, true), true);
+             entry && sameTerm(entry->key, termKey);
+             entry = cursor->next()) {
+            if (FTSIndexFormat::getPixEntryKind(lastElement(entry->key)) == Kind::kBlock) {
+                haveBlock = true;
+                firstDocid = static_cast<uint32_t>(entryDocid(entry->key));
+                break;
+            }
+        }
+    }
+
+    // The window is that block, if any, and every delta and tombstone whose docid lies between
+    // it and the next block.  Entries at the next block's first docid belong to that block.
+    vector<IndexKeyEntry> window;
+    size_t pending = 0;
+    {
+        std::unique_ptr<SortedDataInterface::Cursor> cursor(_newInterface->newCursor(txn, true));
+        for (auto entry = cursor->seek(FTSIndexFormat::getPixSeekKey(termKey, firstDocid, false),
+                                       true);
+             entry && sameTerm(entry->key, termKey);
+             entry = cursor->next()) {
+            uint32_t entryId = static_cast<uint32_t>(entryDocid(entry->key));
+            if (FTSIndexFormat::getPixEntryKind(lastElement(entry->key)) == Kind::kBlock) {
+                if (!haveBlock || entryId != firstDocid) {
+                    while (!window.empty() && entryDocid(window.back().key) >= entryId) {
+                        window.pop_back();
+                        --pending;
+                    }
+                    break;
+                }
+            } else {
+                ++pending;
+            }
+            window.push_back(IndexKeyEntry(entry->key.getOwned(), entry->loc));
+        }
+    }
+    if (pending < kMaxPendingEntries)
+        return Status::OK();
+
+    // Blocks cover disjoint docid ranges, so the merged postings fit back between the
+    // neighbouring blocks.
+    PostingList merged;
+    vector<DocPosting> deltas;
+    vector<uint32_t> tombstones;
+    for (const IndexKeyEntry& entry : window) {
+        Kind kind = FTSIndexFormat::getPixEntryKind(lastElement(entry.key));
+        if (kind == Kind::kBlock) {
+            merged.append(decodeBlock(entry.key));
+        } else if (kind == Kind::kDelta) {
+            PostingList delta = decodeBlock(entry.key);
+            deltas.insert(deltas.end(), delta.begin(), delta.end());
+        } else {
+            tombstones.push_back(static_cast<uint32_t>(entryDocid(entry.key)));
+        }
+    }
+
+    // Tombstones only ever refer to postings in blocks; deltas are applied after them so that
+    // a document that reused a tombstoned docid keeps its new posting.
+    for (uint32_t docid : tombstones) {
+        merged.remove(docid);
+    }
+    for (const DocPosting& dp : deltas) {
+        merged.insert(dp);
+    }
+
+    for (const IndexKeyEntry& entry : window) {
+        _newInterface->unindex(txn, entry.key, entry.loc, true);
+    }
+    if (merged.size() == 0)
+        return Status::OK();
+    return _writeBlocks(txn, termKey, merged);
+}
+
+Status PixAccessMethod::_writeBlocks(OperationContext* txn,
+                                     const BSONObj& termKey,
+                                     const PostingList& pList,
+                                     SortedDataBuilderInterface* builder) {
+    invariant(pList.size() > 0);
+
+    vector<unsigned char> block;
+    pList.pack(block, getSpec().pixBlockFormat());
+
+    if (block.size() > kMaxBlockBytes && pList.size() > 1) {
+        PostingList::PostingListIterator mid = pList.begin() + pList.size() / 2;
+        Status status = _writeBlocks(
+            txn, termKey, PostingList("", vector<DocPosting>(pList.begin(), mid)), builder);
+        if (!status.isOK())
+            return status;
+        return _writeBlocks(
+            txn, termKey, PostingList("", vector<DocPosting>(mid, pList.end())), builder);
+    }
+
+    uint32_t firstDocid = pList.begin()->getDocid();
+    BSONObj blockKey = FTSIndexFormat::getPixBlockKey(termKey, firstDocid, block);
+    if (builder)
+        return builder->addKey(blockKey, RecordId(firstDocid));
+    return _newInterface->insert(txn, blockKey, RecordId(firstDocid), true);
+}
+
+}  // namespace mongo
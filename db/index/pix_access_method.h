@@ -0,0 +1,155 @@
+/**
+ *    Copyright (C) 2016 MongoDB Inc.
+ *
+ *    This program is free software: you can redistribute it and/or  modify
+ *    it under the terms of the GNU Affero General Public License, version 3,
+ *    as published by the Free Software Foundation.
+ *
+ *    This program is distributed in the hope that it will be useful,
+ *    but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *    GNU Affero General Public License for more details.
+ *
+ *    You should have received a copy of the GNU Affero General Public License
+ *    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ *    As a special exception, the copyright holders give permission to link the
+ *    code of portions of this program with the OpenSSL library under certain
+ *    conditions as described in each individual source file and distribute
+ *    linked combinations including the program with the OpenSSL library. You
+ *    must comply with the GNU Affero General Public License in all respects for
+ *    all of the code used other than as permitted herein. If you modify file(s)
+ *    with this exception, you may extend this exception to your version of the
+ *    file(s), but you are not obligated to do so. If you do not wish to do so,
+ *    delete this exception statement from your version. If you delete this
+ *    exception statement from all source files in the program, then also delete
+ *    it in the license file.
+ */
+
+#pragma once
+
+#include <vector>
+
+#include "mongo/db/fts/pix_posting_list.h"
+#include "mongo/db/index/fts_access_method.h"
+#include "mongo/db/index/pix_docid_map.h"
+#include "mongo/db/storage/index_entry_comparison.h"
+
+namespace mongo {
+
+/**
+ * Access method for a text index created with {pix: true}.
+ *
+ * Instead of one index entry per (term, document), the index stores posting blocks:
+ *
+ *     {prefix..., term, firstDocid, BinData(PostingList)}  ->  RecordId(firstDocid)
+ *
+ * Each block holds the DocPostings (docid, tf, positions) of a run of documents for one term,
+ * delta coded by PostingList::pack in the index's "pixBlockFormat" (see FTSSpec).  Blocks are
+ * kept under kMaxBlockBytes so that a stored key stays well below the storage engine key size
+ * limit.  Deltas always use the varint frames, which are the smallest for a single posting.
+ *
+ * Blocks are never rewritten by a single write.  insertKey() adds a delta entry holding the
+ * document's posting, and unindexKey() removes that delta or, once the posting has been merged
+ * into a block, adds a tombstone entry for the docid (see FTSIndexFormat::PixEntryKind).  When
+ * kMaxPendingEntries deltas and tombstones fall in the docid range of a block of the term, from
+ * its first docid up to the next block's, they are merged with it into new blocks.  Queries
+ * read all three kinds and skip tombstoned block postings.
+ *
+ * Bulk builds sort {prefix..., term, NumberLong(docid), positions} keys instead, so that the
+ * postings of each term arrive in docid order and are packed into blocks in one pass.
+ *
+ * Postings address documents by dense 32-bit docids rather than by RecordId.  Each document gets
+ * its docid when it is first indexed, and the index also stores a {MinKey, docid} -> RecordId
+ * entry for it, which remove() deletes (see PixDocidMap).
+ */
+class PixAccessMethod : public FTSAccessMethod {
+public:
+    PixAccessMethod(IndexCatalogEntry* btreeState, SortedDataInterface* btree);
+
+    /**
+     * Bulk builds start from an empty index, so docids are allocated from 1 without loading.
+     */
+    virtual std::unique_ptr<BulkBuilder> initiateBulk();
+
+    /**
+     * Also allocates the docid of 'loc' and adds its docid entry to 'keys'.
+     */
+    virtual void getBulkKeys(const BSONObj& obj, const RecordId& loc, BSONObjSet* keys) const;
+
+    /**
+     * Returns the RecordId of the document with 'docid', or a null RecordId if there is none.
+     */
+    RecordId findRecordId(OperationContext* txn, uint32_t docid) const;
+
+    // Upper bound on the packed size of a single posting block.
+    static const size_t kMaxBlockBytes = 512;
+
+    // Postings gathered per term before a bulk build packs them into blocks.
+    static const size_t kBulkPostings = 64;
+
+    // Deltas and tombstones that may fall in a block's docid range before they are merged into it.
+    static const size_t kMaxPendingEntries = 16;
+
+protected:
+    virtual Status insertKey(OperationContext* txn,
+                             const BSONObj& key,
+                             const RecordId& loc,
+                             bool dupsAllowed);
+
+    virtual void unindexKey(OperationContext* txn,
+                            const BSONObj& key,
+                            const RecordId& loc,
+                            bool dupsAllowed);
+
+    virtual void unindexDocument(OperationContext* txn, const RecordId& loc);
+
+    virtual Status addBulkKey(OperationContext* txn,
+                              SortedDataBuilderInterface* builder,
+                              const BSONObj& key,
+                              const RecordId& loc);
+
+    virtual Status flushBulkKeys(OperationContext* txn, SortedDataBuilderInterface* builder);
+
+private:
+    /**
+     * Returns the docid of 'loc'.  If it has none, allocates one and inserts its docid entry
+     * when 'allocate' is set, and returns PixDocidMap::kNoDocid otherwise.
+     */
+    uint32_t _docid(OperationContext* txn, const RecordId& loc, bool allocate);
+
+    /**
+     * Splits a key generated by getKeys() into {prefix..., term} and its position blob.
+     */
+    BSONObj _termKey(const BSONObj& key, BSONElement* blob) const;
+
+    /**
+     * Returns the delta entry key holding the posting of a key generated by getKeys(), and
+     * sets 'termKey' to its {prefix..., term}.
+     */
+    BSONObj _deltaKey(const BSONObj& key, uint32_t docid, BSONObj* termKey) const;
+
+    /**
+     * Merges the deltas and tombstones around the just written 'entryKey' into the blocks of
+     * 'termKey' once there are kMaxPendingEntries of them.
+     */
+    Status _mergeDeltas(OperationContext* txn, const BSONObj& termKey, const BSONObj& entryKey);
+
+    /**
+     * Packs 'pList' into one or more blocks of at most kMaxBlockBytes and inserts them, in
+     * order through 'builder' if one is given.
+     */
+    Status _writeBlocks(OperationContext* txn,
+                        const BSONObj& termKey,
+                        const PostingList& pList,
+                        SortedDataBuilderInterface* builder = nullptr);
+
+    // Docids of the indexed documents.  getBulkKeys() allocates them.
+    mutable PixDocidMap _docids;
+
+    // Postings of the current term while commitBulk() runs.
+    BSONObj _bulkTermKey;
+    PostingList _bulkPostings;
+};
+
+}  // namespace mongo
@@ -0,0 +1,132 @@
+/**
+ *    Copyright (C) 2016 MongoDB Inc.
+ *
+ *    This program is free software: you can redistribute it and/or  modify
+ *    it under the terms of the GNU Affero General Public License, version 3,
+ *    as published by the Free Software Foundation.
+ *
+ *    This program is distributed in the hope that it will be useful,
+ *    but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *    GNU Affero General Public License for more details.
+ *
+ *    You should have received a copy of the GNU Affero General Public License
+ *    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ *    As a special exception, the copyright holders give permission to link the
+ *    code of portions of this program with the OpenSSL library under certain
+ *    conditions as described in each individual source file and distribute
+ *    linked combinations including the program with the OpenSSL library. You
+ *    must comply with the GNU Affero General Public License in all respects for
+ *    all of the code used other than as permitted herein. If you modify file(s)
+ *    with this exception, you may extend this exception to your version of the
+ *    file(s), but you are not obligated to do so. If you do not wish to do so,
+ *    delete this exception statement from your version. If you delete this
+ *    exception statement from all source files in the program, then also delete
+ *    it in the license file.
+ */
+
+#define MONGO_LOG_DEFAULT_COMPONENT ::mongo::logger::LogComponent::kIndex
+
+#include "mongo/platform/basic.h"
+
+#include "mongo/db/index/pix_docid_map.h"
+
+#include <limits>
+
+#include "mongo/db/fts/fts_index_format.h"
+#include "mongo/db/storage/sorted_data_interface.h"
+#include "mongo/util/assert_util.h"
+#include "mongo/util/log.h"
+
+namespace mongo {
+
+using fts::FTSIndexFormat;
+
+PixDocidMap::PixDocidMap() : _loaded(false), _recordIds(1) {}
+
+void PixDocidMap::load(OperationContext* txn, SortedDataInterface* index) {
+    if (_loaded.load())
+        return;
+
+    stdx::lock_guard<stdx::mutex> loadLock(_loadMutex);
+    if (_loaded.load())
+        return;
+
+    // Every writer loads the map before it allocates a docid, so nothing in it is uncommitted.
+    // The docid entries all start with MinKey; entries of terms whose prefix is MinKey are
+    // skipped.
+    BSONObjBuilder seekKey;
+    seekKey.appendMinKey("");
+    std::unique_ptr<SortedDataInterface::Cursor> cursor(index->newCursor(txn, true));
+    for (auto entry = cursor->seek(seekKey.obj(), true);
+         entry && entry->key.firstElement().type() == MinKey;
+         entry = cursor->next()) {
+        uint32_t docid;
+        if (FTSIndexFormat::isPixDocidKey(entry->key, &docid))
+            set(docid, entry->loc);
+    }
+
+    LOG(1) << "loaded " << size() << " pix docids";
+    _loaded.store(true);
+}
+
+void PixDocidMap::initializeAsEmpty() {
+    stdx::lock_guard<stdx::mutex> loadLock(_loadMutex);
+    _loaded.store(true);
+}
+
+uint32_t PixDocidMap::findDocid(const RecordId& loc) const {
+    stdx::lock_guard<stdx::mutex> lk(_mutex);
+    auto it = _docids.find(loc);
+    return it == _docids.end() ? kNoDocid : it->second;
+}
+
+RecordId PixDocidMap::findRecordId(uint32_t docid) const {
+    stdx::lock_guard<stdx::mutex> lk(_mutex);
+    return docid < _recordIds.size() ? _recordIds[docid] : RecordId();
+}
+
+uint32_t PixDocidMap::allocate(const RecordId& loc) {
+    stdx::lock_guard<stdx::mutex> lk(_mutex);
+    uassert(34504,
+            "pix text index has run out of docids and must be rebuilt",
+            _recordIds.size() <= std::numeric_limits<uint32_t>::max());
+
+    uint32_t docid = static_cast<uint32_t>(_recordIds.size());
+    _recordIds.push_back(loc);
+    bool inserted = _docids.emplace(loc, docid).second;
+    invariant(inserted);
+    return docid;
+}
+
+void PixDocidMap::set(uint32_t docid, const RecordId& loc) {
+    invariant(docid != kNoDocid);
+    stdx::lock_guard<stdx::mutex> lk(_mutex);
+    if (docid >= _recordIds.size())
+        _recordIds.resize(docid + 1);
+    _recordIds[docid] = loc;
+    _docids[loc] = docid;
+}
+
+void PixDocidMap::remove(const RecordId& loc) {
+    stdx::lock_guard<stdx::mutex> lk(_mutex);
+    _docids.erase(loc);
+}
+
+void PixDocidMap::unallocate(uint32_t docid) {
+    stdx::lock_guard<stdx::mutex> lk(_mutex);
+    invariant(docid != kNoDocid && docid < _recordIds.size());
+    _docids.erase(_recordIds[docid]);
+    if (docid + 1 == _recordIds.size())
+        _recordIds.pop_back();
+    else
+        _recordIds[docid] = RecordId();
+}
+
+size_t PixDocidMap::size() const {
+    stdx::lock_guard<stdx::mutex> lk(_mutex);
+    return _docids.size();
+}
+
+}  // namespace mongo
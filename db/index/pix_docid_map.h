@@ -0,0 +1,123 @@
+/**
+ *    Copyright (C) 2016 MongoDB Inc.
+ *
+ *    This program is free software: you can redistribute it and/or  modify
+ *    it under the terms of the GNU Affero General Public License, version 3,
+ *    as published by the Free Software Foundation.
+ *
+ *    This program is distributed in the hope that it will be useful,
+ *    but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *    GNU Affero General Public License for more details.
+ *
+ *    You should have received a copy of the GNU Affero General Public License
+ *    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ *    As a special exception, the copyright holders give permission to link the
+ *    code of portions of this program with the OpenSSL library under certain
+ *    conditions as described in each individual source file and distribute
+ *    linked combinations including the program with the OpenSSL library. You
+ *    must comply with the GNU Affero General Public License in all respects for
+ *    all of the code used other than as permitted herein. If you modify file(s)
+ *    with this exception, you may extend this exception to your version of the
+ *    file(s), but you are not obligated to do so. If you do not wish to do so,
+ *    delete this exception statement from your version. If you delete this
+ *    exception statement from all source files in the program, then also delete
+ *    it in the license file.
+ */
+
+#pragma once
+
+#include <atomic>
+#include <cstdint>
+#include <vector>
+
+#include "mongo/base/disallow_copying.h"
+#include "mongo/db/record_id.h"
+#include "mongo/platform/unordered_map.h"
+#include "mongo/stdx/mutex.h"
+
+namespace mongo {
+
+class OperationContext;
+class SortedDataInterface;
+
+/**
+ * Maps the RecordIds of the documents in a pix text index to dense 32-bit docids and back.
+ *
+ * Posting blocks delta code their docids and skip lists step over them, which only pays off
+ * when consecutive docids are close.  RecordIds are 64-bit and may be sparse, so each indexed
+ * document gets the next docid instead.  Docids start at 1.  Those of deleted documents are
+ * not handed out again while the index is open, though after a restart the highest ones may
+ * be; merging deltas and tombstones tolerates a reused docid.
+ *
+ * The mapping is persisted by PixAccessMethod as {MinKey, docid} -> RecordId entries of the index
+ * itself (see FTSIndexFormat::getPixDocidKey()) and held here in memory: a hash map from
+ * RecordId to docid for writers, and an array indexed by docid for queries.  The reverse entry
+ * of a deleted document is kept in memory so that readers of older snapshots can still fetch it.
+ *
+ * All methods are thread safe.
+ */
+class PixDocidMap {
+    MONGO_DISALLOW_COPYING(PixDocidMap);
+
+public:
+    static const uint32_t kNoDocid = 0;
+
+    PixDocidMap();
+
+    /**
+     * Fills the map from the docid entries of 'index' unless it is already loaded.
+     */
+    void load(OperationContext* txn, SortedDataInterface* index);
+
+    /**
+     * Marks the map loaded without reading anything, for an index that is built from scratch.
+     */
+    void initializeAsEmpty();
+
+    /**
+     * Returns the docid of 'loc', or kNoDocid if it has none.
+     */
+    uint32_t findDocid(const RecordId& loc) const;
+
+    /**
+     * Returns the RecordId of 'docid', or a null RecordId if it has none.
+     */
+    RecordId findRecordId(uint32_t docid) const;
+
+    /**
+     * Returns a new docid for 'loc', which must not have one.  Throws once docids run out.
+     */
+    uint32_t allocate(const RecordId& loc);
+
+    /**
+     * Maps 'docid' to 'loc' and back.
+     */
+    void set(uint32_t docid, const RecordId& loc);
+
+    /**
+     * Forgets the docid of 'loc'.  The RecordId of the docid is still returned by findRecordId().
+     */
+    void remove(const RecordId& loc);
+
+    /**
+     * Undoes allocate(): forgets 'docid' in both directions, and reuses it if it was the last.
+     */
+    void unallocate(uint32_t docid);
+
+    /**
+     * The number of documents that have a docid.
+     */
+    size_t size() const;
+
+private:
+    std::atomic<bool> _loaded;  // NOLINT
+    stdx::mutex _loadMutex;     // serializes load()
+
+    mutable stdx::mutex _mutex;
+    unordered_map<RecordId, uint32_t, RecordId::Hasher> _docids;
+    std::vector<RecordId> _recordIds;  // indexed by docid, [kNoDocid] unused
+};
+
+}  // namespace mongo
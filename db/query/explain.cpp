@@ -158,6 +158,12 @@ size_t getDocsExamined(StageType type, const SpecificStats* specific) {
     } else if (STAGE_TEXT_OR == type) {
         const TextOrStats* spec = static_cast<const TextOrStats*>(specific);
         return spec->fetches;
+    } else if (STAGE_TEXT_PIX == type) {
+        const TextPixStats* spec = static_cast<const TextPixStats*>(specific);
+        return spec->fetches;
+    } else if (STAGE_TEXT_PROXIMITY == type) {
+        const TextProximityStats* spec = static_cast<const TextProximityStats*>(specific);
+        return spec->fetches;
     }
 
     return 0;
@@ -435,6 +441,7 @@ void Explain::statsToBSON(const PlanStageStats& stats,
         bob->append("indexName", spec->indexName);
         bob->append("parsedTextQuery", spec->parsedTextQuery);
         bob->append("textIndexVersion", spec->textIndexVersion);
+        bob->append("fromResultCache", spec->fromResultCache);
     } else if (STAGE_TEXT_MATCH == stats.stageType) {
         TextMatchStats* spec = static_cast<TextMatchStats*>(stats.specific.get());
 
@@ -444,8 +451,37 @@ void Explain::statsToBSON(const PlanStageStats& stats,
     } else if (STAGE_TEXT_OR == stats.stageType) {
         TextOrStats* spec = static_cast<TextOrStats*>(stats.specific.get());
 
+        if (spec->topK > 0) {
+            bob->appendNumber("topK", spec->topK);
+        }
+
+        if (verbosity >= ExplainCommon::EXEC_STATS) {
+            bob->appendNumber("docsExamined", spec->fetches);
+            if (spec->spills > 0) {
+                bob->appendNumber("spills", spec->spills);
+            }
+        }
+    } else if (STAGE_TEXT_PIX == stats.stageType) {
+        TextPixStats* spec = static_cast<TextPixStats*>(stats.specific.get());
+
+        if (spec->topK > 0) {
+            bob->appendNumber("topK", spec->topK);
+        }
+
+        if (verbosity >= ExplainCommon::EXEC_STATS) {
+            bob->appendNumber("docsExamined", spec->fetches);
+            bob->appendNumber("blocksRead", spec->blocksRead);
+            bob->appendNumber("deltasRead", spec->deltasRead);
+            bob->appendNumber("tombstonesRead", spec->tombstonesRead);
+            bob->appendNumber("postingsRead", spec->postingsRead);
+            bob->appendNumber("phraseRejects", spec->phraseRejects);
+        }
+    } else if (STAGE_TEXT_PROXIMITY == stats.stageType) {
+        TextProximityStats* spec = static_cast<TextProximityStats*>(stats.specific.get());
+
         if (verbosity >= ExplainCommon::EXEC_STATS) {
             bob->appendNumber("docsExamined", spec->fetches);
+            bob->appendNumber("phraseRejects", spec->phraseRejects);
         }
     } else if (STAGE_UPDATE == stats.stageType) {
         UpdateStats* spec = static_cast<UpdateStats*>(stats.specific.get());
@@ -73,6 +73,14 @@ extern std::atomic<int> internalQueryCacheFeedbacksStored;  // NOLINT
 // and replanning?
 extern AtomicDouble internalQueryCacheEvictionRatio;  // NOLINT
 
+//
+// text result cache
+//
+
+// How many bytes may the text search results cached for one collection take?  0 disables the
+// cache.
+extern std::atomic<int> internalQueryTextResultCacheSizeBytes;  // NOLINT
+
 //
 // Planning and enumeration.
 //
@@ -99,6 +107,10 @@ extern std::atomic<int> internalQueryMaxScansToExplode;  // NOLINT
 
 extern std::atomic<int> internalQueryExecMaxBlockingSortBytes;  // NOLINT
 
+// TEXT_OR spills partial scores to disk once its buffered documents and scores exceed this many
+// bytes.  0 keeps everything in memory.
+extern std::atomic<int> internalQueryTextOrMaxMemoryBytes;  // NOLINT
+
 // Yield after this many "should yield?" checks.
 extern std::atomic<int> internalQueryExecYieldIterations;  // NOLINT
 
@@ -54,6 +54,7 @@
 #include "mongo/db/exec/text.h"
 #include "mongo/db/index/fts_access_method.h"
 #include "mongo/db/matcher/extensions_callback_real.h"
+#include "mongo/db/query/lite_parsed_query.h"
 #include "mongo/db/catalog/collection.h"
 #include "mongo/db/catalog/database.h"
 #include "mongo/db/s/sharding_state.h"
@@ -65,6 +66,39 @@ namespace mongo {
 using std::unique_ptr;
 using stdx::make_unique;
 
+namespace {
+
+/**
+ * If the only consumer of 'textNode' results is a limited sort on the text score alone, returns
+ * the number of results that sort keeps. Otherwise returns 0.
+ */
+size_t textScoreSortLimit(const QuerySolutionNode* root, const QuerySolutionNode* textNode) {
+    const QuerySolutionNode* node = root;
+    while (node && STAGE_SORT != node->getType()) {
+        if (node->children.size() != 1) {
+            return 0;
+        }
+        node = node->children[0];
+    }
+    if (!node) {
+        return 0;
+    }
+
+    const SortNode* sn = static_cast<const SortNode*>(node);
+    BSONObjIterator it(sn->pattern);
+    if (!it.more() || !LiteParsedQuery::isTextScoreMeta(it.next()) || it.more()) {
+        return 0;
+    }
+
+    const QuerySolutionNode* child = sn->children[0];
+    if (STAGE_SORT_KEY_GENERATOR == child->getType()) {
+        child = child->children[0];
+    }
+    return child == textNode ? sn->limit : 0;
+}
+
+}  // namespace
+
 PlanStage* buildStages(OperationContext* txn,
                        Collection* collection,
                        const QuerySolution& qsol,
@@ -274,6 +308,8 @@ PlanStage* buildStages(OperationContext* txn,
         // planning a query that contains "no-op" expressions. TODO: make StageBuilder::build()
         // fail in this case (this improvement is being tracked by SERVER-21510).
         params.query = static_cast<FTSQueryImpl&>(*node->ftsQuery);
+        params.topK = textScoreSortLimit(qsol.root.get(), node);
+        params.termStats = fam->getTermStats();
         return new TextStage(txn, params, ws, node->filter.get());
     } else if (STAGE_SHARDING_FILTER == root->getType()) {
         const ShardingFilterNode* fn = static_cast<const ShardingFilterNode*>(root);
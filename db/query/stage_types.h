@@ -105,6 +105,7 @@ enum StageType {
     STAGE_TEXT_OR,
     STAGE_TEXT_MATCH,
     STAGE_TEXT_PROXIMITY,
+    STAGE_TEXT_PIX,
 
     STAGE_UNKNOWN,
 
@@ -0,0 +1,161 @@
+/**
+ *    Copyright (C) 2016 MongoDB Inc.
+ *
+ *    This program is free software: you can redistribute it and/or  modify
+ *    it under the terms of the GNU Affero General Public License, version 3,
+ *    as published by the Free Software Foundation.
+ *
+ *    This program is distributed in the hope that it will be useful,
+ *    but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *    GNU Affero General Public License for more details.
+ *
+ *    You should have received a copy of the GNU Affero General Public License
+ *    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ *    As a special exception, the copyright holders give permission to link the
+ *    code of portions of this program with the OpenSSL library under certain
+ *    conditions as described in each individual source file and distribute
+ *    linked combinations including the program with the OpenSSL library. You
+ *    must comply with the GNU Affero General Public License in all respects for
+ *    all of the code used other than as permitted herein. If you modify file(s)
+ *    with this exception, you may extend this exception to your version of the
+ *    file(s), but you are not obligated to do so. If you do not wish to do so,
+ *    delete this exception statement from your version. If you delete this
+ *    exception statement from all source files in the program, then also delete
+ *    it in the license file.
+ */
+
+#include "mongo/platform/basic.h"
+
+#include "mongo/db/query/text_result_cache.h"
+
+#include "mongo/base/counter.h"
+#include "mongo/db/commands/server_status_metric.h"
+#include "mongo/db/query/query_knobs.h"
+
+namespace mongo {
+
+namespace {
+
+Counter64 textResultCacheHits;
+Counter64 textResultCacheMisses;
+Counter64 textResultCacheEvictions;
+Counter64 textResultCacheBytes;
+
+ServerStatusMetricField<Counter64> displayTextResultCacheHits("query.textResultCache.hits",
+                                                              &textResultCacheHits);
+ServerStatusMetricField<Counter64> displayTextResultCacheMisses("query.textResultCache.misses",
+                                                                &textResultCacheMisses);
+ServerStatusMetricField<Counter64> displayTextResultCacheEvictions(
+    "query.textResultCache.evictions", &textResultCacheEvictions);
+ServerStatusMetricField<Counter64> displayTextResultCacheBytes("query.textResultCache.bytes",
+                                                               &textResultCacheBytes);
+
+}  // namespace
+
+TextResultCache::~TextResultCache() {
+    textResultCacheBytes.decrement(_bytes);
+}
+
+std::shared_ptr<const TextResultCache::Results> TextResultCache::get(const std::string& key) {
+    stdx::lock_guard<stdx::mutex> lock(_mutex);
+    auto it = _index.find(key);
+    if (it == _index.end()) {
+        textResultCacheMisses.increment();
+        return nullptr;
+    }
+
+    _entries.splice(_entries.begin(), _entries, it->second);
+    textResultCacheHits.increment();
+    return it->second->second;
+}
+
+bool TextResultCache::add(const std::string& key, uint64_t generation, Results results) {
+    const int maxBytesParam = internalQueryTextResultCacheSizeBytes.load();
+    if (maxBytesParam <= 0 || generation != _generation.load()) {
+        return false;
+    }
+
+    const size_t maxBytes = maxBytesParam;
+    const size_t bytes = entryBytes(key, results.size());
+    if (bytes > maxBytes) {
+        return false;
+    }
+
+    stdx::lock_guard<stdx::mutex> lock(_mutex);
+    auto it = _index.find(key);
+    if (it != _index.end()) {
+        const size_t oldBytes = entryBytes(key, it->second->second->size());
+        _bytes -= oldBytes;
+        textResultCacheBytes.decrement(oldBytes);
+        _entries.erase(it->second);
+        _index.erase(it);
+        _numEntries.subtractAndFetch(1);
+    }
+
+    while (!_entries.empty() && _bytes + bytes > maxBytes) {
+        _evictLast_inlock();
+    }
+
+    _entries.emplace_front(key, std::make_shared<const Results>(std::move(results)));
+    _index[key] = _entries.begin();
+    _bytes += bytes;
+    textResultCacheBytes.increment(bytes);
+    _numEntries.addAndFetch(1);
+
+    if (generation != _generation.load()) {
+        // Invalidated concurrently, possibly without seeing this entry.
+        _clear_inlock();
+        return false;
+    }
+    return true;
+}
+
+void TextResultCache::invalidate() {
+    _generation.addAndFetch(1);
+    if (_numEntries.load() == 0) {
+        return;
+    }
+
+    stdx::lock_guard<stdx::mutex> lock(_mutex);
+    _clear_inlock();
+}
+
+size_t TextResultCache::size() const {
+    stdx::lock_guard<stdx::mutex> lock(_mutex);
+    return _entries.size();
+}
+
+size_t TextResultCache::bytes() const {
+    stdx::lock_guard<stdx::mutex> lock(_mutex);
+    return _bytes;
+}
+
+// static
+size_t TextResultCache::entryBytes(const std::string& key, size_t numResults) {
+    // The key is stored twice: in the list and in the index.
+    return sizeof(Entry) + 2 * key.size() + sizeof(Results) + numResults * sizeof(Result);
+}
+
+void TextResultCache::_evictLast_inlock() {
+    const Entry& last = _entries.back();
+    const size_t bytes = entryBytes(last.first, last.second->size());
+    _bytes -= bytes;
+    textResultCacheBytes.decrement(bytes);
+    textResultCacheEvictions.increment();
+
+    _index.erase(last.first);
+    _entries.pop_back();
+    _numEntries.subtractAndFetch(1);
+}
+
+void TextResultCache::_clear_inlock() {
+    textResultCacheBytes.decrement(_bytes);
+    _bytes = 0;
+    _index.clear();
+    _entries.clear();
+    _numEntries.store(0);
+}
+
+}  // namespace mongo
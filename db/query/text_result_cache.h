@@ -0,0 +1,129 @@
+/**
+ *    Copyright (C) 2016 MongoDB Inc.
+ *
+ *    This program is free software: you can redistribute it and/or  modify
+ *    it under the terms of the GNU Affero General Public License, version 3,
+ *    as published by the Free Software Foundation.
+ *
+ *    This program is distributed in the hope that it will be useful,
+ *    but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *    GNU Affero General Public License for more details.
+ *
+ *    You should have received a copy of the GNU Affero General Public License
+ *    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ *    As a special exception, the copyright holders give permission to link the
+ *    code of portions of this program with the OpenSSL library under certain
+ *    conditions as described in each individual source file and distribute
+ *    linked combinations including the program with the OpenSSL library. You
+ *    must comply with the GNU Affero General Public License in all respects for
+ *    all of the code used other than as permitted herein. If you modify file(s)
+ *    with this exception, you may extend this exception to your version of the
+ *    file(s), but you are not obligated to do so. If you do not wish to do so,
+ *    delete this exception statement from your version. If you delete this
+ *    exception statement from all source files in the program, then also delete
+ *    it in the license file.
+ */
+
+#pragma once
+
+#include <list>
+#include <memory>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include "mongo/base/disallow_copying.h"
+#include "mongo/db/record_id.h"
+#include "mongo/platform/atomic_word.h"
+#include "mongo/stdx/mutex.h"
+
+namespace mongo {
+
+/**
+ * Caches the results of text searches over one collection.  Each entry maps the key of a
+ * normalized text query (see TextStage) to the RecordIds and scores of every document the
+ * query returned.  Entries are evicted least recently used first to keep the cache within
+ * internalQueryTextResultCacheSizeBytes.
+ *
+ * Any write to the collection makes every entry stale, so CollectionInfoCache calls
+ * invalidate() for each write as well as whenever it clears the plan cache.  A search reads
+ * getGeneration() before it reads the collection and passes it back to add(): results computed
+ * while the collection was being written are never cached.
+ *
+ * Thread safe.
+ */
+class TextResultCache {
+    MONGO_DISALLOW_COPYING(TextResultCache);
+
+public:
+    struct Result {
+        RecordId recordId;
+        double score;  // NaN if the plan computed no text score
+    };
+    typedef std::vector<Result> Results;
+
+    TextResultCache() = default;
+    ~TextResultCache();
+
+    /**
+     * Counts the invalidations so far.  Read before the collection.
+     */
+    uint64_t getGeneration() const {
+        return _generation.load();
+    }
+
+    /**
+     * Returns the results cached for 'key', or null if there are none.
+     */
+    std::shared_ptr<const Results> get(const std::string& key);
+
+    /**
+     * Caches 'results' for 'key' unless the cache was invalidated after 'generation' was read or
+     * the entry alone would exceed the size bound.  Returns true if the results were cached.
+     */
+    bool add(const std::string& key, uint64_t generation, Results results);
+
+    /**
+     * Drops every entry and makes the searches in progress unable to add theirs.
+     */
+    void invalidate();
+
+    /**
+     * Number of entries.
+     */
+    size_t size() const;
+
+    /**
+     * Bytes accounted to the entries.
+     */
+    size_t bytes() const;
+
+    /**
+     * Bytes accounted to an entry for 'key' with 'numResults' results.
+     */
+    static size_t entryBytes(const std::string& key, size_t numResults);
+
+private:
+    typedef std::pair<std::string, std::shared_ptr<const Results>> Entry;
+    typedef std::list<Entry> EntryList;
+
+    void _evictLast_inlock();
+    void _clear_inlock();
+
+    mutable stdx::mutex _mutex;
+
+    // Most recently used first.
+    EntryList _entries;
+    std::unordered_map<std::string, EntryList::iterator> _index;
+    size_t _bytes = 0;
+
+    // invalidate() bumps _generation and then checks _numEntries without the mutex; add() bumps
+    // _numEntries and then checks _generation.  One of them sees the other's write, so an entry
+    // added concurrently with an invalidation never survives it.
+    AtomicUInt64 _generation;
+    AtomicUInt64 _numEntries;
+};
+
+}  // namespace mongo
@@ -0,0 +1,146 @@
+/**
+ *    Copyright (C) 2016 MongoDB Inc.
+ *
+ *    This program is free software: you can redistribute it and/or  modify
+ *    it under the terms of the GNU Affero General Public License, version 3,
+ *    as published by the Free Software Foundation.
+ *
+ *    This program is distributed in the hope that it will be useful,
+ *    but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *    GNU Affero General Public License for more details.
+ *
+ *    You should have received a copy of the GNU Affero General Public License
+ *    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ *    As a special exception, the copyright holders give permission to link the
+ *    code of portions of this program with the OpenSSL library under certain
+ *    conditions as described in each individual source file and distribute
+ *    linked combinations including the program with the OpenSSL library. You
+ *    must comply with the GNU Affero General Public License in all respects for
+ *    all of the code used other than as permitted herein. If you modify file(s)
+ *    with this exception, you may extend this exception to your version of the
+ *    file(s), but you are not obligated to do so. If you do not wish to do so,
+ *    delete this exception statement from your version. If you delete this
+ *    exception statement from all source files in the program, then also delete
+ *    it in the license file.
+ */
+
+/**
+ * This file contains tests for mongo/db/query/text_result_cache.h
+ */
+
+#include "mongo/db/query/text_result_cache.h"
+
+#include "mongo/db/query/query_knobs.h"
+#include "mongo/unittest/unittest.h"
+
+using namespace mongo;
+
+namespace {
+
+/**
+ * Sets the size bound of the cache for the duration of a test.
+ */
+class CacheSizeBound {
+public:
+    explicit CacheSizeBound(int bytes) : _saved(internalQueryTextResultCacheSizeBytes.load()) {
+        internalQueryTextResultCacheSizeBytes.store(bytes);
+    }
+
+    ~CacheSizeBound() {
+        internalQueryTextResultCacheSizeBytes.store(_saved);
+    }
+
+private:
+    const int _saved;
+};
+
+TextResultCache::Results makeResults(int n) {
+    TextResultCache::Results results;
+    for (int i = 0; i < n; ++i) {
+        results.push_back({RecordId(i + 1), 0.5 * i});
+    }
+    return results;
+}
+
+TEST(TextResultCacheTest, AddGet) {
+    TextResultCache cache;
+    ASSERT(!cache.get("a"));
+
+    ASSERT(cache.add("a", cache.getGeneration(), makeResults(3)));
+    auto results = cache.get("a");
+    ASSERT(results);
+    ASSERT_EQUALS(results->size(), 3U);
+    ASSERT_EQUALS((*results)[2].recordId, RecordId(3));
+    ASSERT_EQUALS((*results)[2].score, 1.0);
+    ASSERT(!cache.get("b"));
+    ASSERT_EQUALS(cache.size(), 1U);
+    ASSERT_EQUALS(cache.bytes(), TextResultCache::entryBytes("a", 3));
+}
+
+TEST(TextResultCacheTest, AddReplaces) {
+    TextResultCache cache;
+    ASSERT(cache.add("a", cache.getGeneration(), makeResults(3)));
+    ASSERT(cache.add("a", cache.getGeneration(), makeResults(5)));
+    ASSERT_EQUALS(cache.get("a")->size(), 5U);
+    ASSERT_EQUALS(cache.size(), 1U);
+    ASSERT_EQUALS(cache.bytes(), TextResultCache::entryBytes("a", 5));
+}
+
+TEST(TextResultCacheTest, InvalidateDropsEntries) {
+    TextResultCache cache;
+    uint64_t generation = cache.getGeneration();
+    ASSERT(cache.add("a", generation, makeResults(3)));
+
+    cache.invalidate();
+    ASSERT(!cache.get("a"));
+    ASSERT_EQUALS(cache.size(), 0U);
+    ASSERT_EQUALS(cache.bytes(), 0U);
+    ASSERT_NOT_EQUALS(cache.getGeneration(), generation);
+}
+
+TEST(TextResultCacheTest, StaleGenerationIsNotCached) {
+    TextResultCache cache;
+    uint64_t generation = cache.getGeneration();
+    cache.invalidate();
+    ASSERT(!cache.add("a", generation, makeResults(3)));
+    ASSERT(!cache.get("a"));
+    ASSERT(cache.add("a", cache.getGeneration(), makeResults(3)));
+}
+
+TEST(TextResultCacheTest, EvictsLeastRecentlyUsed) {
+    CacheSizeBound bound(3 * TextResultCache::entryBytes("a", 10));
+    TextResultCache cache;
+    ASSERT(cache.add("a", cache.getGeneration(), makeResults(10)));
+    ASSERT(cache.add("b", cache.getGeneration(), makeResults(10)));
+    ASSERT(cache.add("c", cache.getGeneration(), makeResults(10)));
+    ASSERT(cache.get("a"));
+
+    // "b" is the least recently used.
+    ASSERT(cache.add("d", cache.getGeneration(), makeResults(10)));
+    ASSERT_EQUALS(cache.size(), 3U);
+    ASSERT(cache.get("a"));
+    ASSERT(!cache.get("b"));
+    ASSERT(cache.get("c"));
+    ASSERT(cache.get("d"));
+    ASSERT_LESS_THAN_OR_EQUALS(cache.bytes(), 3 * TextResultCache::entryBytes("a", 10));
+}
+
+TEST(TextResultCacheTest, EntryOverBoundIsNotCached) {
+    CacheSizeBound bound(TextResultCache::entryBytes("a", 10));
+    TextResultCache cache;
+    ASSERT(cache.add("a", cache.getGeneration(), makeResults(10)));
+    ASSERT(!cache.add("b", cache.getGeneration(), makeResults(11)));
+    ASSERT(cache.get("a"));
+    ASSERT(!cache.get("b"));
+}
+
+TEST(TextResultCacheTest, DisabledCacheAddsNothing) {
+    CacheSizeBound bound(0);
+    TextResultCache cache;
+    ASSERT(!cache.add("a", cache.getGeneration(), makeResults(1)));
+    ASSERT_EQUALS(cache.size(), 0U);
+}
+
+}  // namespace
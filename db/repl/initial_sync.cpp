@@ -110,7 +110,7 @@ void InitialSync::_applyOplogUntil(OperationContext* txn, const OpTime& endOpTim
         bytesApplied += ops.getSize();
         entriesApplied += ops.getDeque().size();
 
-        const OpTime lastOpTime = multiApply(txn, ops);
+        const OpTime lastOpTime = multiApply(txn, &ops);
 
         replCoord->setMyLastAppliedOpTime(lastOpTime);
         setNewTimestamp(lastOpTime.getTimestamp());
@@ -270,11 +270,29 @@ void ApplyBatchFinalizerForJournal::_run() {
 }
 }  // anonymous namespace containing ApplyBatchFinalizer definitions.
 
+namespace {
+
+// A batch is partitioned into this many writer chains per writer thread, so that when one chain
+// is much longer than the others the idle writers can steal the remaining ones.
+const size_t kWriterChainsPerThread = 4;
+
+WorkStealingThreadPool::Options makeWriterPoolOptions() {
+    WorkStealingThreadPool::Options options;
+    options.poolName = "repl writer worker Pool";
+    options.threadNamePrefix = "repl writer worker ";
+    options.numThreads = SyncTail::replWriterThreadCount;
+    return options;
+}
+
+}  // namespace
+
 SyncTail::SyncTail(BackgroundSyncInterface* q, MultiSyncApplyFunc func)
     : _networkQueue(q),
       _applyFunc(func),
-      _writerPool(replWriterThreadCount, "repl writer worker "),
-      _prefetcherPool(replPrefetcherThreadCount, "repl prefetch worker ") {}
+      _writerPool(makeWriterPoolOptions()),
+      _prefetcherPool(replPrefetcherThreadCount, "repl prefetch worker ") {
+    _writerPool.startup();
+}
 
 SyncTail::~SyncTail() {}
 
@@ -440,19 +458,31 @@ void prefetchOps(const std::deque<SyncTail::OplogEntry>& ops, OldThreadPool* pre
     prefetcherPool->join();
 }
 
-// Doles out all the work to the writer pool threads and waits for them to complete
-void applyOps(const std::vector<std::vector<SyncTail::OplogEntry>>& writerVectors,
-              OldThreadPool* writerPool,
+// Doles out all the work to the writer pool threads. The caller waits for them to complete.
+void applyOps(const std::vector<std::vector<SyncTail::OplogEntry*>>& writerVectors,
+              WorkStealingThreadPool* writerPool,
               SyncTail::MultiSyncApplyFunc func,
               SyncTail* sync) {
     TimerHolder timer(&applyBatchStats);
-    for (std::vector<std::vector<SyncTail::OplogEntry>>::const_iterator it = writerVectors.begin();
-         it != writerVectors.end();
-         ++it) {
-        if (!it->empty()) {
-            writerPool->schedule(func, stdx::cref(*it), sync);
+
+    // Schedule the longest chains first. Each writer starts on the longest of its own chains and
+    // idle writers steal the shortest ones, which keeps a skewed batch from waiting on one writer.
+    std::vector<size_t> order;
+    for (size_t i = 0; i < writerVectors.size(); ++i) {
+        if (!writerVectors[i].empty()) {
+            order.push_back(i);
         }
     }
+    std::stable_sort(order.begin(),
+                     order.end(),
+                     [&](size_t l, size_t r) {
+                         return writerVectors[l].size() > writerVectors[r].size();
+                     });
+
+    for (size_t i : order) {
+        const auto& ops = writerVectors[i];
+        fassertStatusOK(34509, writerPool->schedule(i, [func, &ops, sync] { func(ops, sync); }));
+    }
 }
 
 /**
@@ -485,9 +515,12 @@ private:
     StringMap<bool> _cache;
 };
 
+// The ns and _id hashes were computed when the entries were parsed, so all that is left here is
+// the capped check, which must see the catalog as of this batch. The writer vectors point into
+// 'ops' rather than holding copies of the entries.
 void fillWriterVectors(OperationContext* txn,
-                       const std::deque<SyncTail::OplogEntry>& ops,
-                       std::vector<std::vector<SyncTail::OplogEntry>>* writerVectors) {
+                       std::deque<SyncTail::OplogEntry>* ops,
+                       std::vector<std::vector<SyncTail::OplogEntry*>>* writerVectors) {
     const bool supportsDocLocking =
         getGlobalServiceContext()->getGlobalStorageEngine()->supportsDocLocking();
     const uint32_t numWriters = writerVectors->size();
@@ -496,41 +529,23 @@ void fillWriterVectors(OperationContext* txn,
 
     CachingCappedChecker isCapped;
 
-    for (auto&& op : ops) {
-        StringMapTraits::HashedKey hashedNs(op.ns);
-        uint32_t hash = hashedNs.hash();
-
-        const char* opType = op.opType.rawData();
+    for (auto&& op : *ops) {
+        StringMapTraits::HashedKey hashedNs(op.ns, op.nsHash);
+        uint32_t hash = op.nsHash;
 
         // For doc locking engines, include the _id of the document in the hash so we get
         // parallelism even if all writes are to a single collection. We can't do this for capped
         // collections because the order of inserts is a guaranteed property, unlike for normal
         // collections.
-        if (supportsDocLocking && isCrudOpType(opType) && !isCapped(txn, hashedNs)) {
-            BSONElement id;
-            switch (opType[0]) {
-                case 'u':
-                    id = op.o2.Obj()["_id"];
-                    break;
-                case 'd':
-                case 'i':
-                    id = op.o.Obj()["_id"];
-                    break;
-            }
-
-            const size_t idHash = BSONElement::Hasher()(id);
-            MurmurHash3_x86_32(&idHash, sizeof(idHash), hash, &hash);
+        if (supportsDocLocking && isCrudOpType(op.opType.rawData()) && !isCapped(txn, hashedNs)) {
+            MurmurHash3_x86_32(&op.idHash, sizeof(op.idHash), hash, &hash);
         }
 
-        if (op.opType == "i" && isCapped(txn, hashedNs)) {
-            // Mark capped collection ops before storing them to ensure we do not attempt to bulk
-            // insert them.
-            SyncTail::OplogEntry modifiedOp = op;
-            modifiedOp.isForCappedCollection = true;
-            (*writerVectors)[hash % numWriters].push_back(modifiedOp);
-        } else {
-            (*writerVectors)[hash % numWriters].push_back(op);
-        }
+        // Mark capped collection ops before storing them to ensure we do not attempt to bulk
+        // insert them.
+        op.isForCappedCollection = op.opType == "i" && isCapped(txn, hashedNs);
+
+        (*writerVectors)[hash % numWriters].push_back(&op);
     }
 }
 
@@ -538,18 +553,19 @@ void fillWriterVectors(OperationContext* txn,
 
 // Applies a batch of oplog entries, by using a set of threads to apply the operations and then
 // writes the oplog entries to the local oplog.
-OpTime SyncTail::multiApply(OperationContext* txn, const OpQueue& ops) {
+OpTime SyncTail::multiApply(OperationContext* txn, OpQueue* ops) {
     invariant(_applyFunc);
 
     if (getGlobalServiceContext()->getGlobalStorageEngine()->isMmapV1()) {
         // Use a ThreadPool to prefetch all the operations in a batch.
-        prefetchOps(ops.getDeque(), &_prefetcherPool);
+        prefetchOps(ops->getDeque(), &_prefetcherPool);
     }
 
-    std::vector<std::vector<SyncTail::OplogEntry>> writerVectors(replWriterThreadCount);
+    std::vector<std::vector<SyncTail::OplogEntry*>> writerVectors(replWriterThreadCount *
+                                                                  kWriterChainsPerThread);
 
-    fillWriterVectors(txn, ops.getDeque(), &writerVectors);
-    LOG(2) << "replication batch size is " << ops.getDeque().size() << endl;
+    fillWriterVectors(txn, &ops->getDeque(), &writerVectors);
+    LOG(2) << "replication batch size is " << ops->getDeque().size() << endl;
     // We must grab this because we're going to grab write locks later.
     // We hold this mutex the entire time we're writing; it doesn't matter
     // because all readers are blocked anyway.
@@ -566,12 +582,13 @@ OpTime SyncTail::multiApply(OperationContext* txn, const OpQueue& ops) {
 
     applyOps(writerVectors, &_writerPool, _applyFunc, this);
 
+    // Write the batch to the local oplog while the writers apply it.
     OpTime lastOpTime;
     {
-        ON_BLOCK_EXIT([&] { _writerPool.join(); });
+        ON_BLOCK_EXIT([&] { _writerPool.waitForIdle(); });
         std::vector<BSONObj> raws;
-        raws.reserve(ops.getDeque().size());
-        for (auto&& op : ops.getDeque()) {
+        raws.reserve(ops->getDeque().size());
+        for (auto&& op : ops->getDeque()) {
             raws.emplace_back(op.raw);
         }
         lastOpTime = writeOpsToOplog(txn, raws);
@@ -814,7 +831,7 @@ void SyncTail::oplogApplication() {
         // This write will not journal/checkpoint.
         setMinValid(&txn, {start, end});
 
-        lastWriteOpTime = multiApply(&txn, ops);
+        lastWriteOpTime = multiApply(&txn, &ops);
         if (lastWriteOpTime.isNull()) {
             // fassert if oplog application failed for any reasons other than shutdown.
             error() << "Failed to apply " << ops.getDeque().size()
@@ -847,6 +864,15 @@ SyncTail::OplogEntry::OplogEntry(const BSONObj& rawInput) : raw(rawInput.getOwne
             o = elem;
         }
     }
+
+    nsHash = StringMapTraits::hash(ns);
+
+    const char* op = opType.rawData();
+    if (isCrudOpType(op)) {
+        const BSONElement& doc = op[0] == 'u' ? o2 : o;
+        const BSONElement id = doc.isABSONObj() ? doc.Obj()["_id"] : BSONElement();
+        idHash = BSONElement::Hasher()(id);
+    }
 }
 
 // Copies ops out of the bgsync queue into the deque passed in as a parameter.
@@ -1030,14 +1056,11 @@ static void initializeWriterThread() {
 }
 
 // This free function is used by the writer threads to apply each op
-void multiSyncApply(const std::vector<SyncTail::OplogEntry>& ops, SyncTail* st) {
+void multiSyncApply(const std::vector<SyncTail::OplogEntry*>& ops, SyncTail* st) {
     using OplogEntry = SyncTail::OplogEntry;
 
-    std::vector<OplogEntry> oplogEntries(ops.begin(), ops.end());
-    std::vector<OplogEntry*> oplogEntryPointers(oplogEntries.size());
-    for (size_t i = 0; i < oplogEntries.size(); i++) {
-        oplogEntryPointers[i] = &oplogEntries[i];
-    }
+    // Sort a copy of the pointers only; the entries themselves are owned by the batch.
+    std::vector<OplogEntry*> oplogEntryPointers(ops.begin(), ops.end());
 
     if (oplogEntryPointers.size() > 1) {
         std::stable_sort(oplogEntryPointers.begin(),
@@ -1146,7 +1169,7 @@ void multiSyncApply(const std::vector<SyncTail::OplogEntry>& ops, SyncTail* st)
 }
 
 // This free function is used by the initial sync writer threads to apply each op
-void multiInitialSyncApply(const std::vector<SyncTail::OplogEntry>& ops, SyncTail* st) {
+void multiInitialSyncApply(const std::vector<SyncTail::OplogEntry*>& ops, SyncTail* st) {
     initializeWriterThread();
 
     OperationContextImpl txn;
@@ -1158,15 +1181,14 @@ void multiInitialSyncApply(const std::vector<SyncTail::OplogEntry>& ops, SyncTai
 
     bool convertUpdatesToUpserts = false;
 
-    for (std::vector<SyncTail::OplogEntry>::const_iterator it = ops.begin(); it != ops.end();
-         ++it) {
+    for (auto&& op : ops) {
         try {
-            const Status s = SyncTail::syncApply(&txn, it->raw, convertUpdatesToUpserts);
+            const Status s = SyncTail::syncApply(&txn, op->raw, convertUpdatesToUpserts);
             if (!s.isOK()) {
-                if (st->shouldRetry(&txn, it->raw)) {
-                    const Status s2 = SyncTail::syncApply(&txn, it->raw, convertUpdatesToUpserts);
+                if (st->shouldRetry(&txn, op->raw)) {
+                    const Status s2 = SyncTail::syncApply(&txn, op->raw, convertUpdatesToUpserts);
                     if (!s2.isOK()) {
-                        severe() << "Error applying operation (" << it->raw.toString()
+                        severe() << "Error applying operation (" << op->raw.toString()
                                  << "): " << s2;
                         fassertFailedNoTrace(15915);
                     }
@@ -1178,7 +1200,7 @@ void multiInitialSyncApply(const std::vector<SyncTail::OplogEntry>& ops, SyncTai
             }
         } catch (const DBException& e) {
             severe() << "writer worker caught exception: " << causedBy(e)
-                     << " on: " << it->raw.toString();
+                     << " on: " << op->raw.toString();
 
             if (inShutdown()) {
                 return;
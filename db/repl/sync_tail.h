@@ -35,6 +35,7 @@
 #include "mongo/db/storage/mmap_v1/dur.h"
 #include "mongo/stdx/functional.h"
 #include "mongo/util/concurrency/old_thread_pool.h"
+#include "mongo/util/concurrency/work_stealing_thread_pool.h"
 
 namespace mongo {
 
@@ -66,6 +67,12 @@ public:
         // This member is not parsed from the BSON and is instead populated by fillWriterVectors.
         bool isForCappedCollection = false;
 
+        // Writer partitioning hashes. These are computed when the entry is parsed, on the batcher
+        // thread, so the next batch is hashed while the current one is being applied. idHash is
+        // the hash of the document _id for CRUD ops and zero otherwise.
+        uint32_t nsHash = 0;
+        size_t idHash = 0;
+
         BSONObj raw;  // Owned.
 
         StringData ns = "";
@@ -77,7 +84,7 @@ public:
     };
 
     using MultiSyncApplyFunc =
-        stdx::function<void(const std::vector<OplogEntry>& ops, SyncTail* st)>;
+        stdx::function<void(const std::vector<OplogEntry*>& ops, SyncTail* st)>;
 
     /**
      * Type of function to increment "repl.apply.ops" server status metric.
@@ -135,6 +142,9 @@ public:
         const std::deque<OplogEntry>& getDeque() const {
             return _deque;
         }
+        std::deque<OplogEntry>& getDeque() {
+            return _deque;
+        }
         void push_back(OplogEntry&& op) {
             _size += op.raw.objsize();
             _deque.push_back(std::move(op));
@@ -184,7 +194,8 @@ protected:
 
     // Apply a batch of operations, using multiple threads.
     // Returns the last OpTime applied during the apply batch, ops.end["ts"] basically.
-    OpTime multiApply(OperationContext* txn, const OpQueue& ops);
+    // The writer threads are handed pointers into 'ops', which must not change until this returns.
+    OpTime multiApply(OperationContext* txn, OpQueue* ops);
 
 private:
     class OpQueueBatcher;
@@ -196,15 +207,16 @@ private:
     // Function to use during applyOps
     MultiSyncApplyFunc _applyFunc;
 
-    // persistent pool of worker threads for writing ops to the databases
-    OldThreadPool _writerPool;
+    // persistent pool of worker threads for writing ops to the databases; ops are handed out as
+    // chains keyed by their writer partition, which idle workers steal from busy ones
+    WorkStealingThreadPool _writerPool;
     // persistent pool of worker threads for prefetching
     OldThreadPool _prefetcherPool;
 };
 
 // These free functions are used by the thread pool workers to write ops to the db.
-void multiSyncApply(const std::vector<SyncTail::OplogEntry>& ops, SyncTail* st);
-void multiInitialSyncApply(const std::vector<SyncTail::OplogEntry>& ops, SyncTail* st);
+void multiSyncApply(const std::vector<SyncTail::OplogEntry*>& ops, SyncTail* st);
+void multiInitialSyncApply(const std::vector<SyncTail::OplogEntry*>& ops, SyncTail* st);
 
 }  // namespace repl
 }  // namespace mongo
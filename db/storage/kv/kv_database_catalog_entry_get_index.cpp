@@ -36,6 +36,7 @@
 #include "mongo/db/index/2d_access_method.h"
 #include "mongo/db/index/btree_access_method.h"
 #include "mongo/db/index/fts_access_method.h"
+#include "mongo/db/index/pix_access_method.h"
 #include "mongo/db/index/hash_access_method.h"
 #include "mongo/db/index/haystack_access_method.h"
 #include "mongo/db/index/index_access_method.h"
@@ -70,8 +71,11 @@ IndexAccessMethod* KVDatabaseCatalogEntry::getIndex(OperationContext* txn,
     if (IndexNames::GEO_2DSPHERE == type)
         return new S2AccessMethod(index, sdi);
 
-    if (IndexNames::TEXT == type)
+    if (IndexNames::TEXT == type) {
+        if (desc->infoObj()["pix"].trueValue())
+            return new PixAccessMethod(index, sdi);
         return new FTSAccessMethod(index, sdi);
+    }
 
     if (IndexNames::GEO_HAYSTACK == type)
         return new HaystackAccessMethod(index, sdi);
@@ -39,6 +39,7 @@
 #include "mongo/db/index/btree_access_method.h"
 #include "mongo/db/index/index_access_method.h"
 #include "mongo/db/index/fts_access_method.h"
+#include "mongo/db/index/pix_access_method.h"
 #include "mongo/db/index/hash_access_method.h"
 #include "mongo/db/index/haystack_access_method.h"
 #include "mongo/db/index/s2_access_method.h"
@@ -746,8 +747,11 @@ IndexAccessMethod* MMAPV1DatabaseCatalogEntry::getIndex(OperationContext* txn,
     if (IndexNames::GEO_2DSPHERE == type)
         return new S2AccessMethod(entry, btree.release());
 
-    if (IndexNames::TEXT == type)
+    if (IndexNames::TEXT == type) {
+        if (entry->descriptor()->infoObj()["pix"].trueValue())
+            return new PixAccessMethod(entry, btree.release());
         return new FTSAccessMethod(entry, btree.release());
+    }
 
     if (IndexNames::GEO_HAYSTACK == type)
         return new HaystackAccessMethod(entry, btree.release());
@@ -63,6 +63,7 @@
 #include "mongo/db/storage/storage_options.h"
 #include "mongo/util/log.h"
 #include "mongo/util/background.h"
+#include "mongo/util/concurrency/adaptive_ticket_controller.h"
 #include "mongo/util/concurrency/ticketholder.h"
 #include "mongo/util/exit.h"
 #include "mongo/util/processinfo.h"
@@ -166,8 +167,77 @@ TicketHolder openReadTransaction(128);
 TicketServerParameter openReadTransactionParam(&openReadTransaction,
                                                "wiredTigerConcurrentReadTransactions");
 
+// Shares of the tickets above open to operations that have yielded, such as collection scans.
+TicketHolder openLongWriteTransaction(64);
+TicketServerParameter openLongWriteTransactionParam(&openLongWriteTransaction,
+                                                    "wiredTigerConcurrentLongWriteTransactions");
+
+TicketHolder openLongReadTransaction(64);
+TicketServerParameter openLongReadTransactionParam(&openLongReadTransaction,
+                                                   "wiredTigerConcurrentLongReadTransactions");
+
+// How often to resize the transaction tickets from their observed hold times and throughput,
+// within [wiredTigerMinConcurrentTransactions, wiredTigerMaxConcurrentTransactions]. 0 keeps
+// them at the sizes set through the parameters above.
+MONGO_EXPORT_SERVER_PARAMETER(wiredTigerTicketAdjustmentMillis, int, 0);
+MONGO_EXPORT_SERVER_PARAMETER(wiredTigerMinConcurrentTransactions, int, 16);
+MONGO_EXPORT_SERVER_PARAMETER(wiredTigerMaxConcurrentTransactions, int, 512);
+
 }  // namespace
 
+class WiredTigerKVEngine::WiredTigerTicketAdjuster : public BackgroundJob {
+public:
+    WiredTigerTicketAdjuster() : BackgroundJob(false /* deleteSelf */) {}
+
+    virtual string name() const {
+        return "WTTicketAdjuster";
+    }
+
+    virtual void run() {
+        LOG(1) << "starting " << name() << " thread";
+
+        std::unique_ptr<AdaptiveTicketController> read;
+        std::unique_ptr<AdaptiveTicketController> write;
+        while (!_shuttingDown.load()) {
+            const int ms = wiredTigerTicketAdjustmentMillis.load();
+            if (ms <= 0) {
+                // Start afresh, from whatever sizes were set meanwhile, once enabled again.
+                read.reset();
+                write.reset();
+                sleepmillis(1000);
+                continue;
+            }
+
+            if (!read) {
+                read = stdx::make_unique<AdaptiveTicketController>(&openReadTransaction,
+                                                                   &openLongReadTransaction);
+                write = stdx::make_unique<AdaptiveTicketController>(&openWriteTransaction,
+                                                                    &openLongWriteTransaction);
+            }
+
+            sleepmillis(ms);
+
+            const int minTickets = wiredTigerMinConcurrentTransactions.load();
+            const int maxTickets = wiredTigerMaxConcurrentTransactions.load();
+            read->adjust(minTickets, maxTickets);
+            write->adjust(minTickets, maxTickets);
+        }
+        LOG(1) << "stopping " << name() << " thread";
+    }
+
+    /**
+     * Returns false if the thread did not stop in time, which happens when shrinking a holder
+     * waits for tickets that are not released before shutdown.
+     */
+    bool shutdown() {
+        _shuttingDown.store(true);
+        return wait(5000);
+    }
+
+private:
+    std::atomic<bool> _shuttingDown{false};  // NOLINT
+};
+
 WiredTigerKVEngine::WiredTigerKVEngine(const std::string& canonicalName,
                                        const std::string& path,
                                        const std::string& extraOpenOptions,
@@ -265,6 +335,10 @@ WiredTigerKVEngine::WiredTigerKVEngine(const std::string& canonicalName,
     }
 
     Locker::setGlobalThrottling(&openReadTransaction, &openWriteTransaction);
+    Locker::setLongRunningThrottling(&openLongReadTransaction, &openLongWriteTransaction);
+
+    _ticketAdjuster = stdx::make_unique<WiredTigerTicketAdjuster>();
+    _ticketAdjuster->go();
 }
 
 
@@ -292,6 +366,20 @@ void WiredTigerKVEngine::appendGlobalStats(BSONObjBuilder& b) {
         bbb.append("totalTickets", openReadTransaction.outof());
         bbb.done();
     }
+    {
+        BSONObjBuilder bbb(bb.subobjStart("longRunningWrite"));
+        bbb.append("out", openLongWriteTransaction.used());
+        bbb.append("available", openLongWriteTransaction.available());
+        bbb.append("totalTickets", openLongWriteTransaction.outof());
+        bbb.done();
+    }
+    {
+        BSONObjBuilder bbb(bb.subobjStart("longRunningRead"));
+        bbb.append("out", openLongReadTransaction.used());
+        bbb.append("available", openLongReadTransaction.available());
+        bbb.append("totalTickets", openLongReadTransaction.outof());
+        bbb.done();
+    }
     bb.done();
 }
 
@@ -302,6 +390,10 @@ void WiredTigerKVEngine::cleanShutdown() {
         // these must be the last things we do before _conn->close();
         if (_journalFlusher)
             _journalFlusher->shutdown();
+        if (_ticketAdjuster && !_ticketAdjuster->shutdown()) {
+            // Still blocked resizing; it only touches the static ticket holders, so let it be.
+            _ticketAdjuster.release();
+        }
         _sizeStorer.reset();
         _sessionCache->shuttingDown();
 
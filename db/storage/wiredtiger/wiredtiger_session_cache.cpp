@@ -34,12 +34,15 @@
 #include "mongo/db/storage/wiredtiger/wiredtiger_session_cache.h"
 
 #include "mongo/base/error_codes.h"
+#include "mongo/bson/bsonobjbuilder.h"
 #include "mongo/db/storage/journal_listener.h"
 #include "mongo/db/storage/wiredtiger/wiredtiger_kv_engine.h"
 #include "mongo/db/storage/wiredtiger/wiredtiger_util.h"
 #include "mongo/stdx/memory.h"
 #include "mongo/stdx/thread.h"
+#include "mongo/util/concurrency/threadlocal.h"
 #include "mongo/util/log.h"
+#include "mongo/util/processinfo.h"
 #include "mongo/util/scopeguard.h"
 
 namespace mongo {
@@ -132,11 +135,39 @@ uint64_t WiredTigerSession::genTableId() {
 
 // -----------------------
 
+namespace {
+
+const size_t kMaxShards = 64;
+
+// Home shards are handed out round robin, in the order threads first use a session cache.
+AtomicUInt32 nextShardHint;
+MONGO_TRIVIALLY_CONSTRUCTIBLE_THREAD_LOCAL uint32_t shardHint;  // 0 until first use
+
+size_t shardCount() {
+    ProcessInfo pi;
+    const size_t cores = std::max(1u, pi.getNumCores());
+    size_t n = 1;
+    while (n < cores && n < kMaxShards) {
+        n <<= 1;
+    }
+    return n;
+}
+
+}  // namespace
+
 WiredTigerSessionCache::WiredTigerSessionCache(WiredTigerKVEngine* engine)
-    : _engine(engine), _conn(engine->getConnection()), _snapshotManager(_conn), _shuttingDown(0) {}
+    : _engine(engine), _conn(engine->getConnection()), _snapshotManager(_conn), _shuttingDown(0) {
+    for (size_t i = shardCount(); i > 0; --i) {
+        _shards.push_back(stdx::make_unique<Shard>());
+    }
+}
 
 WiredTigerSessionCache::WiredTigerSessionCache(WT_CONNECTION* conn)
-    : _engine(NULL), _conn(conn), _snapshotManager(_conn), _shuttingDown(0) {}
+    : _engine(NULL), _conn(conn), _snapshotManager(_conn), _shuttingDown(0) {
+    for (size_t i = shardCount(); i > 0; --i) {
+        _shards.push_back(stdx::make_unique<Shard>());
+    }
+}
 
 WiredTigerSessionCache::~WiredTigerSessionCache() {
     shuttingDown();
@@ -218,13 +249,17 @@ void WiredTigerSessionCache::waitUntilDurable(bool forceCheckpoint) {
 }
 
 void WiredTigerSessionCache::closeAll() {
-    // Increment the epoch as we are now closing all sessions with this epoch
-    SessionCache swap;
+    // Increment the epoch as we are now closing all sessions with this epoch. A session released
+    // to a shard after we have emptied it sees the new epoch under the shard lock and is freed.
+    _epoch.fetchAndAdd(1);
 
-    {
-        stdx::lock_guard<stdx::mutex> lock(_cacheLock);
-        _epoch.fetchAndAdd(1);
-        _sessions.swap(swap);
+    SessionCache swap;
+    for (size_t i = 0; i < _shards.size(); ++i) {
+        Shard& shard = *_shards[i];
+        stdx::lock_guard<stdx::mutex> lock(shard.lock);
+        swap.insert(swap.end(), shard.sessions.begin(), shard.sessions.end());
+        shard.sessions.clear();
+        shard.cached.store(0);
     }
 
     for (SessionCache::iterator i = swap.begin(); i != swap.end(); i++) {
@@ -241,18 +276,42 @@ UniqueWiredTigerSession WiredTigerSessionCache::getSession() {
     // operations should be allowed to start.
     invariant(!(_shuttingDown.loadRelaxed() & kShuttingDownMask));
 
-    {
-        stdx::lock_guard<stdx::mutex> lock(_cacheLock);
-        if (!_sessions.empty()) {
+    // Try the home shard first, then any other shard that has sessions and is not locked.
+    const size_t home = _homeShard();
+    const size_t mask = _shards.size() - 1;
+    for (size_t i = 0; i < _shards.size(); ++i) {
+        Shard& shard = *_shards[(home + i) & mask];
+        if (shard.cached.loadRelaxed() == 0)
+            continue;
+
+        stdx::unique_lock<stdx::mutex> lock(shard.lock, stdx::defer_lock);
+        if (i == 0) {
+            _lockShard(shard, lock);
+        } else if (!lock.try_lock()) {
+            continue;
+        }
+
+        while (!shard.sessions.empty()) {
             // Get the most recently used session so that if we discard sessions, we're
             // discarding older ones
-            WiredTigerSession* cachedSession = _sessions.back();
-            _sessions.pop_back();
+            WiredTigerSession* cachedSession = shard.sessions.back();
+            shard.sessions.pop_back();
+            shard.cached.store(shard.sessions.size());
+
+            // closeAll may not have reached this shard yet
+            if (cachedSession->_getEpoch() != _epoch.load()) {
+                delete cachedSession;
+                continue;
+            }
+
+            if (i != 0)
+                _sessionsStolen.fetchAndAdd(1);
             return UniqueWiredTigerSession(cachedSession);
         }
     }
 
     // Outside of the cache partition lock, but on release will be put back on the cache
+    _sessionsCreated.fetchAndAdd(1);
     return UniqueWiredTigerSession(new WiredTigerSession(_conn, this, _epoch.load()));
 }
 
@@ -284,10 +343,13 @@ void WiredTigerSessionCache::releaseSession(WiredTigerSession* session) {
     uint64_t currentEpoch = _epoch.load();
 
     if (session->_getEpoch() == currentEpoch) {  // check outside of lock to reduce contention
-        stdx::lock_guard<stdx::mutex> lock(_cacheLock);
+        Shard& shard = *_shards[_homeShard()];
+        stdx::unique_lock<stdx::mutex> lock(shard.lock, stdx::defer_lock);
+        _lockShard(shard, lock);
         if (session->_getEpoch() == _epoch.load()) {  // recheck inside the lock for correctness
             returnedToCache = true;
-            _sessions.push_back(session);
+            shard.sessions.push_back(session);
+            shard.cached.store(shard.sessions.size());
         }
     } else
         invariant(session->_getEpoch() < currentEpoch);
@@ -300,6 +362,45 @@ void WiredTigerSessionCache::releaseSession(WiredTigerSession* session) {
 }
 
 
+size_t WiredTigerSessionCache::_homeShard() const {
+    while (MONGO_unlikely(shardHint == 0)) {
+        shardHint = nextShardHint.addAndFetch(1);
+    }
+    return shardHint & (_shards.size() - 1);
+}
+
+void WiredTigerSessionCache::_lockShard(Shard& shard, stdx::unique_lock<stdx::mutex>& lk) {
+    if (!lk.try_lock()) {
+        shard.contended.fetchAndAdd(1);
+        lk.lock();
+    }
+}
+
+void WiredTigerSessionCache::appendStats(BSONObjBuilder& b) const {
+    BSONObjBuilder bb(b.subobjStart("sessionCache"));
+    bb.append("shards", static_cast<int>(_shards.size()));
+    bb.append("created", static_cast<long long>(_sessionsCreated.load()));
+    bb.append("takenFromOtherShards", static_cast<long long>(_sessionsStolen.load()));
+
+    long long cached = 0;
+    long long contended = 0;
+    BSONArrayBuilder cachedPerShard;
+    BSONArrayBuilder contendedPerShard;
+    for (size_t i = 0; i < _shards.size(); ++i) {
+        const uint32_t shardCached = _shards[i]->cached.load();
+        const uint64_t shardContended = _shards[i]->contended.load();
+        cached += shardCached;
+        contended += shardContended;
+        cachedPerShard.append(static_cast<int>(shardCached));
+        contendedPerShard.append(static_cast<long long>(shardContended));
+    }
+    bb.append("cached", cached);
+    bb.append("contended", contended);
+    bb.append("cachedPerShard", cachedPerShard.arr());
+    bb.append("contendedPerShard", contendedPerShard.arr());
+    bb.done();
+}
+
 void WiredTigerSessionCache::setJournalListener(JournalListener* jl) {
     stdx::unique_lock<stdx::mutex> lk(_journalListenerMutex);
     _journalListener = jl;
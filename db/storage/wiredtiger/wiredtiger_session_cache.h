@@ -32,7 +32,9 @@
 #pragma once
 
 #include <list>
+#include <memory>
 #include <string>
+#include <vector>
 
 #include <boost/thread/shared_mutex.hpp>
 #include <wiredtiger.h>
@@ -45,6 +47,7 @@
 
 namespace mongo {
 
+class BSONObjBuilder;
 class WiredTigerKVEngine;
 class WiredTigerSessionCache;
 
@@ -131,6 +134,10 @@ private:
 /**
  *  This cache implements a shared pool of WiredTiger sessions with the goal to amortize the
  *  cost of session creation and destruction over multiple uses.
+ *
+ *  The pool is split into shards, one per core rounded up to a power of two, each with its own
+ *  lock. A thread gets and releases sessions through its home shard. When that shard is empty it
+ *  takes a session from any other shard whose lock is free before creating a new one.
  */
 class WiredTigerSessionCache {
 public:
@@ -187,7 +194,33 @@ public:
 
     void setJournalListener(JournalListener* jl);
 
+    /**
+     * Appends the number of shards, sessions created, sessions taken from another thread's shard
+     * and, per shard, the sessions cached and the lock acquisitions that had to wait.
+     */
+    void appendStats(BSONObjBuilder& b) const;
+
 private:
+    typedef std::vector<WiredTigerSession*> SessionCache;
+
+    /**
+     * One partition of the cached sessions. Padded so that the locks of neighbouring shards do
+     * not share a cache line.
+     */
+    struct Shard {
+        stdx::mutex lock;
+        SessionCache sessions;
+        AtomicUInt32 cached;      // sessions.size(), readable without the lock
+        AtomicUInt64 contended;   // lock acquisitions that found the lock held
+        char pad[64];
+    };
+
+    // Returns the index of the calling thread's home shard.
+    size_t _homeShard() const;
+
+    // Locks 'shard' through 'lk', counting the acquisition as contended if it has to wait.
+    static void _lockShard(Shard& shard, stdx::unique_lock<stdx::mutex>& lk);
+
     WiredTigerKVEngine* _engine;  // not owned, might be NULL
     WT_CONNECTION* _conn;         // not owned
     WiredTigerSnapshotManager _snapshotManager;
@@ -198,9 +231,9 @@ private:
     AtomicUInt32 _shuttingDown;
     static const uint32_t kShuttingDownMask = 1 << 31;
 
-    stdx::mutex _cacheLock;
-    typedef std::vector<WiredTigerSession*> SessionCache;
-    SessionCache _sessions;
+    std::vector<std::unique_ptr<Shard>> _shards;  // size is a power of two
+    AtomicUInt64 _sessionsCreated;
+    AtomicUInt64 _sessionsStolen;
 
     // Bumped when all open sessions need to be closed
     AtomicUInt64 _epoch;  // atomic so we can check it outside of the lock
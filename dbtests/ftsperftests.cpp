@@ -0,0 +1,561 @@
+/**
+ *    Copyright (C) 2016 MongoDB Inc.
+ *
+ *    This program is free software: you can redistribute it and/or  modify
+ *    it under the terms of the GNU Affero General Public License, version 3,
+ *    as published by the Free Software Foundation.
+ *
+ *    This program is distributed in the hope that it will be useful,
+ *    but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *    GNU Affero General Public License for more details.
+ *
+ *    You should have received a copy of the GNU Affero General Public License
+ *    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ *    As a special exception, the copyright holders give permission to link the
+ *    code of portions of this program with the OpenSSL library under certain
+ *    conditions as described in each individual source file and distribute
+ *    linked combinations including the program with the OpenSSL library. You
+ *    must comply with the GNU Affero General Public License in all respects for
+ *    all of the code used other than as permitted herein. If you modify file(s)
+ *    with this exception, you may extend this exception to your version of the
+ *    file(s), but you are not obligated to do so. If you do not wish to do so,
+ *    delete this exception statement from your version. If you delete this
+ *    exception statement from all source files in the program, then also delete
+ *    it in the license file.
+ */
+
+/**
+ * Benchmarks of text indexing and search over a deterministic synthetic corpus:
+ * tokenizing and stemming throughput, text index build rate for each kind of text index, query
+ * latency percentiles for single term, AND, phrase and proximity searches, and the pix block
+ * formats, both as raw PixCodec block codecs and as posting lists scanned by a PostingCursor.
+ *
+ * Each benchmark prints one line "ftsperf <json>" with its results, so runs can be compared by
+ * a script.  Run them with "dbtest ftsperf".
+ */
+
+#define MONGO_LOG_DEFAULT_COMPONENT ::mongo::logger::LogComponent::kDefault
+
+#include "mongo/platform/basic.h"
+
+#include <algorithm>
+#include <cmath>
+#include <iostream>
+#include <string>
+#include <vector>
+
+#include "mongo/client/dbclientcursor.h"
+#include "mongo/db/dbdirectclient.h"
+#include "mongo/db/fts/fts_language.h"
+#include "mongo/db/fts/fts_tokenizer.h"
+#include "mongo/db/fts/fts_util.h"
+#include "mongo/db/fts/pix_codec.h"
+#include "mongo/db/fts/pix_doc_posting.h"
+#include "mongo/db/fts/pix_posting_cursor.h"
+#include "mongo/db/fts/pix_posting_list.h"
+#include "mongo/db/fts/stemmer.h"
+#include "mongo/db/operation_context_impl.h"
+#include "mongo/dbtests/dbtests.h"
+#include "mongo/platform/random.h"
+#include "mongo/util/mongoutils/str.h"
+#include "mongo/util/timer.h"
+
+namespace FTSPerfTests {
+
+using std::string;
+using std::vector;
+
+using fts::FTSLanguage;
+using fts::FTSTokenizer;
+using mongo::DocPosting;
+using mongo::PixCodec;
+using mongo::PostingCursor;
+using mongo::PostingList;
+using fts::Stemmer;
+
+const int32_t kSeed = 1234;
+
+/**
+ * Prints the results of one benchmark as a line of JSON.
+ */
+void report(StringData benchmark, const BSONObj& results) {
+    BSONObjBuilder b;
+    b.append("benchmark", benchmark);
+    DEV {
+        b.append("debug", true);
+    }
+    b.appendElements(results);
+    std::cout << "ftsperf " << b.obj().jsonString() << std::endl;
+}
+
+/**
+ * Appends the count, mean and percentiles of 'micros' to 'b'.
+ */
+void appendLatencies(vector<long long> micros, BSONObjBuilder* b) {
+    invariant(!micros.empty());
+    std::sort(micros.begin(), micros.end());
+
+    long long total = 0;
+    for (long long m : micros)
+        total += m;
+
+    auto percentile = [&micros](double p) {
+        return micros[std::min(micros.size() - 1, static_cast<size_t>(p * micros.size()))];
+    };
+    b->append("queries", static_cast<long long>(micros.size()));
+    b->append("meanMicros", static_cast<double>(total) / micros.size());
+    b->append("p50Micros", percentile(0.50));
+    b->append("p90Micros", percentile(0.90));
+    b->append("p99Micros", percentile(0.99));
+    b->append("maxMicros", micros.back());
+}
+
+double perSecond(long long count, long long micros) {
+    return micros > 0 ? count * 1000.0 * 1000.0 / micros : 0;
+}
+
+/**
+ * English-like text drawn from a fixed seed.  Words are built from syllables and common
+ * suffixes, so that stemming has work to do, and are drawn with a Zipf-like skew: the word of
+ * rank r is about r times less frequent than the most frequent one.
+ */
+class Corpus {
+public:
+    static const Corpus& get() {
+        static const Corpus corpus;
+        return corpus;
+    }
+
+    const vector<string>& documents() const {
+        return _documents;
+    }
+
+    /**
+     * The word of rank 'rank', with rank 0 the most frequent.
+     */
+    const string& word(size_t rank) const {
+        return _vocabulary[rank % _vocabulary.size()];
+    }
+
+    /**
+     * 'count' pairs of adjacent words, for phrase and proximity queries.
+     */
+    vector<string> adjacentPairs(size_t count) const {
+        vector<string> pairs;
+        for (size_t i = 0; pairs.size() < count; i++) {
+            const string& doc = _documents[(i * 7919) % _documents.size()];
+            size_t first = doc.find(' ', doc.size() / 2);
+            if (first == string::npos)
+                continue;
+            size_t second = doc.find(' ', first + 1);
+            if (second == string::npos)
+                continue;
+            size_t third = doc.find(' ', second + 1);
+            if (third != string::npos)
+                pairs.push_back(doc.substr(first + 1, third - first - 1));
+        }
+        return pairs;
+    }
+
+    long long bytes() const {
+        return _bytes;
+    }
+
+    static const size_t kVocabularySize = 5000;
+
+private:
+    Corpus() : _bytes(0) {
+        static const char* const kOnsets[] = {
+            "b", "c", "d", "f", "g", "h", "l", "m", "n", "p", "r", "s", "t", "v", "st", "tr", "pl"};
+        static const char* const kVowels[] = {"a", "e", "i", "o", "u", "ea", "ou"};
+        static const char* const kSuffixes[] = {"", "", "s", "ing", "ed", "er", "ly", "ness"};
+
+        PseudoRandom random(kSeed);
+        for (size_t i = 0; i < kVocabularySize; i++) {
+            string word;
+            int syllables = 1 + random.nextInt32(3);
+            for (int s = 0; s < syllables; s++) {
+                word += kOnsets[random.nextInt32(sizeof(kOnsets) / sizeof(kOnsets[0]))];
+                word += kVowels[random.nextInt32(sizeof(kVowels) / sizeof(kVowels[0]))];
+            }
+            word += "n";
+            word += kSuffixes[random.nextInt32(sizeof(kSuffixes) / sizeof(kSuffixes[0]))];
+            _vocabulary.push_back(word);
+        }
+
+        size_t numDocuments = 5000;
+        DEV {
+            numDocuments = 500;
+        }
+        for (size_t d = 0; d < numDocuments; d++) {
+            string doc;
+            int length = 50 + random.nextInt32(100);
+            for (int w = 0; w < length; w++) {
+                if (w > 0)
+                    doc += ' ';
+                // Rank kVocabularySize^u - 1 for uniform u in [0, 1).
+                double u = random.nextCanonicalDouble();
+                doc += word(static_cast<size_t>(std::pow(kVocabularySize, u)) - 1);
+            }
+            _bytes += doc.size();
+            _documents.push_back(doc);
+        }
+    }
+
+    vector<string> _vocabulary;
+    vector<string> _documents;
+    long long _bytes;
+};
+
+const FTSLanguage& english() {
+    return *FTSLanguage::make("english", fts::TEXT_INDEX_VERSION_3).getValue();
+}
+
+/**
+ * The kinds of text index benchmarked, with the options that create them.
+ */
+struct IndexKind {
+    const char* name;
+    BSONObj options;
+};
+
+vector<IndexKind> indexKinds() {
+    return {IndexKind{"text", BSONObj()},
+            IndexKind{"pix", BSON("pix" << true)},
+            IndexKind{"proximity", BSON("proximity" << 2)}};
+}
+
+string corpusNs(const IndexKind& kind) {
+    return string("ftsperf.") + kind.name;
+}
+
+/**
+ * Loads the corpus into the collection of 'kind' and returns the micros taken to build its
+ * text index.
+ */
+long long buildCorpusCollection(OperationContext* txn, const IndexKind& kind) {
+    const string ns = corpusNs(kind);
+    DBDirectClient client(txn);
+    client.dropCollection(ns);
+
+    const vector<string>& documents = Corpus::get().documents();
+    vector<BSONObj> batch;
+    for (size_t i = 0; i < documents.size(); i++) {
+        batch.push_back(BSON("_id" << static_cast<int>(i) << "body" << documents[i]));
+        if (batch.size() == 100 || i + 1 == documents.size()) {
+            client.insert(ns, batch);
+            batch.clear();
+        }
+    }
+
+    BSONObjBuilder spec;
+    spec.append("name", "body_text");
+    spec.append("ns", ns);
+    spec.append("key", BSON("body"
+                            << "text"));
+    spec.appendElements(kind.options);
+
+    Timer t;
+    ASSERT_OK(dbtests::createIndexFromSpec(txn, ns, spec.obj()));
+    return t.micros();
+}
+
+/**
+ * Tokens per second of the english tokenizer, with stop words filtered out.
+ */
+class Tokenize {
+public:
+    void run() {
+        const Corpus& corpus = Corpus::get();
+        std::unique_ptr<FTSTokenizer> tokenizer = english().createTokenizer();
+
+        long long tokens = 0;
+        Timer t;
+        for (const string& doc : corpus.documents()) {
+            tokenizer->reset(doc, FTSTokenizer::kFilterStopWords);
+            while (tokenizer->moveNext())
+                tokens++;
+        }
+        long long micros = t.micros();
+        ASSERT_GREATER_THAN(tokens, 0);
+
+        report("tokenize",
+               BSON("tokens" << tokens << "micros" << micros << "tokensPerSecond"
+                             << perSecond(tokens, micros) << "megabytesPerSecond"
+                             << perSecond(corpus.bytes(), micros) / (1024 * 1024)));
+    }
+};
+
+/**
+ * Words per second through the english stemmer.
+ */
+class Stem {
+public:
+    void run() {
+        const Corpus& corpus = Corpus::get();
+        Stemmer stemmer(&english());
+
+        long long words = 0;
+        size_t stemBytes = 0;
+        Timer t;
+        for (const string& doc : corpus.documents()) {
+            size_t start = 0;
+            while (start < doc.size()) {
+                size_t end = std::min(doc.find(' ', start), doc.size());
+                stemBytes += stemmer.stem(StringData(doc).substr(start, end - start)).size();
+                words++;
+                start = end + 1;
+            }
+        }
+        long long micros = t.micros();
+        ASSERT_GREATER_THAN(stemBytes, 0U);
+
+        report("stem",
+               BSON("words" << words << "micros" << micros << "wordsPerSecond"
+                            << perSecond(words, micros)));
+    }
+};
+
+/**
+ * Documents per second indexed by a foreground build of each kind of text index.
+ */
+class IndexBuild {
+public:
+    void run() {
+        OperationContextImpl txn;
+        long long numDocuments = Corpus::get().documents().size();
+        for (const IndexKind& kind : indexKinds()) {
+            long long micros = buildCorpusCollection(&txn, kind);
+            report("indexBuild",
+                   BSON("index" << kind.name << "documents" << numDocuments << "micros" << micros
+                                << "documentsPerSecond" << perSecond(numDocuments, micros)));
+            DBDirectClient(&txn).dropCollection(corpusNs(kind));
+        }
+    }
+};
+
+/**
+ * Latency percentiles of text queries against each kind of text index.  The collections are
+ * rebuilt so that this benchmark can run on its own.
+ */
+class QueryLatency {
+public:
+    void run() {
+        OperationContextImpl txn;
+        DBDirectClient client(&txn);
+        const Corpus& corpus = Corpus::get();
+
+        // Single terms from the frequent to the rare, pairs of frequent terms that must both
+        // match, and phrases and proximity windows over words that do occur together.
+        vector<string> terms;
+        vector<string> conjunctions;
+        for (size_t i = 0; i < 20; i++) {
+            terms.push_back(corpus.word(1 + i * i * 10));
+            conjunctions.push_back(str::stream() << "\"" << corpus.word(i) << "\" \""
+                                                 << corpus.word(i + 20) << "\"");
+        }
+        vector<string> pairs = corpus.adjacentPairs(20);
+        vector<string> phrases;
+        for (const string& pair : pairs)
+            phrases.push_back("\"" + pair + "\"");
+
+        for (const IndexKind& kind : indexKinds()) {
+            buildCorpusCollection(&txn, kind);
+            const string ns = corpusNs(kind);
+
+            measure(&client, ns, kind, "single", terms, BSONObj());
+            measure(&client, ns, kind, "and", conjunctions, BSONObj());
+            measure(&client, ns, kind, "phrase", phrases, BSONObj());
+            if (kind.options.hasField("proximity"))
+                measure(&client, ns, kind, "proximity", pairs, BSON("$proximity" << 8));
+
+            client.dropCollection(ns);
+        }
+    }
+
+private:
+    static const int kRounds = 10;
+
+    void measure(DBClientBase* client,
+                 const string& ns,
+                 const IndexKind& kind,
+                 StringData queryType,
+                 const vector<string>& searches,
+                 const BSONObj& textOptions) {
+        vector<long long> micros;
+        long long results = 0;
+        for (int round = 0; round < kRounds; round++) {
+            for (const string& search : searches) {
+                BSONObjBuilder text;
+                text.append("$search", search);
+                text.appendElements(textOptions);
+                BSONObj query = BSON("$text" << text.obj());
+
+                Timer t;
+                std::unique_ptr<DBClientCursor> cursor = client->query(ns, query);
+                while (cursor->more()) {
+                    cursor->nextSafe();
+                    results++;
+                }
+                micros.push_back(t.micros());
+            }
+        }
+        ASSERT_GREATER_THAN(results, 0);
+
+        BSONObjBuilder b;
+        b.append("index", kind.name);
+        b.append("query", queryType);
+        b.append("results", results / kRounds);
+        appendLatencies(micros, &b);
+        report("query", b.obj());
+    }
+};
+
+/**
+ * The block formats a pix index can code its posting blocks in.
+ */
+struct BlockFormatKind {
+    const char* name;
+    PixCodec::BlockFormat format;
+};
+
+vector<BlockFormatKind> blockFormats() {
+    return {BlockFormatKind{"varint", PixCodec::kVarint},
+            BlockFormatKind{"groupVarint", PixCodec::kGroupVarint},
+            BlockFormatKind{"bitPack", PixCodec::kBitPack}};
+}
+
+/**
+ * Encode and decode speed of the PixCodec block formats on the docid gaps of a term.
+ */
+class Codec {
+public:
+    void run() {
+        const uint32_t n = 128 * 1024;
+        int rounds = 50;
+        DEV {
+            rounds = 5;
+        }
+
+        // Docid gaps of a term that occurs in about one document in 50.
+        PseudoRandom random(kSeed);
+        vector<uint32_t> gaps(n);
+        for (uint32_t& gap : gaps)
+            gap = 1 + random.nextInt32(100);
+        vector<unsigned char> encoded;
+        vector<uint32_t> decoded(n);
+
+        for (const BlockFormatKind& kind : blockFormats()) {
+            uint32_t bytes = 0;
+            Timer encodeTimer;
+            for (int r = 0; r < rounds; r++) {
+                encoded.clear();
+                bytes = PixCodec::encodeBlock(kind.format, encoded, &gaps[0], n);
+            }
+            long long encodeMicros = encodeTimer.micros();
+
+            Timer decodeTimer;
+            for (int r = 0; r < rounds; r++) {
+                uint32_t read =
+                    PixCodec::decodeBlock(kind.format, &decoded[0], &encoded[0], bytes, n);
+                ASSERT_EQUALS(bytes, read);
+            }
+            long long decodeMicros = decodeTimer.micros();
+            ASSERT(gaps == decoded);
+
+            long long values = static_cast<long long>(n) * rounds;
+            report("codec",
+                   BSON("format" << kind.name << "simd" << PixCodec::simdAvailable() << "values"
+                                 << values << "bytesPerValue" << static_cast<double>(bytes) / n
+                                 << "encodeValuesPerSecond" << perSecond(values, encodeMicros)
+                                 << "decodeValuesPerSecond" << perSecond(values, decodeMicros)));
+        }
+    }
+};
+
+/**
+ * Postings per second through a PostingCursor over a posting list packed in each block format,
+ * both scanned in full and skipped through as the smaller side of a conjunction would.
+ */
+class PostingScan {
+public:
+    void run() {
+        const unsigned n = 64 * 1024;
+        int rounds = 50;
+        DEV {
+            rounds = 5;
+        }
+
+        PseudoRandom random(kSeed);
+        PostingList pList("t");
+        vector<unsigned> targets;
+        unsigned docid = 0;
+        for (unsigned i = 0; i < n; i++) {
+            docid += 1 + random.nextInt32(100);
+            vector<unsigned> positions;
+            unsigned tf = 1 + random.nextInt32(4);
+            unsigned position = 0;
+            for (unsigned p = 0; p < tf; p++) {
+                position += 1 + random.nextInt32(50);
+                positions.push_back(position);
+            }
+            pList.append(DocPosting(docid, positions));
+            if (i % 64 == 0)
+                targets.push_back(docid);
+        }
+
+        for (const BlockFormatKind& kind : blockFormats()) {
+            vector<unsigned char> packed;
+            pList.pack(packed, kind.format);
+
+            long long postings = 0;
+            Timer scanTimer;
+            for (int r = 0; r < rounds; r++) {
+                for (PostingCursor cursor(&packed[0], packed.size()); !cursor.done();
+                     cursor.next())
+                    postings += cursor.tf() > 0;
+            }
+            long long scanMicros = scanTimer.micros();
+            ASSERT_EQUALS(static_cast<long long>(n) * rounds, postings);
+
+            long long skips = 0;
+            Timer skipTimer;
+            for (int r = 0; r < rounds; r++) {
+                PostingCursor cursor(&packed[0], packed.size());
+                for (unsigned target : targets) {
+                    cursor.skipTo(target);
+                    skips += cursor.docid() == target;
+                }
+            }
+            long long skipMicros = skipTimer.micros();
+            ASSERT_EQUALS(static_cast<long long>(targets.size()) * rounds, skips);
+
+            report("postingScan",
+                   BSON("format" << kind.name << "postings" << static_cast<long long>(n)
+                                 << "bytesPerPosting"
+                                 << static_cast<double>(packed.size()) / n
+                                 << "scanPostingsPerSecond" << perSecond(postings, scanMicros)
+                                 << "skipsPerSecond" << perSecond(skips, skipMicros)));
+        }
+    }
+};
+
+class All : public Suite {
+public:
+    All() : Suite("ftsperf") {}
+
+    void setupTests() {
+        add<Tokenize>();
+        add<Stem>();
+        add<IndexBuild>();
+        add<QueryLatency>();
+        add<Codec>();
+        add<PostingScan>();
+    }
+};
+
+SuiteInstance<All> ftsPerfAll;
+
+}  // namespace FTSPerfTests
@@ -28,19 +28,28 @@
  *    then also delete it in the license file.
  */
 
+#include <algorithm>
 #include <cstdint>
+#include <map>
+#include <set>
 
+#include "mongo/client/dbclientcursor.h"
 #include "mongo/db/catalog/collection.h"
 #include "mongo/db/catalog/index_catalog.h"
 #include "mongo/db/catalog/index_create.h"
 #include "mongo/db/db_raii.h"
 #include "mongo/db/dbdirectclient.h"
 #include "mongo/db/dbhelpers.h"
+#include "mongo/db/fts/fts_index_format.h"
+#include "mongo/db/fts/pix_posting_list.h"
 #include "mongo/db/service_context_d.h"
 #include "mongo/db/service_context.h"
+#include "mongo/db/index/index_access_method.h"
 #include "mongo/db/index/index_descriptor.h"
+#include "mongo/db/index/pix_access_method.h"
 #include "mongo/db/operation_context_impl.h"
 #include "mongo/dbtests/dbtests.h"
+#include "mongo/util/mongoutils/str.h"
 
 namespace IndexUpdateTests {
 
@@ -872,6 +881,441 @@ protected:
     }
 };
 
+/**
+ * Returns the docids of a pix index by RecordId, from its {MinKey, docid} -> RecordId entries.
+ */
+std::map<RecordId, uint32_t> scanPixDocids(OperationContext* txn, const IndexAccessMethod* iam) {
+    std::map<RecordId, uint32_t> docids;
+    auto cursor = iam->newCursor(txn);
+    for (auto kv = cursor->seek(BSONObj(), true); kv; kv = cursor->next()) {
+        // The docid entries sort before every term.
+        uint32_t docid;
+        if (!fts::FTSIndexFormat::isPixDocidKey(kv->key, &docid))
+            break;
+        docids[kv->loc] = docid;
+    }
+    return docids;
+}
+
+/**
+ * Returns the entries of a text index as strings.  A pix index built one document at a time
+ * holds deltas and tombstones where a bulk build writes only blocks, and a parallel bulk build
+ * allocates docids in no fixed order, so for 'pix' the entries are resolved into the sorted
+ * live "term RecordId[tf]->positions" postings.  A docid without a docid entry, whose document
+ * is gone, is shown as "#docid" instead of a RecordId.
+ */
+std::vector<std::string> scanTextIndex(OperationContext* txn,
+                                       const IndexAccessMethod* iam,
+                                       bool pix) {
+    std::map<uint32_t, RecordId> locs;
+    if (pix) {
+        for (const auto& entry : scanPixDocids(txn, iam)) {
+            locs[entry.second] = entry.first;
+        }
+    }
+    auto docidString = [&locs](long long docid) -> std::string {
+        auto it = locs.find(static_cast<uint32_t>(docid));
+        if (it == locs.end())
+            return str::stream() << "#" << docid;
+        return str::stream() << it->second.repr();
+    };
+
+    std::vector<std::string> entries;
+    std::set<std::string> tombstones;
+    auto cursor = iam->newCursor(txn);
+    for (auto kv = cursor->seek(BSONObj(), true); kv; kv = cursor->next()) {
+        if (!pix) {
+            entries.push_back(str::stream() << kv->key.toString() << " " << kv->loc);
+            continue;
+        }
+
+        uint32_t docidKey;
+        if (fts::FTSIndexFormat::isPixDocidKey(kv->key, &docidKey))
+            continue;
+
+        // {term, docid, data}
+        BSONObjIterator it(kv->key);
+        std::string term = it.next().toString(false);
+        long long docid = it.next().numberLong();
+        BSONElement data = it.next();
+        if (fts::FTSIndexFormat::getPixEntryKind(data) ==
+            fts::FTSIndexFormat::PixEntryKind::kTombstone) {
+            tombstones.insert(str::stream() << term << " " << docidString(docid));
+            continue;
+        }
+        int len;
+        const char* bytes = data.binData(len);
+        PostingList postings("", reinterpret_cast<const unsigned char*>(bytes), len);
+        for (const DocPosting& dp : postings) {
+            std::string posting = dp.compactString();
+            entries.push_back(str::stream() << term << " " << docidString(dp.getDocid())
+                                            << posting.substr(posting.find('[')));
+        }
+    }
+
+    if (pix) {
+        std::vector<std::string> live;
+        for (const std::string& entry : entries) {
+            if (!tombstones.count(entry.substr(0, entry.find('['))))
+                live.push_back(entry);
+        }
+        entries.swap(live);
+        std::sort(entries.begin(), entries.end());
+    }
+    return entries;
+}
+
+/**
+ * A text index built in bulk, which generates keys on textIndexBuildWorkers (4 by default)
+ * worker threads, has the same entries as the index built one document at a time in the
+ * background.  'format' is 0 for a regular text index, 1 for a proximity index, 2 for a pix
+ * index and 3 for a pix index with bit packed blocks.
+ */
+template <int format>
+class TextIndexBulkBuildMatchesBackground : public IndexBuildBase {
+public:
+    void run() {
+        Database* db = _ctx.db();
+        Collection* coll;
+        {
+            WriteUnitOfWork wunit(&_txn);
+            db->dropCollection(&_txn, _ns);
+            coll = db->createCollection(&_txn, _ns);
+
+            // Enough documents to fill several worker batches.
+            const char* words[] = {"apple", "banana", "cherry", "date", "elder", "fig", "grape"};
+            for (int i = 0; i < 2000; i++) {
+                std::string text;
+                for (int j = 0; j <= i % 7; j++) {
+                    text += std::string(words[(i + j * 3) % 7]) + " ";
+                }
+                coll->insertDocument(&_txn, BSON("_id" << i << "t" << text), true);
+            }
+            wunit.commit();
+        }
+
+        std::vector<std::string> bulk = buildAndScan(coll, false);
+        std::vector<std::string> background = buildAndScan(coll, true);
+
+        ASSERT_GREATER_THAN(bulk.size(), 0U);
+        ASSERT_EQUALS(background.size(), bulk.size());
+        for (size_t i = 0; i < bulk.size(); i++) {
+            ASSERT_EQUALS(background[i], bulk[i]);
+        }
+    }
+
+private:
+    /**
+     * Builds the index, drops it again, and returns its entries as scanTextIndex() does.
+     */
+    std::vector<std::string> buildAndScan(Collection* coll, bool background) {
+        MultiIndexBlock indexer(&_txn, coll);
+        if (background) {
+            indexer.allowBackgroundBuilding();
+            indexer.allowInterruption();
+        }
+
+        BSONObjBuilder spec;
+        spec.append("name", "t");
+        spec.append("ns", coll->ns().ns());
+        spec.append("key", BSON("t"
+                                << "text"));
+        spec.append("background", background);
+        if (format == 1)
+            spec.append("proximity", true);
+        if (format >= 2)
+            spec.append("pix", true);
+        if (format == 3)
+            spec.append("pixBlockFormat", "bitPack");
+
+        ASSERT_OK(indexer.init(spec.obj()));
+        ASSERT_OK(indexer.insertAllDocumentsInCollection());
+        {
+            WriteUnitOfWork wunit(&_txn);
+            indexer.commit();
+            wunit.commit();
+        }
+
+        IndexCatalog* catalog = coll->getIndexCatalog();
+        IndexDescriptor* desc = catalog->findIndexByName(&_txn, "t");
+        ASSERT(desc);
+
+        std::vector<std::string> entries =
+            scanTextIndex(&_txn, catalog->getIndex(desc), format >= 2);
+
+        WriteUnitOfWork wunit(&_txn);
+        ASSERT_OK(catalog->dropIndex(&_txn, desc));
+        wunit.commit();
+        return entries;
+    }
+};
+
+/**
+ * Unindexing documents whose postings are in pix blocks leaves tombstones, which hide the
+ * postings until they are merged into new blocks.
+ */
+class PixIndexDeletes : public IndexBuildBase {
+public:
+    void run() {
+        Database* db = _ctx.db();
+        Collection* coll;
+        {
+            WriteUnitOfWork wunit(&_txn);
+            db->dropCollection(&_txn, _ns);
+            coll = db->createCollection(&_txn, _ns);
+            for (int i = 0; i < 200; i++) {
+                coll->insertDocument(&_txn,
+                                     BSON("_id" << i << "t"
+                                                << "apple banana"),
+                                     true);
+            }
+            wunit.commit();
+        }
+
+        // A foreground build writes only blocks.
+        ASSERT_OK(createIndex("unittests",
+                              BSON("name"
+                                   << "t"
+                                   << "ns" << _ns << "key" << BSON("t"
+                                                                   << "text") << "pix" << true)));
+
+        std::vector<RecordId> locs;
+        auto cursor = coll->getCursor(&_txn);
+        while (auto record = cursor->next()) {
+            locs.push_back(record->id);
+        }
+        cursor.reset();
+        ASSERT_EQUALS(200U, locs.size());
+
+        // The postings hold docids, which a parallel build allocates in no fixed order, so the
+        // deleted documents are looked up in the docid map while their entries still exist.
+        IndexCatalog* catalog = coll->getIndexCatalog();
+        IndexDescriptor* desc = catalog->findIndexByName(&_txn, "t");
+        ASSERT(desc);
+        std::map<RecordId, uint32_t> docids = scanPixDocids(&_txn, catalog->getIndex(desc));
+        ASSERT_EQUALS(200U, docids.size());
+
+        std::vector<std::string> deleted;
+        for (size_t i = 0; i < locs.size(); i += 2) {
+            ASSERT_EQUALS(1U, docids.count(locs[i]));
+            deleted.push_back(str::stream() << " #" << docids[locs[i]] << "[");
+            deleted.push_back(str::stream() << " " << locs[i].repr() << "[");
+
+            WriteUnitOfWork wunit(&_txn);
+            coll->deleteDocument(&_txn, locs[i]);
+            wunit.commit();
+        }
+
+        desc = catalog->findIndexByName(&_txn, "t");
+        ASSERT(desc);
+        ASSERT_EQUALS(100U, scanPixDocids(&_txn, catalog->getIndex(desc)).size());
+        std::vector<std::string> postings = scanTextIndex(&_txn, catalog->getIndex(desc), true);
+
+        // Both terms of the 100 remaining documents, and nothing of the deleted ones.
+        ASSERT_EQUALS(200U, postings.size());
+        for (const std::string& posting : postings) {
+            for (const std::string& id : deleted) {
+                ASSERT_EQUALS(std::string::npos, posting.find(id));
+            }
+        }
+    }
+};
+
+/**
+ * Base for tests of a pix index "t" over 200 documents "apple banana", built in the foreground
+ * so that it starts out with blocks only.
+ */
+class PixIndexBase : public IndexBuildBase {
+protected:
+    void buildIndex() {
+        Database* db = _ctx.db();
+        {
+            WriteUnitOfWork wunit(&_txn);
+            db->dropCollection(&_txn, _ns);
+            Collection* coll = db->createCollection(&_txn, _ns);
+            for (int i = 0; i < 200; i++) {
+                coll->insertDocument(&_txn,
+                                     BSON("_id" << i << "t"
+                                                << "apple banana"),
+                                     true);
+            }
+            wunit.commit();
+        }
+        ASSERT_OK(createIndex("unittests",
+                              BSON("name"
+                                   << "t"
+                                   << "ns" << _ns << "key" << BSON("t"
+                                                                   << "text") << "pix" << true)));
+    }
+
+    const PixAccessMethod* index() {
+        IndexCatalog* catalog = collection()->getIndexCatalog();
+        IndexDescriptor* desc = catalog->findIndexByName(&_txn, "t");
+        ASSERT(desc);
+        return static_cast<const PixAccessMethod*>(catalog->getIndex(desc));
+    }
+
+    /**
+     * The _id of the document with 'docid'.
+     */
+    BSONElement idOf(uint32_t docid) {
+        RecordId loc = index()->findRecordId(&_txn, docid);
+        ASSERT(!loc.isNull());
+        _doc = collection()->docFor(&_txn, loc).value().getOwned();
+        return _doc["_id"];
+    }
+
+    /**
+     * The stored entries of 'term' as {docid, kind} pairs, in index order.
+     */
+    std::vector<std::pair<uint32_t, fts::FTSIndexFormat::PixEntryKind>> termEntries(
+        const std::string& term) {
+        std::vector<std::pair<uint32_t, fts::FTSIndexFormat::PixEntryKind>> entries;
+        auto cursor = index()->newCursor(&_txn);
+        for (auto kv = cursor->seek(BSONObj(), true); kv; kv = cursor->next()) {
+            uint32_t docid;
+            if (fts::FTSIndexFormat::isPixDocidKey(kv->key, &docid))
+                continue;
+            BSONObjIterator it(kv->key);
+            if (it.next().String() != term)
+                continue;
+            docid = static_cast<uint32_t>(it.next().numberLong());
+            entries.push_back(
+                std::make_pair(docid, fts::FTSIndexFormat::getPixEntryKind(it.next())));
+        }
+        return entries;
+    }
+
+    int countMatches(const std::string& search) {
+        BSONObj query = BSON("$text" << BSON("$search" << search));
+        return _client.query(_ns, query)->itcount();
+    }
+
+private:
+    BSONObj _doc;
+};
+
+/**
+ * $text queries over a pix index still return the rest of a block after its first document is
+ * deleted or updated, whose tombstone and delta share the RecordId of the block.
+ */
+class PixQueryAfterFirstDocidChanges : public PixIndexBase {
+public:
+    void run() {
+        buildIndex();
+        ASSERT_EQUALS(200, countMatches("apple"));
+
+        // Docids start at 1, so the first block of every term starts with docid 1.
+        BSONObj first = BSON("_id" << idOf(1));
+
+        _client.update(_ns,
+                       first,
+                       BSON("$set" << BSON("t"
+                                           << "apple cherry")));
+        ASSERT_EQUALS(200, countMatches("apple"));
+        ASSERT_EQUALS(199, countMatches("banana"));
+        ASSERT_EQUALS(1, countMatches("cherry"));
+
+        _client.remove(_ns, first);
+        ASSERT_EQUALS(199, countMatches("apple"));
+        ASSERT_EQUALS(199, countMatches("banana"));
+        ASSERT_EQUALS(0, countMatches("cherry"));
+    }
+};
+
+/**
+ * A tombstone at the first docid of a block sorts before that block, since an empty BinData
+ * sorts first, but still belongs to it: merging the block before it must neither apply nor
+ * drop that tombstone, or the deleted posting comes back.
+ */
+class PixMergeKeepsFirstDocidTombstone : public PixIndexBase {
+public:
+    void run() {
+        typedef fts::FTSIndexFormat::PixEntryKind Kind;
+        const uint32_t maxPending = PixAccessMethod::kMaxPendingEntries;
+
+        buildIndex();
+        std::vector<uint32_t> blocks;
+        for (const auto& entry : termEntries("apple")) {
+            ASSERT(entry.second == Kind::kBlock);
+            blocks.push_back(entry.first);
+        }
+        ASSERT_GREATER_THAN(blocks.size(), 1U);
+        ASSERT_GREATER_THAN(blocks[1] - blocks[0], maxPending);
+
+        // Delete the first document of the second block, then enough documents of the first
+        // block to merge it.
+        _client.remove(_ns, BSON("_id" << idOf(blocks[1])));
+        for (uint32_t docid = blocks[0] + 1; docid <= blocks[0] + maxPending; docid++) {
+            _client.remove(_ns, BSON("_id" << idOf(docid)));
+        }
+
+        // Only the tombstone of the second block's first docid is left.
+        int tombstones = 0;
+        for (const auto& entry : termEntries("apple")) {
+            if (entry.second == Kind::kTombstone) {
+                ASSERT_EQUALS(blocks[1], entry.first);
+                tombstones++;
+            }
+        }
+        ASSERT_EQUALS(1, tombstones);
+
+        int remaining = 200 - 1 - maxPending;
+        ASSERT_EQUALS(remaining, countMatches("apple"));
+        ASSERT_EQUALS(static_cast<size_t>(2 * remaining),
+                      scanTextIndex(&_txn, index(), true).size());
+    }
+};
+
+/**
+ * A proximity query sees every stored key of a term in a document, not only the first one.
+ * The matching window here needs the last occurrence of "cherry", which with "proximity": 2
+ * is also past the first packed key of the term.
+ */
+template <int proximity>
+class ProximityQueryUsesLaterOccurrences : public IndexBuildBase {
+public:
+    void run() {
+        std::string near;
+        std::string far = "grape ";
+        for (int i = 0; i < 300; i++) {
+            near += "cherry kiwi ";
+            far += "kiwi ";
+        }
+        near += "grape";
+        far += "cherry";
+
+        Database* db = _ctx.db();
+        {
+            WriteUnitOfWork wunit(&_txn);
+            db->dropCollection(&_txn, _ns);
+            Collection* coll = db->createCollection(&_txn, _ns);
+            coll->insertDocument(&_txn, BSON("_id" << 0 << "t" << near), true);
+            coll->insertDocument(&_txn, BSON("_id" << 1 << "t" << far), true);
+            wunit.commit();
+        }
+
+        BSONObjBuilder spec;
+        spec.append("name", "t");
+        spec.append("ns", _ns);
+        spec.append("key", BSON("t"
+                                << "text"));
+        if (proximity == 1)
+            spec.append("proximity", true);
+        else
+            spec.append("proximity", proximity);
+        ASSERT_OK(createIndex("unittests", spec.obj()));
+
+        BSONObj query = BSON("$text" << BSON("$search"
+                                             << "cherry grape"
+                                             << "$proximity" << 3));
+        std::unique_ptr<DBClientCursor> cursor = _client.query(_ns, query);
+        ASSERT(cursor->more());
+        ASSERT_EQUALS(0, cursor->nextSafe()["_id"].numberInt());
+        ASSERT_FALSE(cursor->more());
+    }
+};
+
 class IndexCatatalogFixIndexKey {
 public:
     void run() {
@@ -915,6 +1359,15 @@ public:
         add<SameSpecDifferentSparse>();
         add<SameSpecDifferentTTL>();
         add<StorageEngineOptions>();
+        add<TextIndexBulkBuildMatchesBackground<0>>();
+        add<TextIndexBulkBuildMatchesBackground<1>>();
+        add<TextIndexBulkBuildMatchesBackground<2>>();
+        add<TextIndexBulkBuildMatchesBackground<3>>();
+        add<PixIndexDeletes>();
+        add<PixQueryAfterFirstDocidChanges>();
+        add<PixMergeKeepsFirstDocidTombstone>();
+        add<ProximityQueryUsesLaterOccurrences<1>>();
+        add<ProximityQueryUsesLaterOccurrences<2>>();
 
         add<IndexCatatalogFixIndexKey>();
     }
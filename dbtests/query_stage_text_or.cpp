@@ -0,0 +1,273 @@
+/**
+ *    Copyright (C) 2016 MongoDB Inc.
+ *
+ *    This program is free software: you can redistribute it and/or  modify
+ *    it under the terms of the GNU Affero General Public License, version 3,
+ *    as published by the Free Software Foundation.
+ *
+ *    This program is distributed in the hope that it will be useful,
+ *    but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *    GNU Affero General Public License for more details.
+ *
+ *    You should have received a copy of the GNU Affero General Public License
+ *    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ *    As a special exception, the copyright holders give permission to link the
+ *    code of portions of this program with the OpenSSL library under certain
+ *    conditions as described in each individual source file and distribute
+ *    linked combinations including the program with the OpenSSL library. You
+ *    must comply with the GNU Affero General Public License in all respects for
+ *    all of the code used other than as permitted herein. If you modify file(s)
+ *    with this exception, you may extend this exception to your version of the
+ *    file(s), but you are not obligated to do so. If you do not wish to do so,
+ *    delete this exception statement from your version. If you delete this
+ *    exception statement from all source files in the program, then also delete
+ *    it in the license file.
+ */
+
+/**
+ * This file tests db/exec/text_or.cpp.  TextOrStage fetches and scores documents, so we cannot
+ * test it outside of a dbtest.
+ */
+
+#include "mongo/platform/basic.h"
+
+#include <algorithm>
+#include <vector>
+
+#include "mongo/client/dbclientinterface.h"
+#include "mongo/db/catalog/collection.h"
+#include "mongo/db/catalog/database.h"
+#include "mongo/db/catalog/index_catalog.h"
+#include "mongo/db/client.h"
+#include "mongo/db/db_raii.h"
+#include "mongo/db/exec/index_scan.h"
+#include "mongo/db/exec/text_or.h"
+#include "mongo/db/exec/working_set.h"
+#include "mongo/db/exec/working_set_computed_data.h"
+#include "mongo/db/fts/fts_index_format.h"
+#include "mongo/db/fts/fts_spec.h"
+#include "mongo/db/jsobj.h"
+#include "mongo/db/op_observer.h"
+#include "mongo/db/operation_context_impl.h"
+#include "mongo/dbtests/dbtests.h"
+#include "mongo/stdx/memory.h"
+
+namespace QueryStageTextOr {
+
+using std::pair;
+using std::set;
+using std::string;
+using std::unique_ptr;
+using std::vector;
+using stdx::make_unique;
+
+using fts::FTSIndexFormat;
+using fts::FTSSpec;
+using fts::TermFrequencyMap;
+
+class TextOrTest {
+public:
+    TextOrTest()
+        : _txn(),
+          _scopedXact(&_txn, MODE_IX),
+          _dbLock(_txn.lockState(), nsToDatabaseSubstring(ns()), MODE_X),
+          _ctx(&_txn, ns()),
+          _coll(NULL) {}
+
+    virtual ~TextOrTest() {}
+
+    void setup() {
+        WriteUnitOfWork wunit(&_txn);
+
+        _ctx.db()->dropCollection(&_txn, ns());
+        _coll = _ctx.db()->createCollection(&_txn, ns());
+
+        ASSERT_OK(_coll->getIndexCatalog()->createIndexOnEmptyCollection(
+            &_txn,
+            BSON("ns" << ns() << "key" << BSON("body"
+                                               << "text") << "name"
+                      << "body_text")));
+
+        wunit.commit();
+    }
+
+    void insert(const BSONObj& doc) {
+        WriteUnitOfWork wunit(&_txn);
+        ASSERT_OK(_coll->insertDocument(&_txn, doc, false));
+        wunit.commit();
+    }
+
+    void update(const RecordId& recordId, const BSONObj& newDoc) {
+        OplogUpdateEntryArgs args;
+        args.ns = ns();
+        Snapshotted<BSONObj> oldDoc = _coll->docFor(&_txn, recordId);
+        WriteUnitOfWork wunit(&_txn);
+        StatusWith<RecordId> updated =
+            _coll->updateDocument(&_txn, recordId, oldDoc, newDoc, false, true, NULL, &args);
+        ASSERT_OK(updated.getStatus());
+        wunit.commit();
+    }
+
+    RecordId recordIdOf(int id) {
+        auto cursor = _coll->getCursor(&_txn);
+        while (auto record = cursor->next()) {
+            if (record->data.toBson()["_id"].numberInt() == id) {
+                return record->id;
+            }
+        }
+        FAIL("no such document");
+        return RecordId();
+    }
+
+    IndexDescriptor* descriptor() {
+        return _coll->getIndexCatalog()->findIndexByName(&_txn, "body_text");
+    }
+
+    /**
+     * A TextOrStage over 'terms' that keeps the 'topK' best documents, with the index scans the
+     * text plan would give it.
+     */
+    unique_ptr<TextOrStage> makeTextOr(const set<string>& terms, size_t topK) {
+        IndexDescriptor* index = descriptor();
+        FTSSpec spec(index->infoObj());
+        auto textOr = make_unique<TextOrStage>(&_txn, spec, &_ws, nullptr, index, terms, topK);
+        for (const auto& term : terms) {
+            IndexScanParams params;
+            params.bounds.startKey = FTSIndexFormat::getIndexKey(
+                fts::MAX_WEIGHT, term, BSONObj(), spec.getTextIndexVersion());
+            params.bounds.endKey =
+                FTSIndexFormat::getIndexKey(0, term, BSONObj(), spec.getTextIndexVersion());
+            params.bounds.endKeyInclusive = true;
+            params.bounds.isSimpleRange = true;
+            params.descriptor = index;
+            params.direction = -1;
+            textOr->addChild(make_unique<IndexScan>(&_txn, params, &_ws, nullptr));
+        }
+        return textOr;
+    }
+
+    /**
+     * The score over 'terms' of each document in the collection that has any of them, best
+     * first.
+     */
+    vector<pair<double, int>> expectedScores(const set<string>& terms) {
+        FTSSpec spec(descriptor()->infoObj());
+        vector<pair<double, int>> scores;
+        auto cursor = _coll->getCursor(&_txn);
+        while (auto record = cursor->next()) {
+            BSONObj obj = record->data.toBson();
+            TermFrequencyMap termFreqs;
+            spec.scoreDocument(obj, &termFreqs);
+            double score = 0;
+            for (const auto& term : terms) {
+                if (termFreqs.count(term))
+                    score += termFreqs[term];
+            }
+            if (score > 0)
+                scores.push_back(std::make_pair(score, obj["_id"].numberInt()));
+        }
+        std::sort(scores.rbegin(), scores.rend());
+        return scores;
+    }
+
+    /**
+     * Works 'stage' to EOF and returns the scores and _ids of its results, best first.
+     */
+    vector<pair<double, int>> readScores(PlanStage* stage) {
+        vector<pair<double, int>> scores;
+        WorkingSetID out;
+        PlanStage::StageState state;
+        while (PlanStage::IS_EOF != (state = stage->work(&out))) {
+            ASSERT_NE(PlanStage::FAILURE, state);
+            ASSERT_NE(PlanStage::DEAD, state);
+            if (PlanStage::ADVANCED != state)
+                continue;
+            WorkingSetMember* member = _ws.get(out);
+            const auto* score = static_cast<const TextScoreComputedData*>(
+                member->getComputed(WSM_COMPUTED_TEXT_SCORE));
+            scores.push_back(
+                std::make_pair(score->getScore(), member->obj.value()["_id"].numberInt()));
+            _ws.free(out);
+        }
+        std::sort(scores.rbegin(), scores.rend());
+        return scores;
+    }
+
+    static const char* ns() {
+        return "unittests.QueryStageTextOr";
+    }
+
+protected:
+    OperationContextImpl _txn;
+    ScopedTransaction _scopedXact;
+    Lock::DBLock _dbLock;
+    OldClientContext _ctx;
+    Collection* _coll;
+
+    WorkingSet _ws;
+};
+
+// Updating one of the k best documents mid-query must not lose the documents it displaced.
+class QueryStageTextOrTopKInvalidation : public TextOrTest {
+public:
+    void run() {
+        setup();
+
+        // Scores of "apple" and "pear" that fall in the order of the _ids, so that with k = 2 the
+        // stage reads apple 1, pear 2, apple 3, and drops 3 from the top k.  The terms are
+        // stemmed.
+        insert(BSON("_id" << 1 << "body"
+                          << "apple apple apple"));
+        insert(BSON("_id" << 2 << "body"
+                          << "pear pear pear fig"));
+        insert(BSON("_id" << 3 << "body"
+                          << "apple apple fig fig"));
+        insert(BSON("_id" << 4 << "body"
+                          << "pear fig fig fig"));
+        insert(BSON("_id" << 5 << "body"
+                          << "apple fig fig fig fig"));
+        insert(BSON("_id" << 6 << "body"
+                          << "pear fig fig fig fig fig"));
+
+        const set<string> terms = {"appl", "pear"};
+        unique_ptr<TextOrStage> textOr = makeTextOr(terms, 2);
+
+        // Read the first three documents.
+        const TextOrStats* stats = static_cast<const TextOrStats*>(textOr->getSpecificStats());
+        while (stats->fetches < 3) {
+            WorkingSetID out;
+            ASSERT_EQUALS(PlanStage::NEED_TIME, textOr->work(&out));
+        }
+
+        // Update the best of them so that it no longer matches.
+        RecordId best = recordIdOf(1);
+        textOr->saveState();
+        textOr->invalidate(&_txn, best, INVALIDATION_MUTATION);
+        update(best,
+               BSON("_id" << 1 << "body"
+                          << "fig"));
+        textOr->restoreState();
+
+        vector<pair<double, int>> expected = expectedScores(terms);
+        vector<pair<double, int>> results = readScores(textOr.get());
+        ASSERT_GREATER_THAN_OR_EQUALS(results.size(), 2U);
+        for (size_t i = 0; i < 2; i++) {
+            ASSERT_EQUALS(expected[i].second, results[i].second);
+            ASSERT_APPROX_EQUAL(expected[i].first, results[i].first, 1e-9);
+        }
+        ASSERT_EQUALS(3, results[1].second);
+    }
+};
+
+class All : public Suite {
+public:
+    All() : Suite("query_stage_text_or") {}
+
+    void setupTests() {
+        add<QueryStageTextOrTopKInvalidation>();
+    }
+} QueryStageTextOrAll;
+
+}  // namespace QueryStageTextOr
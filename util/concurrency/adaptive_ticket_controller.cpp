@@ -0,0 +1,131 @@
+/**
+ *    Copyright (C) 2016 MongoDB Inc.
+ *
+ *    This program is free software: you can redistribute it and/or  modify
+ *    it under the terms of the GNU Affero General Public License, version 3,
+ *    as published by the Free Software Foundation.
+ *
+ *    This program is distributed in the hope that it will be useful,
+ *    but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *    GNU Affero General Public License for more details.
+ *
+ *    You should have received a copy of the GNU Affero General Public License
+ *    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ *    As a special exception, the copyright holders give permission to link the
+ *    code of portions of this program with the OpenSSL library under certain
+ *    conditions as described in each individual source file and distribute
+ *    linked combinations including the program with the OpenSSL library. You
+ *    must comply with the GNU Affero General Public License in all respects for
+ *    all of the code used other than as permitted herein. If you modify file(s)
+ *    with this exception, you may extend this exception to your version of the
+ *    file(s), but you are not obligated to do so. If you do not wish to do so,
+ *    delete this exception statement from your version. If you delete this
+ *    exception statement from all source files in the program, then also delete
+ *    it in the license file.
+ */
+
+#define MONGO_LOG_DEFAULT_COMPONENT ::mongo::logger::LogComponent::kDefault
+
+#include "mongo/platform/basic.h"
+
+#include "mongo/util/concurrency/adaptive_ticket_controller.h"
+
+#include <algorithm>
+
+#include "mongo/util/log.h"
+
+namespace mongo {
+
+namespace {
+
+// Mean hold times up to this multiple of the baseline count as unloaded.
+const double kLatencyTolerance = 2.0;
+
+// Each call moves the baseline this far towards a higher mean hold time, so that it follows a
+// change of workload rather than remembering the fastest period forever.
+const double kBaselineDrift = 0.05;
+
+// A growth step is taken back if throughput falls below this share of the previous period's.
+const double kThroughputDrop = 0.95;
+
+// Smallest size TicketHolder::resize accepts.
+const int kMinTickets = 5;
+
+int step(int size) {
+    return std::max(1, size / 10);
+}
+
+}  // namespace
+
+AdaptiveTicketController::AdaptiveTicketController(TicketHolder* holder,
+                                                   TicketHolder* longRunningHolder)
+    : _holder(holder),
+      _longRunningHolder(longRunningHolder),
+      _longRunningShare(longRunningHolder
+                            ? static_cast<double>(longRunningHolder->outof()) / holder->outof()
+                            : 0),
+      _last(holder->getStats()) {}
+
+int AdaptiveTicketController::adjust(int minTickets, int maxTickets) {
+    const TicketHolder::Stats stats = _holder->getStats();
+    const uint64_t released = stats.released - _last.released;
+    const uint64_t heldMicros = stats.heldMicros - _last.heldMicros;
+    const uint64_t queued = stats.queued - _last.queued;
+    _last = stats;
+
+    minTickets = std::max(minTickets, kMinTickets);
+    maxTickets = std::max(maxTickets, minTickets);
+
+    const int size = _holder->outof();
+    int target = size;
+
+    // An idle period says nothing about the right size.
+    if (released > 0) {
+        const double latency = static_cast<double>(heldMicros) / released;
+        if (_baselineMicros == 0 || latency < _baselineMicros) {
+            _baselineMicros = latency;
+        } else {
+            _baselineMicros += (latency - _baselineMicros) * kBaselineDrift;
+        }
+
+        if (latency > _baselineMicros * kLatencyTolerance) {
+            target = size - step(size);
+        } else if (_lastGrew && released < _lastThroughput * kThroughputDrop) {
+            target = size - step(size);
+        } else if (queued > 0) {
+            target = size + step(size);
+        }
+        _lastThroughput = released;
+    }
+
+    target = std::min(std::max(target, minTickets), maxTickets);
+    _lastGrew = target > size;
+    _resize(size, target);
+    return target;
+}
+
+void AdaptiveTicketController::_resize(int size, int target) {
+    if (_longRunningHolder) {
+        const int longRunningTarget = std::min(
+            target, std::max(kMinTickets, static_cast<int>(_longRunningShare * target + 0.5)));
+        if (longRunningTarget != _longRunningHolder->outof()) {
+            Status status = _longRunningHolder->resize(longRunningTarget);
+            if (!status.isOK()) {
+                warning() << "failed to resize long running tickets to " << longRunningTarget
+                          << ": " << status;
+            }
+        }
+    }
+
+    if (target != size) {
+        LOG(2) << "resizing tickets from " << size << " to " << target;
+        Status status = _holder->resize(target);
+        if (!status.isOK()) {
+            warning() << "failed to resize tickets to " << target << ": " << status;
+        }
+    }
+}
+
+}  // namespace mongo
@@ -0,0 +1,87 @@
+/**
+ *    Copyright (C) 2016 MongoDB Inc.
+ *
+ *    This program is free software: you can redistribute it and/or  modify
+ *    it under the terms of the GNU Affero General Public License, version 3,
+ *    as published by the Free Software Foundation.
+ *
+ *    This program is distributed in the hope that it will be useful,
+ *    but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *    GNU Affero General Public License for more details.
+ *
+ *    You should have received a copy of the GNU Affero General Public License
+ *    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ *    As a special exception, the copyright holders give permission to link the
+ *    code of portions of this program with the OpenSSL library under certain
+ *    conditions as described in each individual source file and distribute
+ *    linked combinations including the program with the OpenSSL library. You
+ *    must comply with the GNU Affero General Public License in all respects for
+ *    all of the code used other than as permitted herein. If you modify file(s)
+ *    with this exception, you may extend this exception to your version of the
+ *    file(s), but you are not obligated to do so. If you do not wish to do so,
+ *    delete this exception statement from your version. If you delete this
+ *    exception statement from all source files in the program, then also delete
+ *    it in the license file.
+ */
+
+#pragma once
+
+#include "mongo/base/disallow_copying.h"
+#include "mongo/util/concurrency/ticketholder.h"
+
+namespace mongo {
+
+/**
+ * Resizes a TicketHolder at runtime from the throughput and ticket hold times it reports through
+ * TicketHolder::getStats(), in place of a hand tuned fixed count.
+ *
+ * Each call to adjust() looks at the tickets released since the previous call:
+ *  - If their mean hold time is well above the baseline, the lowest recently seen, more
+ *    concurrency only adds queueing inside the storage engine and the holder shrinks.
+ *  - If the previous call grew the holder and throughput fell, that step is taken back.
+ *  - Otherwise, if operations had to queue for tickets, the holder grows.
+ * Steps are a tenth of the current size. Throughput is counted per call, so adjust() should be
+ * called at a fixed period.
+ *
+ * An optional holder for long running operations is kept at the same share of the tickets as it
+ * had when the controller was created.
+ *
+ * Not thread safe; meant to be driven by a single background thread.
+ */
+class AdaptiveTicketController {
+    MONGO_DISALLOW_COPYING(AdaptiveTicketController);
+
+public:
+    /**
+     * Neither holder is owned. 'longRunningHolder' may be null.
+     */
+    AdaptiveTicketController(TicketHolder* holder, TicketHolder* longRunningHolder);
+
+    /**
+     * Samples the holder and resizes it within [minTickets, maxTickets]. Returns the new size.
+     */
+    int adjust(int minTickets, int maxTickets);
+
+    /**
+     * Mean ticket hold time, in microseconds, that the controller takes as unloaded.
+     */
+    double baselineMicros() const {
+        return _baselineMicros;
+    }
+
+private:
+    void _resize(int size, int target);
+
+    TicketHolder* const _holder;
+    TicketHolder* const _longRunningHolder;
+    const double _longRunningShare;
+
+    TicketHolder::Stats _last;
+    double _baselineMicros = 0;
+    uint64_t _lastThroughput = 0;
+    bool _lastGrew = false;
+};
+
+}  // namespace mongo
@@ -0,0 +1,139 @@
+/**
+ *    Copyright (C) 2016 MongoDB Inc.
+ *
+ *    This program is free software: you can redistribute it and/or  modify
+ *    it under the terms of the GNU Affero General Public License, version 3,
+ *    as published by the Free Software Foundation.
+ *
+ *    This program is distributed in the hope that it will be useful,
+ *    but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *    GNU Affero General Public License for more details.
+ *
+ *    You should have received a copy of the GNU Affero General Public License
+ *    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ *    As a special exception, the copyright holders give permission to link the
+ *    code of portions of this program with the OpenSSL library under certain
+ *    conditions as described in each individual source file and distribute
+ *    linked combinations including the program with the OpenSSL library. You
+ *    must comply with the GNU Affero General Public License in all respects for
+ *    all of the code used other than as permitted herein. If you modify file(s)
+ *    with this exception, you may extend this exception to your version of the
+ *    file(s), but you are not obligated to do so. If you do not wish to do so,
+ *    delete this exception statement from your version. If you delete this
+ *    exception statement from all source files in the program, then also delete
+ *    it in the license file.
+ */
+
+#include "mongo/platform/basic.h"
+
+#include "mongo/stdx/thread.h"
+#include "mongo/unittest/unittest.h"
+#include "mongo/util/concurrency/adaptive_ticket_controller.h"
+#include "mongo/util/concurrency/ticketholder.h"
+
+namespace {
+
+using mongo::AdaptiveTicketController;
+using mongo::TicketHolder;
+
+namespace stdx = mongo::stdx;
+
+/**
+ * Runs 'ops' operations that each hold a ticket for 'heldMicros'. If 'queue' is set, the first
+ * of them has to wait for its ticket.
+ */
+void runOps(TicketHolder* holder, int ops, uint64_t heldMicros, bool queue) {
+    if (queue) {
+        int taken = 0;
+        while (holder->tryAcquire()) {
+            ++taken;
+        }
+
+        stdx::thread waiter([holder, heldMicros] {
+            holder->waitForTicket();
+            holder->release(heldMicros);
+        });
+        while (holder->getStats().queued == 0) {
+            stdx::this_thread::yield();
+        }
+
+        while (taken-- > 0) {
+            holder->release();
+        }
+        waiter.join();
+        --ops;
+    }
+
+    for (int i = 0; i < ops; ++i) {
+        ASSERT(holder->tryAcquire());
+        holder->release(heldMicros);
+    }
+}
+
+TEST(AdaptiveTicketController, IdlePeriodOnlyAppliesBounds) {
+    TicketHolder holder(10);
+    AdaptiveTicketController controller(&holder, nullptr);
+
+    ASSERT_EQUALS(10, controller.adjust(5, 100));
+    ASSERT_EQUALS(20, controller.adjust(20, 100));
+    ASSERT_EQUALS(20, holder.outof());
+}
+
+TEST(AdaptiveTicketController, GrowsWhileOperationsQueue) {
+    TicketHolder holder(10);
+    AdaptiveTicketController controller(&holder, nullptr);
+
+    runOps(&holder, 100, 100, false);
+    ASSERT_EQUALS(10, controller.adjust(5, 100));
+    ASSERT_EQUALS(100, controller.baselineMicros());
+
+    runOps(&holder, 100, 100, true);
+    ASSERT_EQUALS(11, controller.adjust(5, 100));
+    ASSERT_EQUALS(11, holder.outof());
+
+    runOps(&holder, 100, 100, true);
+    ASSERT_EQUALS(11, controller.adjust(5, 11));
+}
+
+TEST(AdaptiveTicketController, ShrinksWhenHoldTimesRise) {
+    TicketHolder holder(20);
+    AdaptiveTicketController controller(&holder, nullptr);
+
+    runOps(&holder, 100, 100, false);
+    ASSERT_EQUALS(20, controller.adjust(5, 100));
+
+    // queueing does not make up for hold times of three times the baseline
+    runOps(&holder, 100, 300, true);
+    ASSERT_EQUALS(18, controller.adjust(5, 100));
+    ASSERT_EQUALS(18, holder.outof());
+    ASSERT_GREATER_THAN(controller.baselineMicros(), 100);
+}
+
+TEST(AdaptiveTicketController, TakesBackGrowthThatLowersThroughput) {
+    TicketHolder holder(10);
+    AdaptiveTicketController controller(&holder, nullptr);
+
+    runOps(&holder, 100, 100, true);
+    ASSERT_EQUALS(11, controller.adjust(5, 100));
+
+    runOps(&holder, 50, 100, true);
+    ASSERT_EQUALS(10, controller.adjust(5, 100));
+}
+
+TEST(AdaptiveTicketController, LongRunningHolderKeepsItsShare) {
+    TicketHolder holder(20);
+    TicketHolder longRunning(10);
+    AdaptiveTicketController controller(&holder, &longRunning);
+
+    runOps(&holder, 100, 100, true);
+    ASSERT_EQUALS(22, controller.adjust(5, 100));
+    ASSERT_EQUALS(11, longRunning.outof());
+
+    runOps(&holder, 100, 1000, false);
+    ASSERT_EQUALS(20, controller.adjust(5, 100));
+    ASSERT_EQUALS(10, longRunning.outof());
+}
+
+}  // namespace
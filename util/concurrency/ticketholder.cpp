@@ -72,6 +72,13 @@ bool TicketHolder::tryAcquire() {
 }
 
 void TicketHolder::waitForTicket() {
+    if (tryAcquire())
+        return;
+    _queued.fetchAndAdd(1);
+    _waitForTicket();
+}
+
+void TicketHolder::_waitForTicket() {
     while (0 != sem_wait(&_sem)) {
         switch (errno) {
             case EINTR:
@@ -104,7 +111,7 @@ Status TicketHolder::resize(int newSize) {
     }
 
     while (_outof.load() > newSize) {
-        waitForTicket();
+        _waitForTicket();
         _outof.subtractAndFetch(1);
     }
 
@@ -140,6 +147,10 @@ bool TicketHolder::tryAcquire() {
 void TicketHolder::waitForTicket() {
     stdx::unique_lock<stdx::mutex> lk(_mutex);
 
+    if (_tryAcquire())
+        return;
+    _queued.fetchAndAdd(1);
+
     while (!_tryAcquire()) {
         _newTicket.wait(lk);
     }
@@ -198,4 +209,18 @@ bool TicketHolder::_tryAcquire() {
     return true;
 }
 #endif
+
+void TicketHolder::release(uint64_t heldMicros) {
+    _released.fetchAndAdd(1);
+    _heldMicros.fetchAndAdd(heldMicros);
+    release();
+}
+
+TicketHolder::Stats TicketHolder::getStats() const {
+    Stats stats;
+    stats.released = _released.load();
+    stats.heldMicros = _heldMicros.load();
+    stats.queued = _queued.load();
+    return stats;
+}
 }
@@ -31,6 +31,7 @@
 #endif
 
 #include "mongo/base/disallow_copying.h"
+#include "mongo/platform/atomic_word.h"
 #include "mongo/stdx/condition_variable.h"
 #include "mongo/stdx/mutex.h"
 #include "mongo/util/concurrency/mutex.h"
@@ -41,6 +42,15 @@ class TicketHolder {
     MONGO_DISALLOW_COPYING(TicketHolder);
 
 public:
+    /**
+     * Cumulative counts, for callers that sample them periodically and look at the differences.
+     */
+    struct Stats {
+        uint64_t released = 0;    // tickets released through release(heldMicros)
+        uint64_t heldMicros = 0;  // total time those tickets were held
+        uint64_t queued = 0;      // calls to waitForTicket() that found no ticket available
+    };
+
     explicit TicketHolder(int num);
     ~TicketHolder();
 
@@ -50,6 +60,11 @@ public:
 
     void release();
 
+    /**
+     * Releases a ticket that was held for 'heldMicros', counting it in getStats().
+     */
+    void release(uint64_t heldMicros);
+
     Status resize(int newSize);
 
     int available() const;
@@ -58,8 +73,17 @@ public:
 
     int outof() const;
 
+    Stats getStats() const;
+
 private:
+    AtomicUInt64 _released;
+    AtomicUInt64 _heldMicros;
+    AtomicUInt64 _queued;
+
 #if defined(__linux__)
+    // waitForTicket() without counting the wait in getStats()
+    void _waitForTicket();
+
     mutable sem_t _sem;
 
     // You can read _outof without a lock, but have to hold _resizeMutex to change.
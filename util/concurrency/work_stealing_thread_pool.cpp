@@ -0,0 +1,329 @@
+/**
+ *    Copyright (C) 2016 MongoDB Inc.
+ *
+ *    This program is free software: you can redistribute it and/or  modify
+ *    it under the terms of the GNU Affero General Public License, version 3,
+ *    as published by the Free Software Foundation.
+ *
+ *    This program is distributed in the hope that it will be useful,
+ *    but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *    GNU Affero General Public License for more details.
+ *
+ *    You should have received a copy of the GNU Affero General Public License
+ *    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ *    As a special exception, the copyright holders give permission to link the
+ *    code of portions of this program with the OpenSSL library under certain
+ *    conditions as described in each individual source file and distribute
+ *    linked combinations including the program with the OpenSSL library. You
+ *    must comply with the GNU Affero General Public License in all respects for
+ *    all of the code used other than as permitted herein. If you modify file(s)
+ *    with this exception, you may extend this exception to your version of the
+ *    file(s), but you are not obligated to do so. If you do not wish to do so,
+ *    delete this exception statement from your version. If you delete this
+ *    exception statement from all source files in the program, then also delete
+ *    it in the license file.
+ */
+
+#define MONGO_LOG_DEFAULT_COMPONENT ::mongo::logger::LogComponent::kExecutor
+
+#include "mongo/platform/basic.h"
+
+#include "mongo/util/concurrency/work_stealing_thread_pool.h"
+
+#include "mongo/base/status.h"
+#include "mongo/util/assert_util.h"
+#include "mongo/util/concurrency/thread_name.h"
+#include "mongo/util/concurrency/threadlocal.h"
+#include "mongo/util/log.h"
+#include "mongo/util/mongoutils/str.h"
+
+namespace mongo {
+
+namespace {
+
+// Counter used to assign unique names to otherwise-unnamed thread pools.
+AtomicInt32 nextUnnamedPoolId{1};
+
+// The pool and worker index of the current thread, if it is a pool worker.
+MONGO_TRIVIALLY_CONSTRUCTIBLE_THREAD_LOCAL const WorkStealingThreadPool* currentPool;
+MONGO_TRIVIALLY_CONSTRUCTIBLE_THREAD_LOCAL size_t currentWorker;
+
+WorkStealingThreadPool::Options cleanUpOptions(WorkStealingThreadPool::Options&& options) {
+    if (options.poolName.empty()) {
+        options.poolName = str::stream() << "WorkStealingThreadPool"
+                                         << nextUnnamedPoolId.fetchAndAdd(1);
+    }
+    if (options.threadNamePrefix.empty()) {
+        options.threadNamePrefix = str::stream() << options.poolName << '-';
+    }
+    if (options.numThreads < 1) {
+        severe() << "Tried to create pool " << options.poolName << " with " << options.numThreads
+                 << " threads but it must have at least 1";
+        fassertFailed(34506);
+    }
+    return options;
+}
+
+}  // namespace
+
+WorkStealingThreadPool::WorkStealingThreadPool(Options options)
+    : _options(cleanUpOptions(std::move(options))) {
+    for (size_t i = 0; i < _options.numThreads; ++i) {
+        _workers.emplace_back(new Worker);
+    }
+}
+
+WorkStealingThreadPool::~WorkStealingThreadPool() {
+    stdx::unique_lock<stdx::mutex> lk(_mutex);
+    _shutdown_inlock();
+    if (shutdownComplete != _state) {
+        _join_inlock(&lk);
+    }
+    invariant(_threads.empty());
+    invariant(_queuedItems.load() == 0);
+}
+
+void WorkStealingThreadPool::startup() {
+    stdx::lock_guard<stdx::mutex> lk(_mutex);
+    if (_state != preStart) {
+        severe() << "Attempting to start pool " << _options.poolName
+                 << ", but it has already started";
+        fassertFailed(34507);
+    }
+    _setState_inlock(running);
+    for (size_t i = 0; i < _options.numThreads; ++i) {
+        const std::string threadName = str::stream() << _options.threadNamePrefix << i;
+        _threads.emplace_back(
+            stdx::bind(&WorkStealingThreadPool::_workerThreadBody, this, i, threadName));
+    }
+}
+
+void WorkStealingThreadPool::shutdown() {
+    stdx::lock_guard<stdx::mutex> lk(_mutex);
+    _shutdown_inlock();
+}
+
+void WorkStealingThreadPool::_shutdown_inlock() {
+    switch (_state) {
+        case preStart:
+        case running:
+            _setState_inlock(joinRequired);
+            _workAvailable.notify_all();
+            return;
+        case joinRequired:
+        case joining:
+        case shutdownComplete:
+            return;
+    }
+    MONGO_UNREACHABLE;
+}
+
+void WorkStealingThreadPool::join() {
+    try {
+        stdx::unique_lock<stdx::mutex> lk(_mutex);
+        _join_inlock(&lk);
+    } catch (...) {
+        std::terminate();
+    }
+}
+
+void WorkStealingThreadPool::_join_inlock(stdx::unique_lock<stdx::mutex>* lk) {
+    _stateChange.wait(*lk,
+                      [this] {
+                          switch (_state) {
+                              case preStart:
+                              case running:
+                                  return false;
+                              case joinRequired:
+                                  return true;
+                              case joining:
+                              case shutdownComplete:
+                                  severe() << "Attempted to join pool " << _options.poolName
+                                           << " more than once";
+                                  fassertFailed(34508);
+                          }
+                          MONGO_UNREACHABLE;
+                      });
+    _setState_inlock(joining);
+    std::vector<stdx::thread> threadsToJoin;
+    swap(threadsToJoin, _threads);
+    lk->unlock();
+    for (auto& t : threadsToJoin) {
+        t.join();
+    }
+
+    // The workers drain every queue before they exit, so anything left was scheduled on a pool
+    // that was never started.
+    WorkItem item;
+    while (_pop(0, &item)) {
+        _run(std::move(item));
+    }
+    lk->lock();
+    invariant(_state == joining);
+    _setState_inlock(shutdownComplete);
+}
+
+Status WorkStealingThreadPool::schedule(Task task) {
+    stdx::lock_guard<stdx::mutex> lk(_mutex);
+    if (_state != preStart && _state != running) {
+        return Status(ErrorCodes::ShutdownInProgress,
+                      str::stream() << "Shutdown of thread pool " << _options.poolName
+                                    << " in progress");
+    }
+    _pendingTasks.fetchAndAdd(1);
+
+    const size_t index = currentPool == this
+        ? currentWorker
+        : _nextWorker.fetchAndAdd(1) % _options.numThreads;
+    _push_inlock(index, WorkItem{std::move(task), nullptr});
+    return Status::OK();
+}
+
+Status WorkStealingThreadPool::schedule(uint64_t key, Task task) {
+    stdx::lock_guard<stdx::mutex> lk(_mutex);
+    if (_state != preStart && _state != running) {
+        return Status(ErrorCodes::ShutdownInProgress,
+                      str::stream() << "Shutdown of thread pool " << _options.poolName
+                                    << " in progress");
+    }
+    _pendingTasks.fetchAndAdd(1);
+
+    std::shared_ptr<Chain> chain;
+    {
+        stdx::lock_guard<stdx::mutex> chainsLk(_chainsMutex);
+        auto& entry = _chains[key];
+        if (entry) {
+            // The chain is already queued or running, and will pick this task up.
+            entry->tasks.push_back(std::move(task));
+            return Status::OK();
+        }
+        entry = std::make_shared<Chain>(key);
+        entry->tasks.push_back(std::move(task));
+        chain = entry;
+    }
+    _push_inlock(key % _options.numThreads, WorkItem{Task(), std::move(chain)});
+    return Status::OK();
+}
+
+void WorkStealingThreadPool::waitForIdle() {
+    stdx::unique_lock<stdx::mutex> lk(_mutex);
+    _poolIsIdle.wait(lk, [this] { return _pendingTasks.load() == 0; });
+}
+
+WorkStealingThreadPool::Stats WorkStealingThreadPool::getStats() {
+    stdx::lock_guard<stdx::mutex> lk(_mutex);
+    Stats result;
+    result.options = _options;
+    result.numThreads = _threads.size();
+    result.numPendingTasks = _pendingTasks.load();
+    result.numStolen = _stolen.load();
+    return result;
+}
+
+void WorkStealingThreadPool::_push_inlock(size_t index, WorkItem item) {
+    _queuedItems.fetchAndAdd(1);
+    {
+        Worker& worker = *_workers[index];
+        stdx::lock_guard<stdx::mutex> workerLk(worker.mutex);
+        worker.items.push_back(std::move(item));
+    }
+    _workAvailable.notify_one();
+}
+
+bool WorkStealingThreadPool::_pop(size_t index, WorkItem* item) {
+    const size_t numWorkers = _workers.size();
+    for (size_t i = 0; i < numWorkers; ++i) {
+        Worker& worker = *_workers[(index + i) % numWorkers];
+        stdx::lock_guard<stdx::mutex> workerLk(worker.mutex);
+        if (worker.items.empty()) {
+            continue;
+        }
+        if (i == 0) {
+            *item = std::move(worker.items.front());
+            worker.items.pop_front();
+        } else {
+            // Steal the most recently queued item, which its owner would reach last.
+            *item = std::move(worker.items.back());
+            worker.items.pop_back();
+            _stolen.fetchAndAdd(1);
+        }
+        _queuedItems.fetchAndSubtract(1);
+        return true;
+    }
+    return false;
+}
+
+void WorkStealingThreadPool::_run(WorkItem item) {
+    if (!item.chain) {
+        _runTask(std::move(item.task));
+        return;
+    }
+
+    // Run the chain until it is empty, taking tasks that are appended to it meanwhile.
+    while (true) {
+        Task task;
+        {
+            stdx::lock_guard<stdx::mutex> chainsLk(_chainsMutex);
+            if (item.chain->tasks.empty()) {
+                _chains.erase(item.chain->key);
+                return;
+            }
+            task = std::move(item.chain->tasks.front());
+            item.chain->tasks.pop_front();
+        }
+        _runTask(std::move(task));
+    }
+}
+
+void WorkStealingThreadPool::_runTask(Task task) {
+    try {
+        task();
+    } catch (...) {
+        severe() << "Exception escaped task in thread pool " << _options.poolName;
+        std::terminate();
+    }
+    if (_pendingTasks.subtractAndFetch(1) == 0) {
+        stdx::lock_guard<stdx::mutex> lk(_mutex);
+        _poolIsIdle.notify_all();
+    }
+}
+
+void WorkStealingThreadPool::_workerThreadBody(size_t index, const std::string& threadName) {
+    setThreadName(threadName);
+    currentPool = this;
+    currentWorker = index;
+    LOG(1) << "starting thread in pool " << _options.poolName;
+
+    WorkItem item;
+    while (true) {
+        if (_pop(index, &item)) {
+            _run(std::move(item));
+            continue;
+        }
+
+        stdx::unique_lock<stdx::mutex> lk(_mutex);
+        if (_queuedItems.load() != 0) {
+            continue;
+        }
+        if (_state != running) {
+            // Shutting down, and every queue has been drained.
+            break;
+        }
+        _workAvailable.wait(lk);
+    }
+
+    currentPool = nullptr;
+    LOG(1) << "shutting down thread in pool " << _options.poolName;
+}
+
+void WorkStealingThreadPool::_setState_inlock(const LifecycleState newState) {
+    if (newState == _state) {
+        return;
+    }
+    _state = newState;
+    _stateChange.notify_all();
+}
+
+}  // namespace mongo
@@ -0,0 +1,226 @@
+/**
+ *    Copyright (C) 2016 MongoDB Inc.
+ *
+ *    This program is free software: you can redistribute it and/or  modify
+ *    it under the terms of the GNU Affero General Public License, version 3,
+ *    as published by the Free Software Foundation.
+ *
+ *    This program is distributed in the hope that it will be useful,
+ *    but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *    GNU Affero General Public License for more details.
+ *
+ *    You should have received a copy of the GNU Affero General Public License
+ *    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ *    As a special exception, the copyright holders give permission to link the
+ *    code of portions of this program with the OpenSSL library under certain
+ *    conditions as described in each individual source file and distribute
+ *    linked combinations including the program with the OpenSSL library. You
+ *    must comply with the GNU Affero General Public License in all respects for
+ *    all of the code used other than as permitted herein. If you modify file(s)
+ *    with this exception, you may extend this exception to your version of the
+ *    file(s), but you are not obligated to do so. If you do not wish to do so,
+ *    delete this exception statement from your version. If you delete this
+ *    exception statement from all source files in the program, then also delete
+ *    it in the license file.
+ */
+
+#pragma once
+
+#include <cstdint>
+#include <deque>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "mongo/base/disallow_copying.h"
+#include "mongo/platform/atomic_word.h"
+#include "mongo/platform/unordered_map.h"
+#include "mongo/stdx/condition_variable.h"
+#include "mongo/stdx/mutex.h"
+#include "mongo/stdx/thread.h"
+#include "mongo/util/concurrency/thread_pool_interface.h"
+
+namespace mongo {
+
+class Status;
+
+/**
+ * A fixed-size thread pool in which every worker owns a queue of tasks and idle workers steal
+ * from the queues of busy ones.
+ *
+ * Besides the unordered schedule() of ThreadPoolInterface, tasks may be scheduled with a key.
+ * Tasks sharing a key form a chain: they run one at a time, in the order they were scheduled.
+ * A chain is queued on the worker its key maps to, but it is stolen as a whole, so an idle
+ * worker may run any chain that has not started yet while ordering within each chain is kept.
+ *
+ * Tasks scheduled by a worker of the pool go to that worker's own queue.
+ */
+class WorkStealingThreadPool final : public ThreadPoolInterface {
+    MONGO_DISALLOW_COPYING(WorkStealingThreadPool);
+
+public:
+    /**
+     * Structure used to configure an instance of WorkStealingThreadPool.
+     */
+    struct Options {
+        // Name of the thread pool. If this string is empty, the pool will be assigned a
+        // name unique to the current process.
+        std::string poolName;
+
+        // Prefix used to name threads for logging purposes. An integer is appended to it for each
+        // thread. If this is empty, the prefix is the pool name followed by a hyphen.
+        std::string threadNamePrefix;
+
+        // Number of worker threads, all of which are started by startup().
+        size_t numThreads = 8;
+    };
+
+    /**
+     * Structure used to return information about the thread pool via getStats().
+     */
+    struct Stats {
+        // The options for the instance of the pool returning these stats.
+        Options options;
+
+        // The number of threads in the pool.
+        size_t numThreads;
+
+        // The number of tasks scheduled but not yet completed.
+        uint64_t numPendingTasks;
+
+        // The number of tasks and chains taken from another worker's queue.
+        uint64_t numStolen;
+    };
+
+    /**
+     * Constructs a thread pool, configured with the given "options".
+     */
+    explicit WorkStealingThreadPool(Options options);
+
+    ~WorkStealingThreadPool() override;
+
+    void startup() override;
+    void shutdown() override;
+    void join() override;
+    Status schedule(Task task) override;
+
+    /**
+     * Schedules "task" on the chain for "key". It runs after every task previously scheduled with
+     * the same key has completed.
+     *
+     * Returns OK on success, ShutdownInProgress if shutdown() has already executed.
+     */
+    Status schedule(uint64_t key, Task task);
+
+    /**
+     * Blocks the caller until every task scheduled so far has completed. Unlike join(), the pool
+     * keeps running. May not be called by a task in the thread pool.
+     */
+    void waitForIdle();
+
+    /**
+     * Returns statistics about the thread pool's utilization.
+     */
+    Stats getStats();
+
+private:
+    /**
+     * The tasks scheduled under one key that have not started yet. Guarded by _chainsMutex.
+     */
+    struct Chain {
+        explicit Chain(uint64_t k) : key(k) {}
+
+        const uint64_t key;
+        std::deque<Task> tasks;
+    };
+
+    /**
+     * An entry of a worker's queue: either a single task or a whole chain.
+     */
+    struct WorkItem {
+        Task task;
+        std::shared_ptr<Chain> chain;
+    };
+
+    /**
+     * The queue of one worker. Owners take from the front and thieves from the back.
+     */
+    struct Worker {
+        stdx::mutex mutex;
+        std::deque<WorkItem> items;
+    };
+
+    /**
+     * See ThreadPool::LifecycleState; the transitions are the same.
+     */
+    enum LifecycleState { preStart, running, joinRequired, joining, shutdownComplete };
+
+    /**
+     * This is the thread body for worker number "index".
+     */
+    void _workerThreadBody(size_t index, const std::string& threadName);
+
+    /**
+     * Appends "item" to the queue of worker "index" and wakes a sleeping worker. _mutex must be
+     * held.
+     */
+    void _push_inlock(size_t index, WorkItem item);
+
+    /**
+     * Takes the next item from the queue of worker "index", or else steals one from another
+     * worker. Returns false if every queue is empty.
+     */
+    bool _pop(size_t index, WorkItem* item);
+
+    /**
+     * Runs a single task, or every task of a chain until the chain is empty.
+     */
+    void _run(WorkItem item);
+
+    /**
+     * Runs one task and accounts for its completion.
+     */
+    void _runTask(Task task);
+
+    void _shutdown_inlock();
+    void _join_inlock(stdx::unique_lock<stdx::mutex>* lk);
+    void _setState_inlock(LifecycleState newState);
+
+    // These are the options with which the pool was configured at construction time.
+    const Options _options;
+
+    // One queue per worker thread, created with the pool so tasks can be queued before startup().
+    std::vector<std::unique_ptr<Worker>> _workers;
+
+    // Chains that have queued or running tasks, by key.
+    stdx::mutex _chainsMutex;
+    unordered_map<uint64_t, std::shared_ptr<Chain>> _chains;
+
+    // Guards _state and _threads, and is held by workers that are about to sleep.
+    stdx::mutex _mutex;
+    LifecycleState _state = preStart;
+    std::vector<stdx::thread> _threads;
+
+    // Signaled when an item is queued, or when the pool is shutting down.
+    stdx::condition_variable _workAvailable;
+
+    // Signaled when _pendingTasks drops to zero.
+    stdx::condition_variable _poolIsIdle;
+
+    // Signaled whenever _state changes.
+    stdx::condition_variable _stateChange;
+
+    // Items in the worker queues. Only incremented with _mutex held, so a worker that sees zero
+    // under _mutex cannot miss the notification for the next item.
+    AtomicUInt64 _queuedItems;
+
+    // Tasks scheduled but not yet completed.
+    AtomicUInt64 _pendingTasks;
+
+    AtomicUInt64 _stolen;
+    AtomicUInt64 _nextWorker;
+};
+
+}  // namespace mongo
@@ -0,0 +1,107 @@
+/**
+ *    Copyright (C) 2016 MongoDB Inc.
+ *
+ *    This program is free software: you can redistribute it and/or  modify
+ *    it under the terms of the GNU Affero General Public License, version 3,
+ *    as published by the Free Software Foundation.
+ *
+ *    This program is distributed in the hope that it will be useful,
+ *    but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *    GNU Affero General Public License for more details.
+ *
+ *    You should have received a copy of the GNU Affero General Public License
+ *    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ *    As a special exception, the copyright holders give permission to link the
+ *    code of portions of this program with the OpenSSL library under certain
+ *    conditions as described in each individual source file and distribute
+ *    linked combinations including the program with the OpenSSL library. You
+ *    must comply with the GNU Affero General Public License in all respects for
+ *    all of the code used other than as permitted herein. If you modify file(s)
+ *    with this exception, you may extend this exception to your version of the
+ *    file(s), but you are not obligated to do so. If you do not wish to do so,
+ *    delete this exception statement from your version. If you delete this
+ *    exception statement from all source files in the program, then also delete
+ *    it in the license file.
+ */
+
+#include "mongo/platform/basic.h"
+
+#include <vector>
+
+#include "mongo/base/init.h"
+#include "mongo/stdx/condition_variable.h"
+#include "mongo/stdx/memory.h"
+#include "mongo/stdx/mutex.h"
+#include "mongo/unittest/unittest.h"
+#include "mongo/util/concurrency/thread_pool_test_common.h"
+#include "mongo/util/concurrency/work_stealing_thread_pool.h"
+#include "mongo/util/time_support.h"
+
+namespace {
+using namespace mongo;
+
+MONGO_INITIALIZER(WorkStealingThreadPoolCommonTests)(InitializerContext*) {
+    addTestsForThreadPool("WorkStealingThreadPoolCommon", []() {
+        return stdx::make_unique<WorkStealingThreadPool>(WorkStealingThreadPool::Options());
+    });
+    return Status::OK();
+}
+
+TEST(WorkStealingThreadPoolTest, KeyedTasksRunInScheduleOrder) {
+    WorkStealingThreadPool::Options options;
+    options.numThreads = 4;
+    WorkStealingThreadPool pool(options);
+    pool.startup();
+
+    const size_t numKeys = 8;
+    const size_t tasksPerKey = 500;
+    std::vector<std::vector<size_t>> seen(numKeys);
+    for (size_t i = 0; i < tasksPerKey; ++i) {
+        for (size_t key = 0; key < numKeys; ++key) {
+            // Tasks of one key never run concurrently, so each vector is only touched by one
+            // thread at a time.
+            ASSERT_OK(pool.schedule(key, [&seen, key, i] { seen[key].push_back(i); }));
+        }
+    }
+    pool.waitForIdle();
+    ASSERT_EQ(0U, pool.getStats().numPendingTasks);
+
+    for (size_t key = 0; key < numKeys; ++key) {
+        ASSERT_EQ(tasksPerKey, seen[key].size());
+        for (size_t i = 0; i < tasksPerKey; ++i) {
+            ASSERT_EQ(i, seen[key][i]);
+        }
+    }
+}
+
+TEST(WorkStealingThreadPoolTest, IdleWorkerStealsChainQueuedBehindBusyOne) {
+    WorkStealingThreadPool::Options options;
+    options.numThreads = 2;
+    WorkStealingThreadPool pool(options);
+
+    stdx::mutex mutex;
+    stdx::condition_variable cv;
+    bool secondRan = false;
+    bool firstSawSecond = false;
+
+    // Keys 0 and 2 are both queued on worker 0. The first chain blocks until the second has run,
+    // which can only happen if worker 1 steals it.
+    ASSERT_OK(pool.schedule(0, [&] {
+        stdx::unique_lock<stdx::mutex> lk(mutex);
+        firstSawSecond = cv.wait_for(lk, Seconds(30), [&] { return secondRan; });
+    }));
+    ASSERT_OK(pool.schedule(2, [&] {
+        stdx::lock_guard<stdx::mutex> lk(mutex);
+        secondRan = true;
+        cv.notify_all();
+    }));
+    pool.startup();
+    pool.waitForIdle();
+
+    ASSERT_TRUE(firstSawSecond);
+    ASSERT_GTE(pool.getStats().numStolen, 1U);
+}
+
+}  // namespace
@@ -75,6 +75,9 @@ public:
     virtual bool setupSockets() = 0;
 };
 
-// TODO use a factory here to decide between port and asio variations
+/**
+ * Creates a server with a thread per connection, or with the epoll service executor when started
+ * with --setParameter serviceExecutor=epoll.
+ */
 MessageServer* createServer(const MessageServer::Options& opts, MessageHandler* handler);
 }
@@ -0,0 +1,461 @@
+/**
+ *    Copyright (C) 2016 MongoDB Inc.
+ *
+ *    This program is free software: you can redistribute it and/or  modify
+ *    it under the terms of the GNU Affero General Public License, version 3,
+ *    as published by the Free Software Foundation.
+ *
+ *    This program is distributed in the hope that it will be useful,
+ *    but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *    GNU Affero General Public License for more details.
+ *
+ *    You should have received a copy of the GNU Affero General Public License
+ *    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ *    As a special exception, the copyright holders give permission to link the
+ *    code of portions of this program with the OpenSSL library under certain
+ *    conditions as described in each individual source file and distribute
+ *    linked combinations including the program with the OpenSSL library. You
+ *    must comply with the GNU Affero General Public License in all respects for
+ *    all of the code used other than as permitted herein. If you modify file(s)
+ *    with this exception, you may extend this exception to your version of the
+ *    file(s), but you are not obligated to do so. If you do not wish to do so,
+ *    delete this exception statement from your version. If you delete this
+ *    exception statement from all source files in the program, then also delete
+ *    it in the license file.
+ */
+
+#define MONGO_LOG_DEFAULT_COMPONENT ::mongo::logger::LogComponent::kNetwork
+
+#include "mongo/platform/basic.h"
+
+#include "mongo/util/net/message_server_epoll.h"
+
+#include <memory>
+#include <set>
+#include <sstream>
+#include <sys/epoll.h>
+#include <sys/socket.h>
+#include <unistd.h>
+#include <vector>
+
+#include "mongo/base/disallow_copying.h"
+#include "mongo/db/client.h"
+#include "mongo/db/server_options.h"
+#include "mongo/db/stats/counters.h"
+#include "mongo/stdx/functional.h"
+#include "mongo/stdx/mutex.h"
+#include "mongo/stdx/thread.h"
+#include "mongo/util/allocator.h"
+#include "mongo/util/concurrency/synchronization.h"
+#include "mongo/util/concurrency/thread_name.h"
+#include "mongo/util/concurrency/ticketholder.h"
+#include "mongo/util/exit.h"
+#include "mongo/util/log.h"
+#include "mongo/util/mongoutils/str.h"
+#include "mongo/util/net/listen.h"
+#include "mongo/util/net/message.h"
+#include "mongo/util/net/message_port.h"
+#include "mongo/util/scopeguard.h"
+
+namespace mongo {
+
+namespace {
+
+/**
+ * One client connection. Between messages it owns the connection's Client, which a worker binds
+ * to its thread while it processes a message, along with whatever part of the next message has
+ * arrived so far.
+ */
+class EpollConnection {
+    MONGO_DISALLOW_COPYING(EpollConnection);
+
+public:
+    enum ReadStatus {
+        kComplete,  // 'm' holds the whole message.
+        kPartial,   // The socket has no more data yet; wait for it to become readable again.
+        kClosed,    // The peer went away or sent something unusable; close the connection.
+    };
+
+    EpollConnection(const std::shared_ptr<Socket>& socket, long long connectionId)
+        : port(socket) {
+        port.setConnectionId(connectionId);
+    }
+
+    ~EpollConnection() {
+        free(_data);
+    }
+
+    /**
+     * Reads as much of the next message as the socket has available without blocking. Mirrors the
+     * checks in MessagingPort::recv(), except that an SSL handshake is refused since the epoll
+     * server only runs without SSL.
+     */
+    ReadStatus readMessage(Message& m);
+
+    /**
+     * Bytes read from the socket for the last complete message.
+     */
+    long long bytesIn() const {
+        return _bytesIn;
+    }
+
+    MessagingPort port;
+
+    // Null until MessageHandler::connected() has run for this connection.
+    ServiceContext::UniqueClient client;
+
+private:
+    ReadStatus readSome(char* buf, int len, int* got);
+
+    MSGHEADER::Value _header;
+    int _headerRead = 0;
+
+    // Allocated once the header is complete, holds the header followed by the body.
+    char* _data = nullptr;
+    int _dataRead = 0;
+
+    long long _bytesIn = 0;
+};
+
+EpollConnection::ReadStatus EpollConnection::readSome(char* buf, int len, int* got) {
+    while (*got < len) {
+        ssize_t n = ::recv(port.psock->rawFD(), buf + *got, len - *got, MSG_DONTWAIT);
+        if (n > 0) {
+            *got += n;
+            _bytesIn += n;
+            continue;
+        }
+        if (n == 0) {
+            return kClosed;
+        }
+        if (errno == EINTR) {
+            continue;
+        }
+        if (errno == EAGAIN || errno == EWOULDBLOCK) {
+            return kPartial;
+        }
+        LOG(port.psock->getLogLevel()) << "SocketException: remote: " << port.remote()
+                                       << " error: " << errnoWithDescription();
+        return kClosed;
+    }
+    return kComplete;
+}
+
+EpollConnection::ReadStatus EpollConnection::readMessage(Message& m) {
+    const int headerLen = sizeof(MSGHEADER::Value);
+
+    if (!_data) {
+        if (_headerRead == 0) {
+            _bytesIn = 0;
+        }
+
+        ReadStatus status = readSome(reinterpret_cast<char*>(&_header), headerLen, &_headerRead);
+        if (status != kComplete) {
+            return status;
+        }
+
+        int len = _header.constView().getMessageLength();
+        if (len == 542393671) {
+            // an http GET
+            std::string msg =
+                "It looks like you are trying to access MongoDB over HTTP on the native driver "
+                "port.\n";
+            LOG(port.psock->getLogLevel()) << msg;
+            std::stringstream ss;
+            ss << "HTTP/1.0 200 OK\r\nConnection: close\r\nContent-Type: "
+                  "text/plain\r\nContent-Length: " << msg.size() << "\r\n\r\n" << msg;
+            std::string s = ss.str();
+            port.send(s.c_str(), s.size(), "http");
+            return kClosed;
+        }
+        if (port.psock->isAwaitingHandshake() && _header.constView().getResponseTo() != 0 &&
+            _header.constView().getResponseTo() != -1) {
+            log() << "SSL handshake requested, SSL feature not available in this server";
+            return kClosed;
+        }
+        if (static_cast<size_t>(len) < sizeof(MSGHEADER::Value) ||
+            static_cast<size_t>(len) > MaxMessageSizeBytes) {
+            LOG(0) << "recv(): message len " << len << " is invalid. "
+                   << "Min " << sizeof(MSGHEADER::Value) << " Max: " << MaxMessageSizeBytes;
+            return kClosed;
+        }
+
+        port.psock->setHandshakeReceived();
+        int z = (len + 1023) & 0xfffffc00;
+        verify(z >= len);
+        _data = reinterpret_cast<char*>(mongoMalloc(z));
+        memcpy(_data, &_header, headerLen);
+        _dataRead = headerLen;
+    }
+
+    const int len = _header.constView().getMessageLength();
+    ReadStatus status = readSome(_data, len, &_dataRead);
+    if (status != kComplete) {
+        return status;
+    }
+
+    m.setData(_data, true);
+    _data = nullptr;
+    _dataRead = 0;
+    _headerRead = 0;
+    return kComplete;
+}
+
+// How long a worker waits in epoll_wait before checking for shutdown.
+const int kWaitMillis = 1000;
+
+}  // namespace
+
+class EpollMessageServer : public MessageServer, public Listener {
+public:
+    /**
+     * @param handler the handler to use. Caller is responsible for managing this object
+     *     and should make sure that it lives longer than this server.
+     */
+    EpollMessageServer(const MessageServer::Options& opts, MessageHandler* handler, int workers)
+        : Listener("", opts.ipList, opts.port), _handler(handler), _workers(workers), _epfd(-1) {}
+
+    virtual ~EpollMessageServer() {
+        closeAllConnections();
+        if (_epfd >= 0)
+            ::close(_epfd);
+    }
+
+    virtual void accepted(std::shared_ptr<Socket> psocket, long long connectionId) {
+        ScopeGuard sleepAfterClosingPort = MakeGuard(sleepmillis, 2);
+        std::unique_ptr<EpollConnection> conn(new EpollConnection(psocket, connectionId));
+
+        if (!Listener::globalTicketHolder.tryAcquire()) {
+            log() << "connection refused because too many open connections: "
+                  << Listener::globalTicketHolder.used();
+            return;
+        }
+
+        conn->port.psock->setLogLevel(logger::LogSeverity::Debug(1));
+
+        stdx::lock_guard<stdx::mutex> lk(_mutex);
+        struct epoll_event event;
+        event.events = EPOLLIN | EPOLLRDHUP | EPOLLONESHOT;
+        event.data.ptr = conn.get();
+        if (epoll_ctl(_epfd, EPOLL_CTL_ADD, psocket->rawFD(), &event) != 0) {
+            Listener::globalTicketHolder.release();
+            log() << "epoll_ctl failed after accepting new connection, closing connection: "
+                  << errnoWithDescription();
+            return;
+        }
+        _connections.insert(conn.get());
+
+        conn.release();
+        sleepAfterClosingPort.Dismiss();
+    }
+
+    virtual void setAsTimeTracker() {
+        Listener::setAsTimeTracker();
+    }
+
+    virtual bool setupSockets() {
+        _epfd = epoll_create1(EPOLL_CLOEXEC);
+        if (_epfd < 0) {
+            error() << "epoll_create1 failed: " << errnoWithDescription();
+            return false;
+        }
+        return Listener::setupSockets();
+    }
+
+    void run() {
+        log() << "serving connections with " << _workers << " epoll worker threads";
+        std::vector<stdx::thread> workers;
+        for (int i = 0; i < _workers; ++i) {
+            workers.emplace_back(stdx::bind(&EpollMessageServer::workerLoop, this, i));
+        }
+
+        initAndListen();
+
+        // initAndListen() only returns on shutdown, which also stops the workers. Once they are
+        // gone nobody else touches the registered connections.
+        for (auto& worker : workers) {
+            worker.join();
+        }
+        closeAllConnections();
+    }
+
+    virtual bool useUnixSockets() const {
+        return true;
+    }
+
+private:
+    /**
+     * Each worker waits on the shared epoll set for one ready connection at a time. Sockets are
+     * registered with EPOLLONESHOT, so a ready connection is handed to exactly one worker and is
+     * not reported again until that worker re-arms it after processing the message.
+     */
+    void workerLoop(int n) {
+        setThreadName(std::string(str::stream() << "epollWorker" << n));
+        int64_t counter = 0;
+
+        while (!inShutdown()) {
+            struct epoll_event event;
+            int ready = epoll_wait(_epfd, &event, 1, kWaitMillis);
+            if (ready < 0) {
+                if (errno == EINTR)
+                    continue;
+                severe() << "epoll_wait failed: " << errnoWithDescription();
+                fassertFailed(34505);
+            }
+            if (ready == 0)
+                continue;
+
+            EpollConnection* conn = static_cast<EpollConnection*>(event.data.ptr);
+            if (!handleReady(conn)) {
+                closeConnection(conn);
+            }
+
+            // Occasionally we want to see if we're using too much memory.
+            if ((counter++ & 0xf) == 0) {
+                markThreadIdle();
+            }
+        }
+    }
+
+    /**
+     * Reads whatever has arrived on a ready connection, with the connection's Client bound to the
+     * current thread, and processes the message once all of it is in. Reads never block: a
+     * partially received message stays buffered on the connection until the socket is reported
+     * readable again.
+     *
+     * Returns true once the connection is re-armed for more input. Returns false if the
+     * connection should be closed, in which case the handler has already been told through
+     * close().
+     */
+    bool handleReady(EpollConnection* conn) {
+        bool connected = false;
+        bool keepOpen = false;
+        try {
+            if (conn->client) {
+                Client::setCurrent(std::move(conn->client));
+            } else {
+                _handler->connected(&conn->port);
+            }
+            connected = true;
+
+            Message m;
+            EpollConnection::ReadStatus status = conn->readMessage(m);
+            if (status == EpollConnection::kComplete) {
+                conn->port.psock->clearCounters();
+                _handler->process(m, &conn->port);
+                networkCounter.hit(conn->bytesIn(), conn->port.psock->getBytesOut());
+                keepOpen = !inShutdown();
+            } else if (status == EpollConnection::kPartial) {
+                keepOpen = !inShutdown();
+            } else if (!serverGlobalParams.quiet) {
+                int conns = Listener::globalTicketHolder.used() - 1;
+                const char* word = (conns == 1 ? " connection" : " connections");
+                log() << "end connection " << conn->port.psock->remoteString() << " (" << conns
+                      << word << " now open)";
+            }
+        } catch (AssertionException& e) {
+            log() << "AssertionException handling request, closing client connection: " << e;
+        } catch (SocketException& e) {
+            log() << "SocketException handling request, closing client connection: " << e;
+        } catch (const DBException& e) {
+            // must be right above std::exception to avoid catching subclasses
+            log() << "DBException handling request, closing client connection: " << e;
+        } catch (std::exception& e) {
+            error() << "Uncaught std::exception: " << e.what() << ", terminating";
+            dbexit(EXIT_UNCAUGHT);
+        }
+
+        if (keepOpen) {
+            // Once re-armed another worker may pick the connection up, so release it first.
+            conn->client = Client::releaseCurrent();
+            if (rearm(conn)) {
+                return true;
+            }
+            Client::setCurrent(std::move(conn->client));
+        }
+        if (connected) {
+            _handler->close();
+        }
+        return false;
+    }
+
+    bool rearm(EpollConnection* conn) {
+        struct epoll_event event;
+        event.events = EPOLLIN | EPOLLRDHUP | EPOLLONESHOT;
+        event.data.ptr = conn;
+        if (epoll_ctl(_epfd, EPOLL_CTL_MOD, conn->port.psock->rawFD(), &event) != 0) {
+            log() << "epoll_ctl failed, closing client connection: " << errnoWithDescription();
+            return false;
+        }
+        return true;
+    }
+
+    void closeConnection(EpollConnection* conn) {
+        {
+            stdx::lock_guard<stdx::mutex> lk(_mutex);
+            _connections.erase(conn);
+        }
+        destroyConnection(conn);
+    }
+
+    /**
+     * Closes every connection still registered. Only called once no worker is running, so each
+     * connection is idle and owns its Client.
+     */
+    void closeAllConnections() {
+        std::set<EpollConnection*> connections;
+        {
+            stdx::lock_guard<stdx::mutex> lk(_mutex);
+            connections.swap(_connections);
+        }
+        if (connections.empty()) {
+            return;
+        }
+
+        // close() expects the connection's Client on the calling thread, and this thread may
+        // already have a Client of its own.
+        stdx::thread closer([this, &connections]() {
+            for (EpollConnection* conn : connections) {
+                if (!conn->client) {
+                    continue;
+                }
+                Client::setCurrent(std::move(conn->client));
+                _handler->close();
+                if (haveClient()) {
+                    Client::releaseCurrent();
+                }
+            }
+        });
+        closer.join();
+
+        for (EpollConnection* conn : connections) {
+            destroyConnection(conn);
+        }
+    }
+
+    void destroyConnection(EpollConnection* conn) {
+        epoll_ctl(_epfd, EPOLL_CTL_DEL, conn->port.psock->rawFD(), NULL);
+        conn->port.shutdown();
+        delete conn;
+        Listener::globalTicketHolder.release();
+    }
+
+    MessageHandler* const _handler;
+    const int _workers;
+    int _epfd;
+
+    // Guards _connections, which holds every connection registered with _epfd.
+    stdx::mutex _mutex;
+    std::set<EpollConnection*> _connections;
+};
+
+
+MessageServer* createEpollServer(const MessageServer::Options& opts,
+                                 MessageHandler* handler,
+                                 int workers) {
+    return new EpollMessageServer(opts, handler, workers);
+}
+
+}  // namespace mongo
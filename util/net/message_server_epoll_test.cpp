@@ -0,0 +1,168 @@
+/**
+ * Copyright (C) 2016 MongoDB Inc.
+ *
+ * This program is free software: you can redistribute it and/or  modify
+ * it under the terms of the GNU Affero General Public License, version 3,
+ * as published by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Affero General Public License for more details.
+ *
+ * You should have received a copy of the GNU Affero General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ * As a special exception, the copyright holders give permission to link the
+ * code of portions of this program with the OpenSSL library under certain
+ * conditions as described in each individual source file and distribute
+ * linked combinations including the program with the OpenSSL library. You
+ * must comply with the GNU Affero General Public License in all respects
+ * for all of the code used other than as permitted herein. If you modify
+ * file(s) with this exception, you may extend this exception to your
+ * version of the file(s), but you are not obligated to do so. If you do not
+ * wish to do so, delete this exception statement from your version. If you
+ * delete this exception statement from all source files in the program,
+ * then also delete it in the license file.
+ */
+
+#define MONGO_LOG_DEFAULT_COMPONENT ::mongo::logger::LogComponent::kDefault
+
+#include "mongo/platform/basic.h"
+
+#include <netinet/in.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+#include "mongo/db/client.h"
+#include "mongo/db/server_parameters.h"
+#include "mongo/db/service_context_noop.h"
+#include "mongo/platform/atomic_word.h"
+#include "mongo/stdx/thread.h"
+#include "mongo/unittest/unittest.h"
+#include "mongo/util/exit.h"
+#include "mongo/util/map_util.h"
+#include "mongo/util/net/message.h"
+#include "mongo/util/net/message_port.h"
+#include "mongo/util/net/message_server.h"
+#include "mongo/util/net/sock.h"
+#include "mongo/util/quick_exit.h"
+#include "mongo/util/time_support.h"
+
+namespace mongo {
+
+static AtomicUInt32 myShutdownInProgress(0);
+bool inShutdown() {
+    return myShutdownInProgress.loadRelaxed() != 0;
+}
+
+void dbexit(ExitCode returnCode, const char* whyMsg) {
+    quickExit(returnCode);
+}
+
+namespace {
+
+/**
+ * Replies to every message with a copy of its body.
+ */
+class EchoHandler : public MessageHandler {
+public:
+    explicit EchoHandler(ServiceContext* service) : _service(service) {}
+
+    virtual void connected(AbstractMessagingPort* p) {
+        Client::initThread("conn", _service, p);
+    }
+
+    virtual void process(Message& m, AbstractMessagingPort* p) {
+        Message response;
+        response.setData(opReply, m.singleData().data(), m.singleData().dataLen());
+        p->reply(m, response);
+    }
+
+    virtual void close() {
+        Client::destroy();
+    }
+
+private:
+    ServiceContext* const _service;
+};
+
+/**
+ * Returns a TCP port that was free a moment ago.
+ */
+int findFreePort() {
+    int fd = socket(AF_INET, SOCK_STREAM, 0);
+    ASSERT_GREATER_THAN_OR_EQUALS(fd, 0);
+    struct sockaddr_in addr = {};
+    addr.sin_family = AF_INET;
+    addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+    addr.sin_port = 0;
+    ASSERT_EQUALS(0, bind(fd, reinterpret_cast<struct sockaddr*>(&addr), sizeof(addr)));
+    socklen_t len = sizeof(addr);
+    ASSERT_EQUALS(0, getsockname(fd, reinterpret_cast<struct sockaddr*>(&addr), &len));
+    ::close(fd);
+    return ntohs(addr.sin_port);
+}
+
+void setServerParameter(const std::string& name, const std::string& value) {
+    ServerParameter* parameter = mapFindWithDefault(
+        ServerParameterSet::getGlobal()->getMap(), name, static_cast<ServerParameter*>(NULL));
+    ASSERT(parameter);
+    ASSERT_OK(parameter->setFromString(value));
+}
+
+TEST(EpollMessageServer, EchoesWholeAndSplitMessages) {
+    setServerParameter("serviceExecutor", "epoll");
+    setServerParameter("serviceExecutorWorkers", "2");
+
+    ServiceContextNoop service;
+    EchoHandler handler(&service);
+
+    MessageServer::Options opts;
+    opts.port = findFreePort();
+    opts.ipList = "127.0.0.1";
+    std::unique_ptr<MessageServer> server(createServer(opts, &handler));
+    ASSERT_TRUE(server->setupSockets());
+    stdx::thread serverThread([&server]() { server->run(); });
+
+    MessagingPort port;
+    SockAddr farEnd("127.0.0.1", opts.port);
+    ASSERT_TRUE(port.connect(farEnd));
+
+    // A message sent in one piece.
+    {
+        Message toSend;
+        toSend.setData(dbMsg, "hello");
+        Message response;
+        ASSERT_TRUE(port.call(toSend, response));
+        ASSERT_EQUALS(std::string("hello"), std::string(response.singleData().data()));
+    }
+
+    // A message whose header and body arrive separately, so that the worker has to re-arm the
+    // connection in the middle of it.
+    {
+        Message toSend;
+        toSend.setData(dbMsg, "split");
+        toSend.header().setId(nextMessageId());
+        const char* buf = toSend.buf();
+        const int len = toSend.header().getLen();
+        port.send(buf, 10, "test");
+        sleepmillis(100);
+        port.send(buf + 10, len - 10, "test");
+
+        Message response;
+        ASSERT_TRUE(port.recv(response));
+        ASSERT_EQUALS(toSend.header().getId(), response.header().getResponseTo());
+        ASSERT_EQUALS(std::string("split"), std::string(response.singleData().data()));
+    }
+
+    // Shutting down stops the workers and closes the still-open connection.
+    myShutdownInProgress.store(1);
+    serverThread.join();
+    Message response;
+    ASSERT_FALSE(port.recv(response));
+}
+
+}  // namespace
+
+}  // namespace mongo
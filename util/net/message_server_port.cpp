@@ -38,6 +38,7 @@
 #include "mongo/config.h"
 #include "mongo/db/lasterror.h"
 #include "mongo/db/server_options.h"
+#include "mongo/db/server_parameters.h"
 #include "mongo/db/stats/counters.h"
 #include "mongo/stdx/functional.h"
 #include "mongo/stdx/thread.h"
@@ -52,7 +53,9 @@
 #include "mongo/util/net/message.h"
 #include "mongo/util/net/message_port.h"
 #include "mongo/util/net/message_server.h"
+#include "mongo/util/net/message_server_epoll.h"
 #include "mongo/util/net/ssl_manager.h"
+#include "mongo/util/net/ssl_options.h"
 #include "mongo/util/scopeguard.h"
 
 #ifdef __linux__  // TODO: consider making this ifndef _WIN32
@@ -70,6 +73,54 @@ using std::endl;
 
 namespace {
 
+/**
+ * How client connections are served: "threadPerConnection" runs a dedicated thread for each
+ * connection, "epoll" serves all of them from a fixed pool of serviceExecutorWorkers threads.
+ */
+std::string serviceExecutor = "threadPerConnection";
+
+class ExportedServiceExecutorParameter
+    : public ExportedServerParameter<std::string, ServerParameterType::kStartupOnly> {
+public:
+    ExportedServiceExecutorParameter()
+        : ExportedServerParameter<std::string, ServerParameterType::kStartupOnly>(
+              ServerParameterSet::getGlobal(), "serviceExecutor", &serviceExecutor) {}
+
+    virtual Status validate(const std::string& potentialNewValue) {
+        if (potentialNewValue != "threadPerConnection" && potentialNewValue != "epoll") {
+            return Status(ErrorCodes::BadValue,
+                          "serviceExecutor must be \"threadPerConnection\" or \"epoll\"");
+        }
+
+        return Status::OK();
+    }
+
+} exportedServiceExecutorParam;
+
+/**
+ * Worker threads of the "epoll" service executor. A worker stays busy for the whole of an
+ * operation, including blocking ones such as awaitData getMores, so size the pool for the
+ * number of operations expected to run at once rather than the number of connections.
+ */
+int serviceExecutorWorkers = 64;
+
+class ExportedServiceExecutorWorkersParameter
+    : public ExportedServerParameter<int, ServerParameterType::kStartupOnly> {
+public:
+    ExportedServiceExecutorWorkersParameter()
+        : ExportedServerParameter<int, ServerParameterType::kStartupOnly>(
+              ServerParameterSet::getGlobal(), "serviceExecutorWorkers", &serviceExecutorWorkers) {}
+
+    virtual Status validate(const int& potentialNewValue) {
+        if (potentialNewValue < 1 || potentialNewValue > 1024) {
+            return Status(ErrorCodes::BadValue, "serviceExecutorWorkers must be between 1 and 1024");
+        }
+
+        return Status::OK();
+    }
+
+} exportedServiceExecutorWorkersParam;
+
 class MessagingPortWithHandler : public MessagingPort {
     MONGO_DISALLOW_COPYING(MessagingPortWithHandler);
 
@@ -262,6 +313,23 @@ private:
 
 
 MessageServer* createServer(const MessageServer::Options& opts, MessageHandler* handler) {
+    if (serviceExecutor == "epoll") {
+#ifdef __linux__
+#ifdef MONGO_CONFIG_SSL
+        // A message may sit decrypted in the SSL layer with nothing left on the socket, which
+        // epoll would never report.
+        if (sslGlobalParams.sslMode.load() != SSLParams::SSLMode_disabled) {
+            warning() << "serviceExecutor \"epoll\" does not support SSL, "
+                      << "using a thread per connection";
+            return new PortMessageServer(opts, handler);
+        }
+#endif
+        return createEpollServer(opts, handler, serviceExecutorWorkers);
+#else
+        warning() << "serviceExecutor \"epoll\" is only available on Linux, "
+                  << "using a thread per connection";
+#endif
+    }
     return new PortMessageServer(opts, handler);
 }
 